@@ -0,0 +1,552 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Runs the torrent poll (dispatch() into trg_torrent_model_update()) against
+ * the mock daemon, at a few torrent counts, and prints the timings.
+ *
+ *   make trg-benchmark
+ *   ./trg-benchmark --torrents=1000,10000,100000 --cycles=20
+ *
+ * The mock daemon runs in this process by default, so its memory is in the
+ * RSS too. For client-only numbers, run "trg-benchmark --serve=9091 -t N"
+ * in one terminal and "trg-benchmark --connect=9091" in another.
+ *
+ * --replay runs a recording (see trg-record.c) through the parser, the
+ * torrent model and the state selector with no network, so the same
+ * traffic can be timed before and after a change:
+ *
+ *   TRG_RECORD=poll.trgrec transmission-remote-gtk
+ *   ./trg-benchmark --replay=poll.trgrec
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+#include <curl/curl.h>
+
+#if defined(HAVE_MALLINFO2) || defined(HAVE_MALLINFO)
+#include <malloc.h>
+#endif
+#ifndef G_OS_WIN32
+#include <sys/resource.h>
+#endif
+
+#include "protocol-constants.h"
+#include "requests.h"
+#include "json.h"
+#include "trg-prefs.h"
+#include "trg-client.h"
+#include "trg-diagnostics.h"
+#include "trg-torrent-model.h"
+#include "trg-state-selector.h"
+#include "trg-record.h"
+#include "mock-daemon.h"
+
+#define BENCHMARK_METHOD_CYCLE "cycle"
+
+static gchar *opt_torrents = "1000,10000,100000";
+static gint opt_cycles = 20;
+static gint opt_files = 4;
+static gint opt_peers = 8;
+static gint opt_trackers = 2;
+static gdouble opt_churn = 0.05;
+static gint opt_addremove = 1;
+static gint opt_serve = -1;
+static gint opt_connect = -1;
+static gchar *opt_replay = NULL;
+static gboolean opt_quiet = FALSE;
+
+static GOptionEntry entries[] = {
+    {"torrents", 't', 0, G_OPTION_ARG_STRING, &opt_torrents,
+     "Comma separated torrent counts", "N,..."},
+    {"cycles", 'c', 0, G_OPTION_ARG_INT, &opt_cycles,
+     "Update polls per torrent count", "N"},
+    {"files", 0, 0, G_OPTION_ARG_INT, &opt_files,
+     "Files per torrent", "N"},
+    {"peers", 0, 0, G_OPTION_ARG_INT, &opt_peers,
+     "Peers per active torrent", "N"},
+    {"trackers", 0, 0, G_OPTION_ARG_INT, &opt_trackers,
+     "Trackers per torrent", "N"},
+    {"churn", 0, 0, G_OPTION_ARG_DOUBLE, &opt_churn,
+     "Fraction of torrents active per poll", "F"},
+    {"addremove", 0, 0, G_OPTION_ARG_INT, &opt_addremove,
+     "Torrents added and removed per poll", "N"},
+    {"serve", 0, 0, G_OPTION_ARG_INT, &opt_serve,
+     "Only run the mock daemon, on this port", "PORT"},
+    {"connect", 0, 0, G_OPTION_ARG_INT, &opt_connect,
+     "Benchmark a mock daemon already running on this port", "PORT"},
+    {"replay", 0, 0, G_OPTION_ARG_FILENAME, &opt_replay,
+     "Replay an RPC recording instead", "FILE"},
+    {"quiet", 'q', 0, G_OPTION_ARG_NONE, &opt_quiet,
+     "Only print the summaries", NULL},
+    {NULL}
+};
+
+/* Bytes the allocator has handed out, or 0 where that can't be had. GLib
+ * can no longer count its own allocations, so growth per cycle is the
+ * stand-in. */
+static gint64 benchmark_heap_in_use(void)
+{
+#if defined(HAVE_MALLINFO2)
+    struct mallinfo2 mi = mallinfo2();
+    return (gint64) (mi.uordblks + mi.hblkhd);
+#elif defined(HAVE_MALLINFO)
+    struct mallinfo mi = mallinfo();
+    return (gint64) mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/* KiB, the process lifetime peak. */
+static glong benchmark_peak_rss(void)
+{
+#ifndef G_OS_WIN32
+    struct rusage usage;
+
+    if (!getrusage(RUSAGE_SELF, &usage))
+        return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+static trg_response *benchmark_dispatch(TrgClient * tc, JsonNode * node)
+{
+    trg_request req;
+    trg_response *rsp;
+
+    memset(&req, 0, sizeof(req));
+    req.node = node;
+
+    rsp = dispatch(tc, &req);
+
+    json_node_free(req.node);
+    g_free(req.body);
+
+    return rsp;
+}
+
+static gboolean benchmark_connect(TrgClient * tc, guint16 port)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(tc);
+    trg_response *rsp;
+
+    /* Only the in-memory profile, nothing is saved. */
+    trg_prefs_set_string(prefs, TRG_PREFS_KEY_HOSTNAME, "127.0.0.1",
+                         TRG_PREFS_PROFILE);
+    trg_prefs_set_int(prefs, TRG_PREFS_KEY_PORT, port, TRG_PREFS_PROFILE);
+    trg_prefs_set_string(prefs, TRG_PREFS_KEY_RPC_URL_PATH,
+                         MOCK_DAEMON_RPC_PATH, TRG_PREFS_PROFILE);
+    trg_prefs_set_bool(prefs, TRG_PREFS_KEY_SSL, FALSE, TRG_PREFS_PROFILE);
+    trg_prefs_set_string(prefs, TRG_PREFS_KEY_USERNAME, "",
+                         TRG_PREFS_PROFILE);
+    trg_prefs_set_string(prefs, TRG_PREFS_KEY_PASSWORD, "",
+                         TRG_PREFS_PROFILE);
+
+    if (trg_client_populate_with_settings(tc) != 0)
+        return FALSE;
+
+    trg_client_inc_connid(tc);
+
+    rsp = benchmark_dispatch(tc, session_get());
+    if (rsp->status != CURLE_OK) {
+        g_printerr("session-get failed: %d\n", rsp->status);
+        trg_response_free(rsp);
+        return FALSE;
+    }
+
+    trg_client_set_session(tc, get_arguments(rsp->obj));
+    trg_response_free(rsp);
+
+    return TRUE;
+}
+
+static void
+benchmark_print_metric(trg_diagnostics * diag, const gchar * method,
+                       trg_diag_metric metric, const gchar * label)
+{
+    trg_diag_histogram h;
+    gdouble scale = trg_diag_metric_is_time(metric) ? 1000.0 : 1024.0;
+
+    if (!trg_diagnostics_get(diag, method, metric, &h))
+        return;
+
+    g_print("  %-10s mean %10.2f  p50 %10.2f  p90 %10.2f  max %10.2f %s\n",
+            label, (h.sum / (gdouble) h.count) / scale,
+            trg_diag_histogram_percentile(&h, 0.5) / scale,
+            trg_diag_histogram_percentile(&h, 0.9) / scale,
+            h.max / scale, trg_diag_metric_is_time(metric) ? "ms" : "KiB");
+}
+
+static void benchmark_run(TrgClient * tc)
+{
+    TrgTorrentModel *model = trg_torrent_model_new();
+    trg_diagnostics *diag = trg_diagnostics_new();
+    gint64 heap_start = benchmark_heap_in_use();
+    gint cycle;
+
+    trg_client_set_torrent_table(tc, get_torrent_table(model));
+
+    for (cycle = 0; cycle <= opt_cycles; cycle++) {
+        gboolean first = cycle == 0;
+        const gchar *method = first ? "first" : BENCHMARK_METHOD_CYCLE;
+        gint64 heap_before = benchmark_heap_in_use();
+        gint64 apply;
+        trg_response *rsp;
+        guint rows;
+
+        rsp = benchmark_dispatch(tc,
+                                 torrent_get(tc,
+                                             first ?
+                                             TORRENT_GET_TAG_MODE_FULL :
+                                             TORRENT_GET_TAG_MODE_UPDATE));
+
+        if (rsp->status != CURLE_OK) {
+            g_printerr("torrent-get failed: %d\n", rsp->status);
+            trg_response_free(rsp);
+            break;
+        }
+
+        /* The later polls are for the recently active torrents only, so
+         * are applied as the main window applies them, not as the whole
+         * list. */
+        trg_client_inc_serial(tc);
+        apply = g_get_monotonic_time();
+        trg_torrent_model_update(model, tc, rsp->obj,
+                                 first ? TORRENT_GET_MODE_FIRST :
+                                 TORRENT_GET_MODE_ACTIVE);
+        apply = g_get_monotonic_time() - apply;
+
+        /* Known once loaded, as a real daemon has however many it has. */
+        if (first) {
+            g_print("%d torrents, %d cycles\n",
+                    trg_torrent_model_get_stats(model)->count, opt_cycles);
+
+            if (!opt_quiet)
+                g_print("%6s %8s %10s %10s %10s %10s %12s\n", "cycle",
+                        "rows", "bytes", "fetch ms", "parse ms",
+                        "apply ms", "heap delta");
+        }
+
+        rows = get_torrents_count(get_arguments(rsp->obj));
+
+        trg_diagnostics_record_response(diag, method, rsp);
+        trg_diagnostics_record(diag, method, TRG_DIAG_APPLY, apply);
+
+        if (!opt_quiet)
+            g_print("%6d %8u %10d %10.2f %10.2f %10.2f %12"
+                    G_GINT64_FORMAT "\n", cycle, rows, rsp->size,
+                    rsp->rtt * 1000.0, rsp->parse_time / 1000.0,
+                    apply / 1000.0, benchmark_heap_in_use() - heap_before);
+
+        trg_response_free(rsp);
+    }
+
+    g_print(" first poll:\n");
+    benchmark_print_metric(diag, "first", TRG_DIAG_TOTAL, "fetch");
+    benchmark_print_metric(diag, "first", TRG_DIAG_PARSE, "parse");
+    benchmark_print_metric(diag, "first", TRG_DIAG_APPLY, "apply");
+    benchmark_print_metric(diag, "first", TRG_DIAG_BYTES, "size");
+    g_print(" update polls:\n");
+    benchmark_print_metric(diag, BENCHMARK_METHOD_CYCLE, TRG_DIAG_TOTAL,
+                           "fetch");
+    benchmark_print_metric(diag, BENCHMARK_METHOD_CYCLE, TRG_DIAG_PARSE,
+                           "parse");
+    benchmark_print_metric(diag, BENCHMARK_METHOD_CYCLE, TRG_DIAG_APPLY,
+                           "apply");
+    benchmark_print_metric(diag, BENCHMARK_METHOD_CYCLE, TRG_DIAG_BYTES,
+                           "size");
+    g_print(" heap growth %" G_GINT64_FORMAT " KiB, peak RSS %ld KiB\n\n",
+            (benchmark_heap_in_use() - heap_start) / 1024,
+            benchmark_peak_rss());
+
+    trg_diagnostics_free(diag);
+    trg_torrent_model_remove_all(model);
+    trg_client_set_torrent_table(tc, NULL);
+    g_object_unref(model);
+}
+
+/* The torrent model mode the main window would have used for this
+ * torrent-get, or -1 for one it doesn't apply to the list. */
+static gint benchmark_replay_mode(JsonObject * args, gboolean first)
+{
+    JsonNode *ids = args ? json_object_get_member(args, PARAM_IDS) : NULL;
+
+    if (!ids)
+        return first ? TORRENT_GET_MODE_FIRST : TORRENT_GET_MODE_UPDATE;
+    else if (JSON_NODE_HOLDS_VALUE(ids))
+        return TORRENT_GET_MODE_ACTIVE;
+    else if (first)
+        return -1;
+    else
+        return TORRENT_GET_MODE_INTERACTION;
+}
+
+static void
+benchmark_replay_apply(TrgClient * tc, TrgTorrentModel * model,
+                       trg_diagnostics * diag, const gchar * request,
+                       trg_record_entry * entry, gboolean * first)
+{
+    JsonObject *reqObj = NULL, *args = NULL;
+    const gchar *method = NULL;
+    GError *error = NULL;
+    JsonParser *parser;
+    trg_response rsp;
+    gint64 start;
+
+    parser = json_parser_new();
+    if (request && json_parser_load_from_data(parser, request, -1, NULL)
+        && JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser))) {
+        reqObj = json_node_get_object(json_parser_get_root(parser));
+        method = json_object_get_string_member(reqObj, PARAM_METHOD);
+        if (json_object_has_member(reqObj, PARAM_ARGUMENTS))
+            args = json_object_get_object_member(reqObj, PARAM_ARGUMENTS);
+    }
+
+    if (!method || entry->status != CURLE_OK || !entry->len) {
+        g_object_unref(parser);
+        return;
+    }
+
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.raw = entry->data;
+    rsp.size = entry->len;
+
+    start = g_get_monotonic_time();
+    rsp.obj = trg_deserialize(&rsp, &error);
+    trg_diagnostics_record(diag, method, TRG_DIAG_PARSE,
+                           g_get_monotonic_time() - start);
+    trg_diagnostics_record(diag, method, TRG_DIAG_BYTES, entry->len);
+
+    if (!rsp.obj) {
+        g_printerr("seq %u: %s\n", entry->seq,
+                   error ? error->message : "no JSON object");
+        g_clear_error(&error);
+        g_object_unref(parser);
+        return;
+    }
+
+    if (!g_strcmp0(method, METHOD_SESSION_GET)) {
+        trg_client_set_session(tc, get_arguments(rsp.obj));
+    } else if (!g_strcmp0(method, METHOD_TORRENT_GET)) {
+        gint mode = benchmark_replay_mode(args, *first);
+
+        if (mode >= 0) {
+            trg_client_inc_serial(tc);
+            start = g_get_monotonic_time();
+            trg_torrent_model_update(model, tc, rsp.obj, mode);
+            trg_diagnostics_record(diag, method, TRG_DIAG_APPLY,
+                                   g_get_monotonic_time() - start);
+            *first = FALSE;
+        }
+    }
+
+    json_object_unref(rsp.obj);
+    g_object_unref(parser);
+}
+
+static int benchmark_replay(TrgClient * tc, gboolean have_display)
+{
+    TrgTorrentModel *model = trg_torrent_model_new();
+    trg_diagnostics *diag = trg_diagnostics_new();
+    TrgStateSelector *selector = NULL;
+    trg_torrent_model_update_stats *stats;
+    trg_record_reader *reader;
+    trg_record_entry entry;
+    GError *error = NULL;
+    gchar *request = NULL;
+    guint requestSeq = 0;
+    gboolean first = TRUE;
+    GList *methods, *li;
+    guint exchanges = 0;
+
+    reader = trg_record_reader_open(opt_replay, &error);
+    if (!reader) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return EXIT_FAILURE;
+    }
+
+    trg_client_set_torrent_table(tc, get_torrent_table(model));
+
+    /* A widget, so it needs a display. */
+    if (have_display)
+        selector = trg_state_selector_new(tc, model);
+    else
+        g_printerr("No display, replaying without the state selector\n");
+
+    while (trg_record_reader_next(reader, &entry, &error)) {
+        if (entry.kind == TRG_RECORD_REQUEST) {
+            g_free(request);
+            request = g_strdup(entry.data);
+            requestSeq = entry.seq;
+        } else if (entry.kind == TRG_RECORD_RESPONSE && request
+                   && entry.seq == requestSeq) {
+            benchmark_replay_apply(tc, model, diag, request, &entry,
+                                   &first);
+            g_free(request);
+            request = NULL;
+            exchanges++;
+        }
+
+        trg_record_entry_clear(&entry);
+    }
+
+    /* Likely a log from a client that didn't exit cleanly. */
+    if (error) {
+        g_printerr("%s, replayed what came before\n", error->message);
+        g_error_free(error);
+    }
+
+    g_print("%u exchanges replayed from %s\n", exchanges, opt_replay);
+
+    methods = trg_diagnostics_get_methods(diag);
+    for (li = methods; li; li = g_list_next(li)) {
+        g_print(" %s:\n", (gchar *) li->data);
+        benchmark_print_metric(diag, li->data, TRG_DIAG_PARSE, "parse");
+        benchmark_print_metric(diag, li->data, TRG_DIAG_APPLY, "apply");
+        benchmark_print_metric(diag, li->data, TRG_DIAG_BYTES, "size");
+    }
+    g_list_free_full(methods, g_free);
+
+    /* The same recording should always end up here. */
+    stats = trg_torrent_model_get_stats(model);
+    g_print(" final: %d torrents, %d downloading, %d seeding, %d paused, "
+            "%d checking, %d errored\n", stats->count, stats->down,
+            stats->seeding, stats->paused, stats->checking, stats->error);
+    g_print(" heap %" G_GINT64_FORMAT " KiB, peak RSS %ld KiB\n",
+            benchmark_heap_in_use() / 1024, benchmark_peak_rss());
+
+    g_free(request);
+    trg_record_reader_close(reader);
+    trg_diagnostics_free(diag);
+    if (selector)
+        gtk_widget_destroy(GTK_WIDGET(selector));
+    trg_torrent_model_remove_all(model);
+    trg_client_set_torrent_table(tc, NULL);
+    g_object_unref(model);
+
+    return EXIT_SUCCESS;
+}
+
+static void benchmark_config(mock_daemon_config * config, guint torrents)
+{
+    mock_daemon_config_init(config);
+    config->torrents = torrents;
+    config->files = opt_files;
+    config->peers = opt_peers;
+    config->trackers = opt_trackers;
+    config->churn = opt_churn;
+    config->addremove = opt_addremove;
+}
+
+static int benchmark_serve(void)
+{
+    mock_daemon_config config;
+    GError *error = NULL;
+    mock_daemon *md;
+    GMainLoop *loop;
+
+    benchmark_config(&config, strtoul(opt_torrents, NULL, 10));
+
+    md = mock_daemon_start(&config, opt_serve, &error);
+    if (!md) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return EXIT_FAILURE;
+    }
+
+    g_print("Serving %u torrents on http://127.0.0.1:%u%s\n",
+            config.torrents, mock_daemon_get_port(md),
+            MOCK_DAEMON_RPC_PATH);
+
+    loop = g_main_loop_new(NULL, FALSE);
+    g_main_loop_run(loop);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    GOptionContext *context =
+        g_option_context_new("- benchmark the torrent poll");
+    GError *error = NULL;
+    gboolean have_display;
+    TrgClient *tc;
+    gchar **sizes;
+    guint i;
+
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(context);
+
+    if (opt_serve >= 0)
+        return benchmark_serve();
+
+    /* The model doesn't need a display, but GTK wants initialising. */
+    have_display = gtk_init_check(&argc, &argv);
+    curl_global_init(CURL_GLOBAL_ALL);
+    tc = trg_client_new();
+
+    if (opt_replay)
+        return benchmark_replay(tc, have_display);
+
+    if (opt_connect > 0) {
+        if (!benchmark_connect(tc, opt_connect))
+            return EXIT_FAILURE;
+        benchmark_run(tc);
+        return EXIT_SUCCESS;
+    }
+
+    sizes = g_strsplit(opt_torrents, ",", -1);
+
+    for (i = 0; sizes[i]; i++) {
+        mock_daemon_config config;
+        mock_daemon *md;
+
+        benchmark_config(&config, strtoul(sizes[i], NULL, 10));
+
+        md = mock_daemon_start(&config, 0, &error);
+        if (!md) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+            break;
+        }
+
+        if (benchmark_connect(tc, mock_daemon_get_port(md)))
+            benchmark_run(tc);
+
+        mock_daemon_stop(md);
+    }
+
+    g_strfreev(sizes);
+    curl_global_cleanup();
+
+    return EXIT_SUCCESS;
+}
@@ -21,6 +21,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include <glib-object.h>
 #include <glib/gprintf.h>
 #include <json-glib/json-glib.h>
@@ -47,6 +49,28 @@ gchar *trg_serialize(JsonNode * req)
     return response;
 }
 
+/* Serialise req, which has the string placeholder as a value somewhere, into
+ * the text before and after that value (its quotes included), so something
+ * else can be put in its place. FALSE if it isn't there. */
+gboolean
+trg_serialize_around(JsonNode * req, const gchar * placeholder,
+                     gchar ** before, gchar ** after)
+{
+    gchar *json = trg_serialize(req);
+    gchar *quoted = g_strdup_printf("\"%s\"", placeholder);
+    gchar *marker = strstr(json, quoted);
+
+    if (marker) {
+        *before = g_strndup(json, marker - json);
+        *after = g_strdup(marker + strlen(quoted));
+    }
+
+    g_free(quoted);
+    g_free(json);
+
+    return marker != NULL;
+}
+
 JsonObject *trg_deserialize(trg_response * response, GError ** error)
 {
     JsonParser *parser;
@@ -85,6 +109,214 @@ JsonObject *trg_deserialize(trg_response * response, GError ** error)
     return ret;
 }
 
+/* An incremental parser, fed from the CURL write callback as the body
+ * arrives. Each element of arguments.torrents is parsed as soon as it
+ * closes and its text thrown away, so we never hold the whole body as well
+ * as the whole tree, and parsing overlaps the transfer. Everything else
+ * (the "envelope") is kept and parsed at the end, when the torrents are
+ * put back into it.
+ */
+
+#define TRG_JSON_STREAM_TORRENTS_DEPTH 3
+
+struct _trg_json_stream {
+    JsonParser *parser;
+    GString *envelope;
+    GString *element;
+    GString *token;
+    gchar *keys[TRG_JSON_STREAM_TORRENTS_DEPTH];
+    gint depth;
+    gboolean in_string;
+    gboolean escaped;
+    gboolean in_torrents;
+    JsonArray *torrents;
+    GError *error;
+};
+
+trg_json_stream *trg_json_stream_new(void)
+{
+    trg_json_stream *s = g_new0(trg_json_stream, 1);
+
+    s->parser = json_parser_new();
+    s->envelope = g_string_new(NULL);
+    s->element = g_string_new(NULL);
+    s->token = g_string_new(NULL);
+    s->torrents = json_array_new();
+
+    return s;
+}
+
+void trg_json_stream_reset(trg_json_stream * s)
+{
+    gint i;
+
+    g_string_truncate(s->envelope, 0);
+    g_string_truncate(s->element, 0);
+    g_string_truncate(s->token, 0);
+
+    for (i = 0; i < TRG_JSON_STREAM_TORRENTS_DEPTH; i++) {
+        g_free(s->keys[i]);
+        s->keys[i] = NULL;
+    }
+
+    s->depth = 0;
+    s->in_string = s->escaped = s->in_torrents = FALSE;
+
+    if (s->torrents)
+        json_array_unref(s->torrents);
+    s->torrents = json_array_new();
+
+    g_clear_error(&s->error);
+}
+
+void trg_json_stream_free(trg_json_stream * s)
+{
+    if (!s)
+        return;
+
+    trg_json_stream_reset(s);
+    json_array_unref(s->torrents);
+    g_object_unref(s->parser);
+    g_string_free(s->envelope, TRUE);
+    g_string_free(s->element, TRUE);
+    g_string_free(s->token, TRUE);
+    g_free(s);
+}
+
+static void trg_json_stream_emit(trg_json_stream * s)
+{
+    if (json_parser_load_from_data(s->parser, s->element->str,
+                                   s->element->len, &s->error))
+        json_array_add_element(s->torrents,
+                               json_node_copy(json_parser_get_root
+                                              (s->parser)));
+
+    g_string_truncate(s->element, 0);
+}
+
+/* Returns FALSE once the input is known to be bad. It's still safe to keep
+ * feeding (a 409 or other error page is read to the end), the error is
+ * reported by trg_json_stream_finish().
+ */
+gboolean
+trg_json_stream_feed(trg_json_stream * s, const gchar * data, gsize len)
+{
+    gsize i;
+
+    for (i = 0; i < len && !s->error; i++) {
+        gchar c = data[i];
+
+        /* Inside a torrent, just find where it ends. */
+        if (s->depth > TRG_JSON_STREAM_TORRENTS_DEPTH) {
+            g_string_append_c(s->element, c);
+            if (s->in_string) {
+                if (s->escaped)
+                    s->escaped = FALSE;
+                else if (c == '\\')
+                    s->escaped = TRUE;
+                else if (c == '"')
+                    s->in_string = FALSE;
+            } else if (c == '"') {
+                s->in_string = TRUE;
+            } else if (c == '{' || c == '[') {
+                s->depth++;
+            } else if ((c == '}' || c == ']')
+                       && --s->depth == TRG_JSON_STREAM_TORRENTS_DEPTH) {
+                trg_json_stream_emit(s);
+            }
+            continue;
+        }
+
+        /* Between torrents, leaving an empty array in the envelope. */
+        if (s->in_torrents) {
+            if (c == '{' || c == '[') {
+                g_string_append_c(s->element, c);
+                s->depth++;
+            } else if (c == ']') {
+                g_string_append_c(s->envelope, c);
+                s->in_torrents = FALSE;
+                s->depth--;
+            }
+            continue;
+        }
+
+        g_string_append_c(s->envelope, c);
+
+        if (s->in_string) {
+            if (s->escaped) {
+                s->escaped = FALSE;
+            } else if (c == '\\') {
+                s->escaped = TRUE;
+            } else if (c == '"') {
+                s->in_string = FALSE;
+                continue;
+            }
+            g_string_append_c(s->token, c);
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            s->in_string = TRUE;
+            g_string_truncate(s->token, 0);
+            break;
+        case ':':
+            if (s->depth > 0 && s->depth < TRG_JSON_STREAM_TORRENTS_DEPTH) {
+                g_free(s->keys[s->depth]);
+                s->keys[s->depth] = g_strdup(s->token->str);
+            }
+            break;
+        case '{':
+        case '[':
+            s->depth++;
+            if (c == '[' && s->depth == TRG_JSON_STREAM_TORRENTS_DEPTH
+                && !g_strcmp0(s->keys[1], PARAM_ARGUMENTS)
+                && !g_strcmp0(s->keys[2], FIELD_TORRENTS))
+                s->in_torrents = TRUE;
+            break;
+        case '}':
+        case ']':
+            if (s->depth > 0 && s->depth < TRG_JSON_STREAM_TORRENTS_DEPTH) {
+                g_free(s->keys[s->depth]);
+                s->keys[s->depth] = NULL;
+            }
+            s->depth--;
+            break;
+        }
+    }
+
+    return s->error == NULL;
+}
+
+JsonObject *trg_json_stream_finish(trg_json_stream * s, GError ** error)
+{
+    JsonObject *ret, *args;
+
+    if (s->error) {
+        g_propagate_error(error, s->error);
+        s->error = NULL;
+        return NULL;
+    }
+
+    if (!json_parser_load_from_data(s->parser, s->envelope->str,
+                                    s->envelope->len, error))
+        return NULL;
+
+    ret = json_node_get_object(json_parser_get_root(s->parser));
+    json_object_ref(ret);
+
+    if (json_object_has_member(ret, PARAM_ARGUMENTS)) {
+        args = get_arguments(ret);
+        if (json_object_has_member(args, FIELD_TORRENTS)) {
+            json_object_set_array_member(args, FIELD_TORRENTS,
+                                         s->torrents);
+            s->torrents = NULL;
+        }
+    }
+
+    return ret;
+}
+
 JsonObject *node_get_arguments(JsonNode * req)
 {
     JsonObject *rootObj = json_node_get_object(req);
@@ -115,3 +347,26 @@ gdouble json_node_really_get_double(JsonNode * node)
         return 0.0;
     }
 }
+
+/* Whether two value nodes hold the same value. Objects and arrays are
+ * never considered equal, as nothing compares those yet. */
+gboolean json_node_value_equal(JsonNode * a, JsonNode * b)
+{
+    if (JSON_NODE_TYPE(a) != JSON_NODE_VALUE
+        || JSON_NODE_TYPE(b) != JSON_NODE_VALUE
+        || json_node_get_value_type(a) != json_node_get_value_type(b))
+        return FALSE;
+
+    switch (json_node_get_value_type(a)) {
+    case G_TYPE_INT64:
+        return json_node_get_int(a) == json_node_get_int(b);
+    case G_TYPE_DOUBLE:
+        return json_node_get_double(a) == json_node_get_double(b);
+    case G_TYPE_BOOLEAN:
+        return json_node_get_boolean(a) == json_node_get_boolean(b);
+    case G_TYPE_STRING:
+        return !g_strcmp0(json_node_get_string(a), json_node_get_string(b));
+    default:
+        return FALSE;
+    }
+}
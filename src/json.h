@@ -26,10 +26,20 @@
 #include "trg-client.h"
 
 gchar *trg_serialize(JsonNode * req);
+gboolean trg_serialize_around(JsonNode * req, const gchar * placeholder,
+                              gchar ** before, gchar ** after);
 JsonObject *trg_deserialize(trg_response * response, GError ** error);
 JsonObject *get_arguments(JsonObject * req);
 JsonObject *node_get_arguments(JsonNode * req);
 gdouble json_double_to_progress(JsonNode * n);
 gdouble json_node_really_get_double(JsonNode * node);
+gboolean json_node_value_equal(JsonNode * a, JsonNode * b);
+
+trg_json_stream *trg_json_stream_new(void);
+void trg_json_stream_reset(trg_json_stream * s);
+void trg_json_stream_free(trg_json_stream * s);
+gboolean trg_json_stream_feed(trg_json_stream * s, const gchar * data,
+                              gsize len);
+JsonObject *trg_json_stream_finish(trg_json_stream * s, GError ** error);
 
 #endif                          /* JSON_H_ */
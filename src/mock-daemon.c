@@ -0,0 +1,1032 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <json-glib/json-glib.h>
+
+#include "protocol-constants.h"
+#include "session-get.h"
+#include "mock-daemon.h"
+
+/* Every connection gets a blocking thread, which is plenty for one client.
+ * The torrents are only changed when a "recently-active" poll comes in, so
+ * each update cycle sees the configured amount of churn. */
+
+#define MOCK_SESSION_HEADER "X-Transmission-Session-Id"
+#define MOCK_RECV_CHUNK 65536
+
+static const gchar *mock_dirs[] = {
+    "/downloads",
+    "/downloads/complete",
+    "/downloads/movies",
+    "/downloads/music",
+    "/srv/torrents/linux"
+};
+
+static const gchar *mock_words[] = {
+    "ubuntu", "debian", "fedora", "arch", "mint", "server", "desktop",
+    "amd64", "i386", "dvd", "netinst", "live", "source", "docs"
+};
+
+typedef struct {
+    gint64 id;
+    gchar *name;
+    gchar hash[41];
+    gint64 totalSize;
+    gdouble percentDone;
+    gint64 rateDownload;
+    gint64 rateUpload;
+    gint status;
+    gint64 addedDate;
+    gint64 activityDate;
+    gint64 doneDate;
+    gint64 queuePosition;
+    gint64 uploadedEver;
+    gint64 downloadedEver;
+    gint64 bandwidthPriority;
+    gint64 downloadLimit;
+    gint64 uploadLimit;
+    gboolean downloadLimited;
+    gboolean uploadLimited;
+    gboolean honorsSessionLimits;
+    gdouble seedRatioLimit;
+    gint64 seedRatioMode;
+    gint64 peerLimit;
+    guint dir;
+    gint64 error;
+    gboolean recent;
+} mock_torrent;
+
+typedef struct {
+    mock_daemon *md;
+    GSocket *socket;
+    GThread *thread;
+} mock_connection;
+
+struct _mock_daemon {
+    mock_daemon_config config;
+    GSocket *listener;
+    guint16 port;
+    GCancellable *cancellable;
+    GThread *acceptThread;
+    GMutex lock;
+    GPtrArray *torrents;
+    GHashTable *byId;
+    GArray *removed;
+    gint64 nextId;
+    GRand *rand;
+    gchar *sessionId;
+    GList *connections;
+    gint requests;
+};
+
+void mock_daemon_config_init(mock_daemon_config * config)
+{
+    config->torrents = 1000;
+    config->files = 4;
+    config->peers = 8;
+    config->trackers = 2;
+    config->churn = 0.05;
+    config->addremove = 1;
+    config->seed = 1;
+}
+
+static JsonNode *int_node(gint64 value)
+{
+    JsonNode *node = json_node_new(JSON_NODE_VALUE);
+    json_node_set_int(node, value);
+    return node;
+}
+
+static JsonNode *double_node(gdouble value)
+{
+    JsonNode *node = json_node_new(JSON_NODE_VALUE);
+    json_node_set_double(node, value);
+    return node;
+}
+
+static JsonNode *bool_node(gboolean value)
+{
+    JsonNode *node = json_node_new(JSON_NODE_VALUE);
+    json_node_set_boolean(node, value);
+    return node;
+}
+
+static JsonNode *string_node(const gchar * value)
+{
+    JsonNode *node = json_node_new(JSON_NODE_VALUE);
+    json_node_set_string(node, value);
+    return node;
+}
+
+static JsonNode *take_string_node(gchar * value)
+{
+    JsonNode *node = string_node(value);
+    g_free(value);
+    return node;
+}
+
+static JsonNode *array_node(JsonArray * array)
+{
+    JsonNode *node = json_node_new(JSON_NODE_ARRAY);
+    json_node_take_array(node, array);
+    return node;
+}
+
+static JsonNode *object_node(JsonObject * obj)
+{
+    JsonNode *node = json_node_new(JSON_NODE_OBJECT);
+    json_node_take_object(node, obj);
+    return node;
+}
+
+static void mock_torrent_randomise_rates(mock_daemon * md,
+                                         mock_torrent * t)
+{
+    if (t->status == TR_STATUS_DOWNLOAD) {
+        t->rateDownload = g_rand_int_range(md->rand, 0, 4 * 1024 * 1024);
+        t->percentDone += g_rand_double_range(md->rand, 0.0, 0.02);
+        if (t->percentDone >= 1.0) {
+            t->percentDone = 1.0;
+            t->status = TR_STATUS_SEED;
+            t->rateDownload = 0;
+            t->doneDate = time(NULL);
+        }
+        t->downloadedEver = (gint64) (t->totalSize * t->percentDone);
+    } else {
+        t->rateDownload = 0;
+    }
+
+    if (t->status == TR_STATUS_SEED || t->status == TR_STATUS_DOWNLOAD) {
+        t->rateUpload = g_rand_int_range(md->rand, 0, 1024 * 1024);
+        t->uploadedEver += t->rateUpload;
+    } else {
+        t->rateUpload = 0;
+    }
+}
+
+static mock_torrent *mock_torrent_new(mock_daemon * md)
+{
+    mock_torrent *t = g_new0(mock_torrent, 1);
+    gint roll = g_rand_int_range(md->rand, 0, 100);
+    guint i;
+
+    t->id = md->nextId++;
+    t->name = g_strdup_printf("%s-%s-%" G_GINT64_FORMAT ".iso",
+                              mock_words[g_rand_int_range
+                                         (md->rand, 0,
+                                          G_N_ELEMENTS(mock_words))],
+                              mock_words[g_rand_int_range
+                                         (md->rand, 0,
+                                          G_N_ELEMENTS(mock_words))],
+                              t->id);
+    for (i = 0; i < 40; i++)
+        t->hash[i] = "0123456789abcdef"[g_rand_int_range(md->rand, 0, 16)];
+
+    t->totalSize = (gint64) g_rand_int_range(md->rand, 10, 50 * 1024)
+        * 1024 * 1024;
+    t->addedDate = time(NULL) - g_rand_int_range(md->rand, 0, 86400 * 365);
+    t->activityDate = t->addedDate;
+    t->queuePosition = md->torrents->len;
+    t->dir = g_rand_int_range(md->rand, 0, G_N_ELEMENTS(mock_dirs));
+    t->honorsSessionLimits = TRUE;
+    t->seedRatioLimit = 2.0;
+    t->peerLimit = 50;
+    t->error = roll == 0 ? 2 : 0;
+
+    if (roll < 50) {
+        t->status = TR_STATUS_SEED;
+        t->percentDone = 1.0;
+        t->doneDate = t->addedDate + 3600;
+    } else if (roll < 75) {
+        t->status = TR_STATUS_STOPPED;
+        t->percentDone = g_rand_double(md->rand);
+    } else if (roll < 95) {
+        t->status = TR_STATUS_DOWNLOAD;
+        t->percentDone = g_rand_double(md->rand);
+    } else {
+        t->status = TR_STATUS_DOWNLOAD_WAIT;
+        t->percentDone = 0.0;
+    }
+
+    t->downloadedEver = (gint64) (t->totalSize * t->percentDone);
+    mock_torrent_randomise_rates(md, t);
+
+    g_ptr_array_add(md->torrents, t);
+    g_hash_table_insert(md->byId, &t->id, t);
+
+    return t;
+}
+
+static void mock_torrent_free(mock_torrent * t)
+{
+    g_free(t->name);
+    g_free(t);
+}
+
+static JsonArray *mock_torrent_files(mock_daemon * md, mock_torrent * t)
+{
+    JsonArray *files = json_array_new();
+    gint64 length = t->totalSize / MAX(md->config.files, 1);
+    guint i;
+
+    for (i = 0; i < md->config.files; i++) {
+        JsonObject *f = json_object_new();
+        json_object_set_member(f, TFILE_NAME,
+                               take_string_node(g_strdup_printf
+                                                ("%s/part-%03u.bin",
+                                                 t->name, i)));
+        json_object_set_int_member(f, TFILE_LENGTH, length);
+        json_object_set_int_member(f, TFILE_BYTES_COMPLETED,
+                                   (gint64) (length * t->percentDone));
+        json_array_add_object_element(files, f);
+    }
+
+    return files;
+}
+
+static JsonArray *mock_torrent_int_per_file(mock_daemon * md, gint64 value)
+{
+    JsonArray *array = json_array_new();
+    guint i;
+
+    for (i = 0; i < md->config.files; i++)
+        json_array_add_int_element(array, value);
+
+    return array;
+}
+
+static JsonArray *mock_torrent_peers(mock_daemon * md, mock_torrent * t)
+{
+    JsonArray *peers = json_array_new();
+    guint i;
+
+    if (t->status != TR_STATUS_DOWNLOAD && t->status != TR_STATUS_SEED)
+        return peers;
+
+    for (i = 0; i < md->config.peers; i++) {
+        JsonObject *p = json_object_new();
+        json_object_set_member(p, TPEER_ADDRESS,
+                               take_string_node(g_strdup_printf
+                                                ("10.%u.%u.%u",
+                                                 (guint) (t->id >> 8) &
+                                                 0xff,
+                                                 (guint) t->id & 0xff,
+                                                 i + 1)));
+        json_object_set_int_member(p, "port", 51413 + i);
+        json_object_set_string_member(p, TPEER_CLIENT_NAME,
+                                      "Transmission 2.94");
+        json_object_set_double_member(p, TPEER_PROGRESS,
+                                      (gdouble) i / md->config.peers);
+        json_object_set_int_member(p, TPEER_RATE_TO_CLIENT,
+                                   t->rateDownload / md->config.peers);
+        json_object_set_int_member(p, TPEER_RATE_TO_PEER,
+                                   t->rateUpload / md->config.peers);
+        json_object_set_boolean_member(p, TPEER_IS_ENCRYPTED, i % 2);
+        json_object_set_boolean_member(p, TPEER_IS_DOWNLOADING_FROM,
+                                       t->rateDownload > 0);
+        json_object_set_boolean_member(p, TPEER_IS_UPLOADING_TO,
+                                       t->rateUpload > 0);
+        json_object_set_string_member(p, TPEER_FLAGSTR, "DEI");
+        json_array_add_object_element(peers, p);
+    }
+
+    return peers;
+}
+
+static JsonArray *mock_torrent_trackers(mock_daemon * md,
+                                        mock_torrent * t)
+{
+    JsonArray *trackers = json_array_new();
+    guint i;
+
+    for (i = 0; i < md->config.trackers; i++) {
+        JsonObject *tr = json_object_new();
+        guint host = (guint) ((t->id + i) % 7);
+
+        json_object_set_int_member(tr, FIELD_ID, i);
+        json_object_set_int_member(tr, FIELD_TIER, i);
+        json_object_set_member(tr, FIELD_ANNOUNCE,
+                               take_string_node(g_strdup_printf
+                                                ("http://tracker%u.example.org:6969/announce",
+                                                 host)));
+        json_object_set_member(tr, FIELD_SCRAPE,
+                               take_string_node(g_strdup_printf
+                                                ("http://tracker%u.example.org:6969/scrape",
+                                                 host)));
+        json_object_set_member(tr, FIELD_HOST,
+                               take_string_node(g_strdup_printf
+                                                ("http://tracker%u.example.org:6969",
+                                                 host)));
+        json_object_set_int_member(tr, FIELD_LAST_ANNOUNCE_PEER_COUNT,
+                                   md->config.peers);
+        json_object_set_int_member(tr, FIELD_LAST_ANNOUNCE_TIME,
+                                   t->activityDate);
+        json_object_set_int_member(tr, FIELD_LAST_SCRAPE_TIME,
+                                   t->activityDate);
+        json_object_set_int_member(tr, FIELD_SEEDERCOUNT,
+                                   (t->id * 7) % 500);
+        json_object_set_int_member(tr, FIELD_LEECHERCOUNT,
+                                   (t->id * 3) % 100);
+        json_object_set_int_member(tr, FIELD_DOWNLOADCOUNT,
+                                   (t->id * 11) % 5000);
+        json_object_set_string_member(tr, FIELD_LAST_ANNOUNCE_RESULT,
+                                      "Success");
+        json_array_add_object_element(trackers, tr);
+    }
+
+    return trackers;
+}
+
+static JsonNode *mock_torrent_field(mock_daemon * md, mock_torrent * t,
+                                    const gchar * field)
+{
+    gint64 left = (gint64) (t->totalSize * (1.0 - t->percentDone));
+    gboolean active = t->status == TR_STATUS_DOWNLOAD
+        || t->status == TR_STATUS_SEED;
+
+    if (!g_strcmp0(field, FIELD_ID))
+        return int_node(t->id);
+    else if (!g_strcmp0(field, FIELD_NAME))
+        return string_node(t->name);
+    else if (!g_strcmp0(field, FIELD_HASH_STRING))
+        return string_node(t->hash);
+    else if (!g_strcmp0(field, FIELD_STATUS))
+        return int_node(t->status);
+    else if (!g_strcmp0(field, FIELD_PERCENTDONE))
+        return double_node(t->percentDone);
+    else if (!g_strcmp0(field, FIELD_METADATAPERCENTCOMPLETE))
+        return double_node(1.0);
+    else if (!g_strcmp0(field, FIELD_RECHECK_PROGRESS))
+        return double_node(0.0);
+    else if (!g_strcmp0(field, FIELD_TOTAL_SIZE)
+             || !g_strcmp0(field, FIELD_SIZEWHENDONE))
+        return int_node(t->totalSize);
+    else if (!g_strcmp0(field, FIELD_LEFT_UNTIL_DONE))
+        return int_node(left);
+    else if (!g_strcmp0(field, FIELD_HAVEVALID))
+        return int_node(t->totalSize - left);
+    else if (!g_strcmp0(field, FIELD_HAVEUNCHECKED)
+             || !g_strcmp0(field, FIELD_CORRUPTEVER))
+        return int_node(0);
+    else if (!g_strcmp0(field, FIELD_RATEDOWNLOAD))
+        return int_node(t->rateDownload);
+    else if (!g_strcmp0(field, FIELD_RATEUPLOAD))
+        return int_node(t->rateUpload);
+    else if (!g_strcmp0(field, FIELD_ETA))
+        return int_node(t->rateDownload > 0 ? left / t->rateDownload : -1);
+    else if (!g_strcmp0(field, FIELD_UPLOADEDEVER))
+        return int_node(t->uploadedEver);
+    else if (!g_strcmp0(field, FIELD_DOWNLOADEDEVER))
+        return int_node(t->downloadedEver);
+    else if (!g_strcmp0(field, FIELD_ADDED_DATE)
+             || !g_strcmp0(field, FIELD_DATE_CREATED))
+        return int_node(t->addedDate);
+    else if (!g_strcmp0(field, FIELD_DONE_DATE))
+        return int_node(t->doneDate);
+    else if (!g_strcmp0(field, FIELD_ACTIVITY_DATE))
+        return int_node(t->activityDate);
+    else if (!g_strcmp0(field, FIELD_QUEUE_POSITION))
+        return int_node(t->queuePosition);
+    else if (!g_strcmp0(field, FIELD_DOWNLOAD_DIR))
+        return string_node(mock_dirs[t->dir]);
+    else if (!g_strcmp0(field, FIELD_ISFINISHED))
+        return bool_node(FALSE);
+    else if (!g_strcmp0(field, FIELD_ISPRIVATE))
+        return bool_node(t->id % 10 == 0);
+    else if (!g_strcmp0(field, FIELD_COMMENT))
+        return string_node("Synthesised by trg-benchmark");
+    else if (!g_strcmp0(field, FIELD_CREATOR))
+        return string_node("mock-daemon");
+    else if (!g_strcmp0(field, FIELD_MAGNETLINK))
+        return take_string_node(g_strdup_printf
+                                ("magnet:?xt=urn:btih:%s&dn=%s", t->hash,
+                                 t->name));
+    else if (!g_strcmp0(field, FIELD_ERROR))
+        return int_node(t->error);
+    else if (!g_strcmp0(field, FIELD_ERROR_STRING))
+        return string_node(t->error ? "Tracker gave HTTP response code 404"
+                           : "");
+    else if (!g_strcmp0(field, FIELD_BANDWIDTH_PRIORITY))
+        return int_node(t->bandwidthPriority);
+    else if (!g_strcmp0(field, FIELD_HONORS_SESSION_LIMITS))
+        return bool_node(t->honorsSessionLimits);
+    else if (!g_strcmp0(field, FIELD_UPLOAD_LIMIT))
+        return int_node(t->uploadLimit);
+    else if (!g_strcmp0(field, FIELD_UPLOAD_LIMITED))
+        return bool_node(t->uploadLimited);
+    else if (!g_strcmp0(field, FIELD_DOWNLOAD_LIMIT))
+        return int_node(t->downloadLimit);
+    else if (!g_strcmp0(field, FIELD_DOWNLOAD_LIMITED))
+        return bool_node(t->downloadLimited);
+    else if (!g_strcmp0(field, FIELD_SEED_RATIO_LIMIT))
+        return double_node(t->seedRatioLimit);
+    else if (!g_strcmp0(field, FIELD_SEED_RATIO_MODE))
+        return int_node(t->seedRatioMode);
+    else if (!g_strcmp0(field, FIELD_PEER_LIMIT))
+        return int_node(t->peerLimit);
+    else if (!g_strcmp0(field, FIELD_PEERS_CONNECTED))
+        return int_node(active ? md->config.peers : 0);
+    else if (!g_strcmp0(field, FIELD_PEERS_SENDING_TO_US))
+        return int_node(t->rateDownload > 0 ? md->config.peers / 2 : 0);
+    else if (!g_strcmp0(field, FIELD_PEERS_GETTING_FROM_US))
+        return int_node(t->rateUpload > 0 ? md->config.peers / 2 : 0);
+    else if (!g_strcmp0(field, FIELD_WEB_SEEDS_SENDING_TO_US))
+        return int_node(0);
+    else if (!g_strcmp0(field, FIELD_PEERSFROM)) {
+        JsonObject *from = json_object_new();
+        guint peers = active ? md->config.peers : 0;
+        json_object_set_int_member(from, TPEERFROM_FROMTRACKERS, peers);
+        json_object_set_int_member(from, TPEERFROM_FROMDHT, 0);
+        json_object_set_int_member(from, TPEERFROM_FROMPEX, 0);
+        json_object_set_int_member(from, TPEERFROM_FROMLTEP, 0);
+        json_object_set_int_member(from, TPEERFROM_FROMRESUME, 0);
+        json_object_set_int_member(from, TPEERFROM_FROMINCOMING, 0);
+        json_object_set_int_member(from, TPEERFROM_FROMLPD, 0);
+        return object_node(from);
+    } else if (!g_strcmp0(field, FIELD_FILE_COUNT))
+        return int_node(md->config.files);
+    else if (!g_strcmp0(field, FIELD_FILES))
+        return array_node(mock_torrent_files(md, t));
+    else if (!g_strcmp0(field, FIELD_WANTED))
+        return array_node(mock_torrent_int_per_file(md, 1));
+    else if (!g_strcmp0(field, FIELD_PRIORITIES))
+        return array_node(mock_torrent_int_per_file(md, TR_PRI_NORMAL));
+    else if (!g_strcmp0(field, FIELD_PEERS))
+        return array_node(mock_torrent_peers(md, t));
+    else if (!g_strcmp0(field, FIELD_TRACKER_STATS))
+        return array_node(mock_torrent_trackers(md, t));
+
+    return json_node_new(JSON_NODE_NULL);
+}
+
+static JsonObject *mock_session_get(mock_daemon * md)
+{
+    JsonObject *s = json_object_new();
+
+    json_object_set_string_member(s, SGET_VERSION, "2.94 (mock)");
+    json_object_set_int_member(s, SGET_RPC_VERSION,
+                               MOCK_DAEMON_RPC_VERSION);
+    json_object_set_int_member(s, SGET_RPC_VERSION_MINIMUM, 1);
+    json_object_set_string_member(s, SGET_DOWNLOAD_DIR, mock_dirs[0]);
+    json_object_set_int_member(s, SGET_DOWNLOAD_DIR_FREE_SPACE,
+                               G_GINT64_CONSTANT(1) << 40);
+    json_object_set_string_member(s, SGET_INCOMPLETE_DIR, "/downloads/tmp");
+    json_object_set_boolean_member(s, SGET_INCOMPLETE_DIR_ENABLED, FALSE);
+    json_object_set_boolean_member(s, SGET_BLOCKLIST_ENABLED, FALSE);
+    json_object_set_string_member(s, SGET_BLOCKLIST_URL, "");
+    json_object_set_int_member(s, SGET_BLOCKLIST_SIZE, 0);
+    json_object_set_boolean_member(s, SGET_DHT_ENABLED, TRUE);
+    json_object_set_boolean_member(s, SGET_LPD_ENABLED, FALSE);
+    json_object_set_boolean_member(s, SGET_PEX_ENABLED, TRUE);
+    json_object_set_string_member(s, SGET_ENCRYPTION, "preferred");
+    json_object_set_int_member(s, SGET_PEER_LIMIT_GLOBAL, 200);
+    json_object_set_int_member(s, SGET_PEER_LIMIT_PER_TORRENT, 50);
+    json_object_set_int_member(s, SGET_PEER_PORT, 51413);
+    json_object_set_boolean_member(s, SGET_PEER_PORT_RANDOM_ON_START,
+                                   FALSE);
+    json_object_set_boolean_member(s, SGET_PORT_FORWARDING_ENABLED, FALSE);
+    json_object_set_double_member(s, SGET_SEED_RATIO_LIMIT, 2.0);
+    json_object_set_boolean_member(s, SGET_SEED_RATIO_LIMITED, FALSE);
+    json_object_set_int_member(s, SGET_SPEED_LIMIT_DOWN, 100);
+    json_object_set_boolean_member(s, SGET_SPEED_LIMIT_DOWN_ENABLED, FALSE);
+    json_object_set_int_member(s, SGET_SPEED_LIMIT_UP, 100);
+    json_object_set_boolean_member(s, SGET_SPEED_LIMIT_UP_ENABLED, FALSE);
+    json_object_set_boolean_member(s, SGET_TRASH_ORIGINAL_TORRENT_FILES,
+                                   FALSE);
+    json_object_set_boolean_member(s, SGET_START_ADDED_TORRENTS, TRUE);
+    json_object_set_boolean_member(s, SGET_RENAME_PARTIAL_FILES, TRUE);
+    json_object_set_int_member(s, SGET_CACHE_SIZE_MB, 4);
+    json_object_set_string_member(s, SGET_SCRIPT_TORRENT_DONE_FILENAME, "");
+    json_object_set_boolean_member(s, SGET_SCRIPT_TORRENT_DONE_ENABLED,
+                                   FALSE);
+    json_object_set_boolean_member(s, SGET_DOWNLOAD_QUEUE_ENABLED, TRUE);
+    json_object_set_int_member(s, SGET_DOWNLOAD_QUEUE_SIZE, 5);
+    json_object_set_boolean_member(s, SGET_SEED_QUEUE_ENABLED, FALSE);
+    json_object_set_int_member(s, SGET_SEED_QUEUE_SIZE, 10);
+    json_object_set_boolean_member(s, SGET_QUEUE_STALLED_ENABLED, TRUE);
+    json_object_set_int_member(s, SGET_QUEUE_STALLED_MINUTES, 30);
+    json_object_set_int_member(s, SGET_ALT_SPEED_DOWN, 50);
+    json_object_set_int_member(s, SGET_ALT_SPEED_UP, 50);
+    json_object_set_boolean_member(s, SGET_ALT_SPEED_ENABLED, FALSE);
+    json_object_set_boolean_member(s, SGET_ALT_SPEED_TIME_ENABLED, FALSE);
+    json_object_set_int_member(s, SGET_ALT_SPEED_TIME_BEGIN, 540);
+    json_object_set_int_member(s, SGET_ALT_SPEED_TIME_END, 1020);
+    json_object_set_int_member(s, SGET_ALT_SPEED_TIME_DAY, 127);
+
+    return s;
+}
+
+/* One poll's worth of activity: some torrents transfer, and a few are
+ * removed and replaced. */
+static void mock_daemon_churn(mock_daemon * md)
+{
+    guint active = (guint) (md->config.churn * md->torrents->len);
+    gint64 now = time(NULL);
+    guint i;
+
+    for (i = 0; i < active && md->torrents->len > 0; i++) {
+        mock_torrent *t = g_ptr_array_index(md->torrents,
+                                            g_rand_int_range(md->rand, 0,
+                                                             md->torrents->
+                                                             len));
+        mock_torrent_randomise_rates(md, t);
+        t->activityDate = now;
+        t->recent = TRUE;
+    }
+
+    for (i = 0; i < md->config.addremove && md->torrents->len > 1; i++) {
+        guint index = g_rand_int_range(md->rand, 0, md->torrents->len);
+        mock_torrent *t = g_ptr_array_index(md->torrents, index);
+
+        g_array_append_val(md->removed, t->id);
+        g_hash_table_remove(md->byId, &t->id);
+        g_ptr_array_remove_index_fast(md->torrents, index);
+        mock_torrent_free(t);
+
+        mock_torrent_new(md)->recent = TRUE;
+    }
+}
+
+static void
+mock_torrent_get_add(mock_daemon * md, mock_torrent * t, JsonArray * fields,
+                     gboolean table, JsonArray * out)
+{
+    guint i, n = json_array_get_length(fields);
+
+    if (table) {
+        JsonArray *row = json_array_sized_new(n);
+        for (i = 0; i < n; i++)
+            json_array_add_element(row,
+                                   mock_torrent_field(md, t,
+                                                      json_array_get_string_element
+                                                      (fields, i)));
+        json_array_add_array_element(out, row);
+    } else {
+        JsonObject *obj = json_object_new();
+        for (i = 0; i < n; i++) {
+            const gchar *field = json_array_get_string_element(fields, i);
+            json_object_set_member(obj, field,
+                                   mock_torrent_field(md, t, field));
+        }
+        json_array_add_object_element(out, obj);
+    }
+}
+
+static JsonObject *mock_torrent_get(mock_daemon * md, JsonObject * args)
+{
+    JsonObject *result = json_object_new();
+    JsonArray *torrents = json_array_new();
+    JsonArray *fields = json_object_has_member(args, PARAM_FIELDS) ?
+        json_object_get_array_member(args, PARAM_FIELDS) : NULL;
+    JsonNode *ids = json_object_get_member(args, PARAM_IDS);
+    gboolean table = !g_strcmp0(json_object_has_member(args, PARAM_FORMAT)
+                                ? json_object_get_string_member(args,
+                                                                PARAM_FORMAT)
+                                : NULL, FORMAT_TABLE);
+    guint i;
+
+    if (!fields) {
+        json_object_set_array_member(result, FIELD_TORRENTS, torrents);
+        return result;
+    }
+
+    if (table) {
+        JsonArray *header = json_array_new();
+        for (i = 0; i < json_array_get_length(fields); i++)
+            json_array_add_string_element(header,
+                                          json_array_get_string_element
+                                          (fields, i));
+        json_array_add_array_element(torrents, header);
+    }
+
+    if (ids && JSON_NODE_HOLDS_VALUE(ids)
+        && !g_strcmp0(json_node_get_string(ids), FIELD_RECENTLY_ACTIVE)) {
+        JsonArray *removed = json_array_new();
+
+        mock_daemon_churn(md);
+
+        for (i = 0; i < md->torrents->len; i++) {
+            mock_torrent *t = g_ptr_array_index(md->torrents, i);
+            if (t->recent) {
+                mock_torrent_get_add(md, t, fields, table, torrents);
+                t->recent = FALSE;
+            }
+        }
+
+        for (i = 0; i < md->removed->len; i++)
+            json_array_add_int_element(removed,
+                                       g_array_index(md->removed, gint64,
+                                                     i));
+        g_array_set_size(md->removed, 0);
+
+        json_object_set_array_member(result, FIELD_REMOVED, removed);
+    } else if (ids && JSON_NODE_HOLDS_ARRAY(ids)) {
+        JsonArray *idArray = json_node_get_array(ids);
+        for (i = 0; i < json_array_get_length(idArray); i++) {
+            gint64 id = json_array_get_int_element(idArray, i);
+            mock_torrent *t = g_hash_table_lookup(md->byId, &id);
+            if (t)
+                mock_torrent_get_add(md, t, fields, table, torrents);
+        }
+    } else {
+        for (i = 0; i < md->torrents->len; i++)
+            mock_torrent_get_add(md, g_ptr_array_index(md->torrents, i),
+                                 fields, table, torrents);
+    }
+
+    json_object_set_array_member(result, FIELD_TORRENTS, torrents);
+    return result;
+}
+
+static void mock_torrent_set_one(mock_torrent * t, JsonObject * args)
+{
+    if (json_object_has_member(args, FIELD_BANDWIDTH_PRIORITY))
+        t->bandwidthPriority =
+            json_object_get_int_member(args, FIELD_BANDWIDTH_PRIORITY);
+    if (json_object_has_member(args, FIELD_DOWNLOAD_LIMIT))
+        t->downloadLimit =
+            json_object_get_int_member(args, FIELD_DOWNLOAD_LIMIT);
+    if (json_object_has_member(args, FIELD_DOWNLOAD_LIMITED))
+        t->downloadLimited =
+            json_object_get_boolean_member(args, FIELD_DOWNLOAD_LIMITED);
+    if (json_object_has_member(args, FIELD_UPLOAD_LIMIT))
+        t->uploadLimit = json_object_get_int_member(args, FIELD_UPLOAD_LIMIT);
+    if (json_object_has_member(args, FIELD_UPLOAD_LIMITED))
+        t->uploadLimited =
+            json_object_get_boolean_member(args, FIELD_UPLOAD_LIMITED);
+    if (json_object_has_member(args, FIELD_HONORS_SESSION_LIMITS))
+        t->honorsSessionLimits =
+            json_object_get_boolean_member(args,
+                                           FIELD_HONORS_SESSION_LIMITS);
+    if (json_object_has_member(args, FIELD_SEED_RATIO_MODE))
+        t->seedRatioMode =
+            json_object_get_int_member(args, FIELD_SEED_RATIO_MODE);
+    if (json_object_has_member(args, FIELD_SEED_RATIO_LIMIT))
+        t->seedRatioLimit =
+            json_node_get_double(json_object_get_member
+                                 (args, FIELD_SEED_RATIO_LIMIT));
+    if (json_object_has_member(args, FIELD_PEER_LIMIT))
+        t->peerLimit = json_object_get_int_member(args, FIELD_PEER_LIMIT);
+
+    t->recent = TRUE;
+}
+
+static JsonObject *mock_torrent_set(mock_daemon * md, JsonObject * args)
+{
+    JsonNode *ids = json_object_get_member(args, PARAM_IDS);
+    guint i;
+
+    if (ids && JSON_NODE_HOLDS_ARRAY(ids)) {
+        JsonArray *idArray = json_node_get_array(ids);
+        for (i = 0; i < json_array_get_length(idArray); i++) {
+            gint64 id = json_array_get_int_element(idArray, i);
+            mock_torrent *t = g_hash_table_lookup(md->byId, &id);
+            if (t)
+                mock_torrent_set_one(t, args);
+        }
+    } else if (!ids) {
+        for (i = 0; i < md->torrents->len; i++)
+            mock_torrent_set_one(g_ptr_array_index(md->torrents, i), args);
+    }
+
+    return json_object_new();
+}
+
+/* Returns the JSON response body for an RPC request body. */
+static gchar *mock_daemon_rpc(mock_daemon * md, const gchar * body,
+                              gsize length, gsize * out_length)
+{
+    JsonParser *parser = json_parser_new();
+    JsonObject *response = json_object_new();
+    JsonObject *request, *args, *result = NULL;
+    JsonGenerator *gen;
+    JsonNode *root;
+    const gchar *method;
+    gchar *out;
+
+    if (!json_parser_load_from_data(parser, body, length, NULL)
+        || !JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser))) {
+        json_object_set_string_member(response, FIELD_RESULT,
+                                      "invalid request");
+        goto generate;
+    }
+
+    request = json_node_get_object(json_parser_get_root(parser));
+    method = json_object_get_string_member(request, PARAM_METHOD);
+    args = json_object_has_member(request, PARAM_ARGUMENTS) ?
+        json_object_get_object_member(request, PARAM_ARGUMENTS) : NULL;
+
+    if (json_object_has_member(request, PARAM_TAG))
+        json_object_set_int_member(response, PARAM_TAG,
+                                   json_object_get_int_member(request,
+                                                              PARAM_TAG));
+
+    g_mutex_lock(&md->lock);
+
+    if (!g_strcmp0(method, METHOD_SESSION_GET))
+        result = mock_session_get(md);
+    else if (!g_strcmp0(method, METHOD_TORRENT_GET) && args)
+        result = mock_torrent_get(md, args);
+    else if (!g_strcmp0(method, METHOD_TORRENT_SET) && args)
+        result = mock_torrent_set(md, args);
+
+    g_mutex_unlock(&md->lock);
+
+    if (result) {
+        json_object_set_string_member(response, FIELD_RESULT,
+                                      FIELD_SUCCESS);
+        json_object_set_object_member(response, PARAM_ARGUMENTS, result);
+    } else {
+        json_object_set_string_member(response, FIELD_RESULT,
+                                      "method name not recognized");
+    }
+
+  generate:
+    root = object_node(response);
+    gen = json_generator_new();
+    json_generator_set_root(gen, root);
+    out = json_generator_to_data(gen, out_length);
+
+    g_object_unref(gen);
+    json_node_free(root);
+    g_object_unref(parser);
+
+    return out;
+}
+
+static gboolean
+mock_connection_send(mock_connection * conn, const gchar * data, gsize len)
+{
+    while (len > 0) {
+        gssize sent = g_socket_send(conn->socket, data, len,
+                                    conn->md->cancellable, NULL);
+        if (sent <= 0)
+            return FALSE;
+        data += sent;
+        len -= sent;
+    }
+
+    return TRUE;
+}
+
+static gboolean mock_connection_recv(mock_connection * conn, GString * buf)
+{
+    gchar chunk[MOCK_RECV_CHUNK];
+    gssize received = g_socket_receive(conn->socket, chunk, sizeof(chunk),
+                                       conn->md->cancellable, NULL);
+
+    if (received <= 0)
+        return FALSE;
+
+    g_string_append_len(buf, chunk, received);
+    return TRUE;
+}
+
+static gpointer mock_connection_thread(gpointer data)
+{
+    mock_connection *conn = (mock_connection *) data;
+    mock_daemon *md = conn->md;
+    GString *buf = g_string_new(NULL);
+
+    for (;;) {
+        gchar *end, **lines, **request_line, *body, *reply, *header;
+        gchar *session = NULL;
+        gsize header_len, content_length = 0, reply_len = 0;
+        gboolean keep_alive = TRUE, ok;
+        guint i;
+
+        while (!(end = g_strstr_len(buf->str, buf->len, "\r\n\r\n")))
+            if (!mock_connection_recv(conn, buf))
+                goto out;
+
+        header_len = end - buf->str + 4;
+        *end = '\0';
+        lines = g_strsplit(buf->str, "\r\n", -1);
+        request_line = g_strsplit(lines[0], " ", 3);
+
+        for (i = 1; lines[i]; i++) {
+            gchar *colon = strchr(lines[i], ':');
+            if (!colon)
+                continue;
+            *colon = '\0';
+            if (!g_ascii_strcasecmp(lines[i], "Content-Length"))
+                content_length = strtoul(colon + 1, NULL, 10);
+            else if (!g_ascii_strcasecmp(lines[i], MOCK_SESSION_HEADER))
+                session = g_strstrip(g_strdup(colon + 1));
+            else if (!g_ascii_strcasecmp(lines[i], "Connection")
+                     && strstr(colon + 1, "close"))
+                keep_alive = FALSE;
+        }
+
+        while (buf->len < header_len + content_length)
+            if (!mock_connection_recv(conn, buf))
+                break;
+
+        body = buf->len >= header_len + content_length ?
+            g_strndup(buf->str + header_len, content_length) : NULL;
+        g_string_erase(buf, 0, MIN(buf->len, header_len + content_length));
+
+        g_atomic_int_inc(&md->requests);
+
+        if (!body) {
+            keep_alive = FALSE;
+            reply = NULL;
+            header = NULL;
+        } else if (!request_line[1]
+                   || g_strcmp0(request_line[1], MOCK_DAEMON_RPC_PATH)) {
+            reply = g_strdup("Not Found");
+            reply_len = strlen(reply);
+            header = g_strdup_printf("HTTP/1.1 404 Not Found\r\n"
+                                     "Content-Length: %" G_GSIZE_FORMAT
+                                     "\r\n\r\n", reply_len);
+        } else if (g_strcmp0(session, md->sessionId)) {
+            reply = g_strdup("Conflict");
+            reply_len = strlen(reply);
+            header = g_strdup_printf("HTTP/1.1 409 Conflict\r\n"
+                                     MOCK_SESSION_HEADER ": %s\r\n"
+                                     "Content-Length: %" G_GSIZE_FORMAT
+                                     "\r\n\r\n", md->sessionId,
+                                     reply_len);
+        } else {
+            reply = mock_daemon_rpc(md, body, content_length, &reply_len);
+            header = g_strdup_printf("HTTP/1.1 200 OK\r\n"
+                                     "Server: trg-mock-daemon\r\n"
+                                     "Content-Type: application/json; charset=UTF-8\r\n"
+                                     "Content-Length: %" G_GSIZE_FORMAT
+                                     "\r\n\r\n", reply_len);
+        }
+
+        ok = header && mock_connection_send(conn, header, strlen(header))
+            && mock_connection_send(conn, reply, reply_len);
+
+        g_free(header);
+        g_free(reply);
+        g_free(body);
+        g_free(session);
+        g_strfreev(request_line);
+        g_strfreev(lines);
+
+        if (!ok || !keep_alive)
+            break;
+    }
+
+  out:
+    g_string_free(buf, TRUE);
+    g_socket_close(conn->socket, NULL);
+    return NULL;
+}
+
+static gpointer mock_daemon_accept_thread(gpointer data)
+{
+    mock_daemon *md = (mock_daemon *) data;
+
+    for (;;) {
+        GSocket *socket = g_socket_accept(md->listener, md->cancellable,
+                                          NULL);
+        mock_connection *conn;
+
+        if (!socket)
+            break;
+
+        conn = g_new0(mock_connection, 1);
+        conn->md = md;
+        conn->socket = socket;
+
+        g_mutex_lock(&md->lock);
+        md->connections = g_list_prepend(md->connections, conn);
+        conn->thread = g_thread_new("mock-connection",
+                                    mock_connection_thread, conn);
+        g_mutex_unlock(&md->lock);
+    }
+
+    return NULL;
+}
+
+mock_daemon *mock_daemon_start(const mock_daemon_config * config,
+                               guint16 port, GError ** error)
+{
+    mock_daemon *md = g_new0(mock_daemon, 1);
+    GInetAddress *loopback;
+    GSocketAddress *address;
+    guint i;
+
+    md->config = *config;
+    md->rand = g_rand_new_with_seed(config->seed);
+    md->torrents = g_ptr_array_sized_new(config->torrents);
+    md->byId = g_hash_table_new(g_int64_hash, g_int64_equal);
+    md->removed = g_array_new(FALSE, FALSE, sizeof(gint64));
+    md->nextId = 1;
+    md->sessionId = g_strdup_printf("mock%08x", g_rand_int(md->rand));
+    md->cancellable = g_cancellable_new();
+    g_mutex_init(&md->lock);
+
+    for (i = 0; i < config->torrents; i++)
+        mock_torrent_new(md);
+
+    md->listener = g_socket_new(G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_STREAM,
+                                G_SOCKET_PROTOCOL_TCP, error);
+    if (!md->listener) {
+        mock_daemon_stop(md);
+        return NULL;
+    }
+
+    loopback = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+    address = g_inet_socket_address_new(loopback, port);
+    g_object_unref(loopback);
+
+    if (!g_socket_bind(md->listener, address, TRUE, error)
+        || !g_socket_listen(md->listener, error)) {
+        g_object_unref(address);
+        mock_daemon_stop(md);
+        return NULL;
+    }
+
+    g_object_unref(address);
+
+    address = g_socket_get_local_address(md->listener, error);
+    if (!address) {
+        mock_daemon_stop(md);
+        return NULL;
+    }
+
+    md->port =
+        g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(address));
+    g_object_unref(address);
+
+    md->acceptThread = g_thread_new("mock-accept",
+                                    mock_daemon_accept_thread, md);
+
+    return md;
+}
+
+guint16 mock_daemon_get_port(mock_daemon * md)
+{
+    return md->port;
+}
+
+guint mock_daemon_get_request_count(mock_daemon * md)
+{
+    return (guint) g_atomic_int_get(&md->requests);
+}
+
+void mock_daemon_stop(mock_daemon * md)
+{
+    GList *li;
+
+    if (!md)
+        return;
+
+    g_cancellable_cancel(md->cancellable);
+
+    if (md->acceptThread)
+        g_thread_join(md->acceptThread);
+
+    /* Nothing else adds to the list once the accept thread has gone. */
+    for (li = md->connections; li; li = g_list_next(li)) {
+        mock_connection *conn = (mock_connection *) li->data;
+        g_thread_join(conn->thread);
+        g_object_unref(conn->socket);
+        g_free(conn);
+    }
+    g_list_free(md->connections);
+
+    if (md->listener) {
+        g_socket_close(md->listener, NULL);
+        g_object_unref(md->listener);
+    }
+
+    g_ptr_array_foreach(md->torrents, (GFunc) mock_torrent_free, NULL);
+    g_ptr_array_free(md->torrents, TRUE);
+    g_hash_table_destroy(md->byId);
+    g_array_free(md->removed, TRUE);
+    g_rand_free(md->rand);
+    g_object_unref(md->cancellable);
+    g_mutex_clear(&md->lock);
+    g_free(md->sessionId);
+    g_free(md);
+}
@@ -0,0 +1,53 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MOCK_DAEMON_H_
+#define MOCK_DAEMON_H_
+
+#include <glib.h>
+
+/* A fake Transmission daemon for benchmarking, speaking just enough of
+ * session-get, torrent-get and torrent-set over HTTP. Not part of the
+ * application. */
+
+#define MOCK_DAEMON_RPC_PATH "/transmission/rpc"
+#define MOCK_DAEMON_RPC_VERSION 17
+
+typedef struct {
+    guint torrents;
+    guint files;                /* per torrent */
+    guint peers;                /* per torrent */
+    guint trackers;             /* per torrent */
+    gdouble churn;              /* fraction of torrents active per poll */
+    guint addremove;            /* torrents added and removed per poll */
+    guint seed;
+} mock_daemon_config;
+
+typedef struct _mock_daemon mock_daemon;
+
+void mock_daemon_config_init(mock_daemon_config * config);
+
+/* Listens on 127.0.0.1, on any free port if port is 0. */
+mock_daemon *mock_daemon_start(const mock_daemon_config * config,
+                               guint16 port, GError ** error);
+guint16 mock_daemon_get_port(mock_daemon * md);
+guint mock_daemon_get_request_count(mock_daemon * md);
+void mock_daemon_stop(mock_daemon * md);
+
+#endif                          /* MOCK_DAEMON_H_ */
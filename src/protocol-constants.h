@@ -91,6 +91,7 @@
 #define FIELD_ACTIVITY_DATE "activityDate"
 #define FIELD_ISPRIVATE "isPrivate"
 #define FIELD_METADATAPERCENTCOMPLETE "metadataPercentComplete"
+#define FIELD_FILE_COUNT "file-count"
 
 #define FIELD_FILES_WANTED      "files-wanted"
 #define FIELD_FILES_UNWANTED    "files-unwanted"
@@ -143,6 +144,9 @@
 #define PARAM_FILENAME          "filename"
 #define PARAM_PAUSED            "paused"
 #define PARAM_TAG               "tag"
+#define PARAM_FORMAT            "format"
+
+#define FORMAT_TABLE            "table"
 
 /* peers structure */
 
@@ -167,6 +171,12 @@
 /* The rpc-version >= that the status field of torrent-get changed */
 #define NEW_STATUS_RPC_VERSION  14
 
+/* The rpc-version >= that torrent-get accepts "format":"table" */
+#define TABLE_FORMAT_RPC_VERSION  16
+
+/* The rpc-version >= that torrent-get can return file-count */
+#define FILE_COUNT_RPC_VERSION  17
+
 typedef enum {
     OLD_STATUS_WAITING_TO_CHECK = 1,
     OLD_STATUS_CHECKING = 2,
@@ -145,6 +145,7 @@ gchar *build_remote_exec_cmd(TrgClient * tc, GtkTreeModel * model,
                 GString *gs = g_string_new("");
                 GList *li;
                 GtkTreeIter iter;
+                trg_torrent *t;
                 JsonObject *json;
                 gchar *piece;
 
@@ -152,20 +153,24 @@ gchar *build_remote_exec_cmd(TrgClient * tc, GtkTreeModel * model,
                     piece = NULL;
                     gtk_tree_model_get_iter(model, &iter,
                                             (GtkTreePath *) li->data);
-                    gtk_tree_model_get(model, &iter, TORRENT_COLUMN_JSON,
-                                       &json, -1);
+                    gtk_tree_model_get(model, &iter, TORRENT_COLUMN_TORRENT,
+                                       &t, -1);
+
+                    /* Commands name torrent fields as the RPC does. */
+                    json = trg_torrent_to_json(t);
                     if (json_object_has_member(json, id)) {
                         replacement = json_object_get_member(json, id);
                         if (JSON_NODE_HOLDS_VALUE(replacement)) {
                             piece = dump_json_value(replacement);
                         }
                     }
+                    json_object_unref(json);
 
                     if (!piece) {
                         if (!g_strcmp0(id, "full-dir")) {
-                            piece = torrent_get_full_dir(json);
+                            piece = trg_torrent_get_full_dir(t);
                         } else if (!g_strcmp0(id, "full-path")) {
-                            piece = torrent_get_full_path(json);
+                            piece = trg_torrent_get_full_path(t);
                         }
                     }
 
@@ -30,6 +30,7 @@
 #include "protocol-constants.h"
 #include "json.h"
 #include "torrent.h"
+#include "session-get.h"
 #include "util.h"
 #include "requests.h"
 
@@ -72,6 +73,33 @@ JsonNode *session_get(void)
     return base_request(METHOD_SESSION_GET);
 }
 
+/* Only the session fields which change without us changing them, for the
+ * periodic refresh. Merge the response with trg_client_merge_session().
+ * Daemons older than RPC version 16 ignore fields and send everything,
+ * which merges just the same. */
+JsonNode *session_get_volatile(void)
+{
+    JsonNode *root = base_request(METHOD_SESSION_GET);
+    JsonObject *args = node_get_arguments(root);
+    JsonArray *fields = json_array_new();
+
+    json_array_add_string_element(fields, SGET_DOWNLOAD_DIR_FREE_SPACE);
+    json_array_add_string_element(fields, SGET_ALT_SPEED_ENABLED);
+    json_array_add_string_element(fields, SGET_ALT_SPEED_DOWN);
+    json_array_add_string_element(fields, SGET_ALT_SPEED_UP);
+    json_array_add_string_element(fields, SGET_SPEED_LIMIT_DOWN);
+    json_array_add_string_element(fields, SGET_SPEED_LIMIT_DOWN_ENABLED);
+    json_array_add_string_element(fields, SGET_SPEED_LIMIT_UP);
+    json_array_add_string_element(fields, SGET_SPEED_LIMIT_UP_ENABLED);
+    json_array_add_string_element(fields, SGET_SEED_RATIO_LIMIT);
+    json_array_add_string_element(fields, SGET_SEED_RATIO_LIMITED);
+    json_array_add_string_element(fields, SGET_DOWNLOAD_QUEUE_ENABLED);
+    json_array_add_string_element(fields, SGET_SEED_QUEUE_ENABLED);
+    json_object_set_array_member(args, PARAM_FIELDS, fields);
+
+    return root;
+}
+
 JsonNode *torrent_set_location(JsonArray * array, gchar * location,
                                gboolean move)
 {
@@ -151,25 +179,38 @@ JsonNode *torrent_remove(JsonArray * array, gboolean removeData)
     return root;
 }
 
-JsonNode *torrent_get(gint64 id)
+/* The list poll is sent every few seconds, for each connection, and is the
+ * same every time apart from which torrents it asks for. So the field list
+ * is built once, and the body is serialised once, with the ids spliced in
+ * by request_serialize(). Each request gets its own copy of the field list
+ * rather than a reference, as requests are freed on the request threads
+ * and json-glib's reference counts aren't atomic.
+ *
+ * There's a template for each combination of the two things that depend on
+ * the daemon's RPC version. They're built on first use and kept.
+ */
+
+#define TORRENT_GET_TEMPLATE_FILE_COUNT (1 << 0)
+#define TORRENT_GET_TEMPLATE_TABLE      (1 << 1)
+#define TORRENT_GET_TEMPLATE_IDS        "trg-ids-placeholder"
+
+typedef struct {
+    JsonArray *fields;
+    guint n_args;               /* arguments, not counting ids */
+    gchar *full;                /* all torrents */
+    gchar *recent;              /* recently active */
+    gchar *one_before;          /* one torrent, either side of its id */
+    gchar *one_after;
+} torrent_get_template;
+
+static torrent_get_template *torrent_get_templates[4];
+
+static JsonArray *torrent_get_fields(guint flags)
 {
-    JsonNode *root = base_request(METHOD_TORRENT_GET);
-    JsonObject *args = node_get_arguments(root);
     JsonArray *fields = json_array_new();
 
-    if (id == TORRENT_GET_TAG_MODE_UPDATE) {
-        json_object_set_string_member(args, PARAM_IDS,
-                                      FIELD_RECENTLY_ACTIVE);
-    } else if (id >= 0) {
-        JsonArray *ids = json_array_new();
-        json_array_add_int_element(ids, id);
-        json_object_set_array_member(args, PARAM_IDS, ids);
-    }
-
     json_array_add_string_element(fields, FIELD_ETA);
-    json_array_add_string_element(fields, FIELD_PEERS);
     json_array_add_string_element(fields, FIELD_PEERSFROM);
-    json_array_add_string_element(fields, FIELD_FILES);
     json_array_add_string_element(fields, FIELD_PEERS_SENDING_TO_US);
     json_array_add_string_element(fields, FIELD_PEERS_GETTING_FROM_US);
     json_array_add_string_element(fields, FIELD_WEB_SEEDS_SENDING_TO_US);
@@ -195,7 +236,6 @@ JsonNode *torrent_get(gint64 id)
     json_array_add_string_element(fields, FIELD_METADATAPERCENTCOMPLETE);
     json_array_add_string_element(fields, FIELD_LEFT_UNTIL_DONE);
     json_array_add_string_element(fields, FIELD_ANNOUNCE_URL);
-    json_array_add_string_element(fields, FIELD_ERROR_STRING);
     json_array_add_string_element(fields, FIELD_TRACKER_STATS);
     json_array_add_string_element(fields, FIELD_DATE_CREATED);
     json_array_add_string_element(fields, FIELD_DOWNLOAD_DIR);
@@ -215,10 +255,217 @@ JsonNode *torrent_get(gint64 id)
     json_array_add_string_element(fields, FIELD_MAGNETLINK);
     json_array_add_string_element(fields, FIELD_ERROR);
     json_array_add_string_element(fields, FIELD_ERROR_STRING);
+    json_array_add_string_element(fields, FIELD_RECHECK_PROGRESS);
+
+    /* Older daemons can't give a file count, the priorities array is the
+     * smallest thing which has one element per file. */
+    if (flags & TORRENT_GET_TEMPLATE_FILE_COUNT)
+        json_array_add_string_element(fields, FIELD_FILE_COUNT);
+    else
+        json_array_add_string_element(fields, FIELD_PRIORITIES);
+
+    return fields;
+}
+
+/* Whether fields is the template's field list, or a copy of it. */
+static gboolean torrent_get_template_has_fields(torrent_get_template * t,
+                                                JsonArray * fields)
+{
+    guint i, n = json_array_get_length(t->fields);
+
+    if (fields == t->fields)
+        return TRUE;
+
+    if (json_array_get_length(fields) != n)
+        return FALSE;
+
+    for (i = 0; i < n; i++) {
+        JsonNode *field = json_array_get_element(fields, i);
+        if (!JSON_NODE_HOLDS_VALUE(field)
+            || g_strcmp0(json_node_get_string(field),
+                         json_array_get_string_element(t->fields, i)))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* A torrent-get without ids, with a copy of the template's field list. */
+static JsonNode *torrent_get_from_template(torrent_get_template * t,
+                                           guint flags)
+{
+    JsonNode *root = base_request(METHOD_TORRENT_GET);
+    JsonObject *args = node_get_arguments(root);
+    guint i, n = json_array_get_length(t->fields);
+    JsonArray *fields = json_array_sized_new(n);
+
+    /* trg_torrents_decode() reads the rows by position. */
+    if (flags & TORRENT_GET_TEMPLATE_TABLE)
+        json_object_set_string_member(args, PARAM_FORMAT, FORMAT_TABLE);
+
+    for (i = 0; i < n; i++)
+        json_array_add_string_element(fields,
+                                      json_array_get_string_element
+                                      (t->fields, i));
+
+    json_object_set_array_member(args, PARAM_FIELDS, fields);
+
+    return root;
+}
+
+static torrent_get_template *torrent_get_template_build(guint flags)
+{
+    torrent_get_template *t = g_new0(torrent_get_template, 1);
+    JsonNode *req;
+    JsonObject *args;
+
+    t->fields = torrent_get_fields(flags);
+    t->n_args = flags & TORRENT_GET_TEMPLATE_TABLE ? 2 : 1;
+
+    req = torrent_get_from_template(t, flags);
+    args = node_get_arguments(req);
+    t->full = trg_serialize(req);
+
+    json_object_set_string_member(args, PARAM_IDS, FIELD_RECENTLY_ACTIVE);
+    t->recent = trg_serialize(req);
+
+    json_object_set_string_member(args, PARAM_IDS,
+                                  TORRENT_GET_TEMPLATE_IDS);
+    trg_serialize_around(req, TORRENT_GET_TEMPLATE_IDS, &t->one_before,
+                         &t->one_after);
+
+    json_node_free(req);
+
+    return t;
+}
+
+static torrent_get_template *torrent_get_template_for(guint flags)
+{
+    static gsize initialised[G_N_ELEMENTS(torrent_get_templates)];
+
+    if (g_once_init_enter(&initialised[flags])) {
+        torrent_get_templates[flags] = torrent_get_template_build(flags);
+        g_once_init_leave(&initialised[flags], 1);
+    }
+
+    return torrent_get_templates[flags];
+}
+
+/* The list poll. This only asks for the fields the torrent list, state
+ * selector and general panel need, so the response size scales with the
+ * number of torrents rather than their files and peers. The notebook gets
+ * the rest for the selected torrent from torrent_get_details().
+ */
+JsonNode *torrent_get(TrgClient * tc, gint64 id)
+{
+    gint64 rpcv = trg_client_get_rpc_version(tc);
+    guint flags = 0;
+    JsonNode *root;
+    JsonObject *args;
+
+    if (rpcv >= FILE_COUNT_RPC_VERSION)
+        flags |= TORRENT_GET_TEMPLATE_FILE_COUNT;
+    if (rpcv >= TABLE_FORMAT_RPC_VERSION)
+        flags |= TORRENT_GET_TEMPLATE_TABLE;
+
+    root = torrent_get_from_template(torrent_get_template_for(flags),
+                                     flags);
+    args = node_get_arguments(root);
+
+    if (id == TORRENT_GET_TAG_MODE_UPDATE) {
+        json_object_set_string_member(args, PARAM_IDS,
+                                      FIELD_RECENTLY_ACTIVE);
+    } else if (id >= 0) {
+        JsonArray *ids = json_array_new();
+        json_array_add_int_element(ids, id);
+        json_object_set_array_member(args, PARAM_IDS, ids);
+    }
+
+    return root;
+}
+
+/* The body to send for req. A torrent-get made by torrent_get(), and not
+ * changed since, comes from its template. */
+gchar *request_serialize(JsonNode * req)
+{
+    JsonObject *root = json_node_get_object(req);
+    JsonObject *args;
+    JsonNode *fields, *ids;
+    torrent_get_template *t = NULL;
+    guint i;
+
+    if (json_object_get_size(root) != 2
+        || g_strcmp0(json_object_get_string_member(root, PARAM_METHOD),
+                     METHOD_TORRENT_GET))
+        return trg_serialize(req);
+
+    args = node_get_arguments(req);
+    fields = json_object_get_member(args, PARAM_FIELDS);
+
+    for (i = 0; fields && JSON_NODE_HOLDS_ARRAY(fields)
+         && i < G_N_ELEMENTS(torrent_get_templates); i++) {
+        torrent_get_template *ti = g_atomic_pointer_get
+            (&torrent_get_templates[i]);
+        /* The table and object forms have the same fields. */
+        if (!(i & TORRENT_GET_TEMPLATE_TABLE) !=
+            !json_object_has_member(args, PARAM_FORMAT))
+            continue;
+        if (ti && torrent_get_template_has_fields(ti,
+                                                  json_node_get_array
+                                                  (fields))) {
+            t = ti;
+            break;
+        }
+    }
+
+    if (!t)
+        return trg_serialize(req);
+
+    ids = json_object_get_member(args, PARAM_IDS);
+
+    if (!ids && json_object_get_size(args) == t->n_args) {
+        return g_strdup(t->full);
+    } else if (!ids || json_object_get_size(args) != t->n_args + 1) {
+        return trg_serialize(req);
+    } else if (JSON_NODE_HOLDS_VALUE(ids)
+               && !g_strcmp0(json_node_get_string(ids),
+                             FIELD_RECENTLY_ACTIVE)) {
+        return g_strdup(t->recent);
+    } else if (t->one_before && JSON_NODE_HOLDS_ARRAY(ids)
+               && json_array_get_length(json_node_get_array(ids)) == 1) {
+        JsonNode *id = json_array_get_element(json_node_get_array(ids), 0);
+        if (JSON_NODE_HOLDS_VALUE(id)
+            && json_node_get_value_type(id) == G_TYPE_INT64)
+            return g_strdup_printf("%s[%" G_GINT64_FORMAT "]%s",
+                                   t->one_before, json_node_get_int(id),
+                                   t->one_after);
+    }
+
+    return trg_serialize(req);
+}
+
+/* The per-selection poll, for the files, peers and trackers in the
+ * notebook. */
+JsonNode *torrent_get_details(gint64 id)
+{
+    JsonNode *root = base_request(METHOD_TORRENT_GET);
+    JsonObject *args = node_get_arguments(root);
+    JsonArray *fields = json_array_new();
+    JsonArray *ids = json_array_new();
+
+    json_array_add_int_element(ids, id);
+    json_object_set_array_member(args, PARAM_IDS, ids);
+
+    json_array_add_string_element(fields, FIELD_ID);
+    json_array_add_string_element(fields, FIELD_FILES);
+    json_array_add_string_element(fields, FIELD_PEERS);
     json_array_add_string_element(fields, FIELD_WANTED);
     json_array_add_string_element(fields, FIELD_PRIORITIES);
-    json_array_add_string_element(fields, FIELD_RECHECK_PROGRESS);
+    json_array_add_string_element(fields, FIELD_TRACKER_STATS);
     json_object_set_array_member(args, PARAM_FIELDS, fields);
+
+    request_set_tag(root, id);
+
     return root;
 }
 
@@ -248,13 +495,14 @@ JsonNode *torrent_add_from_response(trg_response *response, gint flags) {
     return root;
 }
 
+/* For a local file, this doesn't include the metainfo, which is streamed
+ * in when it's sent by dispatch_async_upload(). */
 JsonNode *torrent_add_from_file(gchar * target, gint flags)
 {
     JsonNode *root;
     JsonObject *args;
     gboolean isMagnet = is_magnet(target);
     gboolean isUri = isMagnet || is_url(target);
-    gchar *encodedFile;
 
     if (!isUri && !g_file_test(target, G_FILE_TEST_IS_REGULAR)) {
         g_message("file \"%s\" does not exist.", target);
@@ -264,26 +512,12 @@ JsonNode *torrent_add_from_file(gchar * target, gint flags)
     root = base_request(METHOD_TORRENT_ADD);
     args = node_get_arguments(root);
 
-    if (isUri) {
+    if (isUri)
         json_object_set_string_member(args, PARAM_FILENAME, target);
-    } else {
-        encodedFile = trg_base64encode(target);
-        if (encodedFile) {
-            json_object_set_string_member(args, PARAM_METAINFO,
-                                          encodedFile);
-            g_free(encodedFile);
-        } else {
-            g_error("unable to base64 encode file \"%s\".", target);
-            return NULL;
-        }
-    }
 
     json_object_set_boolean_member(args, PARAM_PAUSED,
                                    (flags & TORRENT_ADD_FLAG_PAUSED));
 
-    if ((flags & TORRENT_ADD_FLAG_DELETE))
-        g_unlink(target);
-
     return root;
 }
 
@@ -29,7 +29,9 @@ JsonNode *generic_request(gchar * method, JsonArray * array);
 
 JsonNode *session_set(void);
 JsonNode *session_get(void);
-JsonNode *torrent_get(gint64 id);
+JsonNode *session_get_volatile(void);
+JsonNode *torrent_get(TrgClient * tc, gint64 id);
+JsonNode *torrent_get_details(gint64 id);
 JsonNode *torrent_set(JsonArray * array);
 JsonNode *torrent_pause(JsonArray * array);
 JsonNode *torrent_start(JsonArray * array);
@@ -51,6 +53,7 @@ JsonNode *torrent_queue_move_top(JsonArray * array);
 JsonNode *torrent_start_now(JsonArray * array);
 
 void request_set_tag(JsonNode * req, gint64 tag);
+gchar *request_serialize(JsonNode * req);
 void request_set_tag_from_ids(JsonNode * req, JsonArray * ids);
 
 #endif                          /* REQUESTS_H_ */
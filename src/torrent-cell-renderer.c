@@ -49,7 +49,7 @@ enum {
     P_WEBSEEDSTOUS,
     P_PEERSTOUS,
     P_ETA,
-    P_JSON,
+    P_TORRENT,
     P_CONNECTED,
     P_FILECOUNT,
     P_BAR_HEIGHT,
@@ -114,7 +114,7 @@ struct TorrentCellRendererPrivate {
     gdouble metadataPercentComplete;
     gdouble ratio;
     gdouble seedRatioLimit;
-    gpointer json;
+    trg_torrent *torrent;
     TrgClient *client;
     GtkTreeView *owner;
     gboolean compact;
@@ -315,7 +315,7 @@ static void getStatusString(GString * gstr, TorrentCellRenderer * r)
             N_("Error: %s")
         };
         g_string_append_printf(gstr, _(fmt[priv->error]),
-                               torrent_get_errorstr(priv->json));
+                               priv->torrent->errorString);
     } else if ((priv->flags & TORRENT_FLAG_PAUSED)
                || (priv->flags & TORRENT_FLAG_WAITING_CHECK)
                || (priv->flags & TORRENT_FLAG_CHECKING)
@@ -424,7 +424,7 @@ get_size_compact(TorrentCellRenderer * cell,
     g_object_set(p->icon_renderer, "pixbuf", icon, NULL);
     gtr_cell_renderer_get_preferred_size(p->icon_renderer, widget, NULL,
                                          &icon_size);
-    g_object_set(p->text_renderer, "text", torrent_get_name(p->json),
+    g_object_set(p->text_renderer, "text", p->torrent->name,
                  "ellipsize", PANGO_ELLIPSIZE_NONE, "scale", 1.0, NULL);
     gtr_cell_renderer_get_preferred_size(p->text_renderer, widget, NULL,
                                          &name_size);
@@ -476,7 +476,7 @@ get_size_full(TorrentCellRenderer * cell,
     g_object_set(p->icon_renderer, "pixbuf", icon, NULL);
     gtr_cell_renderer_get_preferred_size(p->icon_renderer, widget, NULL,
                                          &icon_size);
-    g_object_set(p->text_renderer, "text", torrent_get_name(p->json),
+    g_object_set(p->text_renderer, "text", p->torrent->name,
                  "weight", PANGO_WEIGHT_BOLD, "scale", 1.0, "ellipsize",
                  PANGO_ELLIPSIZE_NONE, NULL);
     gtr_cell_renderer_get_preferred_size(p->text_renderer, widget, NULL,
@@ -626,8 +626,8 @@ static void torrent_cell_renderer_set_property(GObject * object,
     struct TorrentCellRendererPrivate *p = self->priv;
 
     switch (property_id) {
-    case P_JSON:
-        p->json = g_value_get_pointer(v);
+    case P_TORRENT:
+        p->torrent = g_value_get_pointer(v);
         break;
     case P_STATUS:
         p->flags = g_value_get_uint(v);
@@ -752,9 +752,9 @@ torrent_cell_renderer_class_init(TorrentCellRendererClass * klass)
     gobject_class->get_property = torrent_cell_renderer_get_property;
     gobject_class->dispose = torrent_cell_renderer_dispose;
 
-    g_object_class_install_property(gobject_class, P_JSON,
-                                    g_param_spec_pointer("json", NULL,
-                                                         "json",
+    g_object_class_install_property(gobject_class, P_TORRENT,
+                                    g_param_spec_pointer("torrent", NULL,
+                                                         "torrent",
                                                          G_PARAM_READWRITE));
 
     g_object_class_install_property(gobject_class, P_CLIENT,
@@ -987,7 +987,7 @@ render_compact(TorrentCellRenderer * cell,
     gtr_cell_renderer_get_preferred_size(p->icon_renderer, widget, NULL,
                                          &size);
     icon_area.width = size.width;
-    g_object_set(p->text_renderer, "text", torrent_get_name(p->json),
+    g_object_set(p->text_renderer, "text", p->torrent->name,
                  "ellipsize", PANGO_ELLIPSIZE_NONE, "scale", 1.0, NULL);
     gtr_cell_renderer_get_preferred_size(p->text_renderer, widget, NULL,
                                          &size);
@@ -1023,7 +1023,7 @@ render_compact(TorrentCellRenderer * cell,
                  FOREGROUND_COLOR_KEY, &text_color, NULL);
     gtr_cell_renderer_render(p->text_renderer, window, widget, &stat_area,
                              flags);
-    g_object_set(p->text_renderer, "text", torrent_get_name(p->json),
+    g_object_set(p->text_renderer, "text", p->torrent->name,
                  "scale", 1.0, FOREGROUND_COLOR_KEY, &text_color, NULL);
     gtr_cell_renderer_render(p->text_renderer, window, widget, &name_area,
                              flags);
@@ -1074,7 +1074,7 @@ render_full(TorrentCellRenderer * cell,
                                          &size);
     icon_area.width = size.width;
     icon_area.height = size.height;
-    g_object_set(p->text_renderer, "text", torrent_get_name(p->json),
+    g_object_set(p->text_renderer, "text", p->torrent->name,
                  "weight", PANGO_WEIGHT_BOLD, "ellipsize",
                  PANGO_ELLIPSIZE_NONE, "scale", 1.0, NULL);
     gtr_cell_renderer_get_preferred_size(p->text_renderer, widget, NULL,
@@ -1137,7 +1137,7 @@ render_full(TorrentCellRenderer * cell,
                  NULL);
     gtr_cell_renderer_render(p->icon_renderer, window, widget, &icon_area,
                              flags);
-    g_object_set(p->text_renderer, "text", torrent_get_name(p->json),
+    g_object_set(p->text_renderer, "text", p->torrent->name,
                  "scale", 1.0, FOREGROUND_COLOR_KEY, &text_color,
                  "ellipsize", PANGO_ELLIPSIZE_END, "weight",
                  PANGO_WEIGHT_BOLD, NULL);
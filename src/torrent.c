@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 
+#include <string.h>
 #include <glib-object.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
@@ -234,102 +235,26 @@ gint64 torrent_get_activity_date(JsonObject * t)
     return json_object_get_int_member(t, FIELD_ACTIVITY_DATE);
 }
 
-guint32
-torrent_get_flags(JsonObject * t, gint64 rpcv, gint64 status,
-                  gint64 fileCount, gint64 downRate, gint64 upRate)
-{
-    guint32 flags = 0;
-
-    if (fileCount > 0 && torrent_get_is_finished(t) == TRUE)
-        flags |= TORRENT_FLAG_COMPLETE;
-    else
-        flags |= TORRENT_FLAG_INCOMPLETE;
-
-    if (rpcv >= NEW_STATUS_RPC_VERSION) {
-        switch (status) {
-        case TR_STATUS_STOPPED:
-            flags |= TORRENT_FLAG_PAUSED;
-            break;
-        case TR_STATUS_CHECK_WAIT:
-            flags |= TORRENT_FLAG_WAITING_CHECK;
-            flags |= TORRENT_FLAG_CHECKING_ANY;
-            break;
-        case TR_STATUS_CHECK:
-            flags |= TORRENT_FLAG_CHECKING;
-            flags |= TORRENT_FLAG_CHECKING_ANY;
-            break;
-        case TR_STATUS_DOWNLOAD_WAIT:
-            flags |= TORRENT_FLAG_DOWNLOADING_WAIT;
-            flags |= TORRENT_FLAG_QUEUED;
-            break;
-        case TR_STATUS_DOWNLOAD:
-            if (!(flags & TORRENT_FLAG_COMPLETE))
-                flags |= TORRENT_FLAG_DOWNLOADING;
-
-            if (fileCount <= 0)
-                flags |= TORRENT_FLAG_DOWNLOADING_METADATA;
-
-            flags |= TORRENT_FLAG_ACTIVE;
-            break;
-        case TR_STATUS_SEED_WAIT:
-            flags |= TORRENT_FLAG_SEEDING_WAIT;
-            break;
-        case TR_STATUS_SEED:
-            flags |= TORRENT_FLAG_SEEDING;
-            if (torrent_get_peers_getting_from_us(t))
-                flags |= TORRENT_FLAG_ACTIVE;
-            break;
-        }
-    } else {
-        switch (status) {
-        case OLD_STATUS_DOWNLOADING:
-            flags |= TORRENT_FLAG_DOWNLOADING;
-            break;
-        case OLD_STATUS_PAUSED:
-            flags |= TORRENT_FLAG_PAUSED;
-            break;
-        case OLD_STATUS_SEEDING:
-            flags |= TORRENT_FLAG_SEEDING;
-            break;
-        case OLD_STATUS_CHECKING:
-            flags |= TORRENT_FLAG_CHECKING;
-            break;
-        case OLD_STATUS_WAITING_TO_CHECK:
-            flags |= TORRENT_FLAG_WAITING_CHECK;
-            flags |= TORRENT_FLAG_CHECKING;
-            break;
-        }
-
-        if (downRate > 0 || upRate > 0)
-            flags |= TORRENT_FLAG_ACTIVE;
-    }
-
-    if (torrent_get_error(t) > 0)
-        flags |= TORRENT_FLAG_ERROR;
-
-    return flags;
-}
-
-gchar *torrent_get_status_icon(gint64 rpcv, guint flags)
+const gchar *torrent_get_status_icon(gint64 rpcv, guint flags)
 {
     if (flags & TORRENT_FLAG_ERROR)
-        return g_strdup("dialog-warning");
+        return "dialog-warning";
     else if (flags & TORRENT_FLAG_DOWNLOADING_METADATA)
-        return g_strdup("edit-find");
+        return "edit-find";
     else if (flags & TORRENT_FLAG_DOWNLOADING)
-        return g_strdup("go-down");
+        return "go-down";
     else if (flags & TORRENT_FLAG_PAUSED)
-        return g_strdup("media-playback-pause");
+        return "media-playback-pause";
     else if (flags & TORRENT_FLAG_SEEDING)
-        return g_strdup("go-up");
+        return "go-up";
     else if (flags & TORRENT_FLAG_CHECKING)
-        return g_strdup("view-refresh");
+        return "view-refresh";
     else if (flags & TORRENT_FLAG_DOWNLOADING_WAIT)
-        return g_strdup("media-seek-backward");
+        return "media-seek-backward";
     else if (flags & TORRENT_FLAG_SEEDING_WAIT)
-        return g_strdup("media-seek-forward");
+        return "media-seek-forward";
     else
-        return g_strdup("dialog-question");
+        return "dialog-question";
 }
 
 gint64 torrent_get_done_date(JsonObject * t)
@@ -365,73 +290,48 @@ const gchar *torrent_get_hash(JsonObject * t)
     return json_object_get_string_member(t, FIELD_HASH_STRING);
 }
 
-gchar *torrent_get_status_string(gint64 rpcv, gint64 value, guint flags)
+const gchar *torrent_get_status_string(gint64 rpcv, gint64 value,
+                                      guint flags)
 {
     if (rpcv >= NEW_STATUS_RPC_VERSION) {
         switch (value) {
         case TR_STATUS_DOWNLOAD:
             if (flags & TORRENT_FLAG_DOWNLOADING_METADATA)
-                return g_strdup(_("Metadata Downloading"));
+                return _("Metadata Downloading");
             else
-                return g_strdup(_("Downloading"));
+                return _("Downloading");
         case TR_STATUS_DOWNLOAD_WAIT:
-            return g_strdup(_("Queued download"));
+            return _("Queued download");
         case TR_STATUS_CHECK_WAIT:
-            return g_strdup(_("Waiting To Check"));
+            return _("Waiting To Check");
         case TR_STATUS_CHECK:
-            return g_strdup(_("Checking"));
+            return _("Checking");
         case TR_STATUS_SEED_WAIT:
-            return g_strdup(_("Queued seed"));
+            return _("Queued seed");
         case TR_STATUS_SEED:
-            return g_strdup(_("Seeding"));
+            return _("Seeding");
         case TR_STATUS_STOPPED:
-            return g_strdup(_("Paused"));
+            return _("Paused");
         }
     } else {
         switch (value) {
         case OLD_STATUS_DOWNLOADING:
             if (flags & TORRENT_FLAG_DOWNLOADING_METADATA)
-                return g_strdup(_("Metadata Downloading"));
+                return _("Metadata Downloading");
             else
-                return g_strdup(_("Downloading"));
+                return _("Downloading");
         case OLD_STATUS_PAUSED:
-            return g_strdup(_("Paused"));
+            return _("Paused");
         case OLD_STATUS_SEEDING:
-            return g_strdup(_("Seeding"));
+            return _("Seeding");
         case OLD_STATUS_CHECKING:
-            return g_strdup(_("Checking"));
+            return _("Checking");
         case OLD_STATUS_WAITING_TO_CHECK:
-            return g_strdup(_("Waiting To Check"));
+            return _("Waiting To Check");
         }
     }
 
-    return g_strdup(_("Unknown"));
-}
-
-gboolean torrent_has_tracker(JsonObject * t, GRegex * rx, gchar * search)
-{
-    GList *trackers;
-    GList *li;
-    gboolean ret = FALSE;
-
-    trackers = json_array_get_elements(torrent_get_tracker_stats(t));
-
-    for (li = trackers; li; li = g_list_next(li)) {
-        JsonObject *tracker = json_node_get_object((JsonNode *) li->data);
-        const gchar *trackerAnnounce = tracker_stats_get_announce(tracker);
-        gchar *trackerAnnounceHost =
-            trg_gregex_get_first(rx, trackerAnnounce);
-        int cmpResult = g_strcmp0(trackerAnnounceHost, search);
-        g_free(trackerAnnounceHost);
-        if (!cmpResult) {
-            ret = TRUE;
-            break;
-        }
-    }
-
-    g_list_free(trackers);
-
-    return ret;
+    return _("Unknown");
 }
 
 gint64 torrent_get_left_until_done(JsonObject * t)
@@ -459,8 +359,24 @@ JsonArray *get_torrents_removed(JsonObject * response)
 
 JsonArray *get_torrents(JsonObject * response)
 {
+    JsonArray *torrents;
+
     g_assert(json_object_get_array_member(response, FIELD_TORRENTS));
-    return json_object_get_array_member(response, FIELD_TORRENTS);
+    torrents = json_object_get_array_member(response, FIELD_TORRENTS);
+
+    return torrents;
+}
+
+/* How many torrents get_torrents() has, not counting a table's header. */
+guint get_torrents_count(JsonObject * response)
+{
+    JsonArray *torrents = get_torrents(response);
+    guint n = json_array_get_length(torrents);
+
+    if (n > 0 && JSON_NODE_HOLDS_ARRAY(json_array_get_element(torrents, 0)))
+        n--;
+
+    return n;
 }
 
 JsonArray *torrent_get_files(JsonObject * args)
@@ -468,6 +384,20 @@ JsonArray *torrent_get_files(JsonObject * args)
     return json_object_get_array_member(args, FIELD_FILES);
 }
 
+/* The list poll doesn't ask for files, so use file-count if the daemon
+ * supports it, otherwise the (much smaller) priorities array. */
+guint torrent_get_file_count(JsonObject * t)
+{
+    if (json_object_has_member(t, FIELD_FILE_COUNT))
+        return (guint) json_object_get_int_member(t, FIELD_FILE_COUNT);
+    else if (json_object_has_member(t, FIELD_FILES))
+        return json_array_get_length(torrent_get_files(t));
+    else if (json_object_has_member(t, FIELD_PRIORITIES))
+        return json_array_get_length(torrent_get_priorities(t));
+    else
+        return 0;
+}
+
 gint64 torrent_get_peers_connected(JsonObject * args)
 {
     return json_object_get_int_member(args, FIELD_PEERS_CONNECTED);
@@ -548,36 +478,6 @@ const gchar *tracker_stats_get_host(JsonObject * t)
     return json_object_get_string_member(t, FIELD_HOST);
 }
 
-gchar *torrent_get_full_path(JsonObject * obj)
-{
-    const gchar *location =
-        json_object_get_string_member(obj, FIELD_DOWNLOAD_DIR);
-    const gchar *name = json_object_get_string_member(obj, FIELD_NAME);
-    return g_strdup_printf("%s/%s", location, name);
-}
-
-gchar *torrent_get_full_dir(JsonObject * obj)
-{
-    gchar *containing_path, *name, *delim;
-    const gchar *location;
-    JsonArray *files = torrent_get_files(obj);
-    JsonObject *firstFile;
-
-    location = json_object_get_string_member(obj, FIELD_DOWNLOAD_DIR);
-    firstFile = json_array_get_object_element(files, 0);
-    name = g_strdup(json_object_get_string_member(firstFile, TFILE_NAME));
-
-    if ((delim = g_strstr_len(name, -1, "/"))) {
-        *delim = '\0';
-        containing_path = g_strdup_printf("%s/%s", location, name);
-    } else {
-        containing_path = g_strdup(location);
-    }
-
-    g_free(name);
-    return containing_path;
-}
-
 /* peers */
 
 const gchar *peer_get_address(JsonObject * p)
@@ -693,3 +593,805 @@ const gchar *file_get_name(JsonObject * f)
 {
     return json_object_get_string_member(f, TFILE_NAME);
 }
+
+/* records */
+
+static guint32 trg_torrent_get_flags(trg_torrent * t, gint64 rpcv)
+{
+    guint32 flags = 0;
+
+    if (t->fileCount > 0 && t->leftUntilDone <= 0)
+        flags |= TORRENT_FLAG_COMPLETE;
+    else
+        flags |= TORRENT_FLAG_INCOMPLETE;
+
+    if (rpcv >= NEW_STATUS_RPC_VERSION) {
+        switch (t->status) {
+        case TR_STATUS_STOPPED:
+            flags |= TORRENT_FLAG_PAUSED;
+            break;
+        case TR_STATUS_CHECK_WAIT:
+            flags |= TORRENT_FLAG_WAITING_CHECK;
+            flags |= TORRENT_FLAG_CHECKING_ANY;
+            break;
+        case TR_STATUS_CHECK:
+            flags |= TORRENT_FLAG_CHECKING;
+            flags |= TORRENT_FLAG_CHECKING_ANY;
+            break;
+        case TR_STATUS_DOWNLOAD_WAIT:
+            flags |= TORRENT_FLAG_DOWNLOADING_WAIT;
+            flags |= TORRENT_FLAG_QUEUED;
+            break;
+        case TR_STATUS_DOWNLOAD:
+            if (!(flags & TORRENT_FLAG_COMPLETE))
+                flags |= TORRENT_FLAG_DOWNLOADING;
+
+            if (t->fileCount <= 0)
+                flags |= TORRENT_FLAG_DOWNLOADING_METADATA;
+
+            flags |= TORRENT_FLAG_ACTIVE;
+            break;
+        case TR_STATUS_SEED_WAIT:
+            flags |= TORRENT_FLAG_SEEDING_WAIT;
+            break;
+        case TR_STATUS_SEED:
+            flags |= TORRENT_FLAG_SEEDING;
+            if (t->peersGettingFromUs)
+                flags |= TORRENT_FLAG_ACTIVE;
+            break;
+        }
+    } else {
+        switch (t->status) {
+        case OLD_STATUS_DOWNLOADING:
+            flags |= TORRENT_FLAG_DOWNLOADING;
+            break;
+        case OLD_STATUS_PAUSED:
+            flags |= TORRENT_FLAG_PAUSED;
+            break;
+        case OLD_STATUS_SEEDING:
+            flags |= TORRENT_FLAG_SEEDING;
+            break;
+        case OLD_STATUS_CHECKING:
+            flags |= TORRENT_FLAG_CHECKING;
+            break;
+        case OLD_STATUS_WAITING_TO_CHECK:
+            flags |= TORRENT_FLAG_WAITING_CHECK;
+            flags |= TORRENT_FLAG_CHECKING;
+            break;
+        }
+
+        if (t->rateDownload > 0 || t->rateUpload > 0)
+            flags |= TORRENT_FLAG_ACTIVE;
+    }
+
+    if (t->error > 0)
+        flags |= TORRENT_FLAG_ERROR;
+
+    return flags;
+}
+
+/* The tracker hosts are shortened with the same regex as everywhere else,
+ * made once, as trg_torrent_new() is called for every torrent. Matching
+ * with a GRegex is thread safe. */
+static GRegex *trg_torrent_host_regex(void)
+{
+    static gsize once = 0;
+    static GRegex *rx = NULL;
+
+    if (g_once_init_enter(&once)) {
+        rx = trg_uri_host_regex_new();
+        g_once_init_leave(&once, 1);
+    }
+
+    return rx;
+}
+
+static const gchar *trg_torrent_intern_host(const gchar * url)
+{
+    const gchar *interned = NULL;
+    gchar *host;
+
+    if (!url)
+        return NULL;
+
+    host = trg_gregex_get_first(trg_torrent_host_regex(), url);
+    if (host && *host)
+        interned = g_intern_string(host);
+
+    g_free(host);
+
+    return interned;
+}
+
+/* The members trg_torrent_new() decodes, so a table response's header can
+ * be mapped to them once (trg_torrent_columns_new()) and each row read by
+ * position, rather than every field of every torrent being looked up by
+ * name. */
+typedef enum {
+    TF_ID,
+    TF_TOTAL_SIZE,
+    TF_SIZE_WHEN_DONE,
+    TF_LEFT_UNTIL_DONE,
+    TF_HAVE_VALID,
+    TF_HAVE_UNCHECKED,
+    TF_DOWNLOADED_EVER,
+    TF_UPLOADED_EVER,
+    TF_CORRUPT_EVER,
+    TF_RATE_DOWNLOAD,
+    TF_RATE_UPLOAD,
+    TF_ETA,
+    TF_ADDED_DATE,
+    TF_DONE_DATE,
+    TF_ACTIVITY_DATE,
+    TF_DATE_CREATED,
+    TF_PERCENT_DONE,
+    TF_RECHECK_PROGRESS,
+    TF_METADATA_PERCENT_COMPLETE,
+    TF_SEED_RATIO_LIMIT,
+    TF_STATUS,
+    TF_ERROR,
+    TF_QUEUE_POSITION,
+    TF_BANDWIDTH_PRIORITY,
+    TF_DOWNLOAD_LIMIT,
+    TF_UPLOAD_LIMIT,
+    TF_PEER_LIMIT,
+    TF_SEED_RATIO_MODE,
+    TF_PEERS_CONNECTED,
+    TF_PEERS_SENDING_TO_US,
+    TF_PEERS_GETTING_FROM_US,
+    TF_WEB_SEEDS_SENDING_TO_US,
+    TF_FILE_COUNT,
+    TF_FILES,
+    TF_PRIORITIES,
+    TF_PEERSFROM,
+    TF_IS_PRIVATE,
+    TF_HONORS_SESSION_LIMITS,
+    TF_DOWNLOAD_LIMITED,
+    TF_UPLOAD_LIMITED,
+    TF_NAME,
+    TF_HASH_STRING,
+    TF_MAGNETLINK,
+    TF_COMMENT,
+    TF_ERROR_STRING,
+    TF_DOWNLOAD_DIR,
+    TF_CREATOR,
+    TF_TRACKER_STATS,
+    TF_COUNT
+} trg_torrent_field;
+
+static const gchar *trg_torrent_field_names[TF_COUNT] = {
+    FIELD_ID,
+    FIELD_TOTAL_SIZE,
+    FIELD_SIZEWHENDONE,
+    FIELD_LEFTUNTILDONE,
+    FIELD_HAVEVALID,
+    FIELD_HAVEUNCHECKED,
+    FIELD_DOWNLOADEDEVER,
+    FIELD_UPLOADEDEVER,
+    FIELD_CORRUPTEVER,
+    FIELD_RATEDOWNLOAD,
+    FIELD_RATEUPLOAD,
+    FIELD_ETA,
+    FIELD_ADDED_DATE,
+    FIELD_DONE_DATE,
+    FIELD_ACTIVITY_DATE,
+    FIELD_DATE_CREATED,
+    FIELD_PERCENTDONE,
+    FIELD_RECHECK_PROGRESS,
+    FIELD_METADATAPERCENTCOMPLETE,
+    FIELD_SEED_RATIO_LIMIT,
+    FIELD_STATUS,
+    FIELD_ERROR,
+    FIELD_QUEUE_POSITION,
+    FIELD_BANDWIDTH_PRIORITY,
+    FIELD_DOWNLOAD_LIMIT,
+    FIELD_UPLOAD_LIMIT,
+    FIELD_PEER_LIMIT,
+    FIELD_SEED_RATIO_MODE,
+    FIELD_PEERS_CONNECTED,
+    FIELD_PEERS_SENDING_TO_US,
+    FIELD_PEERS_GETTING_FROM_US,
+    FIELD_WEB_SEEDS_SENDING_TO_US,
+    FIELD_FILE_COUNT,
+    FIELD_FILES,
+    FIELD_PRIORITIES,
+    FIELD_PEERSFROM,
+    FIELD_ISPRIVATE,
+    FIELD_HONORS_SESSION_LIMITS,
+    FIELD_DOWNLOAD_LIMITED,
+    FIELD_UPLOAD_LIMITED,
+    FIELD_NAME,
+    FIELD_HASH_STRING,
+    FIELD_MAGNETLINK,
+    FIELD_COMMENT,
+    FIELD_ERROR_STRING,
+    FIELD_DOWNLOAD_DIR,
+    FIELD_CREATOR,
+    FIELD_TRACKER_STATS
+};
+
+/* Where each field is in a table response's rows, -1 if it isn't. */
+typedef struct {
+    gint index[TF_COUNT];
+} trg_torrent_columns;
+
+static trg_torrent_columns *trg_torrent_columns_new(JsonArray * header)
+{
+    trg_torrent_columns *cols = g_new(trg_torrent_columns, 1);
+    guint n = json_array_get_length(header);
+    guint i, f;
+
+    for (f = 0; f < TF_COUNT; f++)
+        cols->index[f] = -1;
+
+    for (i = 0; i < n; i++) {
+        const gchar *name = json_array_get_string_element(header, i);
+        for (f = 0; f < TF_COUNT; f++) {
+            if (!g_strcmp0(name, trg_torrent_field_names[f])) {
+                cols->index[f] = (gint) i;
+                break;
+            }
+        }
+    }
+
+    return cols;
+}
+
+/* A torrent to decode, either an object or a table row. */
+typedef struct {
+    JsonObject *obj;
+    JsonArray *row;
+    guint rowLen;
+    const trg_torrent_columns *cols;
+} trg_torrent_input;
+
+static JsonNode *trg_torrent_input_get(const trg_torrent_input * in,
+                                       trg_torrent_field f)
+{
+    if (in->row) {
+        gint i = in->cols->index[f];
+        return i >= 0 && (guint) i < in->rowLen ?
+            json_array_get_element(in->row, i) : NULL;
+    }
+
+    return json_object_get_member(in->obj, trg_torrent_field_names[f]);
+}
+
+static gint64 trg_torrent_input_int(const trg_torrent_input * in,
+                                    trg_torrent_field f, gint64 missing)
+{
+    JsonNode *node = trg_torrent_input_get(in, f);
+    return node && JSON_NODE_HOLDS_VALUE(node) ?
+        json_node_get_int(node) : missing;
+}
+
+static gboolean trg_torrent_input_bool(const trg_torrent_input * in,
+                                       trg_torrent_field f)
+{
+    JsonNode *node = trg_torrent_input_get(in, f);
+    return node && JSON_NODE_HOLDS_VALUE(node) ?
+        json_node_get_boolean(node) : FALSE;
+}
+
+static gdouble trg_torrent_input_double(const trg_torrent_input * in,
+                                        trg_torrent_field f,
+                                        gdouble missing)
+{
+    JsonNode *node = trg_torrent_input_get(in, f);
+    return node && JSON_NODE_HOLDS_VALUE(node) ?
+        json_node_really_get_double(node) : missing;
+}
+
+static const gchar *trg_torrent_input_string(const trg_torrent_input * in,
+                                             trg_torrent_field f)
+{
+    JsonNode *node = trg_torrent_input_get(in, f);
+    const gchar *str = NULL;
+
+    if (node && JSON_NODE_HOLDS_VALUE(node))
+        str = json_node_get_string(node);
+
+    return str ? str : "";
+}
+
+static JsonArray *trg_torrent_input_array(const trg_torrent_input * in,
+                                          trg_torrent_field f)
+{
+    JsonNode *node = trg_torrent_input_get(in, f);
+    return node && JSON_NODE_HOLDS_ARRAY(node) ?
+        json_node_get_array(node) : NULL;
+}
+
+static const gchar *trg_torrent_member_string(JsonObject * t,
+                                              const gchar * name)
+{
+    JsonNode *node = json_object_get_member(t, name);
+    const gchar *str = NULL;
+
+    if (node && JSON_NODE_HOLDS_VALUE(node))
+        str = json_node_get_string(node);
+
+    return str ? str : "";
+}
+
+static gint64 trg_torrent_member_int(JsonObject * t, const gchar * name)
+{
+    JsonNode *node = json_object_get_member(t, name);
+    return node && JSON_NODE_HOLDS_VALUE(node) ? json_node_get_int(node) : 0;
+}
+
+static void trg_torrent_decode_trackers(trg_torrent * t,
+                                        const trg_torrent_input * in)
+{
+    JsonArray *trackerStats = trg_torrent_input_array(in, TF_TRACKER_STATS);
+    guint i, n, hosts = 0;
+
+    if (!trackerStats && in->obj) {
+        /* From trg_torrent_to_json(), by way of a snapshot. */
+        JsonObject *obj = in->obj;
+        JsonArray *saved = json_object_has_member(obj,
+                                                  TORRENT_JSON_ANNOUNCE_HOSTS)
+            ? json_object_get_array_member(obj,
+                                           TORRENT_JSON_ANNOUNCE_HOSTS) :
+            NULL;
+
+        n = saved ? json_array_get_length(saved) : 0;
+        t->announceHosts = g_new0(const gchar *, n + 1);
+        for (i = 0; i < n; i++) {
+            const gchar *host = json_array_get_string_element(saved, i);
+            if (host && *host)
+                t->announceHosts[hosts++] = g_intern_string(host);
+        }
+
+        if (json_object_has_member(obj, TORRENT_JSON_TRACKER_HOST))
+            t->trackerHost =
+                g_intern_string(trg_torrent_member_string
+                                (obj, TORRENT_JSON_TRACKER_HOST));
+
+        t->seeders = trg_torrent_member_int(obj, TORRENT_JSON_SEEDERS);
+        t->leechers = trg_torrent_member_int(obj, TORRENT_JSON_LEECHERS);
+        t->downloads = trg_torrent_member_int(obj, TORRENT_JSON_DOWNLOADS);
+
+        return;
+    }
+
+    n = trackerStats ? json_array_get_length(trackerStats) : 0;
+    t->announceHosts = g_new0(const gchar *, n + 1);
+
+    for (i = 0; i < n; i++) {
+        JsonObject *tracker = json_array_get_object_element(trackerStats, i);
+        const gchar *host =
+            trg_torrent_intern_host(tracker_stats_get_announce(tracker));
+
+        if (host)
+            t->announceHosts[hosts++] = host;
+
+        if (i == 0)
+            t->trackerHost =
+                trg_torrent_intern_host(tracker_stats_get_host(tracker));
+
+        t->seeders += tracker_stats_get_seeder_count(tracker);
+        t->leechers += tracker_stats_get_leecher_count(tracker);
+        t->downloads += tracker_stats_get_download_count(tracker);
+    }
+}
+
+static trg_torrent *trg_torrent_decode(const trg_torrent_input * in,
+                                       gint64 rpcv)
+{
+    trg_torrent *t = g_slice_new0(trg_torrent);
+    JsonNode *pfNode = trg_torrent_input_get(in, TF_PEERSFROM);
+    JsonArray *perFile;
+    gchar *downloadDir;
+
+    t->refs = 1;
+
+    t->id = trg_torrent_input_int(in, TF_ID, 0);
+    t->totalSize = trg_torrent_input_int(in, TF_TOTAL_SIZE, 0);
+    t->sizeWhenDone = trg_torrent_input_int(in, TF_SIZE_WHEN_DONE, 0);
+    t->leftUntilDone = trg_torrent_input_int(in, TF_LEFT_UNTIL_DONE, 0);
+    t->haveValid = trg_torrent_input_int(in, TF_HAVE_VALID, 0);
+    t->haveUnchecked = trg_torrent_input_int(in, TF_HAVE_UNCHECKED, 0);
+    t->downloadedEver = trg_torrent_input_int(in, TF_DOWNLOADED_EVER, 0);
+    t->uploadedEver = trg_torrent_input_int(in, TF_UPLOADED_EVER, 0);
+    t->corruptEver = trg_torrent_input_int(in, TF_CORRUPT_EVER, 0);
+    t->rateDownload = trg_torrent_input_int(in, TF_RATE_DOWNLOAD, 0);
+    t->rateUpload = trg_torrent_input_int(in, TF_RATE_UPLOAD, 0);
+    t->eta = trg_torrent_input_int(in, TF_ETA, 0);
+    t->addedDate = trg_torrent_input_int(in, TF_ADDED_DATE, 0);
+    t->doneDate = trg_torrent_input_int(in, TF_DONE_DATE, 0);
+    t->activityDate = trg_torrent_input_int(in, TF_ACTIVITY_DATE, 0);
+    t->dateCreated = trg_torrent_input_int(in, TF_DATE_CREATED, 0);
+
+    t->percentDone =
+        trg_torrent_input_double(in, TF_PERCENT_DONE, 0.0) * 100.0;
+    t->recheckProgress =
+        trg_torrent_input_double(in, TF_RECHECK_PROGRESS, 0.0) * 100.0;
+    t->metadataPercentComplete =
+        trg_torrent_input_double(in, TF_METADATA_PERCENT_COMPLETE,
+                                 1.0) * 100.0;
+    t->seedRatioLimit =
+        trg_torrent_input_double(in, TF_SEED_RATIO_LIMIT, 0.0);
+
+    t->status = trg_torrent_input_int(in, TF_STATUS, 0);
+    t->error = trg_torrent_input_int(in, TF_ERROR, 0);
+    t->queuePosition = trg_torrent_input_int(in, TF_QUEUE_POSITION, -1);
+    t->bandwidthPriority =
+        trg_torrent_input_int(in, TF_BANDWIDTH_PRIORITY, 0);
+    t->downloadLimit = trg_torrent_input_int(in, TF_DOWNLOAD_LIMIT, 0);
+    t->uploadLimit = trg_torrent_input_int(in, TF_UPLOAD_LIMIT, 0);
+    t->peerLimit = trg_torrent_input_int(in, TF_PEER_LIMIT, 0);
+    t->seedRatioMode = trg_torrent_input_int(in, TF_SEED_RATIO_MODE, 0);
+    t->peersConnected = trg_torrent_input_int(in, TF_PEERS_CONNECTED, 0);
+    t->peersSendingToUs =
+        trg_torrent_input_int(in, TF_PEERS_SENDING_TO_US, 0);
+    t->peersGettingFromUs =
+        trg_torrent_input_int(in, TF_PEERS_GETTING_FROM_US, 0);
+    t->webSeedsSendingToUs =
+        trg_torrent_input_int(in, TF_WEB_SEEDS_SENDING_TO_US, 0);
+
+    /* As torrent_get_file_count(). */
+    if (trg_torrent_input_get(in, TF_FILE_COUNT))
+        t->fileCount = trg_torrent_input_int(in, TF_FILE_COUNT, 0);
+    else if ((perFile = trg_torrent_input_array(in, TF_FILES))
+             || (perFile = trg_torrent_input_array(in, TF_PRIORITIES)))
+        t->fileCount = json_array_get_length(perFile);
+
+    if (pfNode && JSON_NODE_HOLDS_OBJECT(pfNode)) {
+        JsonObject *pf = json_node_get_object(pfNode);
+        t->fromTrackers = peerfrom_get_trackers(pf);
+        t->fromIncoming = peerfrom_get_incoming(pf);
+        t->fromLtep = peerfrom_get_ltep(pf);
+        t->fromDht = peerfrom_get_dht(pf);
+        t->fromPex = peerfrom_get_pex(pf);
+        t->fromLpd = peerfrom_get_lpd(pf);
+        t->fromResume = peerfrom_get_resume(pf);
+    } else {
+        t->fromLpd = -1;
+    }
+
+    t->isPrivate = trg_torrent_input_bool(in, TF_IS_PRIVATE);
+    t->honorsSessionLimits =
+        trg_torrent_input_bool(in, TF_HONORS_SESSION_LIMITS);
+    t->downloadLimited = trg_torrent_input_bool(in, TF_DOWNLOAD_LIMITED);
+    t->uploadLimited = trg_torrent_input_bool(in, TF_UPLOAD_LIMITED);
+
+    t->name = g_strdup(trg_torrent_input_string(in, TF_NAME));
+    t->hashString = g_strdup(trg_torrent_input_string(in, TF_HASH_STRING));
+    t->magnetLink = g_strdup(trg_torrent_input_string(in, TF_MAGNETLINK));
+    t->comment = g_strdup(trg_torrent_input_string(in, TF_COMMENT));
+    t->errorString =
+        g_strdup(trg_torrent_input_string(in, TF_ERROR_STRING));
+
+    downloadDir = g_strdup(trg_torrent_input_string(in, TF_DOWNLOAD_DIR));
+    rm_trailing_slashes(downloadDir);
+    t->downloadDir = g_intern_string(downloadDir);
+    g_free(downloadDir);
+
+    t->creator = g_intern_string(trg_torrent_input_string(in, TF_CREATOR));
+
+    trg_torrent_decode_trackers(t, in);
+
+    t->flags = trg_torrent_get_flags(t, rpcv);
+    t->statusString = torrent_get_status_string(rpcv, t->status, t->flags);
+    t->statusIcon = torrent_get_status_icon(rpcv, t->flags);
+
+    return t;
+}
+
+/* Decode a torrent object from a torrent-get response (or a snapshot). The
+ * object isn't referenced, so can be dropped straight after. */
+trg_torrent *trg_torrent_new(JsonObject * obj, gint64 rpcv)
+{
+    trg_torrent_input in = { obj, NULL, 0, NULL };
+    return trg_torrent_decode(&in, rpcv);
+}
+
+/* Decode all of a torrent-get response's torrents, in either form. A table
+ * (a header array of field names, then one array of values per torrent)
+ * has its header mapped to fields once, and each row is read by position.
+ * Only reads the array, so it can be shared. */
+GPtrArray *trg_torrents_decode(JsonArray * torrents, gint64 rpcv)
+{
+    guint n = torrents ? json_array_get_length(torrents) : 0;
+    GPtrArray *decoded = g_ptr_array_sized_new(n);
+    trg_torrent_input in = { NULL, NULL, 0, NULL };
+    trg_torrent_columns *cols;
+    guint i;
+
+    if (n < 1)
+        return decoded;
+
+    if (!JSON_NODE_HOLDS_ARRAY(json_array_get_element(torrents, 0))) {
+        for (i = 0; i < n; i++) {
+            in.obj = json_array_get_object_element(torrents, i);
+            g_ptr_array_add(decoded, trg_torrent_decode(&in, rpcv));
+        }
+        return decoded;
+    }
+
+    cols = trg_torrent_columns_new(json_array_get_array_element
+                                   (torrents, 0));
+    in.cols = cols;
+
+    for (i = 1; i < n; i++) {
+        in.row = json_array_get_array_element(torrents, i);
+        in.rowLen = json_array_get_length(in.row);
+        g_ptr_array_add(decoded, trg_torrent_decode(&in, rpcv));
+    }
+
+    g_free(cols);
+
+    return decoded;
+}
+
+trg_torrent *trg_torrent_ref(trg_torrent * t)
+{
+    g_atomic_int_inc(&t->refs);
+    return t;
+}
+
+static void trg_torrent_details_free(trg_torrent_details * d)
+{
+    if (!d)
+        return;
+
+    if (d->files)
+        json_array_unref(d->files);
+    if (d->peers)
+        json_array_unref(d->peers);
+    if (d->wanted)
+        json_array_unref(d->wanted);
+    if (d->priorities)
+        json_array_unref(d->priorities);
+    if (d->trackerStats)
+        json_array_unref(d->trackerStats);
+
+    g_slice_free(trg_torrent_details, d);
+}
+
+void trg_torrent_unref(trg_torrent * t)
+{
+    if (!t || !g_atomic_int_dec_and_test(&t->refs))
+        return;
+
+    trg_torrent_details_free(t->details);
+    g_free(t->announceHosts);
+    g_free(t->name);
+    g_free(t->hashString);
+    g_free(t->magnetLink);
+    g_free(t->comment);
+    g_free(t->errorString);
+
+    g_slice_free(trg_torrent, t);
+}
+
+static JsonArray *trg_torrent_details_array(JsonObject * details,
+                                            const gchar * name)
+{
+    JsonNode *node = json_object_get_member(details, name);
+
+    if (node && JSON_NODE_HOLDS_ARRAY(node))
+        return json_array_ref(json_node_get_array(node));
+
+    return NULL;
+}
+
+/* Keep the arrays from a torrent_get_details() response for this torrent,
+ * replacing any from before. */
+void trg_torrent_set_details(trg_torrent * t, JsonObject * details)
+{
+    trg_torrent_details *d = g_slice_new0(trg_torrent_details);
+
+    d->files = trg_torrent_details_array(details, FIELD_FILES);
+    d->peers = trg_torrent_details_array(details, FIELD_PEERS);
+    d->wanted = trg_torrent_details_array(details, FIELD_WANTED);
+    d->priorities = trg_torrent_details_array(details, FIELD_PRIORITIES);
+    d->trackerStats =
+        trg_torrent_details_array(details, FIELD_TRACKER_STATS);
+
+    trg_torrent_details_free(t->details);
+    t->details = d;
+}
+
+/* When a torrent is decoded again by a list update, carry its details over
+ * until the next details response replaces them. */
+void trg_torrent_take_details(trg_torrent * dst, trg_torrent * src)
+{
+    if (!src->details || dst->details)
+        return;
+
+    dst->details = src->details;
+    src->details = NULL;
+}
+
+/* Whether this torrent has been through a torrent_get_details() request,
+ * and has files/peers/wanted/priorities/trackers for the notebook. */
+gboolean trg_torrent_has_details(trg_torrent * t)
+{
+    return t->details && t->details->files && t->details->peers
+        && t->details->wanted && t->details->priorities
+        && t->details->trackerStats;
+}
+
+/* Whether two records have the same tracker hosts, in the same order. */
+gboolean trg_torrent_announce_hosts_equal(trg_torrent * a, trg_torrent * b)
+{
+    const gchar **ha, **hb;
+
+    /* Interned, so the same host is the same pointer. */
+    for (ha = a->announceHosts, hb = b->announceHosts; *ha && *hb;
+         ha++, hb++)
+        if (*ha != *hb)
+            return FALSE;
+
+    return !*ha && !*hb;
+}
+
+/* Whether two records decoded the same, details aside. */
+gboolean trg_torrent_equal(trg_torrent * a, trg_torrent * b)
+{
+    if (memcmp(&a->id, &b->id,
+               G_STRUCT_OFFSET(trg_torrent, flags) + sizeof(a->flags) -
+               G_STRUCT_OFFSET(trg_torrent, id)))
+        return FALSE;
+
+    if (a->isPrivate != b->isPrivate
+        || a->honorsSessionLimits != b->honorsSessionLimits
+        || a->downloadLimited != b->downloadLimited
+        || a->uploadLimited != b->uploadLimited)
+        return FALSE;
+
+    /* Interned or static, so the same string is the same pointer. */
+    if (a->downloadDir != b->downloadDir || a->creator != b->creator
+        || a->trackerHost != b->trackerHost
+        || a->statusString != b->statusString
+        || a->statusIcon != b->statusIcon)
+        return FALSE;
+
+    if (!trg_torrent_announce_hosts_equal(a, b))
+        return FALSE;
+
+    return !g_strcmp0(a->name, b->name)
+        && !g_strcmp0(a->hashString, b->hashString)
+        && !g_strcmp0(a->magnetLink, b->magnetLink)
+        && !g_strcmp0(a->comment, b->comment)
+        && !g_strcmp0(a->errorString, b->errorString);
+}
+
+gboolean trg_torrent_has_announce_host(trg_torrent * t, const gchar * host)
+{
+    const gchar **h;
+
+    for (h = t->announceHosts; h && *h; h++)
+        if (!g_strcmp0(*h, host))
+            return TRUE;
+
+    return FALSE;
+}
+
+/* The record as a torrent-get style object, for the things which work with
+ * any field by name: the snapshot, the properties dialog's limits and the
+ * remote commands. The details aren't included. */
+JsonObject *trg_torrent_to_json(trg_torrent * t)
+{
+    JsonObject *obj = json_object_new();
+    JsonObject *pf = json_object_new();
+    JsonArray *hosts = json_array_new();
+    const gchar **h;
+
+    json_object_set_int_member(obj, FIELD_ID, t->id);
+    json_object_set_string_member(obj, FIELD_NAME, t->name);
+    json_object_set_int_member(obj, FIELD_TOTAL_SIZE, t->totalSize);
+    json_object_set_int_member(obj, FIELD_SIZEWHENDONE, t->sizeWhenDone);
+    json_object_set_int_member(obj, FIELD_LEFTUNTILDONE, t->leftUntilDone);
+    json_object_set_boolean_member(obj, FIELD_ISFINISHED,
+                                   t->leftUntilDone <= 0);
+    json_object_set_int_member(obj, FIELD_HAVEVALID, t->haveValid);
+    json_object_set_int_member(obj, FIELD_HAVEUNCHECKED, t->haveUnchecked);
+    json_object_set_int_member(obj, FIELD_DOWNLOADEDEVER, t->downloadedEver);
+    json_object_set_int_member(obj, FIELD_UPLOADEDEVER, t->uploadedEver);
+    json_object_set_int_member(obj, FIELD_CORRUPTEVER, t->corruptEver);
+    json_object_set_int_member(obj, FIELD_RATEDOWNLOAD, t->rateDownload);
+    json_object_set_int_member(obj, FIELD_RATEUPLOAD, t->rateUpload);
+    json_object_set_int_member(obj, FIELD_ETA, t->eta);
+    json_object_set_int_member(obj, FIELD_ADDED_DATE, t->addedDate);
+    json_object_set_int_member(obj, FIELD_DONE_DATE, t->doneDate);
+    json_object_set_int_member(obj, FIELD_ACTIVITY_DATE, t->activityDate);
+    json_object_set_int_member(obj, FIELD_DATE_CREATED, t->dateCreated);
+
+    /* Stored as percentages, sent as fractions. */
+    json_object_set_double_member(obj, FIELD_PERCENTDONE,
+                                  t->percentDone / 100.0);
+    json_object_set_double_member(obj, FIELD_RECHECK_PROGRESS,
+                                  t->recheckProgress / 100.0);
+    json_object_set_double_member(obj, FIELD_METADATAPERCENTCOMPLETE,
+                                  t->metadataPercentComplete / 100.0);
+    json_object_set_double_member(obj, FIELD_SEED_RATIO_LIMIT,
+                                  t->seedRatioLimit);
+
+    json_object_set_int_member(obj, FIELD_STATUS, t->status);
+    json_object_set_int_member(obj, FIELD_ERROR, t->error);
+    json_object_set_string_member(obj, FIELD_ERROR_STRING, t->errorString);
+    if (t->queuePosition >= 0)
+        json_object_set_int_member(obj, FIELD_QUEUE_POSITION,
+                                   t->queuePosition);
+    json_object_set_int_member(obj, FIELD_BANDWIDTH_PRIORITY,
+                               t->bandwidthPriority);
+    json_object_set_int_member(obj, FIELD_DOWNLOAD_LIMIT, t->downloadLimit);
+    json_object_set_boolean_member(obj, FIELD_DOWNLOAD_LIMITED,
+                                   t->downloadLimited);
+    json_object_set_int_member(obj, FIELD_UPLOAD_LIMIT, t->uploadLimit);
+    json_object_set_boolean_member(obj, FIELD_UPLOAD_LIMITED,
+                                   t->uploadLimited);
+    json_object_set_boolean_member(obj, FIELD_HONORS_SESSION_LIMITS,
+                                   t->honorsSessionLimits);
+    json_object_set_int_member(obj, FIELD_PEER_LIMIT, t->peerLimit);
+    json_object_set_int_member(obj, FIELD_SEED_RATIO_MODE, t->seedRatioMode);
+    json_object_set_int_member(obj, FIELD_PEERS_CONNECTED,
+                               t->peersConnected);
+    json_object_set_int_member(obj, FIELD_PEERS_SENDING_TO_US,
+                               t->peersSendingToUs);
+    json_object_set_int_member(obj, FIELD_PEERS_GETTING_FROM_US,
+                               t->peersGettingFromUs);
+    json_object_set_int_member(obj, FIELD_WEB_SEEDS_SENDING_TO_US,
+                               t->webSeedsSendingToUs);
+    json_object_set_int_member(obj, FIELD_FILE_COUNT, t->fileCount);
+    json_object_set_boolean_member(obj, FIELD_ISPRIVATE, t->isPrivate);
+
+    json_object_set_string_member(obj, FIELD_HASH_STRING, t->hashString);
+    json_object_set_string_member(obj, FIELD_MAGNETLINK, t->magnetLink);
+    json_object_set_string_member(obj, FIELD_COMMENT, t->comment);
+    json_object_set_string_member(obj, FIELD_DOWNLOAD_DIR, t->downloadDir);
+    json_object_set_string_member(obj, FIELD_CREATOR, t->creator);
+
+    json_object_set_int_member(pf, TPEERFROM_FROMTRACKERS, t->fromTrackers);
+    json_object_set_int_member(pf, TPEERFROM_FROMINCOMING, t->fromIncoming);
+    json_object_set_int_member(pf, TPEERFROM_FROMLTEP, t->fromLtep);
+    json_object_set_int_member(pf, TPEERFROM_FROMDHT, t->fromDht);
+    json_object_set_int_member(pf, TPEERFROM_FROMPEX, t->fromPex);
+    if (t->fromLpd >= 0)
+        json_object_set_int_member(pf, TPEERFROM_FROMLPD, t->fromLpd);
+    json_object_set_int_member(pf, TPEERFROM_FROMRESUME, t->fromResume);
+    json_object_set_object_member(obj, FIELD_PEERSFROM, pf);
+
+    for (h = t->announceHosts; h && *h; h++)
+        json_array_add_string_element(hosts, *h);
+    json_object_set_array_member(obj, TORRENT_JSON_ANNOUNCE_HOSTS, hosts);
+    if (t->trackerHost)
+        json_object_set_string_member(obj, TORRENT_JSON_TRACKER_HOST,
+                                      t->trackerHost);
+    json_object_set_int_member(obj, TORRENT_JSON_SEEDERS, t->seeders);
+    json_object_set_int_member(obj, TORRENT_JSON_LEECHERS, t->leechers);
+    json_object_set_int_member(obj, TORRENT_JSON_DOWNLOADS, t->downloads);
+
+    return obj;
+}
+
+gchar *trg_torrent_get_full_path(trg_torrent * t)
+{
+    return g_strdup_printf("%s/%s", t->downloadDir, t->name);
+}
+
+gchar *trg_torrent_get_full_dir(trg_torrent * t)
+{
+    gchar *containing_path, *name, *delim;
+    JsonObject *firstFile;
+
+    if (!t->details || !t->details->files
+        || json_array_get_length(t->details->files) < 1)
+        return g_strdup(t->downloadDir);
+
+    firstFile = json_array_get_object_element(t->details->files, 0);
+    name = g_strdup(json_object_get_string_member(firstFile, TFILE_NAME));
+
+    if ((delim = g_strstr_len(name, -1, "/"))) {
+        *delim = '\0';
+        containing_path = g_strdup_printf("%s/%s", t->downloadDir, name);
+    } else {
+        containing_path = g_strdup(t->downloadDir);
+    }
+
+    g_free(name);
+    return containing_path;
+}
@@ -40,10 +40,128 @@
 #define TORRENT_FLAG_DOWNLOADING_METADATA (1 << 13)
 #define FILTER_FLAG_TRACKER            (1 << 14)
 #define FILTER_FLAG_DIR                (1 << 15)
+#define FILTER_FLAG_SOURCE             (1 << 16)
 
 #define TORRENT_ADD_FLAG_PAUSED        (1 << 0) /* 0x01 */
 #define TORRENT_ADD_FLAG_DELETE        (1 << 1) /* 0x02 */
 
+/* Not RPC fields. The tracker stats aren't kept in a trg_torrent, so
+ * trg_torrent_to_json() gives what was taken from them instead, and
+ * trg_torrent_new() accepts that in their place. */
+#define TORRENT_JSON_TRACKER_HOST      "trg-tracker-host"
+#define TORRENT_JSON_ANNOUNCE_HOSTS    "trg-announce-hosts"
+#define TORRENT_JSON_SEEDERS           "trg-seeders"
+#define TORRENT_JSON_LEECHERS          "trg-leechers"
+#define TORRENT_JSON_DOWNLOADS         "trg-downloads"
+
+/* The arrays which only come from a torrent_get_details() request, for the
+ * selected torrent. Each holds a reference. */
+typedef struct {
+    JsonArray *files;
+    JsonArray *peers;
+    JsonArray *wanted;
+    JsonArray *priorities;
+    JsonArray *trackerStats;
+} trg_torrent_details;
+
+/* A torrent from a torrent-get response, decoded once by trg_torrent_new()
+ * into what the list, panels and dialogs show, so they read fields rather
+ * than looking up members of a JsonObject. Strings many torrents share are
+ * interned, and the details are NULL except for the selected torrent.
+ * Nothing but the details changes after decoding. */
+typedef struct {
+    volatile gint refs;
+
+    /* From id to flags is compared as a block by trg_torrent_equal(), so
+     * keep the numbers together. */
+    gint64 id;
+    gint64 totalSize;
+    gint64 sizeWhenDone;
+    gint64 leftUntilDone;
+    gint64 haveValid;
+    gint64 haveUnchecked;
+    gint64 downloadedEver;
+    gint64 uploadedEver;
+    gint64 corruptEver;
+    gint64 rateDownload;
+    gint64 rateUpload;
+    gint64 eta;
+    gint64 addedDate;
+    gint64 doneDate;
+    gint64 activityDate;
+    gint64 dateCreated;
+    /* Summed over the trackers. */
+    gint64 seeders;
+    gint64 leechers;
+    gint64 downloads;
+
+    gdouble percentDone;
+    gdouble recheckProgress;
+    gdouble metadataPercentComplete;
+    gdouble seedRatioLimit;
+
+    gint32 status;
+    gint32 error;
+    gint32 queuePosition;       /* -1 without queues (RPC < 14) */
+    gint32 bandwidthPriority;
+    gint32 downloadLimit;
+    gint32 uploadLimit;
+    gint32 peerLimit;
+    gint32 seedRatioMode;
+    gint32 peersConnected;
+    gint32 peersSendingToUs;
+    gint32 peersGettingFromUs;
+    gint32 webSeedsSendingToUs;
+    gint32 fromTrackers;
+    gint32 fromIncoming;
+    gint32 fromLtep;
+    gint32 fromDht;
+    gint32 fromPex;
+    gint32 fromLpd;             /* -1 if the daemon doesn't say */
+    gint32 fromResume;
+    guint32 fileCount;
+    guint32 flags;
+
+    guint isPrivate:1;
+    guint honorsSessionLimits:1;
+    guint downloadLimited:1;
+    guint uploadLimited:1;
+
+    gchar *name;
+    gchar *hashString;
+    gchar *magnetLink;
+    gchar *comment;
+    gchar *errorString;
+
+    /* Interned. */
+    const gchar *downloadDir;   /* without trailing slashes */
+    const gchar *creator;
+    const gchar *trackerHost;   /* of the first tracker, or NULL */
+    const gchar **announceHosts;        /* NULL terminated */
+
+    /* Static. */
+    const gchar *statusString;
+    const gchar *statusIcon;
+
+    trg_torrent_details *details;
+} trg_torrent;
+
+trg_torrent *trg_torrent_new(JsonObject * t, gint64 rpcv);
+GPtrArray *trg_torrents_decode(JsonArray * torrents, gint64 rpcv);
+trg_torrent *trg_torrent_ref(trg_torrent * t);
+void trg_torrent_unref(trg_torrent * t);
+JsonObject *trg_torrent_to_json(trg_torrent * t);
+void trg_torrent_set_details(trg_torrent * t, JsonObject * details);
+void trg_torrent_take_details(trg_torrent * dst, trg_torrent * src);
+gboolean trg_torrent_has_details(trg_torrent * t);
+gboolean trg_torrent_equal(trg_torrent * a, trg_torrent * b);
+gboolean trg_torrent_announce_hosts_equal(trg_torrent * a,
+                                          trg_torrent * b);
+gboolean trg_torrent_has_announce_host(trg_torrent * t,
+                                       const gchar * host);
+gchar *trg_torrent_get_full_dir(trg_torrent * t);
+gchar *trg_torrent_get_full_path(trg_torrent * t);
+
 gint64 torrent_get_total_size(JsonObject * t);
 gint64 torrent_get_size_when_done(JsonObject * t);
 const gchar *torrent_get_name(JsonObject * t);
@@ -63,11 +181,9 @@ gint64 torrent_get_status(JsonObject * t);
 const gchar *torrent_get_creator(JsonObject * t);
 gint64 torrent_get_date_created(JsonObject * t);
 const gchar *torrent_get_hash(JsonObject * t);
-gchar *torrent_get_status_string(gint64 rpcv, gint64 value, guint flags);
-gchar *torrent_get_status_icon(gint64 rpcv, guint flags);
-guint32 torrent_get_flags(JsonObject * t, gint64 rpcv, gint64 status,
-                          gint64 fileCount, gint64 downRate,
-                          gint64 upRate);
+const gchar *torrent_get_status_string(gint64 rpcv, gint64 value,
+                                      guint flags);
+const gchar *torrent_get_status_icon(gint64 rpcv, guint flags);
 JsonArray *torrent_get_peers(JsonObject * t);
 JsonObject *torrent_get_peersfrom(JsonObject * t);
 JsonArray *torrent_get_tracker_stats(JsonObject * t);
@@ -75,6 +191,7 @@ JsonArray *torrent_get_wanted(JsonObject * t);
 JsonArray *torrent_get_priorities(JsonObject * t);
 gint64 torrent_get_id(JsonObject * t);
 JsonArray *torrent_get_files(JsonObject * args);
+guint torrent_get_file_count(JsonObject * t);
 gint64 torrent_get_peers_getting_from_us(JsonObject * args);
 gint64 torrent_get_peers_sending_to_us(JsonObject * args);
 gint64 torrent_get_web_seeds_sending_to_us(JsonObject * args);
@@ -96,16 +213,14 @@ gboolean torrent_get_download_limited(JsonObject * t);
 gdouble torrent_get_seed_ratio_limit(JsonObject * t);
 gint64 torrent_get_seed_ratio_mode(JsonObject * t);
 gint64 torrent_get_peer_limit(JsonObject * t);
-gboolean torrent_has_tracker(JsonObject * t, GRegex * rx, gchar * search);
 gint64 torrent_get_queue_position(JsonObject * args);
 gint64 torrent_get_activity_date(JsonObject * t);
-gchar *torrent_get_full_dir(JsonObject * obj);
-gchar *torrent_get_full_path(JsonObject * obj);
 gdouble torrent_get_metadata_percent_complete(JsonObject * t);
 
 /* outer response object */
 
 JsonArray *get_torrents(JsonObject * response);
+guint get_torrents_count(JsonObject * response);
 JsonArray *get_torrents_removed(JsonObject * response);
 
 /* tracker stats */
@@ -0,0 +1,445 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <curl/curl.h>
+
+#include "protocol-constants.h"
+#include "requests.h"
+#include "json.h"
+#include "util.h"
+#include "trg-prefs.h"
+#include "trg-client.h"
+#include "trg-torrent-model.h"
+#include "trg-client-group.h"
+
+/* The profiles marked "connect alongside", connected while the main window
+ * is connected to another, with their torrents merged into its model.
+ *
+ * Each has its own TrgClient, so its own session, request threads and poll
+ * timer, and the daemons are polled in parallel. The clients are kept
+ * across reconnects rather than made again each time. Members are matched
+ * up with the profiles again whenever those change, and one whose profile
+ * is gone or no longer connects alongside is retired: stopped, dropped from
+ * the group, and freed along with its client once the requests it still
+ * has queued are done (trg_client_retire()).
+ */
+
+typedef struct {
+    trg_client_group *group;
+    TrgClient *client;
+    JsonObject *profile;
+    guint timerId;
+    gboolean active;
+    gboolean first;
+    gboolean refresh;           /* poll again as soon as this one's done */
+} trg_client_group_member;
+
+struct _trg_client_group {
+    TrgTorrentModel *model;
+    GList *members;
+    TrgPrefs *prefs;            /* main's, once it has connected */
+    TrgClient *main;            /* while connected */
+};
+
+static void trg_client_group_poll(trg_client_group_member * m);
+
+trg_client_group *trg_client_group_new(TrgTorrentModel * model)
+{
+    trg_client_group *g = g_new0(trg_client_group, 1);
+    g->model = model;
+    return g;
+}
+
+static gboolean trg_client_group_poll_timerfunc(gpointer data)
+{
+    trg_client_group_member *m = (trg_client_group_member *) data;
+
+    m->timerId = 0;
+    trg_client_group_poll(m);
+
+    return FALSE;
+}
+
+/* Backs off while a daemon is failing, like the main poll. */
+static void trg_client_group_schedule(trg_client_group_member * m)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(m->client);
+    guint interval = trg_prefs_get_int(prefs, TRG_PREFS_KEY_UPDATE_INTERVAL,
+                                       TRG_PREFS_CONNECTION);
+
+    if (m->refresh) {
+        m->refresh = FALSE;
+        m->timerId = g_idle_add(trg_client_group_poll_timerfunc, m);
+        return;
+    }
+
+    interval = MIN(MAX(interval, 1) *
+                   (trg_client_get_failcount(m->client) + 1),
+                   TRG_INTERVAL_BACKOFF_MAX);
+
+    m->timerId = g_timeout_add_seconds(interval,
+                                       trg_client_group_poll_timerfunc, m);
+}
+
+static gboolean
+trg_client_group_failed(trg_client_group_member * m,
+                        trg_response * response)
+{
+    if (response->status == CURLE_OK)
+        return FALSE;
+
+    if (trg_client_inc_failcount(m->client) == 1) {
+        gchar *msg = make_error_message(response->obj, response->status);
+        gchar *url = trg_client_get_url(m->client);
+        g_warning("%s: %s", url, msg);
+        g_free(url);
+        g_free(msg);
+    }
+
+    return TRUE;
+}
+
+static gboolean on_group_torrent_prepared(gpointer data)
+{
+    trg_torrent_model_changes *changes =
+        (trg_torrent_model_changes *) data;
+    trg_response *response =
+        (trg_response *) trg_torrent_model_changes_get_data(changes);
+    trg_client_group_member *m =
+        (trg_client_group_member *) response->cb_data;
+
+    /* Dropped if the member was disconnected in the meantime, and if it's
+     * since been reconnected, that's already polling again. */
+    if (trg_torrent_model_changes_get_stats(changes)) {
+        m->first = FALSE;
+        trg_client_group_schedule(m);
+    }
+
+    trg_response_free(response);
+
+    return FALSE;
+}
+
+static gboolean on_group_torrent_get(gpointer data, gint mode)
+{
+    trg_response *response = (trg_response *) data;
+    trg_client_group_member *m =
+        (trg_client_group_member *) response->cb_data;
+
+    if (!m->active) {
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    if (!trg_client_group_failed(m, response)) {
+        trg_client_reset_failcount(m->client);
+
+        if (m->first)
+            mode = TORRENT_GET_MODE_FIRST;
+
+        trg_client_inc_serial(m->client);
+        trg_torrent_model_prepare_async(m->group->model, m->client,
+                                        response->obj, mode,
+                                        on_group_torrent_prepared,
+                                        response);
+        return FALSE;
+    }
+
+    trg_client_group_schedule(m);
+    trg_response_free(response);
+
+    return FALSE;
+}
+
+static gboolean on_group_torrent_get_active(gpointer data)
+{
+    return on_group_torrent_get(data, TORRENT_GET_MODE_ACTIVE);
+}
+
+static gboolean on_group_torrent_get_update(gpointer data)
+{
+    return on_group_torrent_get(data, TORRENT_GET_MODE_UPDATE);
+}
+
+static gboolean on_group_session_get(gpointer data)
+{
+    trg_response *response = (trg_response *) data;
+    trg_client_group_member *m =
+        (trg_client_group_member *) response->cb_data;
+
+    if (!m->active) {
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    if (trg_client_group_failed(m, response)) {
+        trg_client_group_schedule(m);
+    } else {
+        trg_client_reset_failcount(m->client);
+        trg_client_set_session(m->client, get_arguments(response->obj));
+        trg_client_group_poll(m);
+    }
+
+    trg_response_free(response);
+
+    return FALSE;
+}
+
+static void trg_client_group_poll(trg_client_group_member * m)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(m->client);
+    gboolean activeOnly;
+
+    if (!trg_client_is_connected(m->client)) {
+        dispatch_async(m->client, session_get(), on_group_session_get, m);
+        return;
+    }
+
+    /* As the main window's poll decides it. */
+    activeOnly = !m->first
+        && trg_prefs_get_bool(prefs, TRG_PREFS_KEY_UPDATE_ACTIVE_ONLY,
+                              TRG_PREFS_CONNECTION)
+        && (!trg_prefs_get_bool(prefs,
+                                TRG_PREFS_ACTIVEONLY_FULLSYNC_ENABLED,
+                                TRG_PREFS_CONNECTION)
+            || (trg_client_get_serial(m->client) %
+                trg_prefs_get_int(prefs,
+                                  TRG_PREFS_ACTIVEONLY_FULLSYNC_EVERY,
+                                  TRG_PREFS_CONNECTION) != 0));
+
+    dispatch_async(m->client,
+                   torrent_get(m->client,
+                               activeOnly ? TORRENT_GET_TAG_MODE_UPDATE :
+                               TORRENT_GET_TAG_MODE_FULL),
+                   activeOnly ? on_group_torrent_get_active :
+                   on_group_torrent_get_update, m);
+}
+
+static gboolean trg_client_group_wanted(JsonObject * profile,
+                                        JsonObject * current)
+{
+    return profile != current
+        && json_object_has_member(profile, TRG_PREFS_KEY_CONNECT_ALONGSIDE)
+        && json_object_get_boolean_member(profile,
+                                          TRG_PREFS_KEY_CONNECT_ALONGSIDE);
+}
+
+static trg_client_group_member *trg_client_group_find(trg_client_group * g,
+                                                      JsonObject * profile)
+{
+    GList *li;
+
+    for (li = g->members; li; li = g_list_next(li)) {
+        trg_client_group_member *m = (trg_client_group_member *) li->data;
+        if (m->profile == profile)
+            return m;
+    }
+
+    return NULL;
+}
+
+static gboolean trg_client_group_start(trg_client_group_member * m)
+{
+    if (trg_client_populate_with_settings(m->client) != 0)
+        return FALSE;
+
+    trg_client_inc_connid(m->client);
+    trg_client_reset_failcount(m->client);
+    trg_torrent_model_add_source(m->group->model, m->client);
+
+    m->active = TRUE;
+    m->first = TRUE;
+    m->refresh = FALSE;
+
+    trg_client_group_poll(m);
+
+    return TRUE;
+}
+
+static void trg_client_group_stop(trg_client_group_member * m)
+{
+    if (!m->active)
+        return;
+
+    m->active = FALSE;
+
+    if (m->timerId) {
+        g_source_remove(m->timerId);
+        m->timerId = 0;
+    }
+
+    /* Responses still on their way are dropped. */
+    trg_client_inc_connid(m->client);
+    trg_torrent_model_remove_source(m->group->model, m->client);
+    trg_client_status_change(m->client, FALSE);
+}
+
+static void trg_client_group_member_free(trg_client_group_member * m)
+{
+    json_object_unref(m->profile);
+    g_free(m);
+}
+
+/* Retire the members whose profiles were deleted or have stopped connecting
+ * alongside, and start any newly marked, if main is connected. */
+static void trg_client_group_profiles_changed(TrgPrefs * prefs,
+                                              gpointer data)
+{
+    trg_client_group *g = (trg_client_group *) data;
+    JsonObject *current = trg_prefs_get_profile(prefs);
+    GList *profiles, *li;
+
+    if (!g->main)
+        return;
+
+    profiles = json_array_get_elements(trg_prefs_get_profiles(prefs));
+
+    li = g->members;
+    while (li) {
+        trg_client_group_member *m = (trg_client_group_member *) li->data;
+        GList *next = g_list_next(li);
+        GList *pi;
+
+        for (pi = profiles; pi; pi = g_list_next(pi))
+            if (json_node_get_object((JsonNode *) pi->data) == m->profile)
+                break;
+
+        if (!pi || !trg_client_group_wanted(m->profile, current)) {
+            trg_client_group_stop(m);
+            g->members = g_list_delete_link(g->members, li);
+            /* Responses still queued for it come back to m, so it goes
+             * with the client. */
+            trg_client_retire(m->client,
+                              (GDestroyNotify)
+                              trg_client_group_member_free, m);
+        }
+
+        li = next;
+    }
+
+    g_list_free(profiles);
+
+    trg_client_group_connect(g, g->main);
+}
+
+static void trg_client_group_pref_changed(TrgPrefs * prefs,
+                                          const gchar * key, gpointer data)
+{
+    if (!g_strcmp0(key, TRG_PREFS_KEY_CONNECT_ALONGSIDE))
+        trg_client_group_profiles_changed(prefs, data);
+}
+
+/* Connect every other profile marked to connect alongside the one main is
+ * using. Returns how many were started. */
+guint trg_client_group_connect(trg_client_group * g, TrgClient * main)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(main);
+    JsonObject *current = trg_prefs_get_profile(prefs);
+    GList *profiles =
+        json_array_get_elements(trg_prefs_get_profiles(prefs));
+    guint started = 0;
+    GList *li;
+
+    if (!g->prefs) {
+        g->prefs = prefs;
+        g_signal_connect(prefs, "pref-profile-changed",
+                         G_CALLBACK(trg_client_group_profiles_changed), g);
+        g_signal_connect(prefs, "pref-changed",
+                         G_CALLBACK(trg_client_group_pref_changed), g);
+    }
+
+    g->main = main;
+
+    for (li = profiles; li; li = g_list_next(li)) {
+        JsonObject *profile = json_node_get_object((JsonNode *) li->data);
+        trg_client_group_member *m;
+
+        if (!trg_client_group_wanted(profile, current))
+            continue;
+
+        m = trg_client_group_find(g, profile);
+        if (!m) {
+            m = g_new0(trg_client_group_member, 1);
+            m->group = g;
+            m->profile = json_object_ref(profile);
+            m->client = trg_client_new_for_profile(main, profile);
+            g->members = g_list_append(g->members, m);
+        }
+
+        if (!m->active && trg_client_group_start(m))
+            started++;
+    }
+
+    g_list_free(profiles);
+
+    return started;
+}
+
+void trg_client_group_disconnect(trg_client_group * g)
+{
+    GList *li;
+
+    g->main = NULL;
+
+    for (li = g->members; li; li = g_list_next(li))
+        trg_client_group_stop((trg_client_group_member *) li->data);
+}
+
+/* Poll the daemon behind tc now, after an action on one of its torrents,
+ * or straight after the poll already in flight. */
+void trg_client_group_refresh(trg_client_group * g, TrgClient * tc)
+{
+    GList *li;
+
+    for (li = g->members; li; li = g_list_next(li)) {
+        trg_client_group_member *m = (trg_client_group_member *) li->data;
+
+        if (m->client != tc || !m->active)
+            continue;
+
+        if (m->timerId) {
+            g_source_remove(m->timerId);
+            m->timerId = 0;
+            trg_client_group_poll(m);
+        } else {
+            m->refresh = TRUE;
+        }
+
+        return;
+    }
+}
+
+/* How many other daemons are connected. */
+guint trg_client_group_get_size(trg_client_group * g)
+{
+    GList *li;
+    guint n = 0;
+
+    for (li = g->members; li; li = g_list_next(li))
+        if (((trg_client_group_member *) li->data)->active)
+            n++;
+
+    return n;
+}
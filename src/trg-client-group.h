@@ -0,0 +1,36 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TRG_CLIENT_GROUP_H_
+#define TRG_CLIENT_GROUP_H_
+
+#include <glib.h>
+
+#include "trg-client.h"
+#include "trg-torrent-model.h"
+
+typedef struct _trg_client_group trg_client_group;
+
+trg_client_group *trg_client_group_new(TrgTorrentModel * model);
+guint trg_client_group_connect(trg_client_group * g, TrgClient * main);
+void trg_client_group_disconnect(trg_client_group * g);
+guint trg_client_group_get_size(trg_client_group * g);
+void trg_client_group_refresh(trg_client_group * g, TrgClient * tc);
+
+#endif                          /* TRG_CLIENT_GROUP_H_ */
@@ -41,12 +41,16 @@
 #include "util.h"
 #include "requests.h"
 #include "trg-client.h"
+#include "trg-diagnostics.h"
+#include "trg-record.h"
+#include "trg-upload-stream.h"
 
 /* This class manages/does quite a few things, and is passed around a lot. It:
  *
  * 1) Holds/inits the single TrgPrefs object for managing configuration.
  * 2) Manages a thread pool for making requests
- *    (each thread has its own CURL client in thread local storage)
+ *    (each thread has its own CURL client in thread local storage),
+ *    or optionally a curl multi handle driven by the main loop.
  * 3) Holds current connection details needed by CURL clients.
  *    (session ID, username, password, URL, ssl, proxy)
  * 4) Holds a hash table for looking up a torrent by its ID.
@@ -55,11 +59,13 @@
  *    connect/disconnect.
  * 7) Provides a mutex for locking updates.
  * 8) Holds the latest session object sent in a session-get response.
+ *    A full one replaces it ("session-updated"), a partial one is merged
+ *    into it ("session-changed", once for each key with a new value).
  */
 
 G_DEFINE_TYPE(TrgClient, trg_client, G_TYPE_OBJECT)
 enum {
-    TC_SESSION_UPDATED, TC_SIGNAL_COUNT
+    TC_SESSION_UPDATED, TC_SESSION_CHANGED, TC_SIGNAL_COUNT
 };
 
 static guint signals[TC_SIGNAL_COUNT] = { 0 };
@@ -81,17 +87,44 @@ struct _TrgClientPrivate {
     char *proxy;
     GHashTable *torrentTable;
     GThreadPool *pool;
+    GThreadPool *publicPool;
+    gint requestSerial;
     TrgPrefs *prefs;
     GPrivate tlsKey;
     gint configSerial;
-    guint http_class;
     GMutex configMutex;
+    /* Held to swap the session, which is only changed on the main thread,
+     * and to read rpcVersion from others. */
+    GMutex sessionMutex;
+    gint64 rpcVersion;
     gboolean seedRatioLimited;
     gdouble seedRatioLimit;
+    GThread *mainThread;
+    CURLM *multi;
+    guint multiTimer;
+    CURLSH *share;
+    GMutex shareLocks[CURL_LOCK_DATA_LAST];
+    gint connReused;
+    gint connNew;
+    GList *inflightGets;
+    /* List polls held back until the one in flight is done. */
+    GList *deferredGets;
+    /* Bumped as each RPC which might change something is sent, so a
+     * torrent-get isn't answered by one sent before it. */
+    gint actionGen;
+    GList *actionBatches;
+    guint actionBatchTimer;
+    trg_diagnostics *diagnostics;
+    trg_record *record;
 };
 
 static void dispatch_async_threadfunc(trg_request * reqrsp,
                                       TrgClient * tc);
+static void trg_client_share_init(TrgClient * tc);
+static gint dispatch_priority_compare(gconstpointer a, gconstpointer b,
+                                      gpointer data);
+static gboolean dispatch_should_deliver(TrgClient * tc,
+                                        trg_request * req);
 
 static void
 trg_client_get_property(GObject * object, guint property_id,
@@ -117,6 +150,24 @@ trg_client_set_property(GObject * object, guint property_id,
 
 static void trg_client_dispose(GObject * object)
 {
+    TrgClientPrivate *priv = TRG_CLIENT(object)->priv;
+
+    trg_record_close(priv->record);
+    priv->record = NULL;
+
+    /* Each transfer holds a reference, so none are left by now. This may
+     * still call the socket and timer callbacks, as it closes the cached
+     * connections, so the timer goes after. */
+    if (priv->multi) {
+        curl_multi_cleanup(priv->multi);
+        priv->multi = NULL;
+    }
+
+    if (priv->multiTimer) {
+        g_source_remove(priv->multiTimer);
+        priv->multiTimer = 0;
+    }
+
     G_OBJECT_CLASS(trg_client_parent_class)->dispose(object);
 }
 
@@ -142,6 +193,20 @@ static void trg_client_class_init(TrgClientClass * klass)
                                                g_cclosure_marshal_VOID__POINTER,
                                                G_TYPE_NONE, 1,
                                                G_TYPE_POINTER);
+
+    /* Detailed by key, so "session-changed::alt-speed-enabled" works. */
+    signals[TC_SESSION_CHANGED] = g_signal_new("session-changed",
+                                               G_TYPE_FROM_CLASS
+                                               (object_class),
+                                               G_SIGNAL_RUN_LAST |
+                                               G_SIGNAL_DETAILED,
+                                               G_STRUCT_OFFSET
+                                               (TrgClientClass,
+                                                session_changed), NULL,
+                                               NULL,
+                                               g_cclosure_marshal_VOID__POINTER,
+                                               G_TYPE_NONE, 1,
+                                               G_TYPE_POINTER);
 }
 
 static void trg_client_init(TrgClient * self)
@@ -151,21 +216,43 @@ static void trg_client_init(TrgClient * self)
                                     TrgClientPrivate);
 }
 
-TrgClient *trg_client_new(void)
+static TrgClient *trg_client_new_with_prefs(TrgPrefs * prefs,
+                                            gboolean record)
 {
     TrgClient *tc = g_object_new(TRG_TYPE_CLIENT, NULL);
     TrgClientPrivate *priv = tc->priv;
-    TrgPrefs *prefs = priv->prefs = trg_prefs_new();
 
-    trg_prefs_load(prefs);
+    priv->prefs = prefs;
 
     g_mutex_init(&priv->configMutex);
+    g_mutex_init(&priv->sessionMutex);
+    priv->mainThread = g_thread_self();
     //priv->tlsKey = g_private_new(NULL);
     priv->seedRatioLimited = FALSE;
     priv->seedRatioLimit = 0.00;
 
+    trg_client_share_init(tc);
+    priv->diagnostics = trg_diagnostics_new();
+
+    if (record && g_getenv(TRG_RECORD_ENV)) {
+        GError *error = NULL;
+
+        priv->record = trg_record_open(g_getenv(TRG_RECORD_ENV), &error);
+        if (error) {
+            g_warning("Unable to record RPC traffic: %s", error->message);
+            g_error_free(error);
+        }
+    }
+
+    /* RPCs are taken in priority order, and public HTTP (RSS feeds, torrent
+     * downloads) gets its own threads so it can't hold an RPC back. */
     priv->pool = g_thread_pool_new((GFunc) dispatch_async_threadfunc, tc,
                                    DISPATCH_POOL_SIZE, TRUE, NULL);
+    g_thread_pool_set_sort_function(priv->pool, dispatch_priority_compare,
+                                    NULL);
+    priv->publicPool = g_thread_pool_new((GFunc) dispatch_async_threadfunc,
+                                         tc, DISPATCH_PUBLIC_POOL_SIZE,
+                                         TRUE, NULL);
 
     tr_formatter_size_init(disk_K, _(disk_K_str), _(disk_M_str),
                            _(disk_G_str), _(disk_T_str));
@@ -175,6 +262,75 @@ TrgClient *trg_client_new(void)
     return tc;
 }
 
+TrgClient *trg_client_new(void)
+{
+    TrgPrefs *prefs = trg_prefs_new();
+
+    trg_prefs_load(prefs);
+
+    return trg_client_new_with_prefs(prefs, TRUE);
+}
+
+/* A client for another profile, to be connected alongside tc. It sees the
+ * same configuration, and isn't recorded. */
+TrgClient *trg_client_new_for_profile(TrgClient * tc, JsonObject * profile)
+{
+    return trg_client_new_with_prefs(trg_prefs_new_view
+                                     (tc->priv->prefs, profile), FALSE);
+}
+
+typedef struct {
+    TrgClient *tc;
+    GDestroyNotify notify;
+    gpointer data;
+} trg_client_retirement;
+
+static gboolean trg_client_retired(gpointer data)
+{
+    trg_client_retirement *r = (trg_client_retirement *) data;
+
+    if (r->notify)
+        r->notify(r->data);
+
+    g_object_unref(r->tc);
+    g_free(r);
+
+    return FALSE;
+}
+
+static gpointer trg_client_retire_threadfunc(gpointer data)
+{
+    trg_client_retirement *r = (trg_client_retirement *) data;
+    TrgClientPrivate *priv = r->tc->priv;
+
+    g_thread_pool_free(priv->pool, FALSE, TRUE);
+    g_thread_pool_free(priv->publicPool, FALSE, TRUE);
+    priv->pool = priv->publicPool = NULL;
+
+    /* Behind the callbacks of whatever was still queued. */
+    g_idle_add(trg_client_retired, r);
+
+    return NULL;
+}
+
+/* Done with a client from trg_client_new_for_profile(), which mustn't be
+ * given any more requests. Its thread pools are freed once the requests
+ * already in them have finished, which is waited for on a thread of its
+ * own. Then, on the main thread and after their callbacks, notify is called
+ * with data and the reference is dropped. */
+void trg_client_retire(TrgClient * tc, GDestroyNotify notify,
+                       gpointer data)
+{
+    trg_client_retirement *r = g_new0(trg_client_retirement, 1);
+
+    r->tc = tc;
+    r->notify = notify;
+    r->data = data;
+
+    g_thread_unref(g_thread_new("trg-client-retire",
+                                trg_client_retire_threadfunc, r));
+}
+
 const gchar *trg_client_get_version_string(TrgClient * tc)
 {
     return session_get_version_string(tc->priv->session);
@@ -188,7 +344,34 @@ gdouble trg_client_get_version(TrgClient * tc)
 gint64 trg_client_get_rpc_version(TrgClient * tc)
 {
     TrgClientPrivate *priv = tc->priv;
-    return session_get_rpc_version(priv->session);
+    gint64 rpcv;
+
+    g_mutex_lock(&priv->sessionMutex);
+    rpcv = priv->rpcVersion;
+    g_mutex_unlock(&priv->sessionMutex);
+
+    return rpcv;
+}
+
+/* Put a new session in place, taking a reference. Readers on the main
+ * thread can keep using the old one until they return, and the others only
+ * go through trg_client_get_rpc_version(). */
+static void trg_client_swap_session(TrgClient * tc, JsonObject * session)
+{
+    TrgClientPrivate *priv = tc->priv;
+    JsonObject *old;
+
+    if (session)
+        json_object_ref(session);
+
+    g_mutex_lock(&priv->sessionMutex);
+    old = priv->session;
+    priv->session = session;
+    priv->rpcVersion = session ? session_get_rpc_version(session) : 0;
+    g_mutex_unlock(&priv->sessionMutex);
+
+    if (old)
+        json_object_unref(old);
 }
 
 void trg_client_inc_connid(TrgClient * tc)
@@ -201,13 +384,10 @@ void trg_client_set_session(TrgClient * tc, JsonObject * session)
 {
     TrgClientPrivate *priv = tc->priv;
 
-    if (priv->session)
-        json_object_unref(priv->session);
-    else
+    if (!priv->session)
         priv->version = session_get_version(session);
 
-    priv->session = session;
-    json_object_ref(session);
+    trg_client_swap_session(tc, session);
 
     priv->seedRatioLimit = session_get_seed_ratio_limit(session);
     priv->seedRatioLimited = session_get_seed_ratio_limited(session);
@@ -215,6 +395,62 @@ void trg_client_set_session(TrgClient * tc, JsonObject * session)
     g_signal_emit(tc, signals[TC_SESSION_UPDATED], 0, session);
 }
 
+/* Merge the members of a partial session-get (session_get_volatile()) into
+ * a copy of the session, which then replaces it, telling listeners about the
+ * ones which changed. */
+void trg_client_merge_session(TrgClient * tc, JsonObject * partial)
+{
+    TrgClientPrivate *priv = tc->priv;
+    GList *members, *li;
+    GList *changed = NULL;
+    JsonObject *session;
+
+    if (!priv->session) {
+        trg_client_set_session(tc, partial);
+        return;
+    }
+
+    session = json_object_new();
+    members = json_object_get_members(priv->session);
+    for (li = members; li; li = g_list_next(li))
+        json_object_set_member(session, (const gchar *) li->data,
+                               json_node_copy(json_object_get_member
+                                              (priv->session,
+                                               (const gchar *) li->
+                                               data)));
+    g_list_free(members);
+
+    members = json_object_get_members(partial);
+
+    for (li = members; li; li = g_list_next(li)) {
+        const gchar *key = (const gchar *) li->data;
+        JsonNode *node = json_object_get_member(partial, key);
+        JsonNode *current = json_object_has_member(session, key) ?
+            json_object_get_member(session, key) : NULL;
+
+        if (current && json_node_value_equal(current, node))
+            continue;
+
+        json_object_set_member(session, key, json_node_copy(node));
+        changed = g_list_append(changed, (gpointer) key);
+    }
+
+    trg_client_swap_session(tc, session);
+    json_object_unref(session);
+
+    priv->seedRatioLimit = session_get_seed_ratio_limit(priv->session);
+    priv->seedRatioLimited = session_get_seed_ratio_limited(priv->session);
+
+    /* After merging everything, so listeners see a consistent session. */
+    for (li = changed; li; li = g_list_next(li))
+        g_signal_emit(tc, signals[TC_SESSION_CHANGED],
+                      g_quark_from_string((const gchar *) li->data),
+                      li->data);
+
+    g_list_free(changed);
+    g_list_free(members);
+}
+
 TrgPrefs *trg_client_get_prefs(TrgClient * tc)
 {
     return tc->priv->prefs;
@@ -347,10 +583,7 @@ void trg_client_status_change(TrgClient * tc, gboolean connected)
     TrgClientPrivate *priv = tc->priv;
 
     if (!connected) {
-        if (priv->session) {
-            json_object_unref(priv->session);
-            priv->session = NULL;
-        }
+        trg_client_swap_session(tc, NULL);
         g_mutex_lock(&priv->configMutex);
         trg_prefs_set_connection(priv->prefs, NULL);
         g_mutex_unlock(&priv->configMutex);
@@ -440,6 +673,109 @@ void trg_client_configunlock(TrgClient * tc)
     g_mutex_unlock(&tc->priv->configMutex);
 }
 
+/* A curl share object lets the easy handle in each pool thread (and the
+ * multi backend) use the same DNS cache and TLS sessions, rather than each
+ * thread resolving and handshaking from cold. The connection cache isn't
+ * shared, as libcurl doesn't support sharing it between threads; each
+ * thread's handle keeps its own connection alive, as does the multi handle.
+ */
+
+static void
+share_lock_callback(CURL * handle, curl_lock_data data,
+                    curl_lock_access access, void *userp)
+{
+    TrgClientPrivate *priv = (TrgClientPrivate *) userp;
+    g_mutex_lock(&priv->shareLocks[data]);
+}
+
+static void
+share_unlock_callback(CURL * handle, curl_lock_data data, void *userp)
+{
+    TrgClientPrivate *priv = (TrgClientPrivate *) userp;
+    g_mutex_unlock(&priv->shareLocks[data]);
+}
+
+static void trg_client_share_init(TrgClient * tc)
+{
+    TrgClientPrivate *priv = tc->priv;
+    int i;
+
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        g_mutex_init(&priv->shareLocks[i]);
+
+    priv->share = curl_share_init();
+    curl_share_setopt(priv->share, CURLSHOPT_LOCKFUNC,
+                      share_lock_callback);
+    curl_share_setopt(priv->share, CURLSHOPT_UNLOCKFUNC,
+                      share_unlock_callback);
+    curl_share_setopt(priv->share, CURLSHOPT_USERDATA, priv);
+    curl_share_setopt(priv->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(priv->share, CURLSHOPT_SHARE,
+                      CURL_LOCK_DATA_SSL_SESSION);
+}
+
+/* Record how long a finished transfer took, and add the connections it
+ * made to the response's. A 409 retry adds its own to the first's, and
+ * trg_client_count_connections() counts them once it's all done. */
+static void
+trg_client_record_transfer(CURL * curl, trg_response * response)
+{
+    double total = 0, pretransfer = 0, starttransfer = 0;
+    long connects = 0;
+
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &starttransfer);
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME,
+                      &response->namelookup_time);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME,
+                      &response->connect_time);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME,
+                      &response->appconnect_time);
+
+    response->rtt = total;
+    response->starttransfer_time = starttransfer;
+    response->server_time = starttransfer > pretransfer ?
+        starttransfer - pretransfer : 0;
+
+    if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects)
+        != CURLE_OK)
+        return;
+
+    response->connects += (int) connects;
+}
+
+/* Once for each request, however many attempts it took: whether it needed
+ * new connections, or reused one. */
+static void
+trg_client_count_connections(TrgClient * tc, trg_response * response)
+{
+    TrgClientPrivate *priv = tc->priv;
+
+    /* An HTTP error (a negative status) still came over a connection. */
+    if (response->connects > 0)
+        g_atomic_int_add(&priv->connNew, response->connects);
+    else if (response->status <= CURLE_OK)
+        g_atomic_int_inc(&priv->connReused);
+}
+
+void
+trg_client_get_connection_stats(TrgClient * tc, guint * reused,
+                                guint * created)
+{
+    TrgClientPrivate *priv = tc->priv;
+
+    if (reused)
+        *reused = (guint) g_atomic_int_get(&priv->connReused);
+    if (created)
+        *created = (guint) g_atomic_int_get(&priv->connNew);
+}
+
+trg_diagnostics *trg_client_get_diagnostics(TrgClient * tc)
+{
+    return tc->priv->diagnostics;
+}
+
 /* formerly http.c */
 
 void trg_response_free(trg_response * response)
@@ -451,6 +787,9 @@ void trg_response_free(trg_response * response)
 		if (response->raw)
 			g_free(response->raw);
 
+		if (response->cancellable)
+			g_object_unref(response->cancellable);
+
 		g_free(response);
 	}
 }
@@ -461,6 +800,16 @@ http_receive_callback(void *ptr, size_t size, size_t nmemb, void *data)
     size_t realsize = size * nmemb;
     trg_response *mem = (trg_response *) data;
 
+    /* Never abort the transfer on bad JSON here, or the HTTP status (and
+     * a 409 retry) wouldn't get looked at. */
+    if (mem->stream) {
+        gint64 start = g_get_monotonic_time();
+        trg_json_stream_feed(mem->stream, ptr, realsize);
+        mem->parse_time += g_get_monotonic_time() - start;
+        mem->size += realsize;
+        return realsize;
+    }
+
     mem->raw = g_realloc(mem->raw, mem->size + realsize + 1);
     if (mem->raw) {
         memcpy(&(mem->raw[mem->size]), ptr, realsize);
@@ -518,64 +867,92 @@ static trg_tls *get_tls(TrgClient *tc) {
     return tls;
 }
 
-static CURL* get_curl(TrgClient *tc, guint http_class)
-{
-	TrgClientPrivate *priv = tc->priv;
-	TrgPrefs *prefs = trg_client_get_prefs(tc);
-	trg_tls *tls = get_tls(tc);
-	CURL *curl = tls->curl;
+static gboolean trg_request_is_cancelled(trg_request * req);
 
-    g_mutex_lock(&priv->configMutex);
+/* Returning non-zero aborts the transfer with CURLE_ABORTED_BY_CALLBACK. */
+static int
+http_progress_callback(void *data, curl_off_t dltotal, curl_off_t dlnow,
+                       curl_off_t ultotal, curl_off_t ulnow)
+{
+    trg_request *req = (trg_request *) data;
+    return req && trg_request_is_cancelled(req) ? 1 : 0;
+}
 
-    if (priv->configSerial > tls->serial || http_class != priv->http_class) {
-    	gchar *proxy;
+/* Apply the connection settings to an easy handle. Call with configMutex
+ * held. */
+static void
+trg_curl_setup(TrgClient * tc, CURL * curl, guint http_class)
+{
+    gchar *proxy;
 
-        curl_easy_reset(curl);
+    curl_easy_reset(curl);
 
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, PACKAGE_NAME);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,
-                         &http_receive_callback);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, PACKAGE_NAME);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &http_receive_callback);
+    curl_easy_setopt(curl, CURLOPT_SHARE, tc->priv->share);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION,
+                     &http_progress_callback);
 #ifdef DEBUG
-        if (g_getenv("TRG_CURL_VERBOSE") != NULL)
-        	curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
+    if (g_getenv("TRG_CURL_VERBOSE") != NULL)
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
 #endif
 
-        if (http_class == HTTP_CLASS_TRANSMISSION) {
-        	curl_easy_setopt(curl, CURLOPT_WRITEHEADER, (void *) tc);
-        	curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
-        	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &header_callback);
-            curl_easy_setopt(curl, CURLOPT_PASSWORD,
-                             trg_client_get_password(tc));
-            curl_easy_setopt(curl, CURLOPT_USERNAME,
-                             trg_client_get_username(tc));
-            curl_easy_setopt(curl, CURLOPT_URL, trg_client_get_url(tc));
-        }
+    if (http_class == HTTP_CLASS_TRANSMISSION) {
+        curl_easy_setopt(curl, CURLOPT_WRITEHEADER, (void *) tc);
+        curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &header_callback);
+        curl_easy_setopt(curl, CURLOPT_PASSWORD,
+                         trg_client_get_password(tc));
+        curl_easy_setopt(curl, CURLOPT_USERNAME,
+                         trg_client_get_username(tc));
+        curl_easy_setopt(curl, CURLOPT_URL, trg_client_get_url(tc));
+    }
+#ifndef CURL_NO_SSL
+    if (trg_client_get_ssl(tc) && !trg_client_get_ssl_validate(tc)) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
+    }
+#endif
 
-    #ifndef CURL_NO_SSL
-        if (trg_client_get_ssl(tc) && !trg_client_get_ssl_validate(tc)) {
+    proxy = trg_client_get_proxy(tc);
+    if (proxy) {
+        curl_easy_setopt(curl, CURLOPT_PROXYTYPE, CURLPROXY_HTTP);
+        curl_easy_setopt(curl, CURLOPT_PROXY, proxy);
+    }
+}
 
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
-        }
-    #endif
+/* Per-use options which may change without a config serial bump. Call with
+ * configMutex held. */
+static void
+trg_curl_setup_request(TrgClient * tc, CURL * curl, guint http_class)
+{
+    TrgPrefs *prefs = trg_client_get_prefs(tc);
 
-        proxy = trg_client_get_proxy(tc);
-        if (proxy) {
-            curl_easy_setopt(curl, CURLOPT_PROXYTYPE, CURLPROXY_HTTP);
-            curl_easy_setopt(curl, CURLOPT_PROXY, proxy);
-        }
+    if (http_class == HTTP_CLASS_TRANSMISSION)
+        curl_easy_setopt(curl, CURLOPT_URL, trg_client_get_url(tc));
 
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT,
+                     (long) trg_prefs_get_int(prefs, TRG_PREFS_KEY_TIMEOUT,
+                                              TRG_PREFS_CONNECTION));
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "gzip");
+}
+
+static CURL* get_curl(TrgClient *tc, guint http_class)
+{
+	TrgClientPrivate *priv = tc->priv;
+	trg_tls *tls = get_tls(tc);
+	CURL *curl = tls->curl;
+
+    g_mutex_lock(&priv->configMutex);
+
+    if (priv->configSerial > tls->serial || http_class != tls->client_class) {
+        trg_curl_setup(tc, curl, http_class);
         tls->serial = priv->configSerial;
-        priv->http_class = http_class;
+        tls->client_class = http_class;
     }
 
-    if (http_class == HTTP_CLASS_TRANSMISSION)
-    	curl_easy_setopt(curl, CURLOPT_URL, trg_client_get_url(tc));
-
-	curl_easy_setopt(curl, CURLOPT_TIMEOUT,
-					 (long) trg_prefs_get_int(prefs, TRG_PREFS_KEY_TIMEOUT,
-											  TRG_PREFS_CONNECTION));
-    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "gzip");
+    trg_curl_setup_request(tc, curl, http_class);
 
     g_mutex_unlock(&priv->configMutex);
 
@@ -586,6 +963,26 @@ static CURL* get_curl(TrgClient *tc, guint http_class)
 
 }
 
+/* The POST body, and the headers to go with it. */
+static struct curl_slist *trg_curl_set_body(CURL * curl,
+                                            trg_request * request,
+                                            struct curl_slist *headers)
+{
+    if (request->upload) {
+        trg_upload_stream_setup(request->upload, curl);
+        /* Don't wait for a 100 Continue before sending a big file. */
+        return curl_slist_append(headers, "Expect:");
+    }
+
+    /* The thread handles are reused, so undo any earlier upload. */
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t) - 1);
+
+    return headers;
+}
+
 static inline int
 trg_http_perform_inner(TrgClient * tc, trg_request * request,
                        trg_response * response, gboolean recurse)
@@ -597,19 +994,26 @@ trg_http_perform_inner(TrgClient * tc, trg_request * request,
 
     response->size = 0;
     response->raw = NULL;
+    response->parse_time = 0;
+
+    if (response->stream)
+        trg_json_stream_reset(response->stream);
 
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) response);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *) request);
 
 	session_id = trg_client_get_session_id(tc);
 	if (session_id)
 		headers = curl_slist_append(NULL, session_id);
 
+    headers = trg_curl_set_body(curl, request, headers);
+
 	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
     response->status = curl_easy_perform(curl);
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+    trg_client_record_transfer(curl, response);
 
     g_free(session_id);
 
@@ -628,55 +1032,141 @@ trg_http_perform_inner(TrgClient * tc, trg_request * request,
 
 int trg_http_perform(TrgClient * tc, trg_request *request, trg_response * rsp)
 {
-    return trg_http_perform_inner(tc, request, rsp, TRUE);
+    int status = trg_http_perform_inner(tc, request, rsp, TRUE);
+
+    trg_client_count_connections(tc, rsp);
+
+    return status;
 }
 
+/* Frees what the request holds, but not the request itself. Safe to call
+ * more than once. */
 static void trg_request_free(trg_request *req) {
 	g_free(req->body);
 	g_free(req->url);
 	g_free(req->cookie);
+	req->body = req->url = req->cookie = NULL;
 
-	if (req->node)
+	if (req->node) {
 		json_node_free(req->node);
+		req->node = NULL;
+	}
+
+	trg_upload_stream_free(req->upload);
+	req->upload = NULL;
+
+	g_clear_object(&req->cancellable);
 }
 
-/* formerly dispatch.c */
+/* The RPC method, for the diagnostics. Valid until trg_request_free(). */
+static const gchar *trg_request_method(trg_request * req)
+{
+    if (req->url)
+        return TRG_DIAG_METHOD_HTTP;
+    else if (!req->node)
+        return NULL;
 
-trg_response *dispatch(TrgClient * tc, trg_request *req)
+    return json_object_get_string_member(json_node_get_object(req->node),
+                                         PARAM_METHOD);
+}
+
+static gboolean trg_request_is_cancelled(trg_request * req)
 {
-    trg_response *response = g_new0(trg_response, 1);
-    GError *decode_error = NULL;
-    JsonNode *result;
+    if (req->cancellable && g_cancellable_is_cancelled(req->cancellable))
+        return TRUE;
 
-	if (req->node && !req->body)
-		req->body = trg_serialize(req->node);
+    /* Anything for a previous connection is stale too. */
+    return req->client
+        && req->connid != g_atomic_int_get(&req->client->priv->connid);
+}
+
+/* formerly dispatch.c */
+
+static void dispatch_prepare(TrgClient * tc, trg_request * req,
+                             trg_response * response)
+{
+	if (req->node && !req->body && !req->upload)
+		req->body = request_serialize(req->node);
 
 #ifdef DEBUG
     if (g_getenv("TRG_SHOW_OUTGOING"))
         g_message("=>(OUTgoing)=>: %s", req->body);
 #endif
 
-    trg_http_perform(tc, req, response);
+    /* Parse as the body arrives, unless it's wanted for debug output or
+     * the recording. */
+    if (tc->priv->record)
+        return;
 
-    if (response->status == CURLE_OK)
-        response->obj = trg_deserialize(response, &decode_error);
+#ifdef DEBUG
+    if (!g_getenv("TRG_SHOW_INCOMING")
+        && !g_getenv("TRG_SHOW_INCOMING_PRETTY"))
+#endif
+        response->stream = trg_json_stream_new();
+}
+
+static void dispatch_record(TrgClient * tc, trg_request * req,
+                            trg_response * response)
+{
+    gint64 sent;
+
+    if (!tc->priv->record)
+        return;
+
+    sent = g_get_monotonic_time() - (gint64) (response->rtt * G_USEC_PER_SEC);
+    trg_record_exchange(tc->priv->record, req->body, sent,
+                        response->status, response->raw,
+                        response->raw ? response->size : 0);
+}
+
+static void dispatch_finish(trg_response * response)
+{
+    GError *decode_error = NULL;
+    JsonNode *result;
+
+    if (response->status == CURLE_OK) {
+        gint64 start = g_get_monotonic_time();
+
+        if (response->stream)
+            response->obj = trg_json_stream_finish(response->stream,
+                                                   &decode_error);
+        else
+            response->obj = trg_deserialize(response, &decode_error);
+
+        response->parse_time += g_get_monotonic_time() - start;
+    }
+
+    trg_json_stream_free(response->stream);
+    response->stream = NULL;
 
     g_free(response->raw);
     response->raw = NULL;
 
     if (response->status != CURLE_OK)
-        return response;
+        return;
 
     if (decode_error) {
         g_error("JSON decoding error: %s", decode_error->message);
         g_error_free(decode_error);
         response->status = FAIL_JSON_DECODE;
-        return response;
+        return;
     }
 
     result = json_object_get_member(response->obj, FIELD_RESULT);
-    if (!result || g_strcmp0(json_node_get_string(result), FIELD_SUCCESS))
+    if (!result || g_strcmp0(json_node_get_string(result), FIELD_SUCCESS)) {
         response->status = FAIL_RESPONSE_UNSUCCESSFUL;
+        return;
+    }
+}
+
+trg_response *dispatch(TrgClient * tc, trg_request *req)
+{
+    trg_response *response = g_new0(trg_response, 1);
+
+    dispatch_prepare(tc, req, response);
+    trg_http_perform(tc, req, response);
+    dispatch_record(tc, req, response);
+    dispatch_finish(response);
 
     return response;
 }
@@ -693,6 +1183,7 @@ trg_response *dispatch_public_http(TrgClient *tc, trg_request *req) {
 
 	curl_easy_setopt(curl, CURLOPT_URL, req->url);
 	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) response);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *) req);
 
 	if (req->cookie) {
 		cookie_header = g_strdup_printf("Cookie: %s", req->cookie);
@@ -714,6 +1205,8 @@ trg_response *dispatch_public_http(TrgClient *tc, trg_request *req) {
     //g_message(response->raw);
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+    trg_client_record_transfer(curl, response);
+    trg_client_count_connections(tc, response);
 
     if (response->status == CURLE_OK && httpCode != HTTP_OK) {
       response->status = (-httpCode) - 100;
@@ -724,22 +1217,668 @@ trg_response *dispatch_public_http(TrgClient *tc, trg_request *req) {
 
 static void dispatch_async_threadfunc(trg_request * req, TrgClient * tc)
 {
-    TrgClientPrivate *priv = tc->priv;
+    const gchar *method = trg_request_method(req);
     trg_response *rsp;
 
-    if (req->url)
+    /* Cancelled while still queued, so don't bother sending it. */
+    if (trg_request_is_cancelled(req)) {
+        rsp = g_new0(trg_response, 1);
+        rsp->status = CURLE_ABORTED_BY_CALLBACK;
+    } else if (req->url) {
     	rsp = dispatch_public_http(tc, req);
-    else
+    } else {
         rsp = dispatch(tc, req);
+    }
+
+    trg_diagnostics_record_response(tc->priv->diagnostics, method, rsp);
 
     rsp->cb_data = req->cb_data;
+    rsp->client = tc;
+    if (req->cancellable)
+        rsp->cancellable = g_object_ref(req->cancellable);
 
-    if (req->callback && req->connid == g_atomic_int_get(&priv->connid))
+    if (dispatch_should_deliver(tc, req))
         g_idle_add(req->callback, rsp);
     else
         trg_response_free(rsp);
 
+    trg_request_free(req);
+    g_free(req);
+}
+
+/* curl multi backend.
+ *
+ * An alternative to the thread pool, where transfers are driven by socket
+ * watches and a timeout on the default GMainContext. All the transfers share
+ * the multi handle's connection cache, and completion callbacks are invoked
+ * directly on the main thread rather than through g_idle_add().
+ */
+
+typedef struct {
+    TrgClient *tc;              /* a reference, held until it's done */
+    trg_request *req;
+    trg_response *rsp;
+    CURL *curl;
+    struct curl_slist *headers;
+    gchar *cookie_header;
+    gboolean retried;
+} trg_multi_transfer;
+
+typedef struct {
+    TrgClient *tc;
+    curl_socket_t fd;
+    GIOChannel *channel;
+    guint watch;
+} trg_multi_socket;
+
+static void multi_check_info(TrgClient * tc);
+
+static gboolean
+multi_socket_event(GIOChannel * channel, GIOCondition cond, gpointer data)
+{
+    trg_multi_socket *ms = (trg_multi_socket *) data;
+    TrgClient *tc = ms->tc;
+    curl_socket_t fd = ms->fd;
+    int action = 0;
+    int running;
+
+    if (cond & G_IO_IN)
+        action |= CURL_CSELECT_IN;
+    if (cond & G_IO_OUT)
+        action |= CURL_CSELECT_OUT;
+    if (cond & (G_IO_ERR | G_IO_HUP))
+        action |= CURL_CSELECT_ERR;
+
+    /* ms may be freed by the socket callback during this call. */
+    curl_multi_socket_action(tc->priv->multi, fd, action, &running);
+    multi_check_info(tc);
+
+    return TRUE;
+}
+
+static int
+multi_socket_callback(CURL * easy, curl_socket_t s, int what,
+                      void *userp, void *socketp)
+{
+    TrgClient *tc = TRG_CLIENT(userp);
+    TrgClientPrivate *priv = tc->priv;
+    trg_multi_socket *ms = (trg_multi_socket *) socketp;
+    GIOCondition cond = G_IO_ERR | G_IO_HUP;
+
+    if (what == CURL_POLL_REMOVE) {
+        if (ms) {
+            g_source_remove(ms->watch);
+            g_io_channel_unref(ms->channel);
+            g_free(ms);
+            curl_multi_assign(priv->multi, s, NULL);
+        }
+        return 0;
+    }
+
+    if (!ms) {
+        ms = g_new0(trg_multi_socket, 1);
+        ms->tc = tc;
+        ms->fd = s;
+#ifdef G_OS_WIN32
+        ms->channel = g_io_channel_win32_new_socket(s);
+#else
+        ms->channel = g_io_channel_unix_new(s);
+#endif
+        curl_multi_assign(priv->multi, s, ms);
+    } else {
+        g_source_remove(ms->watch);
+    }
+
+    if (what & CURL_POLL_IN)
+        cond |= G_IO_IN;
+    if (what & CURL_POLL_OUT)
+        cond |= G_IO_OUT;
+
+    ms->watch = g_io_add_watch(ms->channel, cond, multi_socket_event, ms);
+
+    return 0;
+}
+
+static gboolean multi_timeout_event(gpointer data)
+{
+    TrgClient *tc = TRG_CLIENT(data);
+    TrgClientPrivate *priv = tc->priv;
+    int running;
+
+    priv->multiTimer = 0;
+
+    curl_multi_socket_action(priv->multi, CURL_SOCKET_TIMEOUT, 0,
+                             &running);
+    multi_check_info(tc);
+
+    return FALSE;
+}
+
+static int
+multi_timer_callback(CURLM * multi, long timeout_ms, void *userp)
+{
+    TrgClient *tc = TRG_CLIENT(userp);
+    TrgClientPrivate *priv = tc->priv;
+
+    if (priv->multiTimer) {
+        g_source_remove(priv->multiTimer);
+        priv->multiTimer = 0;
+    }
+
+    if (timeout_ms >= 0)
+        priv->multiTimer = g_timeout_add(timeout_ms, multi_timeout_event,
+                                         tc);
+
+    return 0;
+}
+
+static CURLM *get_multi(TrgClient * tc)
+{
+    TrgClientPrivate *priv = tc->priv;
+
+    if (!priv->multi) {
+        priv->multi = curl_multi_init();
+        curl_multi_setopt(priv->multi, CURLMOPT_SOCKETFUNCTION,
+                          multi_socket_callback);
+        curl_multi_setopt(priv->multi, CURLMOPT_SOCKETDATA, tc);
+        curl_multi_setopt(priv->multi, CURLMOPT_TIMERFUNCTION,
+                          multi_timer_callback);
+        curl_multi_setopt(priv->multi, CURLMOPT_TIMERDATA, tc);
+    }
+
+    return priv->multi;
+}
+
+static void multi_transfer_start(trg_multi_transfer * xfer)
+{
+    TrgClient *tc = xfer->tc;
+    TrgClientPrivate *priv = tc->priv;
+    trg_request *req = xfer->req;
+    trg_response *rsp = xfer->rsp;
+    guint http_class = req->url ? HTTP_CLASS_PUBLIC :
+        HTTP_CLASS_TRANSMISSION;
+
+    if (!xfer->curl)
+        xfer->curl = curl_easy_init();
+
+    g_mutex_lock(&priv->configMutex);
+    trg_curl_setup(tc, xfer->curl, http_class);
+    trg_curl_setup_request(tc, xfer->curl, http_class);
+    g_mutex_unlock(&priv->configMutex);
+
+    rsp->size = 0;
+    rsp->raw = NULL;
+    rsp->parse_time = 0;
+    if (rsp->stream)
+        trg_json_stream_reset(rsp->stream);
+
+    curl_easy_setopt(xfer->curl, CURLOPT_PRIVATE, xfer);
+    curl_easy_setopt(xfer->curl, CURLOPT_WRITEDATA, (void *) rsp);
+    curl_easy_setopt(xfer->curl, CURLOPT_XFERINFODATA, (void *) req);
+
+    if (req->url) {
+        curl_easy_setopt(xfer->curl, CURLOPT_URL, req->url);
+        if (req->cookie) {
+            xfer->cookie_header = g_strdup_printf("Cookie: %s",
+                                                  req->cookie);
+            xfer->headers = curl_slist_append(NULL, xfer->cookie_header);
+        }
+    } else {
+        gchar *session_id = trg_client_get_session_id(tc);
+        if (session_id)
+            xfer->headers = curl_slist_append(NULL, session_id);
+        xfer->headers = trg_curl_set_body(xfer->curl, req, xfer->headers);
+        g_free(session_id);
+    }
+
+    curl_easy_setopt(xfer->curl, CURLOPT_HTTPHEADER, xfer->headers);
+
+    curl_multi_add_handle(get_multi(tc), xfer->curl);
+}
+
+static void multi_transfer_headers_free(trg_multi_transfer * xfer)
+{
+    if (xfer->headers) {
+        curl_slist_free_all(xfer->headers);
+        xfer->headers = NULL;
+    }
+
+    g_free(xfer->cookie_header);
+    xfer->cookie_header = NULL;
+}
+
+static void multi_transfer_done(trg_multi_transfer * xfer, CURLcode result)
+{
+    TrgClient *tc = xfer->tc;
+    trg_request *req = xfer->req;
+    trg_response *rsp = xfer->rsp;
+    long httpCode = 0;
+
+    curl_easy_getinfo(xfer->curl, CURLINFO_RESPONSE_CODE, &httpCode);
+    multi_transfer_headers_free(xfer);
+
+    rsp->status = result;
+    trg_client_record_transfer(xfer->curl, rsp);
+
+    if (rsp->status == CURLE_OK) {
+        if (!req->url && httpCode == HTTP_CONFLICT && !xfer->retried
+            && !trg_request_is_cancelled(req)) {
+            /* The header callback has picked up the new session ID. */
+            xfer->retried = TRUE;
+            multi_transfer_start(xfer);
+            return;
+        } else if (httpCode != HTTP_OK) {
+            rsp->status = (-httpCode) - 100;
+        }
+    }
+
+    curl_easy_cleanup(xfer->curl);
+    trg_client_count_connections(tc, rsp);
+
+    if (!req->url) {
+        dispatch_record(tc, req, rsp);
+        dispatch_finish(rsp);
+    }
+
+    trg_diagnostics_record_response(tc->priv->diagnostics,
+                                    trg_request_method(req), rsp);
+
+    rsp->cb_data = req->cb_data;
+    rsp->client = tc;
+    if (req->cancellable)
+        rsp->cancellable = g_object_ref(req->cancellable);
+
+    if (dispatch_should_deliver(tc, req))
+        req->callback(rsp);
+    else
+        trg_response_free(rsp);
+
+    trg_request_free(req);
     g_free(req);
+    g_free(xfer);
+    g_object_unref(tc);
+}
+
+static void multi_check_info(TrgClient * tc)
+{
+    TrgClientPrivate *priv = tc->priv;
+    CURLMsg *msg;
+    int pending;
+
+    while ((msg = curl_multi_info_read(priv->multi, &pending))) {
+        trg_multi_transfer *xfer = NULL;
+        CURL *curl = msg->easy_handle;
+        CURLcode result = msg->data.result;
+
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **) &xfer);
+        curl_multi_remove_handle(priv->multi, curl);
+
+        multi_transfer_done(xfer, result);
+    }
+}
+
+static void dispatch_multi(TrgClient * tc, trg_request * req)
+{
+    trg_multi_transfer *xfer = g_new0(trg_multi_transfer, 1);
+
+    xfer->tc = g_object_ref(tc);
+    xfer->req = req;
+    xfer->rsp = g_new0(trg_response, 1);
+
+    if (!req->url)
+        dispatch_prepare(tc, req, xfer->rsp);
+
+    multi_transfer_start(xfer);
+}
+
+static gboolean trg_client_use_multi(TrgClient * tc)
+{
+    TrgClientPrivate *priv = tc->priv;
+
+    /* The multi handle is only ever touched from the main loop. */
+    return g_thread_self() == priv->mainThread
+        && trg_prefs_get_bool(priv->prefs, TRG_PREFS_KEY_CURL_MULTI,
+                              TRG_PREFS_GLOBAL);
+}
+
+/* torrent-get coalescing.
+ *
+ * When a torrent-get is dispatched while another one whose ids and fields
+ * cover it is still in flight, the new caller is attached to the existing
+ * request and gets its own reference to that response, rather than another
+ * RPC being sent. This stops polls stacking up behind a stalled daemon.
+ * Only requests sent since the last action count, so a refresh after one
+ * doesn't get what the daemon had before it.
+ *
+ * List polls (tagged TORRENT_GET_TAG_MODE_FULL or _UPDATE) which can't be
+ * attached wait for the one in flight to finish before being sent, so
+ * there's only ever one at a time.
+ *
+ * Only used from the main thread, which owns priv->inflightGets and
+ * priv->deferredGets.
+ */
+
+typedef struct {
+    TrgClient *tc;
+    gint connid;
+    gint actionGen;
+    GSourceFunc callback;
+    gpointer cb_data;
+    GHashTable *fields;
+    GArray *ids;                /* NULL for all torrents */
+    gboolean recent;
+    gboolean tagged;
+    gint64 tag;
+    gchar *format;
+    GList *waiters;
+} trg_coalesced_get;
+
+static gboolean dispatch_coalesced_callback(gpointer data);
+static gboolean dispatch_async_common(TrgClient * tc,
+                                      trg_request * trg_req,
+                                      GSourceFunc callback, gpointer data);
+
+static gboolean
+dispatch_should_deliver(TrgClient * tc, trg_request * req)
+{
+    if (!req->callback)
+        return FALSE;
+
+    /* The coalesced callback checks the connid of each of its callers, and
+     * has to run regardless to take itself out of the in-flight list. */
+    if (req->callback == dispatch_coalesced_callback)
+        return TRUE;
+
+    return req->connid == g_atomic_int_get(&tc->priv->connid)
+        && !(req->cancellable
+             && g_cancellable_is_cancelled(req->cancellable));
+}
+
+static void trg_coalesced_get_free(trg_coalesced_get * c)
+{
+    g_hash_table_destroy(c->fields);
+    if (c->ids)
+        g_array_free(c->ids, TRUE);
+    g_free(c->format);
+    g_free(c);
+}
+
+static trg_coalesced_get *trg_coalesced_get_new(JsonNode * node)
+{
+    JsonObject *root = json_node_get_object(node);
+    JsonObject *args;
+    JsonArray *fields;
+    JsonNode *ids;
+    trg_coalesced_get *c;
+    guint i;
+
+    if (g_strcmp0(json_object_get_string_member(root, PARAM_METHOD),
+                  METHOD_TORRENT_GET))
+        return NULL;
+
+    args = get_arguments(root);
+    fields = json_object_get_array_member(args, PARAM_FIELDS);
+
+    c = g_new0(trg_coalesced_get, 1);
+    c->fields = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                      NULL);
+
+    for (i = 0; i < json_array_get_length(fields); i++)
+        g_hash_table_add(c->fields,
+                         g_strdup(json_array_get_string_element(fields,
+                                                                i)));
+
+    /* The callback may go by the tag, and decodes by the format, so both
+     * have to match for a response to answer another request. */
+    if (json_object_has_member(root, PARAM_TAG)) {
+        c->tagged = TRUE;
+        c->tag = json_object_get_int_member(root, PARAM_TAG);
+    }
+
+    if (json_object_has_member(args, PARAM_FORMAT))
+        c->format =
+            g_strdup(json_object_get_string_member(args, PARAM_FORMAT));
+
+    ids = json_object_get_member(args, PARAM_IDS);
+    if (ids && JSON_NODE_HOLDS_ARRAY(ids)) {
+        JsonArray *idsArray = json_node_get_array(ids);
+        c->ids = g_array_new(FALSE, FALSE, sizeof(gint64));
+        for (i = 0; i < json_array_get_length(idsArray); i++) {
+            gint64 id = json_array_get_int_element(idsArray, i);
+            g_array_append_val(c->ids, id);
+        }
+    } else if (ids) {
+        c->recent = TRUE;
+    }
+
+    return c;
+}
+
+static gboolean
+trg_coalesced_get_covers(trg_coalesced_get * c, trg_coalesced_get * n)
+{
+    GHashTableIter iter;
+    gpointer field;
+    guint i, j;
+
+    if (c->tagged != n->tagged || (c->tagged && c->tag != n->tag)
+        || g_strcmp0(c->format, n->format))
+        return FALSE;
+
+    g_hash_table_iter_init(&iter, n->fields);
+    while (g_hash_table_iter_next(&iter, &field, NULL))
+        if (!g_hash_table_contains(c->fields, field))
+            return FALSE;
+
+    if (!c->ids && !c->recent)
+        return TRUE;
+    else if (c->recent || n->recent || !n->ids)
+        return c->recent && n->recent;
+
+    for (i = 0; i < n->ids->len; i++) {
+        gint64 id = g_array_index(n->ids, gint64, i);
+        for (j = 0; j < c->ids->len; j++)
+            if (g_array_index(c->ids, gint64, j) == id)
+                break;
+        if (j == c->ids->len)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean trg_coalesced_get_is_list(trg_coalesced_get * c)
+{
+    return c->tagged && (c->tag == TORRENT_GET_TAG_MODE_FULL
+                         || c->tag == TORRENT_GET_TAG_MODE_UPDATE);
+}
+
+/* Whether an RPC might change what a torrent-get returns. */
+static gboolean trg_request_is_action(const gchar * method)
+{
+    return method && g_strcmp0(method, TRG_DIAG_METHOD_HTTP)
+        && g_strcmp0(method, METHOD_TORRENT_GET)
+        && g_strcmp0(method, METHOD_SESSION_GET)
+        && g_strcmp0(method, METHOD_SESSION_STATS)
+        && g_strcmp0(method, METHOD_PORT_TEST);
+}
+
+static gboolean dispatch_coalesce(TrgClient * tc, trg_request * req,
+                                  GSourceFunc * callback, gpointer * data);
+
+/* A list poll has finished, so send the ones held back behind it, or drop
+ * them if the connection has changed since. */
+static void dispatch_deferred_gets(TrgClient * tc)
+{
+    TrgClientPrivate *priv = tc->priv;
+    gint connid = g_atomic_int_get(&priv->connid);
+    GList *deferred = priv->deferredGets;
+    GList *li;
+
+    priv->deferredGets = NULL;
+
+    for (li = deferred; li; li = g_list_next(li)) {
+        trg_request *req = (trg_request *) li->data;
+        GSourceFunc callback = req->callback;
+        gpointer data = req->cb_data;
+
+        if (req->connid != connid) {
+            trg_request_free(req);
+            g_free(req);
+        } else if (!dispatch_coalesce(tc, req, &callback, &data)) {
+            dispatch_async_common(tc, req, callback, data);
+        }
+    }
+
+    g_list_free(deferred);
+}
+
+static gboolean dispatch_coalesced_callback(gpointer data)
+{
+    trg_response *rsp = (trg_response *) data;
+    trg_coalesced_get *c = (trg_coalesced_get *) rsp->cb_data;
+    TrgClientPrivate *priv = c->tc->priv;
+    gint connid = g_atomic_int_get(&priv->connid);
+    GList *li;
+
+    priv->inflightGets = g_list_remove(priv->inflightGets, c);
+
+    /* Each caller frees its own response, so give them a reference each. */
+    for (li = c->waiters; li; li = g_list_next(li)) {
+        trg_request *waiter = (trg_request *) li->data;
+
+        if (waiter->connid == connid) {
+            trg_response *copy = g_new0(trg_response, 1);
+            copy->status = rsp->status;
+            copy->size = rsp->size;
+            copy->connects = 0;
+            copy->rtt = rsp->rtt;
+            copy->server_time = rsp->server_time;
+            copy->cb_data = waiter->cb_data;
+            copy->client = rsp->client;
+            if (rsp->obj)
+                copy->obj = json_object_ref(rsp->obj);
+            waiter->callback(copy);
+        }
+
+        g_free(waiter);
+    }
+
+    g_list_free(c->waiters);
+
+    if (c->connid == connid) {
+        rsp->cb_data = c->cb_data;
+        c->callback(rsp);
+    } else {
+        trg_response_free(rsp);
+    }
+
+    if (trg_coalesced_get_is_list(c))
+        dispatch_deferred_gets(c->tc);
+
+    trg_coalesced_get_free(c);
+
+    return FALSE;
+}
+
+/* Returns TRUE if the request was attached to one already in flight, or
+ * held back behind one. Otherwise, for a torrent-get, the callback and its
+ * data are swapped for the coalescing wrapper. */
+static gboolean
+dispatch_coalesce(TrgClient * tc, trg_request * req,
+                  GSourceFunc * callback, gpointer * data)
+{
+    TrgClientPrivate *priv = tc->priv;
+    gint connid = g_atomic_int_get(&priv->connid);
+    gint actionGen = g_atomic_int_get(&priv->actionGen);
+    gboolean listInFlight = FALSE;
+    trg_coalesced_get *n;
+    GList *li;
+
+    /* A cancellable request has to be the one that actually runs. */
+    if (!req->node || !*callback || req->cancellable
+        || g_thread_self() != priv->mainThread)
+        return FALSE;
+
+    n = trg_coalesced_get_new(req->node);
+    if (!n)
+        return FALSE;
+
+    for (li = priv->inflightGets; li; li = g_list_next(li)) {
+        trg_coalesced_get *c = (trg_coalesced_get *) li->data;
+
+        if (c->connid != connid)
+            continue;
+
+        if (c->actionGen == actionGen && trg_coalesced_get_covers(c, n)) {
+            trg_coalesced_get_free(n);
+            json_node_free(req->node);
+            req->node = NULL;
+            req->callback = *callback;
+            req->cb_data = *data;
+            req->connid = connid;
+            c->waiters = g_list_append(c->waiters, req);
+            return TRUE;
+        }
+
+        listInFlight |= trg_coalesced_get_is_list(c);
+    }
+
+    if (listInFlight && trg_coalesced_get_is_list(n)) {
+        trg_coalesced_get_free(n);
+        req->callback = *callback;
+        req->cb_data = *data;
+        req->connid = connid;
+        priv->deferredGets = g_list_append(priv->deferredGets, req);
+        return TRUE;
+    }
+
+    n->tc = tc;
+    n->connid = connid;
+    n->actionGen = actionGen;
+    n->callback = *callback;
+    n->cb_data = *data;
+    priv->inflightGets = g_list_prepend(priv->inflightGets, n);
+
+    *callback = dispatch_coalesced_callback;
+    *data = n;
+
+    return FALSE;
+}
+
+/* Work out which lane an RPC goes in, when the caller hasn't said. */
+static gint dispatch_request_priority(trg_request * req)
+{
+    const gchar *method = trg_request_method(req);
+
+    if (req->url)
+        return TRG_REQUEST_PRIORITY_PUBLIC;
+    else if (!method)
+        return TRG_REQUEST_PRIORITY_INTERACTIVE;
+
+    if (!g_strcmp0(method, METHOD_TORRENT_GET))
+        return TRG_REQUEST_PRIORITY_VISIBLE;
+    else if (!g_strcmp0(method, METHOD_SESSION_GET)
+             || !g_strcmp0(method, METHOD_SESSION_STATS))
+        return TRG_REQUEST_PRIORITY_BACKGROUND;
+
+    return TRG_REQUEST_PRIORITY_INTERACTIVE;
+}
+
+static gint
+dispatch_priority_compare(gconstpointer a, gconstpointer b, gpointer data)
+{
+    const trg_request *ra = (const trg_request *) a;
+    const trg_request *rb = (const trg_request *) b;
+
+    if (ra->priority != rb->priority)
+        return ra->priority < rb->priority ? -1 : 1;
+
+    /* The sort isn't stable, so keep FIFO order within a lane. */
+    return ra->serial < rb->serial ? -1 : ra->serial > rb->serial;
 }
 
 static gboolean
@@ -752,9 +1891,23 @@ dispatch_async_common(TrgClient * tc,
 
     trg_req->callback = callback;
     trg_req->cb_data = data;
+    trg_req->client = tc;
     trg_req->connid = g_atomic_int_get(&priv->connid);
+    trg_req->serial = g_atomic_int_add(&priv->requestSerial, 1);
+    if (trg_request_is_action(trg_request_method(trg_req)))
+        g_atomic_int_inc(&priv->actionGen);
+    if (trg_req->priority == TRG_REQUEST_PRIORITY_DEFAULT)
+        trg_req->priority = dispatch_request_priority(trg_req);
+
+    if (trg_client_use_multi(tc)) {
+        dispatch_multi(tc, trg_req);
+        return TRUE;
+    }
 
-    trg_client_thread_pool_push(tc, trg_req, &error);
+    if (trg_req->url)
+        g_thread_pool_push(priv->publicPool, trg_req, &error);
+    else
+        trg_client_thread_pool_push(tc, trg_req, &error);
     if (error) {
         g_error("thread creation error: %s\n", error->message);
         g_error_free(error);
@@ -765,19 +1918,226 @@ dispatch_async_common(TrgClient * tc,
     }
 }
 
+gboolean
+dispatch_async_priority(TrgClient * tc, JsonNode * req, gint priority,
+                        GSourceFunc callback, gpointer data)
+{
+    trg_request *trg_req = g_new0(trg_request, 1);
+    trg_req->node = req;
+    trg_req->priority = priority;
+
+    if (dispatch_coalesce(tc, trg_req, &callback, &data))
+        return TRUE;
+
+    return dispatch_async_common(tc, trg_req, callback, data);
+}
+
+/* As dispatch_async(), but returns a GCancellable (which the caller owns a
+ * reference to) for abandoning the request. Cancelling aborts the transfer
+ * if it's running, or stops it being sent if it's still queued, and the
+ * callback is then not called. */
+GCancellable *dispatch_async_cancellable(TrgClient * tc, JsonNode * req,
+                                         gint priority,
+                                         GSourceFunc callback,
+                                         gpointer data)
+{
+    trg_request *trg_req = g_new0(trg_request, 1);
+    GCancellable *cancellable = g_cancellable_new();
+
+    trg_req->node = req;
+    trg_req->priority = priority;
+    trg_req->cancellable = g_object_ref(cancellable);
+
+    if (!dispatch_async_common(tc, trg_req, callback, data)) {
+        g_object_unref(cancellable);
+        return NULL;
+    }
+
+    return cancellable;
+}
+
 gboolean
 dispatch_async(TrgClient * tc, JsonNode * req,
                GSourceFunc callback, gpointer data)
 {
-    trg_request *trg_req = g_new0(trg_request, 1);
+    return dispatch_async_priority(tc, req, TRG_REQUEST_PRIORITY_DEFAULT,
+                                   callback, data);
+}
+
+/* As dispatch_async(), for a torrent-add, with the base64 of metainfoFile
+ * (if not NULL) streamed into its metainfo argument as it's sent (see
+ * trg-upload-stream.c). Returns FALSE, freeing req and setting error, if
+ * the file can't be read. */
+gboolean
+dispatch_async_upload(TrgClient * tc, JsonNode * req,
+                      const gchar * metainfoFile, GSourceFunc callback,
+                      gpointer data, GError ** error)
+{
+    trg_request *trg_req;
+    trg_upload_stream *upload = NULL;
+
+    if (metainfoFile) {
+        upload = trg_upload_stream_new(req, metainfoFile, error);
+        if (!upload) {
+            json_node_free(req);
+            return FALSE;
+        }
+    }
+
+    trg_req = g_new0(trg_request, 1);
     trg_req->node = req;
+    trg_req->upload = upload;
 
     return dispatch_async_common(tc, trg_req, callback, data);
 }
 
+/* Action batching.
+ *
+ * Torrent actions (start, stop, verify, queue moves...) issued through
+ * dispatch_async_batched() are held for ACTION_BATCH_WINDOW_MS. Consecutive
+ * requests for the same method, arguments and callback are merged into one
+ * RPC with a combined ids array, so the callback (and the interactive
+ * torrent-get it usually triggers) runs once per batch. A request for an id
+ * already in the open batch starts a new one, so repeated queue moves aren't
+ * collapsed, and batches are sent in the order they were opened.
+ */
+
+typedef struct {
+    JsonNode *node;
+    JsonArray *ids;
+    gchar *key;
+    gint connid;
+    GSourceFunc callback;
+    gpointer cb_data;
+} trg_action_batch;
+
+static gchar *action_batch_key(JsonNode * node)
+{
+    JsonObject *root = json_node_get_object(node);
+    JsonObject *args = get_arguments(root);
+    JsonArray *ids = json_array_ref(json_object_get_array_member(args,
+                                                                 PARAM_IDS));
+    JsonNode *tag = NULL;
+    gchar *key;
+
+    json_object_remove_member(args, PARAM_IDS);
+    if (json_object_has_member(root, PARAM_TAG)) {
+        tag = json_node_copy(json_object_get_member(root, PARAM_TAG));
+        json_object_remove_member(root, PARAM_TAG);
+    }
+
+    key = trg_serialize(node);
+
+    json_object_set_array_member(args, PARAM_IDS, ids);
+    if (tag)
+        json_object_set_member(root, PARAM_TAG, tag);
+
+    return key;
+}
+
+static gboolean action_batch_has_id(trg_action_batch * batch, gint64 id)
+{
+    guint i;
+
+    for (i = 0; i < json_array_get_length(batch->ids); i++)
+        if (json_array_get_int_element(batch->ids, i) == id)
+            return TRUE;
+
+    return FALSE;
+}
+
+static gboolean action_batch_flush(gpointer data)
+{
+    TrgClient *tc = TRG_CLIENT(data);
+    TrgClientPrivate *priv = tc->priv;
+    GList *batches = priv->actionBatches;
+    GList *li;
+
+    priv->actionBatches = NULL;
+    priv->actionBatchTimer = 0;
+
+    for (li = batches; li; li = g_list_next(li)) {
+        trg_action_batch *batch = (trg_action_batch *) li->data;
+
+        /* Don't send actions meant for one daemon to the next. */
+        if (batch->connid == g_atomic_int_get(&priv->connid)) {
+            request_set_tag_from_ids(batch->node, batch->ids);
+            dispatch_async(tc, batch->node, batch->callback,
+                           batch->cb_data);
+        } else {
+            json_node_free(batch->node);
+        }
+
+        g_free(batch->key);
+        g_free(batch);
+    }
+
+    g_list_free(batches);
+
+    return FALSE;
+}
+
+gboolean
+dispatch_async_batched(TrgClient * tc, JsonNode * req,
+                       GSourceFunc callback, gpointer data)
+{
+    TrgClientPrivate *priv = tc->priv;
+    JsonObject *args = node_get_arguments(req);
+    trg_action_batch *last;
+    JsonArray *ids;
+    gchar *key;
+    guint i, len;
+
+    if (g_thread_self() != priv->mainThread
+        || !json_object_has_member(args, PARAM_IDS)
+        || !JSON_NODE_HOLDS_ARRAY(json_object_get_member(args, PARAM_IDS)))
+        return dispatch_async(tc, req, callback, data);
+
+    ids = json_object_get_array_member(args, PARAM_IDS);
+    len = json_array_get_length(ids);
+    key = action_batch_key(req);
+
+    last = priv->actionBatches ?
+        (trg_action_batch *) g_list_last(priv->actionBatches)->data : NULL;
+
+    if (last && last->callback == callback && last->cb_data == data
+        && last->connid == g_atomic_int_get(&priv->connid)
+        && !g_strcmp0(last->key, key)) {
+        for (i = 0; i < len; i++)
+            if (action_batch_has_id(last, json_array_get_int_element(ids, i)))
+                break;
+
+        if (i == len) {
+            for (i = 0; i < len; i++)
+                json_array_add_int_element(last->ids,
+                                           json_array_get_int_element(ids,
+                                                                      i));
+            json_node_free(req);
+            g_free(key);
+            return TRUE;
+        }
+    }
+
+    last = g_new0(trg_action_batch, 1);
+    last->node = req;
+    last->ids = ids;
+    last->key = key;
+    last->connid = g_atomic_int_get(&priv->connid);
+    last->callback = callback;
+    last->cb_data = data;
+    priv->actionBatches = g_list_append(priv->actionBatches, last);
+
+    if (!priv->actionBatchTimer)
+        priv->actionBatchTimer = g_timeout_add(ACTION_BATCH_WINDOW_MS,
+                                               action_batch_flush, tc);
+
+    return TRUE;
+}
+
 gboolean async_http_request(TrgClient *tc, gchar *url, const gchar *cookie, GSourceFunc callback, gpointer data) {
 	trg_request *trg_req = g_new0(trg_request, 1);
 	trg_req->url = g_strdup(url);
+	trg_req->priority = TRG_REQUEST_PRIORITY_PUBLIC;
 
 	if (cookie)
 		trg_req->cookie = g_strdup(cookie);
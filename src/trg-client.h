@@ -27,6 +27,7 @@
 
 #include <json-glib/json-glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "trg-prefs.h"
 #include "session-get.h"
@@ -52,26 +53,59 @@
 #define FAIL_JSON_DECODE -2
 #define FAIL_RESPONSE_UNSUCCESSFUL -3
 #define DISPATCH_POOL_SIZE 3
+#define DISPATCH_PUBLIC_POOL_SIZE 2
+#define ACTION_BATCH_WINDOW_MS 150
 
 #define HTTP_CLASS_TRANSMISSION 0
 #define HTTP_CLASS_PUBLIC 1
 
+/* Request lanes, lowest first. Default means work it out from the method. */
+#define TRG_REQUEST_PRIORITY_DEFAULT -1
+#define TRG_REQUEST_PRIORITY_INTERACTIVE 0
+#define TRG_REQUEST_PRIORITY_VISIBLE 1
+#define TRG_REQUEST_PRIORITY_BACKGROUND 2
+#define TRG_REQUEST_PRIORITY_PUBLIC 3
+
+/* Incremental response parser, see json.c */
+typedef struct _trg_json_stream trg_json_stream;
+
+/* Per-request timing histograms, see trg-diagnostics.c */
+typedef struct _trg_diagnostics trg_diagnostics;
+
 typedef struct {
     int status;
     int size;
     char *raw;
     JsonObject *obj;
     gpointer cb_data;
+    trg_json_stream *stream;
+    int connects;               /* new connections made, 0 if reused */
+    gdouble rtt;                /* seconds, whole transfer */
+    gdouble server_time;        /* seconds, request sent to first byte */
+    gdouble namelookup_time;    /* seconds from the start, as curl has them */
+    gdouble connect_time;
+    gdouble appconnect_time;
+    gdouble starttransfer_time;
+    gint64 parse_time;          /* microseconds spent decoding JSON */
+    GCancellable *cancellable;  /* the request's, if it had one */
+    struct _TrgClient *client;  /* the one it was sent through */
 } trg_response;
 
+struct _TrgClient;
+
 typedef struct {
+    struct _TrgClient *client;
     gint connid;
+    GCancellable *cancellable;
     JsonNode *node;
     gchar *body;
     gchar *url;
     GSourceFunc callback;
     gpointer cb_data;
     gchar *cookie;
+    gint priority;
+    gint serial;
+    struct _trg_upload_stream *upload; /* streamed instead of body */
 } trg_request;
 
 typedef struct _TrgClientPrivate TrgClientPrivate;
@@ -88,7 +122,7 @@ G_BEGIN_DECLS
   (G_TYPE_CHECK_CLASS_TYPE ((klass), TRG_TYPE_CLIENT))
 #define TRG_CLIENT_GET_CLASS(obj) \
   (G_TYPE_INSTANCE_GET_CLASS ((obj), TRG_TYPE_CLIENT, TrgClientClass))
-    typedef struct {
+    typedef struct _TrgClient {
     GObject parent;
     TrgClientPrivate *priv;
 } TrgClient;
@@ -97,6 +131,8 @@ typedef struct {
     GObjectClass parent_class;
     void (*session_updated) (TrgClient * tc, JsonObject * session,
                              gpointer data);
+    void (*session_changed) (TrgClient * tc, const gchar * key,
+                             gpointer data);
 
 } TrgClientClass;
 
@@ -125,6 +161,19 @@ trg_response *dispatch(TrgClient * tc, trg_request *req);
 trg_response *dispatch_public_http(TrgClient *tc, trg_request *req);
 gboolean dispatch_async(TrgClient * client, JsonNode * req,
                         GSourceFunc callback, gpointer data);
+gboolean dispatch_async_batched(TrgClient * client, JsonNode * req,
+                                GSourceFunc callback, gpointer data);
+gboolean dispatch_async_upload(TrgClient * client, JsonNode * req,
+                               const gchar * metainfoFile,
+                               GSourceFunc callback, gpointer data,
+                               GError ** error);
+gboolean dispatch_async_priority(TrgClient * client, JsonNode * req,
+                                 gint priority, GSourceFunc callback,
+                                 gpointer data);
+GCancellable *dispatch_async_cancellable(TrgClient * client, JsonNode * req,
+                                         gint priority,
+                                         GSourceFunc callback,
+                                         gpointer data);
 gboolean async_http_request(TrgClient *tc, gchar *url, const gchar *cookie, GSourceFunc callback, gpointer data);
 
 /* end dispatch.c*/
@@ -132,9 +181,13 @@ gboolean async_http_request(TrgClient *tc, gchar *url, const gchar *cookie, GSou
 GType trg_client_get_type(void);
 
 TrgClient *trg_client_new(void);
+TrgClient *trg_client_new_for_profile(TrgClient * tc, JsonObject * profile);
+void trg_client_retire(TrgClient * tc, GDestroyNotify notify,
+                       gpointer data);
 TrgPrefs *trg_client_get_prefs(TrgClient * tc);
 int trg_client_populate_with_settings(TrgClient * tc);
 void trg_client_set_session(TrgClient * tc, JsonObject * session);
+void trg_client_merge_session(TrgClient * tc, JsonObject * partial);
 gdouble trg_client_get_version(TrgClient * tc);
 const gchar *trg_client_get_version_string(TrgClient * tc);
 gint64 trg_client_get_rpc_version(TrgClient * tc);
@@ -167,6 +220,9 @@ gboolean trg_client_update_session(TrgClient * tc, GSourceFunc callback,
                                    gpointer data);
 gboolean trg_client_get_seed_ratio_limited(TrgClient * tc);
 gdouble trg_client_get_seed_ratio_limit(TrgClient * tc);
+void trg_client_get_connection_stats(TrgClient * tc, guint * reused,
+                                     guint * created);
+trg_diagnostics *trg_client_get_diagnostics(TrgClient * tc);
 
 G_END_DECLS
 #endif                          /* _TRG_CLIENT_H_ */
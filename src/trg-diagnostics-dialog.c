@@ -0,0 +1,395 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+#include "hig.h"
+#include "util.h"
+#include "trg-client.h"
+#include "trg-diagnostics.h"
+#include "trg-diagnostics-dialog.h"
+#include "trg-main-window.h"
+#include "trg-tree-view.h"
+
+enum {
+    DIAGCOL_METHOD,
+    DIAGCOL_METRIC,
+    DIAGCOL_COUNT,
+    DIAGCOL_MEAN,
+    DIAGCOL_P50,
+    DIAGCOL_P90,
+    DIAGCOL_P99,
+    DIAGCOL_MAX,
+    DIAGCOL_COLUMNS
+};
+
+enum {
+    PROP_0,
+    PROP_PARENT,
+    PROP_CLIENT
+};
+
+enum {
+    DIAG_RESPONSE_EXPORT = 1,
+    DIAG_RESPONSE_RESET
+};
+
+#define DIAGNOSTICS_UPDATE_INTERVAL 2
+
+G_DEFINE_TYPE(TrgDiagnosticsDialog, trg_diagnostics_dialog,
+              GTK_TYPE_DIALOG)
+#define TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRG_TYPE_DIAGNOSTICS_DIALOG, TrgDiagnosticsDialogPrivate))
+typedef struct _TrgDiagnosticsDialogPrivate TrgDiagnosticsDialogPrivate;
+
+struct _TrgDiagnosticsDialogPrivate {
+    TrgClient *client;
+    TrgMainWindow *parent;
+    GtkWidget *tv;
+    GtkListStore *model;
+    guint timerId;
+};
+
+static GObject *instance = NULL;
+
+static void
+trg_diagnostics_dialog_get_property(GObject * object, guint property_id,
+                                    GValue * value, GParamSpec * pspec)
+{
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+}
+
+static void
+trg_diagnostics_dialog_set_property(GObject * object, guint property_id,
+                                    const GValue * value,
+                                    GParamSpec * pspec)
+{
+    TrgDiagnosticsDialogPrivate *priv =
+        TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(object);
+    switch (property_id) {
+    case PROP_CLIENT:
+        priv->client = g_value_get_pointer(value);
+        break;
+    case PROP_PARENT:
+        priv->parent = g_value_get_object(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+format_value(gchar * buf, gsize len, trg_diag_metric metric, gint64 value)
+{
+    if (trg_diag_metric_is_time(metric))
+        g_snprintf(buf, len, "%.1f ms", value / 1000.0);
+    else
+        tr_formatter_size_B(buf, value, len);
+}
+
+static void trg_diagnostics_dialog_refresh(TrgDiagnosticsDialog * dlg)
+{
+    TrgDiagnosticsDialogPrivate *priv =
+        TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(dlg);
+    trg_diagnostics *diag = trg_client_get_diagnostics(priv->client);
+    GList *methods = trg_diagnostics_get_methods(diag);
+    GList *li;
+
+    gtk_list_store_clear(priv->model);
+
+    for (li = methods; li; li = g_list_next(li)) {
+        const gchar *method = (const gchar *) li->data;
+        gint i;
+
+        for (i = 0; i < TRG_DIAG_METRICS; i++) {
+            trg_diag_histogram h;
+            GtkTreeIter iter;
+            gchar count[32], mean[32], p50[32], p90[32], p99[32],
+                max[32];
+
+            if (!trg_diagnostics_get(diag, method, i, &h))
+                continue;
+
+            g_snprintf(count, sizeof(count), "%" G_GUINT64_FORMAT,
+                       h.count);
+            format_value(mean, sizeof(mean), i, h.sum / (gint64) h.count);
+            format_value(p50, sizeof(p50), i,
+                         trg_diag_histogram_percentile(&h, 0.5));
+            format_value(p90, sizeof(p90), i,
+                         trg_diag_histogram_percentile(&h, 0.9));
+            format_value(p99, sizeof(p99), i,
+                         trg_diag_histogram_percentile(&h, 0.99));
+            format_value(max, sizeof(max), i, h.max);
+
+            gtk_list_store_insert_with_values(priv->model, &iter, -1,
+                                              DIAGCOL_METHOD, method,
+                                              DIAGCOL_METRIC,
+                                              trg_diag_metric_name(i),
+                                              DIAGCOL_COUNT, count,
+                                              DIAGCOL_MEAN, mean,
+                                              DIAGCOL_P50, p50,
+                                              DIAGCOL_P90, p90,
+                                              DIAGCOL_P99, p99,
+                                              DIAGCOL_MAX, max, -1);
+        }
+    }
+
+    g_list_free_full(methods, g_free);
+}
+
+static gboolean trg_diagnostics_dialog_timerfunc(gpointer data)
+{
+    trg_diagnostics_dialog_refresh(TRG_DIAGNOSTICS_DIALOG(data));
+    return TRUE;
+}
+
+static void trg_diagnostics_dialog_export(TrgDiagnosticsDialog * dlg)
+{
+    TrgDiagnosticsDialogPrivate *priv =
+        TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(dlg);
+    GtkWidget *chooser =
+        gtk_file_chooser_dialog_new(_("Export Diagnostics"),
+                                    GTK_WINDOW(dlg),
+                                    GTK_FILE_CHOOSER_ACTION_SAVE,
+                                    GTK_STOCK_CANCEL,
+                                    GTK_RESPONSE_CANCEL,
+                                    GTK_STOCK_SAVE,
+                                    GTK_RESPONSE_ACCEPT, NULL);
+
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER
+                                                   (chooser), TRUE);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser),
+                                      "trg-diagnostics.json");
+
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT) {
+        gchar *filename =
+            gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+        JsonNode *root =
+            trg_diagnostics_to_json(trg_client_get_diagnostics
+                                    (priv->client));
+        JsonGenerator *gen = json_generator_new();
+        GError *error = NULL;
+
+        json_generator_set_pretty(gen, TRUE);
+        json_generator_set_root(gen, root);
+
+        if (!json_generator_to_file(gen, filename, &error)) {
+            GtkWidget *msg = gtk_message_dialog_new(GTK_WINDOW(dlg),
+                                                    GTK_DIALOG_MODAL,
+                                                    GTK_MESSAGE_ERROR,
+                                                    GTK_BUTTONS_OK,
+                                                    "%s",
+                                                    error->message);
+            gtk_window_set_title(GTK_WINDOW(msg), _("Error"));
+            gtk_dialog_run(GTK_DIALOG(msg));
+            gtk_widget_destroy(msg);
+            g_error_free(error);
+        }
+
+        g_object_unref(gen);
+        json_node_free(root);
+        g_free(filename);
+    }
+
+    gtk_widget_destroy(chooser);
+}
+
+static void
+trg_diagnostics_response_cb(GtkDialog * dlg, gint res_id,
+                            gpointer data G_GNUC_UNUSED)
+{
+    TrgDiagnosticsDialogPrivate *priv =
+        TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(dlg);
+
+    if (res_id == DIAG_RESPONSE_EXPORT) {
+        trg_diagnostics_dialog_export(TRG_DIAGNOSTICS_DIALOG(dlg));
+        return;
+    } else if (res_id == DIAG_RESPONSE_RESET) {
+        trg_diagnostics_reset(trg_client_get_diagnostics(priv->client));
+        trg_diagnostics_dialog_refresh(TRG_DIAGNOSTICS_DIALOG(dlg));
+        return;
+    }
+
+    gtk_widget_destroy(GTK_WIDGET(dlg));
+}
+
+/* Closed, or destroyed along with the main window. */
+static void
+trg_diagnostics_dialog_destroy_cb(GtkWidget * w,
+                                  gpointer data G_GNUC_UNUSED)
+{
+    TrgDiagnosticsDialogPrivate *priv =
+        TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(w);
+
+    if (priv->timerId > 0) {
+        g_source_remove(priv->timerId);
+        priv->timerId = 0;
+    }
+
+    instance = NULL;
+}
+
+static void
+trg_diagnostics_add_column(GtkTreeView * tv, gint index, gchar * title,
+                           gint width)
+{
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column =
+        gtk_tree_view_column_new_with_attributes(title, renderer,
+                                                 "text", index, NULL);
+    gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(column, width);
+
+    gtk_tree_view_append_column(tv, column);
+}
+
+static GObject *trg_diagnostics_dialog_constructor(GType type,
+                                                   guint
+                                                   n_construct_properties,
+                                                   GObjectConstructParam *
+                                                   construct_params)
+{
+    GtkWidget *tv, *scroll;
+
+    GObject *obj = G_OBJECT_CLASS
+        (trg_diagnostics_dialog_parent_class)->constructor(type,
+                                                           n_construct_properties,
+                                                           construct_params);
+    TrgDiagnosticsDialogPrivate *priv =
+        TRG_DIAGNOSTICS_DIALOG_GET_PRIVATE(obj);
+
+    gtk_window_set_title(GTK_WINDOW(obj), _("Diagnostics"));
+    gtk_window_set_transient_for(GTK_WINDOW(obj),
+                                 GTK_WINDOW(priv->parent));
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(obj), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(obj), 760, 400);
+    gtk_dialog_add_button(GTK_DIALOG(obj), _("_Export..."),
+                          DIAG_RESPONSE_EXPORT);
+    gtk_dialog_add_button(GTK_DIALOG(obj), _("_Reset"),
+                          DIAG_RESPONSE_RESET);
+    gtk_dialog_add_button(GTK_DIALOG(obj), GTK_STOCK_CLOSE,
+                          GTK_RESPONSE_CLOSE);
+
+    gtk_container_set_border_width(GTK_CONTAINER(obj), GUI_PAD);
+
+    gtk_dialog_set_default_response(GTK_DIALOG(obj), GTK_RESPONSE_CLOSE);
+
+    g_signal_connect(G_OBJECT(obj),
+                     "response", G_CALLBACK(trg_diagnostics_response_cb),
+                     NULL);
+    g_signal_connect(G_OBJECT(obj), "destroy",
+                     G_CALLBACK(trg_diagnostics_dialog_destroy_cb), NULL);
+
+    priv->model =
+        gtk_list_store_new(DIAGCOL_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
+                           G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                           G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+
+    tv = priv->tv = trg_tree_view_new();
+    gtk_widget_set_sensitive(tv, TRUE);
+
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_METHOD,
+                               _("Request"), 140);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_METRIC,
+                               _("Measure"), 100);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_COUNT,
+                               _("Count"), 70);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_MEAN,
+                               _("Mean"), 85);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_P50, "p50", 85);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_P90, "p90", 85);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_P99, "p99", 85);
+    trg_diagnostics_add_column(GTK_TREE_VIEW(tv), DIAGCOL_MAX, _("Max"),
+                               85);
+
+    gtk_tree_view_set_model(GTK_TREE_VIEW(tv),
+                            GTK_TREE_MODEL(priv->model));
+
+    scroll = my_scrolledwin_new(tv);
+    gtk_container_set_border_width(GTK_CONTAINER(scroll), GUI_PAD);
+    gtk_box_pack_start(GTK_BOX(gtk_bin_get_child(GTK_BIN(obj))), scroll,
+                       TRUE, TRUE, 0);
+
+    trg_diagnostics_dialog_refresh(TRG_DIAGNOSTICS_DIALOG(obj));
+    priv->timerId = g_timeout_add_seconds(DIAGNOSTICS_UPDATE_INTERVAL,
+                                          trg_diagnostics_dialog_timerfunc,
+                                          obj);
+
+    return obj;
+}
+
+static void
+trg_diagnostics_dialog_class_init(TrgDiagnosticsDialogClass * klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+    g_type_class_add_private(klass, sizeof(TrgDiagnosticsDialogPrivate));
+
+    object_class->get_property = trg_diagnostics_dialog_get_property;
+    object_class->set_property = trg_diagnostics_dialog_set_property;
+    object_class->constructor = trg_diagnostics_dialog_constructor;
+
+    g_object_class_install_property(object_class,
+                                    PROP_PARENT,
+                                    g_param_spec_object
+                                    ("parent-window", "Parent window",
+                                     "Parent window",
+                                     TRG_TYPE_MAIN_WINDOW,
+                                     G_PARAM_READWRITE |
+                                     G_PARAM_CONSTRUCT_ONLY |
+                                     G_PARAM_STATIC_NAME |
+                                     G_PARAM_STATIC_NICK |
+                                     G_PARAM_STATIC_BLURB));
+
+    g_object_class_install_property(object_class,
+                                    PROP_CLIENT,
+                                    g_param_spec_pointer
+                                    ("trg-client", "TClient",
+                                     "Client",
+                                     G_PARAM_READWRITE |
+                                     G_PARAM_CONSTRUCT_ONLY |
+                                     G_PARAM_STATIC_NAME |
+                                     G_PARAM_STATIC_NICK |
+                                     G_PARAM_STATIC_BLURB));
+}
+
+static void trg_diagnostics_dialog_init(TrgDiagnosticsDialog * self)
+{
+}
+
+TrgDiagnosticsDialog *trg_diagnostics_dialog_get_instance(TrgMainWindow *
+                                                          parent,
+                                                          TrgClient *
+                                                          client)
+{
+    if (instance == NULL) {
+        instance = g_object_new(TRG_TYPE_DIAGNOSTICS_DIALOG,
+                                "trg-client", client,
+                                "parent-window", parent, NULL);
+    }
+
+    return TRG_DIAGNOSTICS_DIALOG(instance);
+}
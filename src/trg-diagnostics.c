@@ -0,0 +1,281 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "trg-client.h"
+#include "trg-diagnostics.h"
+
+/* Latency histograms for each RPC method, so a slow refresh can be pinned
+ * on DNS, connecting, TLS, the daemon, decoding the JSON or applying the
+ * result to the model. Requests are recorded from the pool threads and the
+ * model apply from the main thread, so everything is under one mutex.
+ */
+
+struct _trg_diagnostics {
+    GMutex mutex;
+    GHashTable *methods;        /* gchar* -> trg_diag_histogram[METRICS] */
+};
+
+static const gchar *metric_names[TRG_DIAG_METRICS] = {
+    "namelookup",
+    "connect",
+    "appconnect",
+    "first-byte",
+    "total",
+    "bytes",
+    "parse",
+    "apply"
+};
+
+const gchar *trg_diag_metric_name(trg_diag_metric metric)
+{
+    return metric_names[metric];
+}
+
+gboolean trg_diag_metric_is_time(trg_diag_metric metric)
+{
+    return metric != TRG_DIAG_BYTES;
+}
+
+trg_diagnostics *trg_diagnostics_new(void)
+{
+    trg_diagnostics *d = g_new0(trg_diagnostics, 1);
+
+    g_mutex_init(&d->mutex);
+    d->methods = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                       g_free);
+
+    return d;
+}
+
+void trg_diagnostics_free(trg_diagnostics * d)
+{
+    if (!d)
+        return;
+
+    g_hash_table_destroy(d->methods);
+    g_mutex_clear(&d->mutex);
+    g_free(d);
+}
+
+void trg_diagnostics_reset(trg_diagnostics * d)
+{
+    g_mutex_lock(&d->mutex);
+    g_hash_table_remove_all(d->methods);
+    g_mutex_unlock(&d->mutex);
+}
+
+static void histogram_add(trg_diag_histogram * h, gint64 value)
+{
+    guint bucket;
+
+    if (value < 0)
+        value = 0;
+
+    bucket = value > 0 ? g_bit_storage((gulong) value) : 0;
+    if (bucket >= TRG_DIAG_BUCKETS)
+        bucket = TRG_DIAG_BUCKETS - 1;
+
+    if (h->count == 0 || value < h->min)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+
+    h->count++;
+    h->sum += value;
+    h->buckets[bucket]++;
+}
+
+void
+trg_diagnostics_record(trg_diagnostics * d, const gchar * method,
+                       trg_diag_metric metric, gint64 value)
+{
+    trg_diag_histogram *histograms;
+
+    if (!d || !method)
+        return;
+
+    g_mutex_lock(&d->mutex);
+
+    histograms = g_hash_table_lookup(d->methods, method);
+    if (!histograms) {
+        histograms = g_new0(trg_diag_histogram, TRG_DIAG_METRICS);
+        g_hash_table_insert(d->methods, g_strdup(method), histograms);
+    }
+
+    histogram_add(&histograms[metric], value);
+
+    g_mutex_unlock(&d->mutex);
+}
+
+#define SECONDS_TO_US(s) ((gint64) ((s) * G_USEC_PER_SEC))
+
+void
+trg_diagnostics_record_response(trg_diagnostics * d, const gchar * method,
+                                trg_response * response)
+{
+    /* Nothing was sent (cancelled while queued). */
+    if (response->rtt <= 0)
+        return;
+
+    trg_diagnostics_record(d, method, TRG_DIAG_NAMELOOKUP,
+                           SECONDS_TO_US(response->namelookup_time));
+    trg_diagnostics_record(d, method, TRG_DIAG_CONNECT,
+                           SECONDS_TO_US(response->connect_time));
+    if (response->appconnect_time > 0)
+        trg_diagnostics_record(d, method, TRG_DIAG_APPCONNECT,
+                               SECONDS_TO_US(response->appconnect_time));
+    trg_diagnostics_record(d, method, TRG_DIAG_FIRST_BYTE,
+                           SECONDS_TO_US(response->starttransfer_time));
+    trg_diagnostics_record(d, method, TRG_DIAG_TOTAL,
+                           SECONDS_TO_US(response->rtt));
+    trg_diagnostics_record(d, method, TRG_DIAG_BYTES, response->size);
+
+    if (response->parse_time > 0)
+        trg_diagnostics_record(d, method, TRG_DIAG_PARSE,
+                               response->parse_time);
+}
+
+GList *trg_diagnostics_get_methods(trg_diagnostics * d)
+{
+    GList *methods = NULL;
+    GHashTableIter iter;
+    gpointer key;
+
+    g_mutex_lock(&d->mutex);
+
+    g_hash_table_iter_init(&iter, d->methods);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+        methods = g_list_prepend(methods, g_strdup((gchar *) key));
+
+    g_mutex_unlock(&d->mutex);
+
+    return g_list_sort(methods, (GCompareFunc) g_strcmp0);
+}
+
+gboolean
+trg_diagnostics_get(trg_diagnostics * d, const gchar * method,
+                    trg_diag_metric metric, trg_diag_histogram * out)
+{
+    trg_diag_histogram *histograms;
+
+    g_mutex_lock(&d->mutex);
+
+    histograms = g_hash_table_lookup(d->methods, method);
+    if (histograms)
+        memcpy(out, &histograms[metric], sizeof(trg_diag_histogram));
+
+    g_mutex_unlock(&d->mutex);
+
+    return histograms != NULL && out->count > 0;
+}
+
+/* An estimate, the upper bound of the bucket the percentile falls in. */
+gint64
+trg_diag_histogram_percentile(const trg_diag_histogram * h, gdouble p)
+{
+    guint64 target, seen = 0;
+    guint i;
+
+    if (h->count == 0)
+        return 0;
+
+    target = (guint64) (p * h->count + 0.5);
+    if (target < 1)
+        target = 1;
+
+    for (i = 0; i < TRG_DIAG_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            gint64 upper = i == 0 ? 0 : (((gint64) 1) << i) - 1;
+            return MIN(upper, h->max);
+        }
+    }
+
+    return h->max;
+}
+
+static JsonObject *histogram_to_json(const trg_diag_histogram * h)
+{
+    JsonObject *obj = json_object_new();
+    JsonArray *buckets = json_array_new();
+    guint i;
+
+    json_object_set_int_member(obj, "count", h->count);
+    json_object_set_int_member(obj, "sum", h->sum);
+    json_object_set_int_member(obj, "min", h->min);
+    json_object_set_int_member(obj, "max", h->max);
+    json_object_set_int_member(obj, "p50",
+                               trg_diag_histogram_percentile(h, 0.5));
+    json_object_set_int_member(obj, "p90",
+                               trg_diag_histogram_percentile(h, 0.9));
+    json_object_set_int_member(obj, "p99",
+                               trg_diag_histogram_percentile(h, 0.99));
+
+    for (i = 0; i < TRG_DIAG_BUCKETS; i++)
+        json_array_add_int_element(buckets, h->buckets[i]);
+    json_object_set_array_member(obj, "buckets", buckets);
+
+    return obj;
+}
+
+/* For attaching to bug reports. Times are in microseconds. */
+JsonNode *trg_diagnostics_to_json(trg_diagnostics * d)
+{
+    JsonNode *root = json_node_new(JSON_NODE_OBJECT);
+    JsonObject *rootObj = json_object_new();
+    JsonObject *methodsObj = json_object_new();
+    GHashTableIter iter;
+    gpointer key, value;
+    guint i;
+
+    json_object_set_string_member(rootObj, "version", PACKAGE_VERSION);
+    json_object_set_string_member(rootObj, "time-unit", "us");
+
+    g_mutex_lock(&d->mutex);
+
+    g_hash_table_iter_init(&iter, d->methods);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        trg_diag_histogram *histograms = (trg_diag_histogram *) value;
+        JsonObject *methodObj = json_object_new();
+
+        for (i = 0; i < TRG_DIAG_METRICS; i++)
+            if (histograms[i].count > 0)
+                json_object_set_object_member(methodObj, metric_names[i],
+                                              histogram_to_json
+                                              (&histograms[i]));
+
+        json_object_set_object_member(methodsObj, (gchar *) key,
+                                      methodObj);
+    }
+
+    g_mutex_unlock(&d->mutex);
+
+    json_object_set_object_member(rootObj, "methods", methodsObj);
+    json_node_take_object(root, rootObj);
+
+    return root;
+}
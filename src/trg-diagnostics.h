@@ -0,0 +1,74 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TRG_DIAGNOSTICS_H_
+#define TRG_DIAGNOSTICS_H_
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "trg-client.h"
+
+/* Requests that aren't RPCs (RSS feeds, torrent downloads). */
+#define TRG_DIAG_METHOD_HTTP "http"
+
+#define TRG_DIAG_BUCKETS 40
+
+typedef enum {
+    TRG_DIAG_NAMELOOKUP,
+    TRG_DIAG_CONNECT,
+    TRG_DIAG_APPCONNECT,
+    TRG_DIAG_FIRST_BYTE,
+    TRG_DIAG_TOTAL,
+    TRG_DIAG_BYTES,
+    TRG_DIAG_PARSE,
+    TRG_DIAG_APPLY,
+    TRG_DIAG_METRICS
+} trg_diag_metric;
+
+/* Times are in microseconds, sizes in bytes. Bucket n counts values of n
+ * significant bits, so [2^(n-1), 2^n). */
+typedef struct {
+    guint64 count;
+    gint64 sum;
+    gint64 min;
+    gint64 max;
+    guint64 buckets[TRG_DIAG_BUCKETS];
+} trg_diag_histogram;
+
+trg_diagnostics *trg_diagnostics_new(void);
+void trg_diagnostics_free(trg_diagnostics * d);
+void trg_diagnostics_reset(trg_diagnostics * d);
+void trg_diagnostics_record(trg_diagnostics * d, const gchar * method,
+                            trg_diag_metric metric, gint64 value);
+void trg_diagnostics_record_response(trg_diagnostics * d,
+                                     const gchar * method,
+                                     trg_response * response);
+GList *trg_diagnostics_get_methods(trg_diagnostics * d);
+gboolean trg_diagnostics_get(trg_diagnostics * d, const gchar * method,
+                             trg_diag_metric metric,
+                             trg_diag_histogram * out);
+JsonNode *trg_diagnostics_to_json(trg_diagnostics * d);
+
+const gchar *trg_diag_metric_name(trg_diag_metric metric);
+gboolean trg_diag_metric_is_time(trg_diag_metric metric);
+gint64 trg_diag_histogram_percentile(const trg_diag_histogram * h,
+                                     gdouble p);
+
+#endif                          /* TRG_DIAGNOSTICS_H_ */
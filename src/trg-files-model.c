@@ -376,6 +376,8 @@ static gpointer trg_files_model_buildtree_threadfunc(gpointer data)
 
     g_list_free(args->filesList);
     json_array_unref(args->files);
+    json_array_unref(args->priorities);
+    json_array_unref(args->wanted);
 
     if (args->idle_add)
         g_idle_add(trg_files_model_applytree_idlefunc, data);
@@ -385,15 +387,15 @@ static gpointer trg_files_model_buildtree_threadfunc(gpointer data)
 
 void
 trg_files_model_update(TrgFilesModel * model, GtkTreeView * tv,
-                       gint64 updateSerial, JsonObject * t, gint mode)
+                       gint64 updateSerial, trg_torrent * t, gint mode)
 {
     TrgFilesModelPrivate *priv = TRG_FILES_MODEL_GET_PRIVATE(model);
-    JsonArray *files = torrent_get_files(t);
+    JsonArray *files = t->details->files;
     GList *filesList = json_array_get_elements(files);
     guint filesListLength = g_list_length(filesList);
-    JsonArray *priorities = torrent_get_priorities(t);
-    JsonArray *wanted = torrent_get_wanted(t);
-    priv->torrentId = torrent_get_id(t);
+    JsonArray *priorities = t->details->priorities;
+    JsonArray *wanted = t->details->wanted;
+    priv->torrentId = t->id;
 
     /* It's quicker to build this up with simple data structures before
      * putting it into GTK models.
@@ -403,7 +405,12 @@ trg_files_model_update(TrgFilesModel * model, GtkTreeView * tv,
             g_new0(struct FirstUpdateThreadData, 1);
 
         gtk_tree_store_clear(GTK_TREE_STORE(model));
+
+        /* The record's details are dropped once it's no longer selected,
+         * which may be before the thread is done with them. */
         json_array_ref(files);
+        json_array_ref(priorities);
+        json_array_ref(wanted);
 
         futd->tree_view = tv;
         futd->files = files;
@@ -24,6 +24,7 @@
 #include <json-glib/json-glib.h>
 
 #include "trg-model.h"
+#include "torrent.h"
 
 G_BEGIN_DECLS
 #define TRG_TYPE_FILES_MODEL trg_files_model_get_type()
@@ -63,7 +64,7 @@ G_END_DECLS enum {
 #define TRG_FILES_MODEL_CREATE_THREAD_IF_GT 600
 
 void trg_files_model_update(TrgFilesModel * model, GtkTreeView * tv,
-                            gint64 updateSerial, JsonObject * t,
+                            gint64 updateSerial, trg_torrent * t,
                             gint mode);
 gint64 trg_files_model_get_torrent_id(TrgFilesModel * model);
 void trg_files_model_set_accept(TrgFilesModel * model, gboolean accept);
@@ -120,57 +120,50 @@ static void trg_general_panel_class_init(TrgGeneralPanelClass * klass)
 }
 
 void
-trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
-                         GtkTreeIter * iter)
+trg_general_panel_update(TrgGeneralPanel * panel, trg_torrent * t)
 {
     TrgGeneralPanelPrivate *priv;
     gchar buf[32], buf1[32]; //TODO: do it better
-    gchar *statusString, *fullStatusString, *completedAtString, *speed, *comment, *markup;
+    gchar *fullStatusString, *completedAtString, *speed, *comment, *markup;
     const gchar *errorStr;
     gint64 eta, uploaded, corrupted, haveValid, completedAt;
     GtkLabel *keyLabel;
-    gint64 seeders = 0, leechers = 0;
 
     priv = TRG_GENERAL_PANEL_GET_PRIVATE(panel);
 
-    gtk_tree_model_get(GTK_TREE_MODEL(priv->model), iter,
-                       TORRENT_COLUMN_SEEDS, &seeders,
-                       TORRENT_COLUMN_LEECHERS, &leechers,
-                       TORRENT_COLUMN_STATUS, &statusString, -1);
-
-    trg_strlsize(buf, torrent_get_size_when_done(t));
+    trg_strlsize(buf, t->sizeWhenDone);
     gtk_label_set_text(GTK_LABEL(priv->gen_size_label), buf);
 
-	trg_strlspeed(buf, torrent_get_rate_down(t) / disk_K);
-	if (torrent_get_download_limited(t)){
-		trg_strlspeed(buf1, torrent_get_download_limit(t));
+	trg_strlspeed(buf, t->rateDownload / disk_K);
+	if (t->downloadLimited){
+		trg_strlspeed(buf1, t->downloadLimit);
 		speed = g_strdup_printf("%s [%s]", buf, buf1);
 	} else
 		speed = g_strdup_printf("%s", buf);
     gtk_label_set_text(GTK_LABEL(priv->gen_down_rate_label), speed);
     g_free(speed);
 
-	trg_strlspeed(buf, torrent_get_rate_up(t) / disk_K);
-    if (torrent_get_upload_limited(t)){
-		trg_strlspeed(buf1, torrent_get_upload_limit(t));
+	trg_strlspeed(buf, t->rateUpload / disk_K);
+    if (t->uploadLimited){
+		trg_strlspeed(buf1, t->uploadLimit);
 		speed = g_strdup_printf("%s [%s]", buf, buf1);	
 	} else
 		speed = g_strdup_printf("%s", buf);
     gtk_label_set_text(GTK_LABEL(priv->gen_up_rate_label), speed);
 	g_free(speed);
 
-	corrupted = torrent_get_corrupted(t);
+	corrupted = t->corruptEver;
 	trg_strlsize(buf, corrupted);
 	gtk_label_set_text(GTK_LABEL(priv->gen_corrupted_label), buf);
 
-    uploaded = torrent_get_uploaded(t);
+    uploaded = t->uploadedEver;
     trg_strlsize(buf, uploaded);
     gtk_label_set_text(GTK_LABEL(priv->gen_uploaded_label), buf);
 
-    gtk_label_set_text(GTK_LABEL(priv->gen_hash_label), torrent_get_hash(t));
+    gtk_label_set_text(GTK_LABEL(priv->gen_hash_label), t->hashString);
 
-    haveValid = torrent_get_have_valid(t);
-    trg_strlsize(buf, torrent_get_downloaded(t));
+    haveValid = t->haveValid;
+    trg_strlsize(buf, t->downloadedEver);
     gtk_label_set_text(GTK_LABEL(priv->gen_downloaded_label), buf);
 
     if (uploaded > 0 && haveValid > 0) {
@@ -180,10 +173,10 @@ trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
         gtk_label_set_text(GTK_LABEL(priv->gen_ratio_label), _("N/A"));
     }
 
-	trg_strlratio(buf, torrent_get_seed_ratio_limit(t));
+	trg_strlratio(buf, t->seedRatioLimit);
 	gtk_label_set_text(GTK_LABEL(priv->gen_limit_label), buf);
 
-    completedAt = torrent_get_done_date(t);
+    completedAt = t->doneDate;
     if (completedAt > 0) {
         completedAtString = epoch_to_string(completedAt);
         gtk_label_set_text(GTK_LABEL(priv->gen_completedat_label),
@@ -193,15 +186,14 @@ trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
         gtk_label_set_text(GTK_LABEL(priv->gen_completedat_label), "");
     }
 
-    fullStatusString = g_strdup_printf("%s %s", statusString,
-                                       torrent_get_is_private(t) ?
+    fullStatusString = g_strdup_printf("%s %s", t->statusString,
+                                       t->isPrivate ?
                                        _("(Private)") : _("(Public)"));
     gtk_label_set_text(GTK_LABEL(priv->gen_status_label),
                        fullStatusString);
     g_free(fullStatusString);
-    g_free(statusString);
 
-	switch(torrent_get_bandwidth_priority(t)){
+	switch(t->bandwidthPriority){
 		case TR_PRI_LOW:
 			gtk_label_set_text(GTK_LABEL(priv->gen_priority_label), _("Low"));
 			break;
@@ -213,20 +205,20 @@ trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
 			break;
 	}
 
-    trg_strlpercent(buf, torrent_get_percent_done(t));
+    trg_strlpercent(buf, t->percentDone);
     gtk_label_set_text(GTK_LABEL(priv->gen_completed_label), buf);
 
     gtk_label_set_text(GTK_LABEL(priv->gen_name_label),
-                       torrent_get_name(t));
+                       t->name);
 
     gtk_label_set_text(GTK_LABEL(priv->gen_downloaddir_label),
-                       torrent_get_download_dir(t));
+                       t->downloadDir);
 
-    comment = add_links_to_text(torrent_get_comment(t));
+    comment = add_links_to_text(t->comment);
     gtk_label_set_markup(GTK_LABEL(priv->gen_comment_label), comment);
     g_free(comment);
 
-    errorStr = torrent_get_errorstr(t);
+    errorStr = t->errorString;
     keyLabel =
         gen_panel_label_get_key_label(GTK_LABEL(priv->gen_error_label));
     if (strlen(errorStr) > 0) {
@@ -247,7 +239,7 @@ trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
         gtk_label_clear(keyLabel);
     }
 
-    if ((eta = torrent_get_eta(t)) > 0) {
+    if ((eta = t->eta) > 0) {
         tr_strltime_long(buf, eta, sizeof(buf));
         gtk_label_set_text(GTK_LABEL(priv->gen_eta_label), buf);
     } else {
@@ -255,10 +247,10 @@ trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
     }
 
     g_snprintf(buf, sizeof(buf), "%" G_GINT64_FORMAT,
-             seeders >= 0 ? seeders : 0);
+             t->seeders >= 0 ? t->seeders : 0);
     gtk_label_set_text(GTK_LABEL(priv->gen_seeders_label), buf);
     g_snprintf(buf, sizeof(buf), "%" G_GINT64_FORMAT,
-             leechers >= 0 ? leechers : 0);
+             t->leechers >= 0 ? t->leechers : 0);
     gtk_label_set_text(GTK_LABEL(priv->gen_leechers_label), buf);
 }
 
@@ -54,8 +54,8 @@ TrgGeneralPanel *trg_general_panel_new(GtkTreeModel * model,
                                        TrgClient * tc);
 
 G_END_DECLS
-    void trg_general_panel_update(TrgGeneralPanel * panel, JsonObject * t,
-                                  GtkTreeIter * iter);
+    void trg_general_panel_update(TrgGeneralPanel * panel,
+                                  trg_torrent * t);
 void trg_general_panel_clear(TrgGeneralPanel * panel);
 
 #endif                          /* TRG_GENERAL_PANEL_H_ */
@@ -41,6 +41,8 @@
 #endif
 
 #include "trg-client.h"
+#include "trg-client-group.h"
+#include "trg-snapshot.h"
 #include "json.h"
 #include "util.h"
 #include "requests.h"
@@ -73,6 +75,8 @@
 #include "trg-menu-bar.h"
 #include "trg-status-bar.h"
 #include "trg-stats-dialog.h"
+#include "trg-diagnostics.h"
+#include "trg-diagnostics-dialog.h"
 #ifdef HAVE_RSS
 #include "trg-rss-window.h"
 #endif
@@ -131,6 +135,7 @@ static gint confirm_action_dialog(GtkWindow * gtk_win,
                                   const gchar * question_multi,
                                   const gchar * action_stock);
 static void view_stats_toggled_cb(GtkWidget * w, gpointer data);
+static void view_diagnostics_cb(GtkWidget * w, gpointer data);
 static void view_states_toggled_cb(GtkCheckMenuItem * w,
                                    TrgMainWindow * win);
 static void view_notebook_toggled_cb(GtkCheckMenuItem * w,
@@ -143,6 +148,7 @@ static gboolean on_torrent_get_first(gpointer data);
 static gboolean on_torrent_get_active(gpointer data);
 static gboolean on_torrent_get_update(gpointer data);
 static gboolean on_torrent_get_interactive(gpointer data);
+static gboolean on_torrent_get_details(gpointer data);
 static gboolean trg_session_update_timerfunc(gpointer data);
 static gboolean trg_update_torrents_timerfunc(gpointer data);
 static void open_about_cb(GtkWidget * w, GtkWindow * parent);
@@ -233,10 +239,22 @@ typedef struct
     GtkWidget *notebook;
 
     TrgTorrentModel *torrentModel;
+    trg_client_group *clientGroup;
     TrgTorrentTreeView *torrentTreeView;
     GtkTreeModel *filteredTorrentModel;
     GtkTreeModel *sortedTorrentModel;
+    /* Put back once the model has applied everything queued, if the first
+     * load had it unsorted. */
+    gboolean applyUnsorted;
+    gint applySortId;
+    GtkSortType applySortOrder;
+    gboolean applyProgress;
+    /* The torrents shown when a long apply started, which stay the ones
+     * shown until it's done (trg_torrent_tree_view_visible_func()). */
+    GHashTable *applyVisible;
     gint selectedTorrentId;
+    GCancellable *detailsCancellable;
+    gint64 detailsRequestId;
 
     TrgTrackersModel *trackersModel;
     TrgTrackersTreeView *trackersTreeView;
@@ -258,6 +276,9 @@ typedef struct
     gboolean hidden;
     gint width, height;
     guint timerId;
+    guint pollInterval;
+    guint pollIntervalFocused;
+    gdouble pollRtt, pollServerTime;
     guint sessionTimerId;
     gboolean min_on_start;
     gboolean queuesEnabled;
@@ -271,6 +292,46 @@ enum {
     PROP_0, PROP_CLIENT, PROP_MINIMISE_ON_START
 };
 
+/* Show the torrents from last time while connecting, if there are any,
+ * until the first update replaces them. */
+static gboolean trg_main_window_load_snapshot(TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    JsonArray *torrents;
+    gint64 rpcv;
+
+    if (gtk_tree_model_iter_n_children
+        (GTK_TREE_MODEL(priv->torrentModel), NULL) > 0)
+        return FALSE;
+
+    torrents = trg_snapshot_load(priv->client, &rpcv);
+    if (!torrents)
+        return FALSE;
+
+    trg_torrent_model_load_snapshot(priv->torrentModel, priv->client,
+                                    torrents, rpcv);
+    json_array_unref(torrents);
+
+    return TRUE;
+}
+
+static void trg_main_window_save_snapshot(TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    GError *error = NULL;
+
+    /* Nothing new to save until it's been updated. */
+    if (!trg_client_is_connected(priv->client)
+        || trg_torrent_model_is_stale(priv->torrentModel))
+        return;
+
+    if (!trg_snapshot_save(priv->client, GTK_TREE_MODEL(priv->torrentModel),
+                           &error)) {
+        g_warning("Unable to save the torrent list: %s", error->message);
+        g_error_free(error);
+    }
+}
+
 static void reset_connect_args(TrgMainWindow * win)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
@@ -296,22 +357,28 @@ update_selected_torrent_notebook(TrgMainWindow * win, gint mode, gint64 id)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     TrgClient *client = priv->client;
     gint64 serial = trg_client_get_serial(client);
-    JsonObject *t;
-    GtkTreeIter iter;
+    trg_torrent *t;
 
     if (id >= 0
         && get_torrent_data(trg_client_get_torrent_table(client), id, &t,
-                            &iter)) {
+                            NULL)) {
         trg_toolbar_torrent_actions_sensitive(priv->toolBar, TRUE);
         trg_menu_bar_torrent_actions_sensitive(priv->menuBar, TRUE);
-        trg_general_panel_update(priv->genDetails, t, &iter);
-        trg_trackers_model_update(priv->trackersModel, serial, t, mode);
-        trg_files_model_update(priv->filesModel,
-                               GTK_TREE_VIEW(priv->filesTreeView),
-                               serial, t, mode);
-        trg_peers_model_update(priv->peersModel,
-                               TRG_TREE_VIEW(priv->peersTreeView),
-                               serial, t, mode);
+        trg_general_panel_update(priv->genDetails, t);
+        if (trg_torrent_has_details(t)) {
+            trg_trackers_model_update(priv->trackersModel, serial, t,
+                                      mode);
+            trg_files_model_update(priv->filesModel,
+                                   GTK_TREE_VIEW(priv->filesTreeView),
+                                   serial, t, mode);
+            trg_peers_model_update(priv->peersModel,
+                                   TRG_TREE_VIEW(priv->peersTreeView),
+                                   serial, t, mode);
+        } else if (mode == TORRENT_GET_MODE_FIRST) {
+            gtk_list_store_clear(GTK_LIST_STORE(priv->trackersModel));
+            gtk_tree_store_clear(GTK_TREE_STORE(priv->filesModel));
+            gtk_list_store_clear(GTK_LIST_STORE(priv->peersModel));
+        }
     } else {
         trg_main_window_torrent_scrub(win);
     }
@@ -319,6 +386,38 @@ update_selected_torrent_notebook(TrgMainWindow * win, gint mode, gint64 id)
     priv->selectedTorrentId = id;
 }
 
+/* The list poll doesn't include files or peers, and its tracker stats
+ * aren't kept, so fetch those for just the selected torrent. The notebook
+ * is updated when this comes back.
+ */
+static void request_selected_torrent_details(TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+
+    /* Still waiting on the details for this torrent. */
+    if (priv->detailsCancellable
+        && !g_cancellable_is_cancelled(priv->detailsCancellable)
+        && priv->detailsRequestId == priv->selectedTorrentId)
+        return;
+
+    /* Don't let the daemon carry on building the files and peers of a
+     * torrent which is no longer selected. */
+    if (priv->detailsCancellable) {
+        g_cancellable_cancel(priv->detailsCancellable);
+        g_clear_object(&priv->detailsCancellable);
+    }
+
+    if (priv->selectedTorrentId >= 0) {
+        priv->detailsRequestId = priv->selectedTorrentId;
+        priv->detailsCancellable =
+            dispatch_async_cancellable(priv->client,
+                                       torrent_get_details
+                                       (priv->selectedTorrentId),
+                                       TRG_REQUEST_PRIORITY_VISIBLE,
+                                       on_torrent_get_details, win);
+    }
+}
+
 #ifdef HAVE_LIBNOTIFY
 static void
 torrent_event_notification(TrgTorrentModel * model,
@@ -425,6 +524,7 @@ destroy_window(TrgMainWindow * win, gpointer data G_GNUC_UNUSED)
                           TRG_TREE_VIEW_PERSIST_SORT |
                           TRG_TREE_VIEW_PERSIST_LAYOUT);
     trg_prefs_save(prefs);
+    trg_main_window_save_snapshot(win);
 
 #if WIN32
     gtk_main_quit();
@@ -452,15 +552,15 @@ static void open_props_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
 static void copy_magnetlink_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
-    JsonObject *json = NULL;
+    trg_torrent *t = NULL;
     GtkClipboard *clip = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
 
     if (priv->selectedTorrentId < 0)
         return;
 
     if(get_torrent_data(trg_client_get_torrent_table(priv->client),
-                priv->selectedTorrentId, &json, NULL))
-        gtk_clipboard_set_text(clip, torrent_get_magnetlink(json), -1);
+                priv->selectedTorrentId, &t, NULL))
+        gtk_clipboard_set_text(clip, t->magnetLink, -1);
 }
 
 static void
@@ -492,15 +592,34 @@ static void add_cb(GtkWidget * w G_GNUC_UNUSED, gpointer data)
         trg_torrent_add_dialog(win, priv->client);
 }
 
+/* Sends an action for the selected torrents to each daemon they are on,
+ * as the list can hold torrents from several (see trg-client-group.c). */
+static void
+dispatch_for_selected(TrgMainWindow * win,
+                      JsonNode * (*request) (JsonArray * ids))
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    GList *clients =
+        trg_torrent_tree_view_get_selected_clients(priv->torrentTreeView);
+    GList *li;
+
+    for (li = clients; li; li = g_list_next(li)) {
+        TrgClient *client = (TrgClient *) li->data;
+        dispatch_async_batched(client,
+                               request(build_json_id_array_for_client
+                                       (priv->torrentTreeView, client)),
+                               on_generic_interactive_action_response, win);
+    }
+
+    g_list_free(clients);
+}
+
 static void pause_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (trg_client_is_connected(priv->client))
-        dispatch_async(priv->client,
-                       torrent_pause(build_json_id_array
-                                     (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_pause);
 }
 
 static void pause_all_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
@@ -576,10 +695,7 @@ static void resume_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (trg_client_is_connected(priv->client))
-        dispatch_async(priv->client,
-                       torrent_start(build_json_id_array
-                                     (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_start);
 }
 
 static void disconnect_cb(GtkWidget * w G_GNUC_UNUSED, gpointer data)
@@ -644,7 +760,10 @@ void connect_cb(GtkWidget * w, gpointer data)
     }
 
     trg_status_bar_push_connection_msg(priv->statusBar,
-                                       _("Connecting..."));
+                                       trg_main_window_load_snapshot(win)
+                                       ?
+                                       _("Connecting, showing the torrents from last time...")
+                                       : _("Connecting..."));
     trg_client_inc_connid(priv->client);
     dispatch_async(priv->client, session_get(), on_session_get, data);
 }
@@ -745,10 +864,7 @@ static void reannounce_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (trg_client_is_connected(priv->client))
-        dispatch_async(priv->client,
-                       torrent_reannounce(build_json_id_array
-                                          (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_reannounce);
 }
 
 static void verify_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
@@ -756,10 +872,7 @@ static void verify_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (is_ready_for_torrent_action(win))
-        dispatch_async(priv->client,
-                       torrent_verify(build_json_id_array
-                                      (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_verify);
 }
 
 static void start_now_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
@@ -767,10 +880,7 @@ static void start_now_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (is_ready_for_torrent_action(win))
-        dispatch_async(priv->client,
-                       torrent_start_now(build_json_id_array
-                                         (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_start_now);
 }
 
 static void up_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
@@ -778,10 +888,7 @@ static void up_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (priv->queuesEnabled && is_ready_for_torrent_action(win))
-        dispatch_async(priv->client,
-                       torrent_queue_move_up(build_json_id_array
-                                             (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_queue_move_up);
 }
 
 static void top_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
@@ -789,10 +896,7 @@ static void top_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (priv->queuesEnabled && is_ready_for_torrent_action(win))
-        dispatch_async(priv->client,
-                       torrent_queue_move_top(build_json_id_array
-                                              (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_queue_move_top);
 }
 
 static void
@@ -801,10 +905,7 @@ bottom_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (priv->queuesEnabled && is_ready_for_torrent_action(win))
-        dispatch_async(priv->client,
-                       torrent_queue_move_bottom(build_json_id_array
-                                                 (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_queue_move_bottom);
 }
 
 static void down_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
@@ -812,10 +913,7 @@ static void down_queue_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
     if (priv->queuesEnabled && is_ready_for_torrent_action(win))
-        dispatch_async(priv->client,
-                       torrent_queue_move_down(build_json_id_array
-                                               (priv->torrentTreeView)),
-                       on_generic_interactive_action_response, win);
+        dispatch_for_selected(win, torrent_queue_move_down);
 }
 
 static gint
@@ -899,51 +997,67 @@ static void move_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
                              (win, priv->client, priv->torrentTreeView)));
 }
 
+/* As dispatch_for_selected(), for a torrent-remove, with the selection
+ * taken before confirming, in case it changes while the dialog is up. */
+static void
+remove_selected(TrgMainWindow * win, GList * targets, gboolean removeData,
+                GSourceFunc callback)
+{
+    GList *li;
+
+    for (li = targets; li; li = g_list_next(li)) {
+        trg_client_ids *target = (trg_client_ids *) li->data;
+        dispatch_async(target->client,
+                       torrent_remove(target->ids, removeData), callback,
+                       win);
+        target->ids = NULL;
+    }
+}
+
 static void remove_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     GtkTreeSelection *selection;
-    JsonArray *ids;
+    GList *targets;
 
     if (!is_ready_for_torrent_action(win))
         return;
 
     selection =
         gtk_tree_view_get_selection(GTK_TREE_VIEW(priv->torrentTreeView));
-    ids = build_json_id_array(priv->torrentTreeView);
+    targets = build_json_id_arrays(priv->torrentTreeView);
 
     if (confirm_action_dialog(GTK_WINDOW(win), selection, _
                               ("<big><b>Remove torrent \"%s\"?</b></big>"),
                               _("<big><b>Remove %d torrents?</b></big>"),
                               GTK_STOCK_REMOVE) == GTK_RESPONSE_ACCEPT)
-        dispatch_async(priv->client, torrent_remove(ids, FALSE),
-                       on_generic_interactive_action_response, win);
-    else
-        json_array_unref(ids);
+        remove_selected(win, targets, FALSE,
+                        on_generic_interactive_action_response);
+
+    trg_client_ids_list_free(targets);
 }
 
 static void delete_cb(GtkWidget * w G_GNUC_UNUSED, TrgMainWindow * win)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     GtkTreeSelection *selection;
-    JsonArray *ids;
-
-    selection =
-        gtk_tree_view_get_selection(GTK_TREE_VIEW(priv->torrentTreeView));
-    ids = build_json_id_array(priv->torrentTreeView);
+    GList *targets;
 
     if (!is_ready_for_torrent_action(win))
         return;
 
+    selection =
+        gtk_tree_view_get_selection(GTK_TREE_VIEW(priv->torrentTreeView));
+    targets = build_json_id_arrays(priv->torrentTreeView);
+
     if (confirm_action_dialog(GTK_WINDOW(win), selection, _
                               ("<big><b>Remove and delete torrent \"%s\"?</b></big>"),
                               _
                               ("<big><b>Remove and delete %d torrents?</b></big>"),
                               GTK_STOCK_DELETE) == GTK_RESPONSE_ACCEPT)
-        dispatch_async(priv->client, torrent_remove(ids, TRUE),
-                       on_delete_complete, win);
-    else
-        json_array_unref(ids);
+        remove_selected(win, targets, TRUE, on_delete_complete);
+
+    trg_client_ids_list_free(targets);
 }
 
 static void view_stats_toggled_cb(GtkWidget * w, gpointer data)
@@ -960,6 +1074,16 @@ static void view_stats_toggled_cb(GtkWidget * w, gpointer data)
     }
 }
 
+static void view_diagnostics_cb(GtkWidget * w, gpointer data)
+{
+    TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    TrgDiagnosticsDialog *dlg =
+        trg_diagnostics_dialog_get_instance(win, priv->client);
+
+    gtk_widget_show_all(GTK_WIDGET(dlg));
+}
+
 #ifdef HAVE_RSS
 static void view_rss_toggled_cb(GtkWidget * w, gpointer data)
 {
@@ -1106,7 +1230,24 @@ static gboolean on_session_get_timer(gpointer data)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     TrgPrefs *prefs = trg_client_get_prefs(priv->client);
 
-    on_session_get(data);
+    if (!trg_client_is_connected(priv->client)) {
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    if (response->status != CURLE_OK || !response->obj) {
+        gchar *msg = make_error_message(response->obj, response->status);
+        gchar *statusBarMsg =
+            g_strdup_printf(_("Session update failed: %s"), msg);
+        trg_status_bar_push_connection_msg(priv->statusBar, statusBarMsg);
+        g_free(msg);
+        g_free(statusBarMsg);
+    } else {
+        trg_client_merge_session(priv->client,
+                                 get_arguments(response->obj));
+    }
+
+    trg_response_free(response);
 
     priv->sessionTimerId = g_timeout_add_seconds(trg_prefs_get_int(prefs,
                                                                    TRG_PREFS_KEY_SESSION_UPDATE_INTERVAL,
@@ -1137,6 +1278,7 @@ static gboolean on_session_get(gpointer data)
         if (trg_dialog_error_handler(win, response)) {
             trg_response_free(response);
             reset_connect_args(win);
+            trg_torrent_model_remove_all(priv->torrentModel);
             return FALSE;
         }
 
@@ -1159,6 +1301,7 @@ TRANSMISSION_MIN_SUPPORTED, version);
             g_free(msg);
             trg_response_free(response);
             reset_connect_args(win);
+            trg_torrent_model_remove_all(priv->torrentModel);
             return FALSE;
         }
 
@@ -1194,7 +1337,8 @@ TRANSMISSION_MIN_SUPPORTED, version);
         trg_main_window_conn_changed(win, TRUE);
         trg_trackers_tree_view_new_connection(priv->trackersTreeView,
                                               client);
-        dispatch_async(client, torrent_get(TORRENT_GET_TAG_MODE_FULL),
+        dispatch_async(client,
+                       torrent_get(client, TORRENT_GET_TAG_MODE_FULL),
                        on_torrent_get_first, win);
     }
 
@@ -1272,7 +1416,314 @@ update_whatever_statusicon(TrgMainWindow * win,
 }
 
 /*
- * The callback for a torrent-get response.
+ * Work out how long to wait before the next torrent-get.
+ *
+ * Without the adaptive pref this is just the update interval, or the
+ * minimised one when the window isn't visible. With it, the interval also
+ * stretches when the window is visible but not focused or nothing is active,
+ * and backs off so that a slow daemon doesn't spend more than about a tenth
+ * of its time answering this client's polls.
+ */
+
+static guint
+trg_main_window_poll_interval(TrgMainWindow * win,
+                              trg_response * response,
+                              trg_torrent_model_update_stats * stats)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    TrgPrefs *prefs = trg_client_get_prefs(priv->client);
+    gboolean visible = gtk_widget_get_visible(GTK_WIDGET(win));
+    gint update, minimised;
+    guint interval, base, backoff;
+
+    update = trg_prefs_get_int(prefs, TRG_PREFS_KEY_UPDATE_INTERVAL,
+                               TRG_PREFS_CONNECTION);
+    minimised = trg_prefs_get_int(prefs, TRG_PREFS_KEY_MINUPDATE_INTERVAL,
+                                  TRG_PREFS_CONNECTION);
+    if (update < 1)
+        update = TRG_INTERVAL_DEFAULT;
+    if (minimised < 1)
+        minimised = TRG_INTERVAL_DEFAULT;
+
+    interval = visible ? update : minimised;
+
+    if (!trg_prefs_get_bool(prefs, TRG_PREFS_KEY_ADAPTIVE_UPDATE,
+                            TRG_PREFS_CONNECTION)) {
+        priv->pollInterval = priv->pollIntervalFocused = interval;
+        return interval;
+    }
+
+    if (response && response->rtt > 0) {
+        if (priv->pollRtt > 0) {
+            priv->pollRtt = 0.7 * priv->pollRtt + 0.3 * response->rtt;
+            priv->pollServerTime = 0.7 * priv->pollServerTime
+                + 0.3 * response->server_time;
+        } else {
+            priv->pollRtt = response->rtt;
+            priv->pollServerTime = response->server_time;
+        }
+    }
+
+    base = interval;
+
+    if (visible && stats && stats->active == 0 && stats->checking == 0)
+        interval = MAX(interval, MIN(interval * 2, (guint) minimised));
+
+    backoff = (guint) MAX(priv->pollServerTime * 10, priv->pollRtt * 4);
+    backoff = MIN(backoff, TRG_INTERVAL_BACKOFF_MAX);
+    interval = MAX(interval, backoff);
+
+    /* What it would be with focus, which focus_in() goes back to. */
+    priv->pollIntervalFocused = interval;
+
+    if (visible && !gtk_window_is_active(GTK_WINDOW(win)))
+        interval = MAX(interval, MAX(base * 2, (guint) minimised));
+
+    priv->pollInterval = interval;
+
+    return interval;
+}
+
+/* Bring the next poll forward when the window gets focus back, so that it
+ * doesn't have to wait out an interval stretched while in the background.
+ * Only that stretch is undone; the backoff for a slow daemon stays. */
+static gboolean
+trg_main_window_focus_in(GtkWidget * widget, GdkEventFocus * event,
+                         gpointer data)
+{
+    TrgMainWindow *win = TRG_MAIN_WINDOW(widget);
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    guint interval = priv->pollIntervalFocused;
+
+    if (priv->timerId > 0 && interval > 0
+        && priv->pollInterval > interval) {
+        g_source_remove(priv->timerId);
+        priv->pollInterval = interval;
+        priv->timerId = g_timeout_add_seconds(interval,
+                                              trg_update_torrents_timerfunc,
+                                              win);
+    }
+
+    return FALSE;
+}
+
+/* Once the first update is in (or has failed). */
+static void trg_main_window_first_update_done(TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+
+    /* Greyed out while showing a snapshot. */
+    gtk_widget_set_sensitive(GTK_WIDGET(priv->torrentTreeView),
+                             trg_client_is_connected(priv->client)
+                             && !trg_torrent_model_is_stale
+                             (priv->torrentModel));
+
+    if (priv->args) {
+        trg_add_from_filename(win, priv->args);
+        priv->args = NULL;
+    }
+}
+
+/* A torrent in the list, as (client, ID), since IDs are only unique to a
+ * daemon. */
+typedef struct {
+    TrgClient *client;
+    gint64 id;
+} trg_main_window_torrent_key;
+
+static guint trg_main_window_torrent_key_hash(gconstpointer k)
+{
+    const trg_main_window_torrent_key *key =
+        (const trg_main_window_torrent_key *) k;
+    return g_int64_hash(&key->id) ^ g_direct_hash(key->client);
+}
+
+static gboolean
+trg_main_window_torrent_key_equal(gconstpointer a, gconstpointer b)
+{
+    const trg_main_window_torrent_key *ka =
+        (const trg_main_window_torrent_key *) a;
+    const trg_main_window_torrent_key *kb =
+        (const trg_main_window_torrent_key *) b;
+    return ka->id == kb->id && ka->client == kb->client;
+}
+
+static void
+trg_main_window_torrent_key_get(GtkTreeModel * model, GtkTreeIter * iter,
+                                trg_main_window_torrent_key * key)
+{
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_CLIENT, &key->client,
+                       TORRENT_COLUMN_ID, &key->id, -1);
+}
+
+/* The model's apply is going to take more than one main loop dispatch.
+ * With the torrents shown fixed, none are run through the filter until
+ * they're all in (on_torrent_model_apply_finished()). A first load is also
+ * applied unsorted, so each row is put in place as it comes rather than
+ * searched for; there's no order on screen yet to lose. Later ones keep
+ * their sort, so a big poll doesn't reshuffle the list twice. */
+static void
+on_torrent_model_apply_started(TrgTorrentModel * model, gpointer changes,
+                               gpointer data)
+{
+    TrgMainWindowPrivate *priv =
+        trg_main_window_get_instance_private(TRG_MAIN_WINDOW(data));
+    GtkTreeIter iter;
+    gboolean valid;
+
+    gtk_widget_freeze_child_notify(GTK_WIDGET(priv->torrentTreeView));
+
+    priv->applyVisible =
+        g_hash_table_new_full(trg_main_window_torrent_key_hash,
+                              trg_main_window_torrent_key_equal, g_free,
+                              NULL);
+
+    for (valid = gtk_tree_model_get_iter_first(priv->filteredTorrentModel,
+                                               &iter); valid;
+         valid = gtk_tree_model_iter_next(priv->filteredTorrentModel,
+                                          &iter)) {
+        trg_main_window_torrent_key *key =
+            g_new(trg_main_window_torrent_key, 1);
+        trg_main_window_torrent_key_get(priv->filteredTorrentModel, &iter,
+                                        key);
+        g_hash_table_add(priv->applyVisible, key);
+    }
+
+    priv->applyUnsorted = changes
+        && trg_torrent_model_changes_get_mode(changes) ==
+        TORRENT_GET_MODE_FIRST;
+    if (!priv->applyUnsorted)
+        return;
+
+    gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE
+                                         (priv->sortedTorrentModel),
+                                         &priv->applySortId,
+                                         &priv->applySortOrder);
+    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE
+                                         (priv->sortedTorrentModel),
+                                         GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
+                                         GTK_SORT_ASCENDING);
+}
+
+/* Between slices of a change list too big to apply in one go. Only the
+ * first load gets a progress bar; later ones are over quickly enough. */
+static void
+on_torrent_model_apply_progress(TrgTorrentModel * model, gpointer changes,
+                                gpointer data)
+{
+    TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    guint applied, total;
+    gchar *text;
+
+    if (trg_torrent_model_changes_get_mode(changes) !=
+        TORRENT_GET_MODE_FIRST)
+        return;
+
+    trg_torrent_model_changes_get_progress(changes, &applied, &total);
+
+    text = g_strdup_printf(_("Loading torrents: %u of %u"), applied,
+                           total);
+    trg_main_window_set_progress(win, (gdouble) applied / total, text);
+    g_free(text);
+
+    priv->applyProgress = TRUE;
+}
+
+static void
+on_torrent_model_apply_finished(TrgTorrentModel * model, gpointer data)
+{
+    TrgMainWindow *win = TRG_MAIN_WINDOW(data);
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    gint sortId;
+    GtkSortType sortOrder;
+
+    g_hash_table_destroy(priv->applyVisible);
+    priv->applyVisible = NULL;
+    gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER
+                                   (priv->filteredTorrentModel));
+
+    /* Unless a column was picked in the meantime. */
+    gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE
+                                         (priv->sortedTorrentModel),
+                                         &sortId, &sortOrder);
+    if (priv->applyUnsorted
+        && sortId == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+        gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE
+                                             (priv->sortedTorrentModel),
+                                             priv->applySortId,
+                                             priv->applySortOrder);
+    priv->applyUnsorted = FALSE;
+
+    gtk_widget_thaw_child_notify(GTK_WIDGET(priv->torrentTreeView));
+
+    if (priv->applyProgress) {
+        trg_main_window_set_progress(win, 0, NULL);
+        priv->applyProgress = FALSE;
+    }
+}
+
+/*
+ * Called once the model has applied the change list for a torrent-get
+ * response, which trg_torrent_model_prepare_async() worked out from it.
+ */
+
+static gboolean on_torrent_prepared(gpointer data)
+{
+    trg_torrent_model_changes *changes =
+        (trg_torrent_model_changes *) data;
+    trg_response *response =
+        (trg_response *) trg_torrent_model_changes_get_data(changes);
+    gint mode = trg_torrent_model_changes_get_mode(changes);
+    trg_torrent_model_update_stats *stats =
+        trg_torrent_model_changes_get_stats(changes);
+    TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    TrgClient *client = priv->client;
+    guint interval;
+
+    /* Disconnected while it was being prepared or applied, so it was
+     * dropped. */
+    if (!stats) {
+        if (mode == TORRENT_GET_MODE_FIRST)
+            trg_main_window_first_update_done(win);
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    /* Over however many slices it took, not counting the re-sort. */
+    trg_diagnostics_record(trg_client_get_diagnostics(client),
+                           METHOD_TORRENT_GET, TRG_DIAG_APPLY,
+                           trg_torrent_model_changes_get_apply_time
+                           (changes));
+
+    request_selected_torrent_details(win);
+    trg_status_bar_update(priv->statusBar, stats, client);
+    update_whatever_statusicon(win, stats);
+
+#if TRG_WITH_GRAPH
+    if (priv->graphNotebookIndex >= 0)
+        trg_torrent_graph_set_speed(priv->graph, stats);
+#endif
+
+    if (mode != TORRENT_GET_MODE_INTERACTION) {
+        interval = trg_main_window_poll_interval(win, response, stats);
+        priv->timerId = g_timeout_add_seconds(interval,
+                                              trg_update_torrents_timerfunc,
+                                              win);
+    }
+
+    if (mode == TORRENT_GET_MODE_FIRST)
+        trg_main_window_first_update_done(win);
+
+    trg_response_free(response);
+    return FALSE;
+}
+
+/*
+ * The callback for a torrent-get response. The response is decoded and
+ * diffed against the model off the main thread, applied by the model a
+ * slice at a time, then finished off by on_torrent_prepared().
  */
 
 static gboolean on_torrent_get(gpointer data, int mode)
@@ -1282,26 +1733,16 @@ static gboolean on_torrent_get(gpointer data, int mode)
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     TrgClient *client = priv->client;
     TrgPrefs *prefs = trg_client_get_prefs(client);
-    trg_torrent_model_update_stats *stats;
     guint interval;
-    gint old_sort_id;
-    GtkSortType old_order;
 
     /* Disconnected between request and response callback */
     if (!trg_client_is_connected(client)) {
+        if (mode == TORRENT_GET_MODE_FIRST)
+            trg_main_window_first_update_done(win);
         trg_response_free(response);
         return FALSE;
     }
 
-    interval =
-        gtk_widget_get_visible(GTK_WIDGET(win)) ? trg_prefs_get_int(prefs,
-                                                                    TRG_PREFS_KEY_UPDATE_INTERVAL,
-                                                                    TRG_PREFS_CONNECTION)
-        : trg_prefs_get_int(prefs, TRG_PREFS_KEY_MINUPDATE_INTERVAL,
-                            TRG_PREFS_CONNECTION);
-    if (interval < 1)
-        interval = TRG_INTERVAL_DEFAULT;
-
     if (response->status != CURLE_OK) {
         gint64 max_retries =
             trg_prefs_get_int(prefs, TRG_PREFS_KEY_RETRIES,
@@ -1321,11 +1762,15 @@ static gboolean on_torrent_get(gpointer data, int mode)
                                                statusBarMsg);
             g_free(msg);
             g_free(statusBarMsg);
+            interval = trg_main_window_poll_interval(win, response, NULL);
             priv->timerId = g_timeout_add_seconds(interval,
                                                   trg_update_torrents_timerfunc,
                                                   win);
         }
 
+        if (mode == TORRENT_GET_MODE_FIRST)
+            trg_main_window_first_update_done(win);
+
         trg_response_free(response);
 
         return FALSE;
@@ -1334,43 +1779,10 @@ static gboolean on_torrent_get(gpointer data, int mode)
     trg_client_reset_failcount(client);
     trg_client_inc_serial(client);
 
-    if (mode != TORRENT_GET_MODE_FIRST)
-        gtk_widget_freeze_child_notify(GTK_WIDGET(priv->torrentTreeView));
-
-    gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE
-                                         (priv->sortedTorrentModel),
-                                         &old_sort_id, &old_order);
-    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE
-                                         (priv->sortedTorrentModel),
-                                         GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
-                                         GTK_SORT_ASCENDING);
-
-    stats =
-        trg_torrent_model_update(priv->torrentModel, client, response->obj,
-                                 mode);
-
-    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE
-                                         (priv->sortedTorrentModel),
-                                         old_sort_id, old_order);
-
-    if (mode != TORRENT_GET_MODE_FIRST)
-        gtk_widget_thaw_child_notify(GTK_WIDGET(priv->torrentTreeView));
-
-    update_selected_torrent_notebook(win, mode, priv->selectedTorrentId);
-    trg_status_bar_update(priv->statusBar, stats, client);
-    update_whatever_statusicon(win, stats);
-
-#if TRG_WITH_GRAPH
-    if (priv->graphNotebookIndex >= 0)
-        trg_torrent_graph_set_speed(priv->graph, stats);
-#endif
-
-    if (mode != TORRENT_GET_MODE_INTERACTION)
-        priv->timerId = g_timeout_add_seconds(interval,
-                                              trg_update_torrents_timerfunc,
-                                              win);
+    trg_torrent_model_prepare_async(priv->torrentModel, client,
+                                    response->obj, mode,
+                                    on_torrent_prepared, response);
 
-    trg_response_free(response);
     return FALSE;
 }
 
@@ -1381,18 +1793,7 @@ static gboolean on_torrent_get_active(gpointer data)
 
 static gboolean on_torrent_get_first(gpointer data)
 {
-    trg_response *response = (trg_response *) data;
-    TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
-    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
-
-    gboolean result = on_torrent_get(data, TORRENT_GET_MODE_FIRST);
-
-    if (priv->args) {
-        trg_add_from_filename(win, priv->args);
-        priv->args = NULL;
-    }
-
-    return result;
+    return on_torrent_get(data, TORRENT_GET_MODE_FIRST);
 }
 
 static gboolean on_torrent_get_interactive(gpointer data)
@@ -1405,12 +1806,49 @@ static gboolean on_torrent_get_update(gpointer data)
     return on_torrent_get(data, TORRENT_GET_MODE_UPDATE);
 }
 
+static gboolean on_torrent_get_details(gpointer data)
+{
+    trg_response *response = (trg_response *) data;
+    TrgMainWindow *win = TRG_MAIN_WINDOW(response->cb_data);
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    JsonArray *torrents;
+    gint64 id;
+
+    /* A request cancelled after it was checked for delivery can still turn
+     * up here, after the next one was made, so only let go of the
+     * cancellable if it's this request's. */
+    if (response->cancellable
+        && response->cancellable == priv->detailsCancellable)
+        g_clear_object(&priv->detailsCancellable);
+
+    if (response->status != CURLE_OK
+        || !trg_client_is_connected(priv->client)) {
+        trg_response_free(response);
+        return FALSE;
+    }
+
+    /* The selection might have changed while this was in flight. */
+    id = json_object_get_int_member(response->obj, PARAM_TAG);
+    if (id == priv->selectedTorrentId) {
+        torrents = get_torrents(get_arguments(response->obj));
+        if (json_array_get_length(torrents) > 0)
+            trg_torrent_model_merge_details(priv->torrentModel,
+                                            json_array_get_object_element
+                                            (torrents, 0));
+        update_selected_torrent_notebook(win, TORRENT_GET_MODE_UPDATE, id);
+    }
+
+    trg_response_free(response);
+    return FALSE;
+}
+
 static gboolean trg_session_update_timerfunc(gpointer data)
 {
     TrgMainWindow *win = TRG_MAIN_WINDOW(data);
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
 
-    trg_client_update_session(priv->client, on_session_get_timer, win);
+    dispatch_async(priv->client, session_get_volatile(),
+                   on_session_get_timer, win);
 
     return FALSE;
 }
@@ -1427,6 +1865,8 @@ static gboolean trg_update_torrents_timerfunc(gpointer data)
     TrgClient *tc = priv->client;
     TrgPrefs *prefs = trg_client_get_prefs(tc);
 
+    priv->timerId = 0;
+
     if (trg_client_is_connected(tc)) {
         gboolean activeOnly = trg_prefs_get_bool(prefs,
                                                  TRG_PREFS_KEY_UPDATE_ACTIVE_ONLY,
@@ -1438,11 +1878,16 @@ static gboolean trg_update_torrents_timerfunc(gpointer data)
                                                                   TRG_PREFS_ACTIVEONLY_FULLSYNC_EVERY,
                                                                   TRG_PREFS_CONNECTION)
                     != 0));
-        dispatch_async(tc,
-                       torrent_get(activeOnly ? TORRENT_GET_TAG_MODE_UPDATE
-                                   : TORRENT_GET_TAG_MODE_FULL),
-                       activeOnly ? on_torrent_get_active :
-                       on_torrent_get_update, data);
+        /* Nobody's looking while hidden, so let anything else go first. */
+        dispatch_async_priority(tc,
+                                torrent_get(tc, activeOnly ?
+                                            TORRENT_GET_TAG_MODE_UPDATE :
+                                            TORRENT_GET_TAG_MODE_FULL),
+                                gtk_widget_get_visible(GTK_WIDGET(win)) ?
+                                TRG_REQUEST_PRIORITY_VISIBLE :
+                                TRG_REQUEST_PRIORITY_BACKGROUND,
+                                activeOnly ? on_torrent_get_active :
+                                on_torrent_get_update, data);
     }
 
     return FALSE;
@@ -1466,7 +1911,15 @@ trg_torrent_tree_view_visible_func(GtkTreeModel * model,
     gboolean visible;
     const gchar *filterText;
 
-    guint32 criteria = trg_state_selector_get_flag(priv->stateSelector);
+    guint32 criteria;
+
+    if (priv->applyVisible) {
+        trg_main_window_torrent_key key;
+        trg_main_window_torrent_key_get(model, iter, &key);
+        return g_hash_table_contains(priv->applyVisible, &key);
+    }
+
+    criteria = trg_state_selector_get_flag(priv->stateSelector);
 
     gtk_tree_model_get(model, iter, TORRENT_COLUMN_FLAGS, &flags, -1);
 
@@ -1474,19 +1927,27 @@ trg_torrent_tree_view_visible_func(GtkTreeModel * model,
         if (criteria & FILTER_FLAG_TRACKER) {
             gchar *text =
                 trg_state_selector_get_selected_text(priv->stateSelector);
-            JsonObject *json = NULL;
+            trg_torrent *t = NULL;
             gboolean matchesTracker;
-            gtk_tree_model_get(model, iter, TORRENT_COLUMN_JSON, &json,
+            gtk_tree_model_get(model, iter, TORRENT_COLUMN_TORRENT, &t,
                                -1);
-            matchesTracker = (!json
-                              || !torrent_has_tracker(json,
-                                                      trg_state_selector_get_url_host_regex
-                                                      (priv->
-                                                       stateSelector),
-                                                      text));
+            matchesTracker = (!t
+                              || !trg_torrent_has_announce_host(t, text));
             g_free(text);
             if (matchesTracker)
                 return FALSE;
+        } else if (criteria & FILTER_FLAG_SOURCE) {
+            gchar *text =
+                trg_state_selector_get_selected_text(priv->stateSelector);
+            gchar *source;
+            int cmp;
+            gtk_tree_model_get(model, iter, TORRENT_COLUMN_SOURCE, &source,
+                               -1);
+            cmp = g_strcmp0(text, source);
+            g_free(source);
+            g_free(text);
+            if (cmp)
+                return FALSE;
         } else if (criteria & FILTER_FLAG_DIR) {
             gchar *text =
                 trg_state_selector_get_selected_text(priv->stateSelector);
@@ -1598,8 +2059,13 @@ torrent_selection_changed(GtkTreeSelection * selection,
         GtkTreeIter iter;
         if (gtk_tree_model_get_iter(priv->filteredTorrentModel, &iter,
                                     (GtkTreePath *) firstNode->data)) {
+            TrgClient *client;
             gtk_tree_model_get(priv->filteredTorrentModel, &iter,
-                               TORRENT_COLUMN_ID, &id, -1);
+                               TORRENT_COLUMN_ID, &id,
+                               TORRENT_COLUMN_CLIENT, &client, -1);
+            /* The details are only fetched from the main connection. */
+            if (client != priv->client)
+                id = -1;
         }
     }
 
@@ -1607,6 +2073,7 @@ torrent_selection_changed(GtkTreeSelection * selection,
     g_list_free(selectionList);
 
     update_selected_torrent_notebook(win, TORRENT_GET_MODE_FIRST, id);
+    request_selected_torrent_details(win);
 
     return TRUE;
 }
@@ -1632,14 +2099,19 @@ void on_generic_interactive_action(TrgMainWindow *win, trg_response *response) {
     if (trg_client_is_connected(tc)) {
         trg_dialog_error_handler(win, response);
 
-        if (response->status == CURLE_OK) {
+        /* Torrents on another daemon come in through its own poll. */
+        if (response->client && response->client != tc) {
+            if (response->status == CURLE_OK)
+                trg_client_group_refresh(priv->clientGroup,
+                                         response->client);
+        } else if (response->status == CURLE_OK) {
             gint64 id;
             if (json_object_has_member(response->obj, PARAM_TAG))
                 id = json_object_get_int_member(response->obj, PARAM_TAG);
             else
                 id = TORRENT_GET_TAG_MODE_FULL;
 
-            dispatch_async(tc, torrent_get(id), on_torrent_get_interactive,
+            dispatch_async(tc, torrent_get(tc, id), on_torrent_get_interactive,
                            win);
         }
     }
@@ -1657,6 +2129,25 @@ gboolean on_generic_interactive_action_response(gpointer data)
     return FALSE;
 }
 
+/* A full torrent-get now, for after a batch of changes. */
+void trg_main_window_refresh(TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    TrgClient *tc = priv->client;
+
+    if (trg_client_is_connected(tc))
+        dispatch_async(tc, torrent_get(tc, TORRENT_GET_TAG_MODE_FULL),
+                       on_torrent_get_interactive, win);
+}
+
+void
+trg_main_window_set_progress(TrgMainWindow * win, gdouble fraction,
+                             const gchar * text)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    trg_status_bar_set_progress(priv->statusBar, fraction, text);
+}
+
 static void trg_main_window_torrent_scrub(TrgMainWindow * win)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
@@ -1701,7 +2192,9 @@ trg_main_window_conn_changed(TrgMainWindow * win, gboolean connected)
     trg_toolbar_connected_change(priv->toolBar, connected);
     trg_menu_bar_connected_change(priv->menuBar, connected);
 
-    gtk_widget_set_sensitive(GTK_WIDGET(priv->torrentTreeView), connected);
+    gtk_widget_set_sensitive(GTK_WIDGET(priv->torrentTreeView), connected
+                             && !trg_torrent_model_is_stale
+                             (priv->torrentModel));
     gtk_widget_set_sensitive(GTK_WIDGET(priv->peersTreeView), connected);
     gtk_widget_set_sensitive(GTK_WIDGET(priv->filesTreeView), connected);
     gtk_widget_set_sensitive(GTK_WIDGET(priv->trackersTreeView),
@@ -1716,8 +2209,15 @@ trg_main_window_conn_changed(TrgMainWindow * win, gboolean connected)
                                    TRG_PREFS_KEY_SESSION_UPDATE_INTERVAL,
                                    TRG_PREFS_CONNECTION),
                                   trg_session_update_timerfunc, win);
+        trg_state_selector_set_show_sources(priv->stateSelector,
+                                            trg_client_group_connect
+                                            (priv->clientGroup,
+                                             priv->client) > 0);
     } else {
         trg_main_window_torrent_scrub(win);
+        trg_main_window_save_snapshot(win);
+        trg_client_group_disconnect(priv->clientGroup);
+        trg_state_selector_set_show_sources(priv->stateSelector, FALSE);
         trg_state_selector_disconnect(priv->stateSelector);
 
 #if TRG_WITH_GRAPH
@@ -1730,6 +2230,12 @@ trg_main_window_conn_changed(TrgMainWindow * win, gboolean connected)
         g_source_remove(priv->timerId);
         g_source_remove(priv->sessionTimerId);
         priv->sessionTimerId = priv->timerId = 0;
+        priv->pollRtt = priv->pollServerTime = 0;
+
+        if (priv->detailsCancellable) {
+            g_cancellable_cancel(priv->detailsCancellable);
+            g_clear_object(&priv->detailsCancellable);
+        }
     }
 
     trg_client_status_change(tc, connected);
@@ -1790,6 +2296,7 @@ static TrgMenuBar *trg_main_window_menu_bar_new(TrgMainWindow * win)
     GObject *b_disconnect, *b_add, *b_resume, *b_pause, *b_verify,
         *b_remove, *b_delete, *b_props, *b_local_prefs, *b_remote_prefs,
         *b_about, *b_view_states, *b_view_notebook, *b_view_stats,
+        *b_view_diagnostics,
         *b_add_url, *b_quit, *b_move, *b_reannounce, *b_pause_all,
         *b_resume_all, *b_dir_filters, *b_tracker_filters, *b_directories_first,
         *b_up_queue, *b_down_queue, *b_top_queue, *b_bottom_queue,
@@ -1821,7 +2328,8 @@ static TrgMenuBar *trg_main_window_menu_bar_new(TrgMainWindow * win)
                  &b_remote_prefs, "local-prefs-button", &b_local_prefs,
                  "view-notebook-button", &b_view_notebook,
                  "view-states-button", &b_view_states, "view-stats-button",
-                 &b_view_stats, "about-button", &b_about, "quit-button",
+                 &b_view_stats, "view-diagnostics-button",
+                 &b_view_diagnostics, "about-button", &b_about, "quit-button",
                  &b_quit, "dir-filters", &b_dir_filters, "tracker-filters",
                  &b_tracker_filters, TRG_PREFS_KEY_DIRECTORIES_FIRST, &b_directories_first,
 #if TRG_WITH_GRAPH
@@ -1877,6 +2385,8 @@ static TrgMenuBar *trg_main_window_menu_bar_new(TrgMainWindow * win)
                      G_CALLBACK(view_states_toggled_cb), win);
     g_signal_connect(b_view_stats, "activate",
                      G_CALLBACK(view_stats_toggled_cb), win);
+    g_signal_connect(b_view_diagnostics, "activate",
+                     G_CALLBACK(view_diagnostics_cb), win);
 #ifdef HAVE_RSS
     g_signal_connect(b_view_rss, "activate",
                      G_CALLBACK(view_rss_toggled_cb), win);
@@ -2000,8 +2510,8 @@ static void set_limit_cb(GtkWidget * w, TrgMainWindow * win)
     json_object_set_boolean_member(args, enabledKey, speed >= 0);
 
     if (limitIds)
-        dispatch_async(priv->client, req, on_generic_interactive_action_response,
-                       win);
+        dispatch_async_batched(priv->client, req,
+                               on_generic_interactive_action_response, win);
     else
         dispatch_async(priv->client, req, on_session_set, win);
 }
@@ -2025,7 +2535,8 @@ static void set_priority_cb(GtkWidget * w, TrgMainWindow * win)
 
     json_object_set_int_member(args, FIELD_BANDWIDTH_PRIORITY, priority);
 
-    dispatch_async(priv->client, req, on_generic_interactive_action_response, win);
+    dispatch_async_batched(priv->client, req,
+                           on_generic_interactive_action_response, win);
 }
 
 static GtkWidget *limit_item_new(TrgMainWindow * win, GtkWidget * menu,
@@ -2069,13 +2580,13 @@ static GtkWidget *priority_menu_new(TrgMainWindow * win, JsonArray * ids)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     TrgClient *client = priv->client;
-    JsonObject *t = NULL;
+    trg_torrent *t = NULL;
     gint selected_pri = TR_PRI_UNSET;
     GtkWidget *toplevel, *menu;
 
     if (get_torrent_data(trg_client_get_torrent_table(client),
                          priv->selectedTorrentId, &t, NULL))
-        selected_pri = torrent_get_bandwidth_priority(t);
+        selected_pri = t->bandwidthPriority;
 
     toplevel = gtk_image_menu_item_new_with_label(GTK_STOCK_NETWORK);
     gtk_image_menu_item_set_use_stock(GTK_IMAGE_MENU_ITEM(toplevel), TRUE);
@@ -2106,21 +2617,25 @@ static GtkWidget *limit_menu_new(TrgMainWindow * win, gchar * title,
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     TrgClient *client = priv->client;
-    JsonObject *current = NULL;
-    GtkTreeIter iter;
     GtkWidget *toplevel, *menu, *item;
-    gint64 limit;
-
-    if (ids)
-        get_torrent_data(trg_client_get_torrent_table(client),
-                         priv->selectedTorrentId, &current, &iter);
-    else
-        current = trg_client_get_session(client);
-
-    limit =
-        json_object_get_boolean_member(current,
-                                       enabledKey) ?
-        json_object_get_int_member(current, speedKey) : -1;
+    gint64 limit = -1;
+
+    if (ids) {
+        trg_torrent *t = NULL;
+        if (get_torrent_data(trg_client_get_torrent_table(client),
+                             priv->selectedTorrentId, &t, NULL)) {
+            if (!g_strcmp0(enabledKey, FIELD_DOWNLOAD_LIMITED))
+                limit = t->downloadLimited ? t->downloadLimit : -1;
+            else
+                limit = t->uploadLimited ? t->uploadLimit : -1;
+        }
+    } else {
+        JsonObject *current = trg_client_get_session(client);
+        limit =
+            json_object_get_boolean_member(current,
+                                           enabledKey) ?
+            json_object_get_int_member(current, speedKey) : -1;
+    }
     toplevel = gtk_image_menu_item_new_with_label(GTK_STOCK_NETWORK);
     gtk_image_menu_item_set_use_stock(GTK_IMAGE_MENU_ITEM(toplevel), TRUE);
     gtk_image_menu_item_set_always_show_image(GTK_IMAGE_MENU_ITEM
@@ -2487,7 +3002,8 @@ static void trg_main_window_set_hidden_to_tray(TrgMainWindow * win,
         if (priv->timerId > 0) {
             g_source_remove(priv->timerId);
             dispatch_async(priv->client,
-                           torrent_get(TORRENT_GET_TAG_MODE_FULL),
+                           torrent_get(priv->client,
+                                       TORRENT_GET_TAG_MODE_FULL),
                            on_torrent_get_update, win);
         }
     }
@@ -2625,14 +3141,11 @@ trg_main_window_config_event(TrgMainWindow * win,
 }
 
 static void
-trg_client_session_updated_cb(TrgClient * tc,
-                              JsonObject * session, TrgMainWindow * win)
+trg_main_window_update_queues(TrgMainWindow * win, JsonObject * session)
 {
     TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
     gboolean queuesEnabled;
 
-    trg_status_bar_session_update(priv->statusBar, session);
-
     if (json_object_has_member(session, SGET_DOWNLOAD_QUEUE_ENABLED)) {
         queuesEnabled = json_object_get_boolean_member(session,
                                                        SGET_DOWNLOAD_QUEUE_ENABLED)
@@ -2651,6 +3164,39 @@ trg_client_session_updated_cb(TrgClient * tc,
     priv->queuesEnabled = queuesEnabled;
 }
 
+static void
+trg_client_session_updated_cb(TrgClient * tc,
+                              JsonObject * session, TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+
+    trg_status_bar_session_update(priv->statusBar, session);
+    trg_main_window_update_queues(win, session);
+}
+
+/* The periodic refresh only fetches the volatile fields, and this is only
+ * called for those which changed. */
+static void
+trg_client_session_changed_cb(TrgClient * tc, const gchar * key,
+                              TrgMainWindow * win)
+{
+    TrgMainWindowPrivate *priv = trg_main_window_get_instance_private(win);
+    JsonObject *session = trg_client_get_session(tc);
+
+    if (!g_strcmp0(key, SGET_DOWNLOAD_DIR_FREE_SPACE)
+        || !g_strcmp0(key, SGET_ALT_SPEED_ENABLED))
+        trg_status_bar_session_update(priv->statusBar, session);
+    else if (!g_strcmp0(key, SGET_DOWNLOAD_QUEUE_ENABLED)
+             || !g_strcmp0(key, SGET_SEED_QUEUE_ENABLED))
+        trg_main_window_update_queues(win, session);
+
+    if (g_str_has_prefix(key, "speed-limit-")
+        || g_str_has_prefix(key, "alt-speed-"))
+        trg_status_bar_update_speed(priv->statusBar,
+                                    trg_torrent_model_get_stats
+                                    (priv->torrentModel), tc);
+}
+
 /* Drag & Drop support */
 static GtkTargetEntry target_list[] = {
 /* datatype (string), restrictions on DnD (GtkTargetFlags), datatype (int) */
@@ -2742,6 +3288,8 @@ static GObject *trg_main_window_constructor(GType type,
                      NULL);
     g_signal_connect(G_OBJECT(self), "window-state-event",
                      G_CALLBACK(window_state_event), NULL);
+    g_signal_connect(G_OBJECT(self), "focus-in-event",
+                     G_CALLBACK(trg_main_window_focus_in), NULL);
     g_signal_connect(G_OBJECT(self), "configure-event",
                      G_CALLBACK(trg_main_window_config_event), NULL);
     g_signal_connect(G_OBJECT(self), "key-press-event",
@@ -2750,11 +3298,18 @@ static GObject *trg_main_window_constructor(GType type,
     priv->torrentModel = trg_torrent_model_new();
     trg_client_set_torrent_table(priv->client,
                                  get_torrent_table(priv->torrentModel));
+    priv->clientGroup = trg_client_group_new(priv->torrentModel);
 
     g_signal_connect(priv->torrentModel, "torrent-completed",
                      G_CALLBACK(on_torrent_completed), self);
     g_signal_connect(priv->torrentModel, "torrent-added",
                      G_CALLBACK(on_torrent_added), self);
+    g_signal_connect(priv->torrentModel, "apply-started",
+                     G_CALLBACK(on_torrent_model_apply_started), self);
+    g_signal_connect(priv->torrentModel, "apply-progress",
+                     G_CALLBACK(on_torrent_model_apply_progress), self);
+    g_signal_connect(priv->torrentModel, "apply-finished",
+                     G_CALLBACK(on_torrent_model_apply_finished), self);
 
     priv->sortedTorrentModel =
         gtk_tree_model_sort_new_with_model(GTK_TREE_MODEL
@@ -2848,6 +3403,8 @@ static GObject *trg_main_window_constructor(GType type,
     priv->statusBar = trg_status_bar_new(self, priv->client);
     g_signal_connect(priv->client, "session-updated",
                      G_CALLBACK(trg_client_session_updated_cb), self);
+    g_signal_connect(priv->client, "session-changed",
+                     G_CALLBACK(trg_client_session_changed_cb), self);
 
     gtk_box_pack_start(GTK_BOX(outerVbox), GTK_WIDGET(priv->statusBar),
                        FALSE, FALSE, 2);
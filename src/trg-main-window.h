@@ -43,6 +43,9 @@ gboolean on_session_set(gpointer data);
 gboolean on_delete_complete(gpointer data);
 void on_generic_interactive_action(TrgMainWindow *win, trg_response *response);
 gboolean on_generic_interactive_action_response(gpointer data);
+void trg_main_window_refresh(TrgMainWindow * win);
+void trg_main_window_set_progress(TrgMainWindow * win, gdouble fraction,
+                                  const gchar * text);
 void auto_connect_if_required(TrgMainWindow * win);
 void trg_main_window_set_start_args(TrgMainWindow * win, gchar ** args);
 TrgMainWindow *trg_main_window_new(TrgClient * tc, gboolean minonstart);
@@ -54,6 +54,7 @@ enum {
     PROP_LOCAL_PREFS_BUTTON,
     PROP_ABOUT_BUTTON,
     PROP_VIEW_STATS_BUTTON,
+    PROP_VIEW_DIAGNOSTICS_BUTTON,
 #ifdef HAVE_RSS
     PROP_VIEW_RSS_BUTTON,
 #endif
@@ -106,6 +107,7 @@ struct _TrgMenuBarPrivate {
     GtkWidget *mb_view_states;
     GtkWidget *mb_view_notebook;
     GtkWidget *mb_view_stats;
+    GtkWidget *mb_view_diagnostics;
 #ifdef HAVE_RSS
     GtkWidget *mb_view_rss;
 #endif
@@ -294,6 +296,9 @@ trg_menu_bar_get_property(GObject * object, guint property_id,
     case PROP_VIEW_STATS_BUTTON:
         g_value_set_object(value, priv->mb_view_stats);
         break;
+    case PROP_VIEW_DIAGNOSTICS_BUTTON:
+        g_value_set_object(value, priv->mb_view_diagnostics);
+        break;
 #ifdef HAVE_RSS
     case PROP_VIEW_RSS_BUTTON:
         g_value_set_object(value, priv->mb_view_rss);
@@ -579,6 +584,11 @@ static GtkWidget *trg_menu_bar_view_menu_new(TrgMenuBar * mb)
     gtk_widget_set_sensitive(priv->mb_view_stats, FALSE);
     gtk_menu_shell_append(GTK_MENU_SHELL(viewMenu), priv->mb_view_stats);
 
+    priv->mb_view_diagnostics =
+        gtk_menu_item_new_with_mnemonic(_("_Diagnostics"));
+    gtk_menu_shell_append(GTK_MENU_SHELL(viewMenu),
+                          priv->mb_view_diagnostics);
+
 #ifdef HAVE_RSS
     priv->mb_view_rss =
         gtk_menu_item_new_with_mnemonic(_("_RSS"));
@@ -924,6 +934,10 @@ static void trg_menu_bar_class_init(TrgMenuBarClass * klass)
     trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_STATS_BUTTON,
                                      "view-stats-button",
                                      "View stats button");
+    trg_menu_bar_install_widget_prop(object_class,
+                                     PROP_VIEW_DIAGNOSTICS_BUTTON,
+                                     "view-diagnostics-button",
+                                     "View diagnostics button");
 #ifdef HAVE_RSS
     trg_menu_bar_install_widget_prop(object_class, PROP_VIEW_RSS_BUTTON,
                                      "view-rss-button",
@@ -161,7 +161,7 @@ static const gchar* lookup_country(TrgPeersModel *model, const gchar *address) {
 
 void
 trg_peers_model_update(TrgPeersModel * model, TrgTreeView * tv,
-                       gint64 updateSerial, JsonObject * t, gint mode)
+                       gint64 updateSerial, trg_torrent * t, gint mode)
 {
 #ifdef HAVE_GEOIP
     TrgPeersModelPrivate *priv = TRG_PEERS_MODEL_GET_PRIVATE(model);
@@ -178,7 +178,7 @@ trg_peers_model_update(TrgPeersModel * model, TrgTreeView * tv,
     GList *li, *peersList;
     gboolean isNew;
 
-    peers = torrent_get_peers(t);
+    peers = t->details->peers;
 
     if (mode == TORRENT_GET_MODE_FIRST)
         gtk_list_store_clear(GTK_LIST_STORE(model));
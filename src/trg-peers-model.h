@@ -33,6 +33,7 @@
 #include <glib-object.h>
 
 #include "trg-tree-view.h"
+#include "torrent.h"
 
 G_BEGIN_DECLS
 #define TRG_TYPE_PEERS_MODEL trg_peers_model_get_type()
@@ -82,7 +83,7 @@ enum {
 };
 
 void trg_peers_model_update(TrgPeersModel * model, TrgTreeView * tv,
-                            gint64 updateSerial, JsonObject * t,
+                            gint64 updateSerial, trg_torrent * t,
                             gboolean first);
 
 #if HAVE_GEOIP
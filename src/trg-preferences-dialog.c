@@ -431,6 +431,12 @@ static GtkWidget *trg_prefs_generalPage(TrgPreferencesDialog * dlg)
                       TRG_PREFS_PROFILE, NULL);
     hig_workarea_add_row(t, &row, _("Update interval:"), w, NULL);
 
+    w = trgp_check_new(dlg,
+                       _("Adapt update interval to activity and load"),
+                       TRG_PREFS_KEY_ADAPTIVE_UPDATE, TRG_PREFS_PROFILE,
+                       NULL);
+    hig_workarea_add_wide_control(t, &row, w);
+
     w = trgp_spin_new(dlg, TRG_PREFS_KEY_MINUPDATE_INTERVAL, 1, INT_MAX, 1,
                       TRG_PREFS_PROFILE, NULL);
     hig_workarea_add_row(t, &row, _("Minimised update interval:"), w,
@@ -440,6 +446,10 @@ static GtkWidget *trg_prefs_generalPage(TrgPreferencesDialog * dlg)
                       INT_MAX, 1, TRG_PREFS_PROFILE, NULL);
     hig_workarea_add_row(t, &row, _("Session update interval:"), w, NULL);
 
+    w = trgp_check_new(dlg, _("Event-driven requests (no worker threads)"),
+                       TRG_PREFS_KEY_CURL_MULTI, TRG_PREFS_GLOBAL, NULL);
+    hig_workarea_add_wide_control(t, &row, w);
+
     hig_workarea_add_section_title(t, &row, _("Torrents"));
 
     w = trgp_check_new(dlg, _("Start paused"), TRG_PREFS_KEY_START_PAUSED,
@@ -456,6 +466,10 @@ static GtkWidget *trg_prefs_generalPage(TrgPreferencesDialog * dlg)
                        TRG_PREFS_GLOBAL, NULL);
     hig_workarea_add_wide_control(t, &row, w);
 
+    w = trgp_spin_new(dlg, TRG_PREFS_KEY_UPLOAD_CONCURRENCY, 1, 64, 1,
+                      TRG_PREFS_GLOBAL, NULL);
+    hig_workarea_add_row(t, &row, _("Torrents to add at once:"), w, NULL);
+
 
     return t;
 }
@@ -870,6 +884,12 @@ static GtkWidget *trg_prefs_serverPage(TrgPreferencesDialog * dlg)
                        NULL);
     hig_workarea_add_wide_control(t, &row, w);
 
+    w = trgp_check_new(dlg,
+                       _("Also show these torrents when connected to another profile"),
+                       TRG_PREFS_KEY_CONNECT_ALONGSIDE, TRG_PREFS_PROFILE,
+                       NULL);
+    hig_workarea_add_wide_control(t, &row, w);
+
 #ifndef CURL_NO_SSL
     w = trgp_check_new(dlg, _("SSL"), TRG_PREFS_KEY_SSL, TRG_PREFS_PROFILE,
                        NULL);
@@ -49,6 +49,7 @@ struct _TrgPrefsPrivate {
     JsonObject *connectionObj;
     JsonObject *profile;
     gchar *file;
+    gboolean view;              /* from trg_prefs_new_view(), holds profile */
 };
 
 enum {
@@ -88,6 +89,18 @@ static void trg_prefs_dispose(GObject * object)
     G_OBJECT_CLASS(trg_prefs_parent_class)->dispose(object);
 }
 
+static void trg_prefs_finalize(GObject * object)
+{
+    TrgPrefsPrivate *priv = TRG_PREFS(object)->priv;
+
+    if (priv->view) {
+        json_object_unref(priv->profile);
+        json_node_free(priv->user);
+    }
+
+    G_OBJECT_CLASS(trg_prefs_parent_class)->finalize(object);
+}
+
 static void trg_prefs_create_defaults(TrgPrefs * p)
 {
     TrgPrefsPrivate *priv = p->priv;
@@ -107,6 +120,7 @@ static void trg_prefs_create_defaults(TrgPrefs * p)
     trg_prefs_add_default_int(p, TRG_PREFS_KEY_STATES_PANED_POS, 120);
     trg_prefs_add_default_int(p, TRG_PREFS_KEY_TIMEOUT, 40);
     trg_prefs_add_default_int(p, TRG_PREFS_KEY_RETRIES, 3);
+    trg_prefs_add_default_int(p, TRG_PREFS_KEY_UPLOAD_CONCURRENCY, 4);
 
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_FILTER_DIRS);
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_FILTER_TRACKERS);
@@ -114,6 +128,7 @@ static void trg_prefs_create_defaults(TrgPrefs * p)
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_SHOW_GRAPH);
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_ADD_OPTIONS_DIALOG);
     trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_SHOW_STATE_SELECTOR);
+    trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_ADAPTIVE_UPDATE);
     //trg_prefs_add_default_bool_true(p, TRG_PREFS_KEY_SHOW_NOTEBOOK);
 }
 
@@ -146,6 +161,7 @@ static void trg_prefs_class_init(TrgPrefsClass * klass)
     object_class->get_property = trg_prefs_get_property;
     object_class->set_property = trg_prefs_set_property;
     object_class->dispose = trg_prefs_dispose;
+    object_class->finalize = trg_prefs_finalize;
     object_class->constructor = trg_prefs_constructor;
 
     signals[PREF_CHANGE] =
@@ -177,6 +193,23 @@ TrgPrefs *trg_prefs_new(void)
     return g_object_new(TRG_TYPE_PREFS, NULL);
 }
 
+/* The same configuration with a different current profile, for connecting
+ * to another daemon alongside the main one. The profile is shared, and held
+ * even if it's deleted from the original, so changes made to it there are
+ * seen here. Only the original should be saved. */
+TrgPrefs *trg_prefs_new_view(TrgPrefs * p, JsonObject * profile)
+{
+    TrgPrefs *view = trg_prefs_new();
+    TrgPrefsPrivate *priv = view->priv;
+
+    priv->user = json_node_copy(p->priv->user);
+    priv->userObj = json_node_get_object(priv->user);
+    priv->profile = json_object_ref(profile);
+    priv->view = TRUE;
+
+    return view;
+}
+
 static JsonObject *trg_prefs_new_profile_object(void)
 {
     return json_object_new();
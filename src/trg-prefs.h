@@ -28,6 +28,7 @@
 #define TRG_PORT_DEFAULT            9091
 #define TRG_INTERVAL_DEFAULT        3
 #define TRG_SESSION_INTERVAL_DEFAULT 60
+#define TRG_INTERVAL_BACKOFF_MAX    120
 #define TRG_PROFILE_NAME_DEFAULT   "Default"
 
 #define TRG_PREFS_KEY_RPC_URL_PATH "rpc-url-path"
@@ -41,6 +42,7 @@
 #define TRG_PREFS_KEY_USERNAME      "username"
 #define TRG_PREFS_KEY_PASSWORD      "password"
 #define TRG_PREFS_KEY_AUTO_CONNECT  "auto-connect"
+#define TRG_PREFS_KEY_CONNECT_ALONGSIDE "connect-alongside"
 #define TRG_PREFS_KEY_SSL            "ssl"
 #define TRG_PREFS_KEY_SSL_VALIDATE   "ssl-validate"
 #define TRG_PREFS_KEY_TIMEOUT            "timeout"
@@ -65,6 +67,9 @@
 #define TRG_PREFS_KEY_START_PAUSED "start-paused"
 #define TRG_PREFS_KEY_UPDATE_ACTIVE_ONLY "update-active-only"
 #define TRG_PREFS_KEY_DELETE_LOCAL_TORRENT "delete-local-torrent"
+#define TRG_PREFS_KEY_UPLOAD_CONCURRENCY "upload-concurrency"
+#define TRG_PREFS_KEY_CURL_MULTI "curl-multi"
+#define TRG_PREFS_KEY_ADAPTIVE_UPDATE "adaptive-update"
 #define TRG_PREFS_STATE_SELECTOR_LAST "state-selector-last"
 #define TRG_PREFS_ACTIVEONLY_FULLSYNC_ENABLED   "activeonly-fullsync-enabled"
 #define TRG_PREFS_ACTIVEONLY_FULLSYNC_EVERY     "activeonly-fullsync-every"
@@ -127,6 +132,7 @@ typedef struct {
 GType trg_prefs_get_type(void);
 
 TrgPrefs *trg_prefs_new(void);
+TrgPrefs *trg_prefs_new_view(TrgPrefs * p, JsonObject * profile);
 
 void trg_prefs_add_default_int(TrgPrefs * p, const gchar * key, int value);
 void trg_prefs_add_default_string(TrgPrefs * p, const gchar * key,
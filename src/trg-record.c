@@ -0,0 +1,255 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "trg-record.h"
+
+/* A gzipped log of RPC exchanges, for replaying through the parser and the
+ * model without a daemon (see benchmark.c). After a magic line, each entry
+ * is a header line
+ *
+ *   <Q|R> <seq> <microseconds> <status> <length>
+ *
+ * then that many bytes and a newline. Every exchange is flushed, so a log
+ * from a client that crashed is readable up to the last complete entry.
+ */
+
+#define TRG_RECORD_MAGIC "TRGREC1"
+
+struct _trg_record {
+    GMutex mutex;
+    GOutputStream *out;
+    gint64 start;
+    guint seq;
+};
+
+struct _trg_record_reader {
+    GDataInputStream *in;
+};
+
+trg_record *trg_record_open(const gchar * filename, GError ** error)
+{
+    GFile *file = g_file_new_for_path(filename);
+    GFileOutputStream *fout =
+        g_file_replace(file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+    GZlibCompressor *compressor;
+    trg_record *r;
+
+    g_object_unref(file);
+
+    if (!fout)
+        return NULL;
+
+    compressor = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+
+    r = g_new0(trg_record, 1);
+    g_mutex_init(&r->mutex);
+    r->start = g_get_monotonic_time();
+    r->out = g_converter_output_stream_new(G_OUTPUT_STREAM(fout),
+                                           G_CONVERTER(compressor));
+    g_object_unref(compressor);
+    g_object_unref(fout);
+
+    if (!g_output_stream_write_all(r->out, TRG_RECORD_MAGIC "\n",
+                                   strlen(TRG_RECORD_MAGIC) + 1, NULL,
+                                   NULL, error)) {
+        trg_record_close(r);
+        return NULL;
+    }
+
+    return r;
+}
+
+static gboolean
+trg_record_write(trg_record * r, trg_record_kind kind, guint seq,
+                 gint64 time, gint status, const gchar * data, gsize len,
+                 GError ** error)
+{
+    gchar header[96];
+
+    if (!data)
+        len = 0;
+
+    g_snprintf(header, sizeof(header),
+               "%c %u %" G_GINT64_FORMAT " %d %" G_GSIZE_FORMAT "\n",
+               kind, seq, time, status, len);
+
+    return g_output_stream_write_all(r->out, header, strlen(header), NULL,
+                                     NULL, error)
+        && g_output_stream_write_all(r->out, data, len, NULL, NULL, error)
+        && g_output_stream_write_all(r->out, "\n", 1, NULL, NULL, error);
+}
+
+/* Written together so the pair is adjacent, whatever the other threads are
+ * doing. request_time is g_get_monotonic_time() when it was sent. */
+void
+trg_record_exchange(trg_record * r, const gchar * request,
+                    gint64 request_time, gint status,
+                    const gchar * response, gsize response_len)
+{
+    GError *error = NULL;
+
+    g_mutex_lock(&r->mutex);
+
+    if (r->out) {
+        guint seq = r->seq++;
+
+        if (!trg_record_write(r, TRG_RECORD_REQUEST, seq,
+                              request_time - r->start, 0, request,
+                              request ? strlen(request) : 0, &error)
+            || !trg_record_write(r, TRG_RECORD_RESPONSE, seq,
+                                 g_get_monotonic_time() - r->start, status,
+                                 response, response_len, &error)
+            || !g_output_stream_flush(r->out, NULL, &error)) {
+            g_warning("RPC recording stopped: %s", error->message);
+            g_error_free(error);
+            g_clear_object(&r->out);
+        }
+    }
+
+    g_mutex_unlock(&r->mutex);
+}
+
+void trg_record_close(trg_record * r)
+{
+    if (!r)
+        return;
+
+    if (r->out) {
+        g_output_stream_close(r->out, NULL, NULL);
+        g_object_unref(r->out);
+    }
+
+    g_mutex_clear(&r->mutex);
+    g_free(r);
+}
+
+trg_record_reader *trg_record_reader_open(const gchar * filename,
+                                          GError ** error)
+{
+    GFile *file = g_file_new_for_path(filename);
+    GFileInputStream *fin = g_file_read(file, NULL, error);
+    GZlibDecompressor *decompressor;
+    GInputStream *converted;
+    trg_record_reader *r;
+    gchar *magic;
+
+    g_object_unref(file);
+
+    if (!fin)
+        return NULL;
+
+    decompressor =
+        g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+    converted = g_converter_input_stream_new(G_INPUT_STREAM(fin),
+                                             G_CONVERTER(decompressor));
+    g_object_unref(decompressor);
+    g_object_unref(fin);
+
+    r = g_new0(trg_record_reader, 1);
+    r->in = g_data_input_stream_new(converted);
+    g_object_unref(converted);
+
+    magic = g_data_input_stream_read_line(r->in, NULL, NULL, error);
+    if (g_strcmp0(magic, TRG_RECORD_MAGIC)) {
+        if (magic)
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                        "%s is not an RPC recording", filename);
+        g_free(magic);
+        trg_record_reader_close(r);
+        return NULL;
+    }
+
+    g_free(magic);
+    return r;
+}
+
+/* FALSE at the end of the log, setting error if it ended badly (such as
+ * an entry cut short). */
+gboolean
+trg_record_reader_next(trg_record_reader * r, trg_record_entry * entry,
+                       GError ** error)
+{
+    gchar *line = g_data_input_stream_read_line(r->in, NULL, NULL, error);
+    gchar **fields;
+    gsize n_read;
+    gchar nl;
+
+    memset(entry, 0, sizeof(trg_record_entry));
+
+    if (!line)
+        return FALSE;
+
+    fields = g_strsplit(line, " ", 5);
+    g_free(line);
+
+    if (g_strv_length(fields) != 5 || strlen(fields[0]) != 1) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                    "Malformed RPC recording entry");
+        g_strfreev(fields);
+        return FALSE;
+    }
+
+    entry->kind = (trg_record_kind) fields[0][0];
+    entry->seq = (guint) g_ascii_strtoull(fields[1], NULL, 10);
+    entry->time = g_ascii_strtoll(fields[2], NULL, 10);
+    entry->status = (gint) g_ascii_strtoll(fields[3], NULL, 10);
+    entry->len = (gsize) g_ascii_strtoull(fields[4], NULL, 10);
+    g_strfreev(fields);
+
+    entry->data = g_malloc(entry->len + 1);
+    entry->data[entry->len] = '\0';
+
+    if (!g_input_stream_read_all(G_INPUT_STREAM(r->in), entry->data,
+                                 entry->len, &n_read, NULL, error)
+        || n_read != entry->len
+        || !g_input_stream_read_all(G_INPUT_STREAM(r->in), &nl, 1,
+                                    &n_read, NULL, error) || n_read != 1) {
+        if (error && !*error)
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                        "RPC recording ends part way through an entry");
+        trg_record_entry_clear(entry);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void trg_record_entry_clear(trg_record_entry * entry)
+{
+    g_free(entry->data);
+    entry->data = NULL;
+    entry->len = 0;
+}
+
+void trg_record_reader_close(trg_record_reader * r)
+{
+    if (!r)
+        return;
+
+    g_object_unref(r->in);
+    g_free(r);
+}
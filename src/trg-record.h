@@ -0,0 +1,59 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TRG_RECORD_H_
+#define TRG_RECORD_H_
+
+#include <glib.h>
+
+/* Set to a filename to record all RPC traffic there. */
+#define TRG_RECORD_ENV "TRG_RECORD"
+
+typedef enum {
+    TRG_RECORD_REQUEST = 'Q',
+    TRG_RECORD_RESPONSE = 'R'
+} trg_record_kind;
+
+typedef struct {
+    trg_record_kind kind;
+    guint seq;                  /* pairs a response with its request */
+    gint64 time;                /* microseconds since recording started */
+    gint status;                /* trg_response status, responses only */
+    gchar *data;                /* nul terminated for convenience */
+    gsize len;
+} trg_record_entry;
+
+typedef struct _trg_record trg_record;
+typedef struct _trg_record_reader trg_record_reader;
+
+trg_record *trg_record_open(const gchar * filename, GError ** error);
+void trg_record_exchange(trg_record * r, const gchar * request,
+                         gint64 request_time, gint status,
+                         const gchar * response, gsize response_len);
+void trg_record_close(trg_record * r);
+
+trg_record_reader *trg_record_reader_open(const gchar * filename,
+                                          GError ** error);
+gboolean trg_record_reader_next(trg_record_reader * r,
+                                trg_record_entry * entry,
+                                GError ** error);
+void trg_record_entry_clear(trg_record_entry * entry);
+void trg_record_reader_close(trg_record_reader * r);
+
+#endif                          /* TRG_RECORD_H_ */
@@ -0,0 +1,261 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+#include "protocol-constants.h"
+#include "trg-client.h"
+#include "trg-prefs.h"
+#include "trg-torrent-model.h"
+#include "trg-snapshot.h"
+
+/* The torrent list as it was when we last disconnected from a daemon, so it
+ * can be shown straight away next time, while the session handshake and the
+ * first full torrent-get are still going (see
+ * trg_torrent_model_load_snapshot()).
+ *
+ * One file per daemon, named by a hash of its RPC URL, in the user cache
+ * directory. It's a serialised GVariant which is memory mapped to load:
+ *
+ *   (version, url, rpc version, time saved, field names, rows)
+ *
+ * Like the table format of torrent-get, the field names are only stored
+ * once, and each row holds one value per field. The rows are exported from
+ * the torrent records, so the per-torrent details (files, peers and tracker
+ * stats) aren't kept, only the tracker hosts and counts decoded from them.
+ */
+
+#define TRG_SNAPSHOT_VERSION 1
+#define TRG_SNAPSHOT_TYPE "(usxxasaav)"
+
+static gchar *trg_snapshot_filename(const gchar * url)
+{
+    gchar *hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url, -1);
+    gchar *basename = g_strconcat(hash, ".snapshot", NULL);
+    gchar *filename = g_build_filename(g_get_user_cache_dir(),
+                                       g_get_application_name(),
+                                       basename, NULL);
+
+    g_free(basename);
+    g_free(hash);
+
+    return filename;
+}
+
+struct trg_snapshot_rows_args {
+    TrgClient *client;
+    GList *torrents;
+};
+
+static gboolean
+trg_snapshot_rows_foreach(GtkTreeModel * model,
+                          GtkTreePath * path G_GNUC_UNUSED,
+                          GtkTreeIter * iter, gpointer data)
+{
+    struct trg_snapshot_rows_args *args =
+        (struct trg_snapshot_rows_args *) data;
+    TrgClient *client;
+    trg_torrent *t;
+
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_CLIENT, &client,
+                       TORRENT_COLUMN_TORRENT, &t, -1);
+
+    if (client == args->client && t)
+        args->torrents = g_list_prepend(args->torrents,
+                                        trg_torrent_to_json(t));
+
+    return FALSE;
+}
+
+static GVariant *trg_snapshot_value(JsonObject * t, const gchar * name)
+{
+    JsonNode *node;
+    GVariant *value;
+
+    if (json_object_has_member(t, name))
+        return g_variant_new_variant(json_gvariant_serialize
+                                     (json_object_get_member(t, name)));
+
+    /* Loading skips nulls, so this is as good as missing. */
+    node = json_node_new(JSON_NODE_NULL);
+    value = g_variant_new_variant(json_gvariant_serialize(node));
+    json_node_free(node);
+
+    return value;
+}
+
+/* Save the rows in model which came from tc. It must be connected, for the
+ * RPC version. */
+gboolean
+trg_snapshot_save(TrgClient * tc, GtkTreeModel * model, GError ** error)
+{
+    struct trg_snapshot_rows_args args;
+    GVariantBuilder names, rows;
+    GList *fields = NULL;
+    GList *li, *fi;
+    GVariant *snapshot;
+    gchar *url, *filename, *dirname;
+    gboolean result;
+
+    args.client = tc;
+    args.torrents = NULL;
+    gtk_tree_model_foreach(model, trg_snapshot_rows_foreach, &args);
+
+    g_variant_builder_init(&names, G_VARIANT_TYPE_STRING_ARRAY);
+    if (args.torrents) {
+        GList *members =
+            json_object_get_members((JsonObject *) args.torrents->data);
+        for (fi = members; fi; fi = g_list_next(fi)) {
+            const gchar *name = (const gchar *) fi->data;
+            if (g_strcmp0(name, FIELD_FILES)
+                && g_strcmp0(name, FIELD_PEERS)) {
+                fields = g_list_append(fields, fi->data);
+                g_variant_builder_add(&names, "s", name);
+            }
+        }
+        g_list_free(members);
+    }
+
+    g_variant_builder_init(&rows, G_VARIANT_TYPE("aav"));
+    for (li = args.torrents; li; li = g_list_next(li)) {
+        JsonObject *t = (JsonObject *) li->data;
+
+        g_variant_builder_open(&rows, G_VARIANT_TYPE("av"));
+        for (fi = fields; fi; fi = g_list_next(fi))
+            g_variant_builder_add_value(&rows,
+                                        trg_snapshot_value(t,
+                                                           (const gchar *)
+                                                           fi->data));
+        g_variant_builder_close(&rows);
+    }
+
+    g_list_free(fields);
+    g_list_free_full(args.torrents, (GDestroyNotify) json_object_unref);
+
+    url = trg_client_get_url(tc);
+    snapshot = g_variant_ref_sink(g_variant_new(TRG_SNAPSHOT_TYPE,
+                                                TRG_SNAPSHOT_VERSION, url,
+                                                trg_client_get_rpc_version
+                                                (tc),
+                                                g_get_real_time() /
+                                                G_USEC_PER_SEC, &names,
+                                                &rows));
+
+    filename = trg_snapshot_filename(url);
+    dirname = g_path_get_dirname(filename);
+    g_mkdir_with_parents(dirname, TRG_PREFS_DEFAULT_DIR_MODE);
+
+    result = g_file_set_contents(filename,
+                                 g_variant_get_data(snapshot),
+                                 g_variant_get_size(snapshot), error);
+
+    g_variant_unref(snapshot);
+    g_free(dirname);
+    g_free(filename);
+    g_free(url);
+
+    return result;
+}
+
+/* The torrents last saved for the daemon tc is configured for, as objects
+ * like those in a torrent-get response, or NULL if there aren't any. */
+JsonArray *trg_snapshot_load(TrgClient * tc, gint64 * rpcv)
+{
+    gchar *url = trg_client_get_url(tc);
+    gchar *filename = trg_snapshot_filename(url);
+    GMappedFile *mapped = g_mapped_file_new(filename, FALSE, NULL);
+    JsonArray *torrents = NULL;
+    GVariant *snapshot, *names, *rows, *row;
+    GVariantIter iter;
+    const gchar *savedUrl;
+    guint32 version;
+    gint64 saved;
+    GBytes *bytes;
+
+    g_free(filename);
+
+    if (!mapped) {
+        g_free(url);
+        return NULL;
+    }
+
+    bytes = g_mapped_file_get_bytes(mapped);
+    g_mapped_file_unref(mapped);
+
+    /* Not trusted, but GVariant copes with any data, giving defaults for
+     * anything malformed. */
+    snapshot = g_variant_ref_sink(g_variant_new_from_bytes
+                                  (G_VARIANT_TYPE(TRG_SNAPSHOT_TYPE), bytes,
+                                   FALSE));
+    g_bytes_unref(bytes);
+
+    g_variant_get(snapshot, "(u&sxx@as@aav)", &version, &savedUrl, rpcv,
+                  &saved, &names, &rows);
+
+    /* A file from another version, or byte order, has the wrong version. */
+    if (version == TRG_SNAPSHOT_VERSION && !g_strcmp0(savedUrl, url)) {
+        gsize n_names = g_variant_n_children(names);
+
+        torrents = json_array_new();
+
+        g_variant_iter_init(&iter, rows);
+        while ((row = g_variant_iter_next_value(&iter))) {
+            JsonObject *t = json_object_new();
+            gsize n = MIN(n_names, g_variant_n_children(row));
+            gsize i;
+
+            for (i = 0; i < n; i++) {
+                const gchar *name;
+                GVariant *value;
+                JsonNode *node;
+
+                g_variant_get_child(names, i, "&s", &name);
+                g_variant_get_child(row, i, "v", &value);
+                node = json_gvariant_deserialize(value, NULL, NULL);
+                g_variant_unref(value);
+
+                if (node && !JSON_NODE_HOLDS_NULL(node))
+                    json_object_set_member(t, name, node);
+                else if (node)
+                    json_node_free(node);
+            }
+
+            g_variant_unref(row);
+
+            if (json_object_has_member(t, FIELD_ID))
+                json_array_add_object_element(torrents, t);
+            else
+                json_object_unref(t);
+        }
+    }
+
+    g_variant_unref(names);
+    g_variant_unref(rows);
+    g_variant_unref(snapshot);
+    g_free(url);
+
+    return torrents;
+}
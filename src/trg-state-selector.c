@@ -54,11 +54,14 @@ struct _TrgStateSelectorPrivate {
     gboolean showDirs;
     gboolean showTrackers;
     gboolean dirsFirst;
+    gboolean showSources;
     TrgClient *client;
     TrgPrefs *prefs;
+    TrgTorrentModel *torrentModel;
+    gint64 pass;
     GHashTable *trackers;
     GHashTable *directories;
-    GRegex *urlHostRegex;
+    GHashTable *sources;
     gint n_categories;
     GtkListStore *store;
     GtkTreeRowReference *error_rr;
@@ -74,12 +77,6 @@ struct _TrgStateSelectorPrivate {
     GtkTreeRowReference *down_wait_rr;
 };
 
-GRegex *trg_state_selector_get_url_host_regex(TrgStateSelector * s)
-{
-    TrgStateSelectorPrivate *priv = TRG_STATE_SELECTOR_GET_PRIVATE(s);
-    return priv->urlHostRegex;
-}
-
 guint32 trg_state_selector_get_flag(TrgStateSelector * s)
 {
     TrgStateSelectorPrivate *priv = TRG_STATE_SELECTOR_GET_PRIVATE(s);
@@ -198,8 +195,6 @@ trg_state_selector_update_dynamic_filter(GtkTreeModel * model,
 
 static void refresh_statelist_cb(GtkWidget * w, gpointer data)
 {
-    TrgStateSelectorPrivate *priv = TRG_STATE_SELECTOR_GET_PRIVATE(data);
-    trg_client_inc_serial(priv->client);
     trg_state_selector_update(TRG_STATE_SELECTOR(data),
                               TORRENT_UPDATE_ADDREMOVE);
 }
@@ -297,60 +292,96 @@ trg_state_selector_insert(TrgStateSelector * s, int offset,
     gtk_list_store_insert(GTK_LIST_STORE(model), iter, args.pos);
 }
 
+/* Sources (daemons) come first after the fixed categories, then the
+ * trackers and directories in whichever order is configured. */
+static gint trg_state_selector_dynamic_offset(TrgStateSelectorPrivate *
+                                              priv)
+{
+    return priv->n_categories + g_hash_table_size(priv->sources);
+}
+
 void trg_state_selector_update(TrgStateSelector * s, guint whatsChanged)
 {
     TrgStateSelectorPrivate *priv = TRG_STATE_SELECTOR_GET_PRIVATE(s);
     GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(s));
     TrgClient *client = priv->client;
-    gint64 updateSerial = trg_client_get_serial(client);
-    GList *torrentItemRefs;
+    gint64 updateSerial;
     GtkTreeIter torrentIter, iter;
-    GList *trackersList, *trackerItem, *li;
-    GtkTreeRowReference *rr;
-    GtkTreePath *path;
-    GtkTreeModel *torrentModel;
+    GtkTreeModel *torrentModel = GTK_TREE_MODEL(priv->torrentModel);
+    gboolean valid;
     gpointer result;
     struct cruft_remove_args cruft;
 
-    if (!trg_client_is_connected(client))
+    /* A snapshot is shown while connecting, with its categories. */
+    if (!trg_client_is_connected(client)
+        && !trg_torrent_model_is_stale(priv->torrentModel))
         return;
 
-    torrentItemRefs =
-        g_hash_table_get_values(trg_client_get_torrent_table(client));
+    /* The sources, trackers and directories only change when torrents are
+     * added/removed, moved or have their trackers changed. The state counts
+     * come from the model's stats (trg_state_selector_stats_update()), so a
+     * state change alone doesn't need a walk. */
+    if (!(whatsChanged & (TORRENT_UPDATE_ADDREMOVE |
+                          TORRENT_UPDATE_PATH_CHANGE |
+                          TORRENT_UPDATE_TRACKER_CHANGE)))
+        return;
 
-    for (li = torrentItemRefs; li; li = g_list_next(li)) {
-        JsonObject *t = NULL;
-        rr = (GtkTreeRowReference *) li->data;
-        path = gtk_tree_row_reference_get_path(rr);
-        torrentModel = gtk_tree_row_reference_get_model(rr);
+    /* Counts are restarted for each pass. This isn't the client's update
+     * serial, as the model may be fed by more than one client. */
+    updateSerial = ++priv->pass;
 
-        if (path) {
-            if (gtk_tree_model_get_iter(torrentModel, &torrentIter, path)) {
-                gtk_tree_model_get(torrentModel, &torrentIter,
-                                   TORRENT_COLUMN_JSON, &t, -1);
-            }
-            gtk_tree_path_free(path);
-        }
+    /* Walk the model rather than a client's torrent table, to include the
+     * torrents of every daemon in a merged view. */
+    for (valid = gtk_tree_model_get_iter_first(torrentModel, &torrentIter);
+         valid; valid = gtk_tree_model_iter_next(torrentModel,
+                                                  &torrentIter)) {
+        trg_torrent *t = NULL;
+
+        gtk_tree_model_get(torrentModel, &torrentIter,
+                           TORRENT_COLUMN_TORRENT, &t, -1);
 
         if (!t)
             continue;
 
-        if (priv->showTrackers
+        if (priv->showSources
             && (whatsChanged & TORRENT_UPDATE_ADDREMOVE)) {
-            trackersList =
-                json_array_get_elements(torrent_get_tracker_stats(t));
-            for (trackerItem = trackersList; trackerItem;
-                 trackerItem = g_list_next(trackerItem)) {
-                JsonObject *tracker =
-                    json_node_get_object((JsonNode *) trackerItem->data);
-                const gchar *announceUrl =
-                    tracker_stats_get_announce(tracker);
-                gchar *announceHost =
-                    trg_gregex_get_first(priv->urlHostRegex,
-                                         announceUrl);
-
-                if (!announceHost)
-                    continue;
+            gchar *source;
+            gtk_tree_model_get(torrentModel, &torrentIter,
+                               TORRENT_COLUMN_SOURCE, &source, -1);
+
+            if (!source) {
+                /* Not yet named, which only a daemon's first poll is. */
+            } else if ((result =
+                        g_hash_table_lookup(priv->sources, source))) {
+                trg_state_selector_update_dynamic_filter(model,
+                                                         (GtkTreeRowReference
+                                                          *) result,
+                                                         updateSerial);
+            } else {
+                trg_state_selector_insert(s, priv->n_categories,
+                                          g_hash_table_size(priv->sources),
+                                          source, &iter);
+                gtk_list_store_set(GTK_LIST_STORE(model), &iter,
+                                   STATE_SELECTOR_ICON, GTK_STOCK_CONNECT,
+                                   STATE_SELECTOR_NAME, source,
+                                   STATE_SELECTOR_SERIAL, updateSerial,
+                                   STATE_SELECTOR_BIT, FILTER_FLAG_SOURCE,
+                                   STATE_SELECTOR_COUNT, 1,
+                                   STATE_SELECTOR_INDEX, 0, -1);
+                g_hash_table_insert(priv->sources, g_strdup(source),
+                                    quick_tree_ref_new(model, &iter));
+            }
+
+            g_free(source);
+        }
+
+        if (priv->showTrackers
+            && (whatsChanged & (TORRENT_UPDATE_ADDREMOVE |
+                                TORRENT_UPDATE_TRACKER_CHANGE))) {
+            const gchar **host;
+
+            for (host = t->announceHosts; host && *host; host++) {
+                const gchar *announceHost = *host;
 
                 result = g_hash_table_lookup(priv->trackers, announceHost);
 
@@ -359,13 +390,12 @@ void trg_state_selector_update(TrgStateSelector * s, guint whatsChanged)
                                                              (GtkTreeRowReference
                                                               *) result,
                                                              updateSerial);
-                    g_free(announceHost);
                 } else {
 					if (priv->dirsFirst){
-							trg_state_selector_insert(s, priv->n_categories +
+							trg_state_selector_insert(s, trg_state_selector_dynamic_offset(priv) +
 										g_hash_table_size(priv->directories), -1, announceHost, &iter);
 					} else {
-						trg_state_selector_insert(s, priv->n_categories,
+						trg_state_selector_insert(s, trg_state_selector_dynamic_offset(priv),
 										g_hash_table_size(priv->trackers), announceHost, &iter);
 					}
                     gtk_list_store_set(GTK_LIST_STORE(model), &iter,
@@ -377,11 +407,11 @@ void trg_state_selector_update(TrgStateSelector * s, guint whatsChanged)
                                        STATE_SELECTOR_BIT,
                                        FILTER_FLAG_TRACKER,
                                        STATE_SELECTOR_INDEX, 0, -1);
-                    g_hash_table_insert(priv->trackers, announceHost,
+                    g_hash_table_insert(priv->trackers,
+                                        g_strdup(announceHost),
                                         quick_tree_ref_new(model, &iter));
                 }
             }
-            g_list_free(trackersList);
         }
 
         if (priv->showDirs && ((whatsChanged & TORRENT_UPDATE_ADDREMOVE)
@@ -399,10 +429,10 @@ void trg_state_selector_update(TrgStateSelector * s, guint whatsChanged)
                                                          updateSerial);
             } else {
                 if (priv->dirsFirst){
-					trg_state_selector_insert(s, priv->n_categories,
+					trg_state_selector_insert(s, trg_state_selector_dynamic_offset(priv),
 								g_hash_table_size(priv->directories), dir, &iter);
 				} else {
-					trg_state_selector_insert(s, priv->n_categories +
+					trg_state_selector_insert(s, trg_state_selector_dynamic_offset(priv) +
 									g_hash_table_size(priv->trackers), -1, dir, &iter);
 				}
                 gtk_list_store_set(GTK_LIST_STORE(model), &iter,
@@ -421,11 +451,17 @@ void trg_state_selector_update(TrgStateSelector * s, guint whatsChanged)
         }
     }
 
-    g_list_free(torrentItemRefs);
+    cruft.serial = updateSerial;
 
-    cruft.serial = trg_client_get_serial(client);
+    if (priv->showSources && (whatsChanged & TORRENT_UPDATE_ADDREMOVE)) {
+        cruft.table = priv->sources;
+        g_hash_table_foreach_remove(priv->sources,
+                                    trg_state_selector_remove_cruft,
+                                    &cruft);
+    }
 
-    if (priv->showTrackers && ((whatsChanged & TORRENT_UPDATE_ADDREMOVE))) {
+    if (priv->showTrackers && (whatsChanged & (TORRENT_UPDATE_ADDREMOVE |
+                                               TORRENT_UPDATE_TRACKER_CHANGE))) {
         cruft.table = priv->trackers;
         g_hash_table_foreach_remove(priv->trackers,
                                     trg_state_selector_remove_cruft,
@@ -451,6 +487,22 @@ void trg_state_selector_set_show_dirs(TrgStateSelector * s, gboolean show)
         trg_state_selector_update(s, TORRENT_UPDATE_PATH_CHANGE);
 }
 
+/* Filter by daemon, for when more than one is merged into the list. */
+void
+trg_state_selector_set_show_sources(TrgStateSelector * s, gboolean show)
+{
+    TrgStateSelectorPrivate *priv = TRG_STATE_SELECTOR_GET_PRIVATE(s);
+
+    if (show == priv->showSources)
+        return;
+
+    priv->showSources = show;
+    if (!show)
+        g_hash_table_remove_all(priv->sources);
+    else
+        trg_state_selector_update(s, TORRENT_UPDATE_ADDREMOVE);
+}
+
 static void
 on_torrents_state_change(TrgTorrentModel * model,
                          guint whatsChanged, gpointer data)
@@ -588,6 +640,7 @@ void trg_state_selector_disconnect(TrgStateSelector * s)
 
     g_hash_table_remove_all(priv->trackers);
     g_hash_table_remove_all(priv->directories);
+    g_hash_table_remove_all(priv->sources);
 
     trg_state_selector_update_stat(priv->all_rr, -1);
     trg_state_selector_update_stat(priv->down_rr, -1);
@@ -610,6 +663,10 @@ TrgStateSelector *trg_state_selector_new(TrgClient * client,
     TrgStateSelector *selector =
         g_object_new(TRG_TYPE_STATE_SELECTOR, "client",
                      client, NULL);
+    TrgStateSelectorPrivate *priv =
+        TRG_STATE_SELECTOR_GET_PRIVATE(selector);
+
+    priv->torrentModel = tmodel;
     g_signal_connect(tmodel, "torrents-state-change",
                      G_CALLBACK(on_torrents_state_change), selector);
     return selector;
@@ -639,13 +696,15 @@ static GObject *trg_state_selector_constructor(GType type,
     selector = TRG_STATE_SELECTOR(object);
     priv = TRG_STATE_SELECTOR_GET_PRIVATE(object);
 
-    priv->urlHostRegex = trg_uri_host_regex_new();
     priv->trackers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
                                            (GDestroyNotify)
                                            remove_row_ref_and_free);
     priv->directories =
         g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
                               (GDestroyNotify) remove_row_ref_and_free);
+    priv->sources =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                              (GDestroyNotify) remove_row_ref_and_free);
 
     gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(object), FALSE);
 
@@ -61,7 +61,8 @@ struct _TrgStatsDialogPrivate {
     GtkWidget *tv;
     GtkListStore *model;
     GtkTreeRowReference *rr_down, *rr_up, *rr_ratio, *rr_files_added,
-        *rr_session_count, *rr_active, *rr_version;
+        *rr_session_count, *rr_active, *rr_version, *rr_conn_reused,
+        *rr_conn_new;
 };
 
 static GObject *instance = NULL;
@@ -211,6 +212,21 @@ update_time_stat(JsonObject * args, GtkTreeRowReference * rr,
     update_statistic(rr, session_val, cumulat_val);
 }
 
+static void update_connection_stats(TrgStatsDialogPrivate * priv)
+{
+    gchar reused_val[32];
+    gchar new_val[32];
+    guint reused, created;
+
+    trg_client_get_connection_stats(priv->client, &reused, &created);
+
+    g_snprintf(reused_val, sizeof(reused_val), "%u", reused);
+    g_snprintf(new_val, sizeof(new_val), "%u", created);
+
+    update_statistic(priv->rr_conn_reused, reused_val, "");
+    update_statistic(priv->rr_conn_new, new_val, "");
+}
+
 static gboolean on_stats_reply(gpointer data)
 {
     trg_response *response = (trg_response *) data;
@@ -238,6 +254,7 @@ static gboolean on_stats_reply(gpointer data)
         update_int_stat(args, priv->rr_files_added, "filesAdded");
         update_int_stat(args, priv->rr_session_count, "sessionCount");
         update_time_stat(args, priv->rr_active, "secondsActive");
+        update_connection_stats(priv);
 
         if (trg_client_is_connected(priv->client))
             g_timeout_add_seconds(STATS_UPDATE_INTERVAL,
@@ -325,6 +342,11 @@ static GObject *trg_stats_dialog_constructor(GType type,
         stats_dialog_add_statistic(priv->model, _("Session Count"));
     priv->rr_active =
         stats_dialog_add_statistic(priv->model, _("Time Active"));
+    priv->rr_conn_reused =
+        stats_dialog_add_statistic(priv->model,
+                                   _("Connections Reused"));
+    priv->rr_conn_new =
+        stats_dialog_add_statistic(priv->model, _("Connections Opened"));
 
     tv = priv->tv = trg_tree_view_new();
     gtk_widget_set_sensitive(tv, TRUE);
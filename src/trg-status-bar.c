@@ -43,6 +43,8 @@
  *
  * There's a signal in TrgClient for session updates, connected into the
  * main window, which calls this. Session updates happen every 10 torrent-get updates.
+ * The periodic refresh only fetches the volatile fields, and this is then
+ * only called when free space or the alt speed state changed.
  */
 
 G_DEFINE_TYPE(TrgStatusBar, trg_status_bar, GTK_TYPE_HBOX)
@@ -55,6 +57,7 @@ struct _TrgStatusBarPrivate {
     GtkWidget *turtleImage, *turtleEventBox;
     GtkWidget *free_lbl;
     GtkWidget *info_lbl;
+    GtkWidget *progress;
     TrgClient *client;
     TrgMainWindow *win;
 };
@@ -79,6 +82,23 @@ void trg_status_bar_reset(TrgStatusBar * sb)
     gtk_widget_set_visible(priv->turtleEventBox, FALSE);
 }
 
+/* For a long running job like adding a batch of torrents. A NULL text hides
+ * it again. */
+void
+trg_status_bar_set_progress(TrgStatusBar * sb, gdouble fraction,
+                            const gchar * text)
+{
+    TrgStatusBarPrivate *priv = TRG_STATUS_BAR_GET_PRIVATE(sb);
+
+    if (text) {
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(priv->progress),
+                                      fraction);
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(priv->progress), text);
+    }
+
+    gtk_widget_set_visible(priv->progress, text != NULL);
+}
+
 static void
 turtle_toggle(GtkWidget * w, GdkEventButton * event, gpointer data)
 {
@@ -108,6 +128,11 @@ static void trg_status_bar_init(TrgStatusBar * self)
     priv->info_lbl = gtk_label_new(_("Disconnected"));
     gtk_box_pack_start(GTK_BOX(self), priv->info_lbl, FALSE, TRUE, 0);
 
+    priv->progress = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(priv->progress), TRUE);
+    gtk_widget_set_no_show_all(priv->progress, TRUE);
+    gtk_box_pack_start(GTK_BOX(self), priv->progress, FALSE, TRUE, 10);
+
     priv->turtleImage = gtk_image_new();
 
     priv->turtleEventBox = gtk_event_box_new();
@@ -61,6 +61,8 @@ void trg_status_bar_push_connection_msg(TrgStatusBar * sb,
                                         const gchar * msg);
 void trg_status_bar_reset(TrgStatusBar * sb);
 void trg_status_bar_clear_indicators(TrgStatusBar * sb);
+void trg_status_bar_set_progress(TrgStatusBar * sb, gdouble fraction,
+                                 const gchar * text);
 const gchar *trg_status_bar_get_speed_text(TrgStatusBar * s);
 void trg_status_bar_update_speed(TrgStatusBar * sb,
                                  trg_torrent_model_update_stats * stats,
@@ -33,8 +33,10 @@
 #include "trg-model.h"
 #include "util.h"
 
-/* An extension of TrgModel (which is an extension of GtkListStore) which
- * updates from a JSON torrent-get response. It handles a number of different
+/* A GtkTreeModel over an array of rows, which updates from a JSON
+ * torrent-get response. Each torrent is decoded into a trg_torrent
+ * (torrent.h), which the row holds until the next update replaces it, and
+ * the columns are read straight from it. It handles a number of different
  * update modes.
  *   1) The first update.
  *   2) A full update.
@@ -47,11 +49,32 @@
  *   2) Emits signals if something is added or removed. This is used by the state
  *      selector so it doesn't have to refresh itself on every update.
  *   3) Added or completed signals, for libnotify notifications.
- *   4) Maintains the torrent hash table (by ID).
- *      (and provide a lookup function which outputs an iter and/or JSON object.)
+ *   4) Maintains the torrent hash table (by ID), which points straight at the
+ *      row (and provide a lookup function which outputs an iter and/or record.)
  *   5) If the download directory is new/changed, create a short version if there
  *      is one (duplicate it not) for the state selector to filter/populate against.
- *   6) Shorten the tracker announce URL.
+ *   6) Shows the first tracker's host, shortened when the record is decoded.
+ *   7) Holds on to the details of the selected torrent, which only come
+ *      from a separate details request, across list updates.
+ *   8) Merges torrents from more than one daemon. Each row records the client
+ *      it came from, and each client has its own ID table, so rows are keyed
+ *      by (client, ID). An update only adds to or removes the rows of the
+ *      client it came from.
+ *   9) Can be filled from a snapshot of the last session (trg-snapshot.c)
+ *      before the daemon answers. Those rows are stale until the first full
+ *      update, which reconciles against them rather than starting afresh.
+ *
+ * The rows are only ever appended, and removals are swept out of the array
+ * together, so adding or removing any number of torrents in an update is one
+ * pass. Iters point at the row, which knows its own index, so they stay
+ * valid until the row is removed and need no row references.
+ *
+ * Decoding and diffing a response happen on a worker thread
+ * (trg_torrent_model_prepare_async()), against a shadow of what each
+ * client's rows hold. The main thread only applies the resulting change
+ * list, which leaves out the torrents that haven't changed at all, and does
+ * so a few milliseconds at a time, so even the first load of a very large
+ * daemon doesn't stop the window drawing.
  */
 
 enum {
@@ -59,36 +82,172 @@ enum {
     TMODEL_UPDATE,
     TMODEL_TORRENT_ADDED,
     TMODEL_STATE_CHANGED,
+    TMODEL_APPLY_STARTED,
+    TMODEL_APPLY_PROGRESS,
+    TMODEL_APPLY_FINISHED,
     TMODEL_SIGNAL_COUNT
 };
 
 #define PROP_REMOVE_IN_PROGRESS "remove-in-progress"
 
+/* How long each main loop dispatch may spend applying change lists, in
+ * microseconds, so the window still draws and takes input during a big
+ * one. */
+#define TRG_TORRENT_MODEL_APPLY_BUDGET 8000
+
+/* How many torrents a run of change lists needs to have queued before it's
+ * bracketed by "apply-started" and "apply-finished". Well under this fits
+ * in a dispatch. */
+#define TRG_TORRENT_MODEL_APPLY_BRACKET 1000
+
 static guint signals[TMODEL_SIGNAL_COUNT] = { 0 };
 
-G_DEFINE_TYPE(TrgTorrentModel, trg_torrent_model, GTK_TYPE_LIST_STORE)
+static void trg_torrent_model_tree_model_init(GtkTreeModelIface * iface);
+
+G_DEFINE_TYPE_WITH_CODE(TrgTorrentModel, trg_torrent_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,
+                                              trg_torrent_model_tree_model_init))
 #define TRG_TORRENT_MODEL_GET_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRG_TYPE_TORRENT_MODEL, TrgTorrentModelPrivate))
 typedef struct _TrgTorrentModelPrivate TrgTorrentModelPrivate;
 
+/* One per client feeding the model. The main connection's table is the
+ * model's own (get_torrent_table()), the others are made by
+ * trg_torrent_model_add_source().
+ *
+ * The shadow is the worker's copy of what the rows hold, keyed by
+ * &t->id, which it diffs updates against. It and the generation are only
+ * touched with the model's lock held. */
+typedef struct {
+    TrgTorrentModel *model;
+    TrgClient *client;
+    gchar *name;
+    GHashTable *ht;
+    gboolean ownTable;
+    GHashTable *shadow;
+    guint generation;
+    gint64 downRateTotal;
+    gint64 upRateTotal;
+} trg_torrent_model_source;
+
+/* The ID tables map &row->id to the row. */
+typedef struct {
+    gint64 id;
+    trg_torrent *t;
+    trg_torrent_model_source *src;
+    gchar *downloadDirShort;
+    gchar *peerSources;
+    gint64 serial;
+    guint index;
+    gboolean removed;
+} trg_torrent_row;
+
 struct _TrgTorrentModelPrivate {
+    GPtrArray *rows;
+    gint stamp;
     GHashTable *ht;
-    GRegex *urlHostRegex;
+    GHashTable *sources;
     trg_torrent_model_update_stats stats;
+    gint64 detailsId;
+    TrgClient *staleClient;
+    GMutex lock;
+    GThreadPool *pool;
+    guint generations;
+    GQueue *pending;
+    guint applyId;
+    gboolean applying;
+    /* While sweep() compacts the array, the slots it has emptied, which
+     * the views don't see. Rows past them still have their old index. */
+    guint gapStart;
+    guint gapLen;
+};
+
+/* One torrent in a change list, which the row takes over when applied. */
+typedef struct {
+    trg_torrent *t;
+    gchar *peerSources;
+    gboolean shown;
+} trg_torrent_model_change;
+
+struct _trg_torrent_model_changes {
+    TrgTorrentModel *model;
+    TrgClient *client;
+    JsonObject *response;
+    gint mode;
+    gint64 rpcv;
+    gint64 serial;
+    guint generation;
+    GSourceFunc callback;
+    gpointer data;
+
+    /* Filled in by trg_torrent_model_prepare(). */
+    GArray *updates;
+    GArray *removed;
+    gint64 downRateTotal;
+    gint64 upRateTotal;
+    gboolean stale;
+
+    /* As it's applied, which may be over several main loop dispatches. */
+    guint applied;
+    guint whatsChanged;
+    gint64 applyTime;
+    trg_torrent_model_update_stats *stats;
 };
 
+static GType column_types[TORRENT_COLUMN_COLUMNS];
+
+static void trg_torrent_row_free(trg_torrent_row * row)
+{
+    trg_torrent_unref(row->t);
+    g_free(row->downloadDirShort);
+    g_free(row->peerSources);
+    g_slice_free(trg_torrent_row, row);
+}
+
+static void trg_torrent_model_source_free(gpointer data)
+{
+    trg_torrent_model_source *src = (trg_torrent_model_source *) data;
+
+    if (src->ownTable)
+        g_hash_table_destroy(src->ht);
+
+    g_hash_table_destroy(src->shadow);
+    g_free(src->name);
+    g_free(src);
+}
+
 static void trg_torrent_model_dispose(GObject * object)
 {
     TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(object);
-    g_hash_table_destroy(priv->ht);
+
+    if (priv->pool) {
+        g_thread_pool_free(priv->pool, FALSE, TRUE);
+        priv->pool = NULL;
+    }
+
+    /* Each change list holds a reference, so there are none left. */
+    if (priv->pending) {
+        g_queue_free(priv->pending);
+        priv->pending = NULL;
+    }
+
+    if (priv->rows) {
+        g_hash_table_destroy(priv->sources);
+        g_hash_table_destroy(priv->ht);
+        g_ptr_array_foreach(priv->rows, (GFunc) trg_torrent_row_free,
+                            NULL);
+        g_ptr_array_free(priv->rows, TRUE);
+        priv->rows = NULL;
+        g_mutex_clear(&priv->lock);
+    }
+
     G_OBJECT_CLASS(trg_torrent_model_parent_class)->dispose(object);
 }
 
 static void
-update_torrent_iter(TrgTorrentModel * model, TrgClient * tc, gint64 rpcv,
-                    gint64 serial, GtkTreeIter * iter, JsonObject * t,
-                    trg_torrent_model_update_stats * stats,
-                    guint * whatsChanged);
+update_torrent_row(TrgTorrentModel * model, trg_torrent_row * row,
+                   gint64 serial, trg_torrent_model_change * change,
+                   guint * whatsChanged);
 
 static void trg_torrent_model_class_init(TrgTorrentModelClass * klass)
 {
@@ -147,71 +306,44 @@ static void trg_torrent_model_class_init(TrgTorrentModelClass * klass)
                                                  g_cclosure_marshal_VOID__UINT,
                                                  G_TYPE_NONE, 1,
                                                  G_TYPE_UINT);
-}
-
-trg_torrent_model_update_stats *trg_torrent_model_get_stats(TrgTorrentModel
-                                                            * model)
-{
-    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
-    return &(priv->stats);
-}
-
-static void
-trg_torrent_model_count_peers(TrgTorrentModel * model,
-                              GtkTreeIter * iter, JsonObject * t)
-{
-    GList *trackersList =
-        json_array_get_elements(torrent_get_tracker_stats(t));
-    gint64 seeders = 0;
-    gint64 leechers = 0;
-    gint64 downloads = 0;
-    GList *li;
-
-    for (li = trackersList; li; li = g_list_next(li)) {
-        JsonObject *tracker = json_node_get_object((JsonNode *) li->data);
-
-        seeders += tracker_stats_get_seeder_count(tracker);
-        leechers += tracker_stats_get_leecher_count(tracker);
-        downloads += tracker_stats_get_download_count(tracker);
-    }
-
-    g_list_free(trackersList);
-
-    gtk_list_store_set(GTK_LIST_STORE(model), iter, TORRENT_COLUMN_SEEDS,
-                       seeders, TORRENT_COLUMN_LEECHERS, leechers,
-                       TORRENT_COLUMN_DOWNLOADS, downloads, -1);
-}
-
-static void trg_torrent_model_ref_free(gpointer data)
-{
-    GtkTreeRowReference *rr = (GtkTreeRowReference *) data;
-    GtkTreeModel *model = gtk_tree_row_reference_get_model(rr);
-    GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
-    if (path) {
-        GtkTreeIter iter;
-        JsonObject *json;
-        if (gtk_tree_model_get_iter(model, &iter, path)) {
-            gtk_tree_model_get(model, &iter, TORRENT_COLUMN_JSON, &json,
-                               -1);
-            json_object_unref(json);
-            g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS,
-                              GINT_TO_POINTER(TRUE));
-            gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
-            g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS,
-                              GINT_TO_POINTER(FALSE));
-        }
-
-        gtk_tree_path_free(path);
-    }
-
-    gtk_tree_row_reference_free(rr);
-}
 
-static void trg_torrent_model_init(TrgTorrentModel * self)
-{
-    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(self);
+    signals[TMODEL_APPLY_STARTED] = g_signal_new("apply-started",
+                                                 G_TYPE_FROM_CLASS
+                                                 (object_class),
+                                                 G_SIGNAL_RUN_LAST |
+                                                 G_SIGNAL_ACTION,
+                                                 G_STRUCT_OFFSET
+                                                 (TrgTorrentModelClass,
+                                                  apply_started), NULL,
+                                                 NULL,
+                                                 g_cclosure_marshal_VOID__POINTER,
+                                                 G_TYPE_NONE, 1,
+                                                 G_TYPE_POINTER);
 
-    GType column_types[TORRENT_COLUMN_COLUMNS];
+    signals[TMODEL_APPLY_PROGRESS] = g_signal_new("apply-progress",
+                                                  G_TYPE_FROM_CLASS
+                                                  (object_class),
+                                                  G_SIGNAL_RUN_LAST |
+                                                  G_SIGNAL_ACTION,
+                                                  G_STRUCT_OFFSET
+                                                  (TrgTorrentModelClass,
+                                                   apply_progress), NULL,
+                                                  NULL,
+                                                  g_cclosure_marshal_VOID__POINTER,
+                                                  G_TYPE_NONE, 1,
+                                                  G_TYPE_POINTER);
+
+    signals[TMODEL_APPLY_FINISHED] = g_signal_new("apply-finished",
+                                                  G_TYPE_FROM_CLASS
+                                                  (object_class),
+                                                  G_SIGNAL_RUN_LAST |
+                                                  G_SIGNAL_ACTION,
+                                                  G_STRUCT_OFFSET
+                                                  (TrgTorrentModelClass,
+                                                   apply_finished), NULL,
+                                                  NULL,
+                                                  g_cclosure_marshal_VOID__VOID,
+                                                  G_TYPE_NONE, 0);
 
     column_types[TORRENT_COLUMN_ICON] = G_TYPE_STRING;
     column_types[TORRENT_COLUMN_NAME] = G_TYPE_STRING;
@@ -234,7 +366,7 @@ static void trg_torrent_model_init(TrgTorrentModel * self)
     column_types[TORRENT_COLUMN_HAVE_VALID] = G_TYPE_INT64;
     column_types[TORRENT_COLUMN_RATIO] = G_TYPE_DOUBLE;
     column_types[TORRENT_COLUMN_ID] = G_TYPE_INT64;
-    column_types[TORRENT_COLUMN_JSON] = G_TYPE_POINTER;
+    column_types[TORRENT_COLUMN_TORRENT] = G_TYPE_POINTER;
     column_types[TORRENT_COLUMN_UPDATESERIAL] = G_TYPE_INT64;
     column_types[TORRENT_COLUMN_FLAGS] = G_TYPE_INT;
     column_types[TORRENT_COLUMN_DOWNLOADDIR] = G_TYPE_STRING;
@@ -258,114 +390,644 @@ static void trg_torrent_model_init(TrgTorrentModel * self)
     column_types[TORRENT_COLUMN_QUEUE_POSITION] = G_TYPE_INT64;
     column_types[TORRENT_COLUMN_LASTACTIVE] = G_TYPE_INT64;
     column_types[TORRENT_COLUMN_FILECOUNT] = G_TYPE_UINT;
+    column_types[TORRENT_COLUMN_CLIENT] = G_TYPE_POINTER;
+    column_types[TORRENT_COLUMN_SOURCE] = G_TYPE_STRING;
+}
 
-    gtk_list_store_set_column_types(GTK_LIST_STORE(self),
-                                    TORRENT_COLUMN_COLUMNS, column_types);
+trg_torrent_model_update_stats *trg_torrent_model_get_stats(TrgTorrentModel
+                                                            * model)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    return &(priv->stats);
+}
+
+static inline void
+trg_torrent_model_row_iter(TrgTorrentModel * model, trg_torrent_row * row,
+                           GtkTreeIter * iter)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
 
-    priv->ht = g_hash_table_new_full(g_int64_hash, g_int64_equal,
-                                     (GDestroyNotify) g_free,
-                                     trg_torrent_model_ref_free);
+    iter->stamp = priv->stamp;
+    iter->user_data = row;
+    iter->user_data2 = NULL;
+    iter->user_data3 = NULL;
+}
 
-    g_object_set_data(G_OBJECT(self), PROP_REMOVE_IN_PROGRESS,
-                      GINT_TO_POINTER(FALSE));
+static inline trg_torrent_row *trg_torrent_model_iter_row(GtkTreeModel *
+                                                          model,
+                                                          GtkTreeIter *
+                                                          iter)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+
+    g_return_val_if_fail(iter->stamp == priv->stamp, NULL);
 
-    priv->urlHostRegex = trg_uri_host_regex_new();
+    return (trg_torrent_row *) iter->user_data;
 }
 
-gboolean trg_torrent_model_is_remove_in_progress(TrgTorrentModel * model)
+/* A row's position as the views see it, allowing for the gap sweep()
+ * leaves in the array while it works. */
+static inline gint
+trg_torrent_model_row_pos(TrgTorrentModelPrivate * priv,
+                          trg_torrent_row * row)
 {
-    return (gboolean) GPOINTER_TO_INT(g_object_get_data
-                                      (G_OBJECT(model),
-                                       PROP_REMOVE_IN_PROGRESS));
+    if (priv->gapLen > 0 && row->index >= priv->gapStart)
+        return (gint) (row->index - priv->gapLen);
+
+    return (gint) row->index;
+}
+
+static inline gboolean
+trg_torrent_model_nth_iter(GtkTreeModel * model, gint n,
+                           GtkTreeIter * iter)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+
+    if (n >= 0 && (guint) n >= priv->gapStart)
+        n += priv->gapLen;
+
+    if (n < 0 || (guint) n >= priv->rows->len)
+        return FALSE;
+
+    trg_torrent_model_row_iter(TRG_TORRENT_MODEL(model),
+                               g_ptr_array_index(priv->rows, n), iter);
+
+    return TRUE;
+}
+
+static void
+trg_torrent_model_row_changed(TrgTorrentModel * model,
+                              trg_torrent_row * row)
+{
+    GtkTreePath *path =
+        gtk_tree_path_new_from_indices(trg_torrent_model_row_pos
+                                       (TRG_TORRENT_MODEL_GET_PRIVATE
+                                        (model), row), -1);
+    GtkTreeIter iter;
+
+    trg_torrent_model_row_iter(model, row, &iter);
+    gtk_tree_model_row_changed(GTK_TREE_MODEL(model), path, &iter);
+    gtk_tree_path_free(path);
+}
+
+/* GtkTreeModel */
+
+static GtkTreeModelFlags trg_torrent_model_get_flags(GtkTreeModel *
+                                                     model G_GNUC_UNUSED)
+{
+    return GTK_TREE_MODEL_ITERS_PERSIST | GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint trg_torrent_model_get_n_columns(GtkTreeModel *
+                                            model G_GNUC_UNUSED)
+{
+    return TORRENT_COLUMN_COLUMNS;
+}
+
+static GType trg_torrent_model_get_column_type(GtkTreeModel *
+                                               model G_GNUC_UNUSED,
+                                               gint index)
+{
+    g_return_val_if_fail(index >= 0
+                         && index < TORRENT_COLUMN_COLUMNS, G_TYPE_INVALID);
+
+    return column_types[index];
+}
+
+static gboolean
+trg_torrent_model_get_iter(GtkTreeModel * model, GtkTreeIter * iter,
+                           GtkTreePath * path)
+{
+    if (gtk_tree_path_get_depth(path) != 1)
+        return FALSE;
+
+    return trg_torrent_model_nth_iter(model,
+                                      gtk_tree_path_get_indices(path)[0],
+                                      iter);
+}
+
+static GtkTreePath *trg_torrent_model_get_path(GtkTreeModel * model,
+                                               GtkTreeIter * iter)
+{
+    trg_torrent_row *row = trg_torrent_model_iter_row(model, iter);
+
+    g_return_val_if_fail(row != NULL, NULL);
+
+    return
+        gtk_tree_path_new_from_indices(trg_torrent_model_row_pos
+                                       (TRG_TORRENT_MODEL_GET_PRIVATE
+                                        (model), row), -1);
+}
+
+static void
+trg_torrent_model_get_value(GtkTreeModel * model, GtkTreeIter * iter,
+                            gint column, GValue * value)
+{
+    trg_torrent_row *row = trg_torrent_model_iter_row(model, iter);
+    trg_torrent *t;
+
+    g_return_if_fail(row != NULL);
+    g_return_if_fail(column >= 0 && column < TORRENT_COLUMN_COLUMNS);
+
+    t = row->t;
+    g_value_init(value, column_types[column]);
+
+    switch (column) {
+    case TORRENT_COLUMN_ICON:
+        g_value_set_static_string(value, t->statusIcon);
+        break;
+    case TORRENT_COLUMN_NAME:
+        g_value_set_string(value, t->name);
+        break;
+    case TORRENT_COLUMN_SIZEWHENDONE:
+        g_value_set_int64(value, t->sizeWhenDone);
+        break;
+    case TORRENT_COLUMN_PERCENTDONE:
+        g_value_set_double(value, (t->flags & TORRENT_FLAG_CHECKING) ?
+                           t->recheckProgress : t->percentDone);
+        break;
+    case TORRENT_COLUMN_METADATAPERCENTCOMPLETE:
+        g_value_set_double(value, t->metadataPercentComplete);
+        break;
+    case TORRENT_COLUMN_STATUS:
+        g_value_set_static_string(value, t->statusString);
+        break;
+    case TORRENT_COLUMN_SEEDS:
+        g_value_set_int64(value, t->seeders);
+        break;
+    case TORRENT_COLUMN_LEECHERS:
+        g_value_set_int64(value, t->leechers);
+        break;
+    case TORRENT_COLUMN_DOWNLOADS:
+        g_value_set_int64(value, t->downloads);
+        break;
+    case TORRENT_COLUMN_PEERS_CONNECTED:
+        g_value_set_int64(value, t->peersConnected);
+        break;
+    case TORRENT_COLUMN_PEERS_FROM_US:
+        g_value_set_int64(value, t->peersGettingFromUs);
+        break;
+    case TORRENT_COLUMN_WEB_SEEDS_TO_US:
+        g_value_set_int64(value, t->webSeedsSendingToUs);
+        break;
+    case TORRENT_COLUMN_PEERS_TO_US:
+        g_value_set_int64(value, t->peersSendingToUs);
+        break;
+    case TORRENT_COLUMN_DOWNSPEED:
+        g_value_set_int64(value, t->rateDownload);
+        break;
+    case TORRENT_COLUMN_UPSPEED:
+        g_value_set_int64(value, t->rateUpload);
+        break;
+    case TORRENT_COLUMN_ETA:
+        g_value_set_int64(value, t->eta);
+        break;
+    case TORRENT_COLUMN_UPLOADED:
+        g_value_set_int64(value, t->uploadedEver);
+        break;
+    case TORRENT_COLUMN_DOWNLOADED:
+        g_value_set_int64(value, t->downloadedEver);
+        break;
+    case TORRENT_COLUMN_TOTALSIZE:
+        g_value_set_int64(value, t->totalSize);
+        break;
+    case TORRENT_COLUMN_HAVE_UNCHECKED:
+        g_value_set_int64(value, t->haveUnchecked);
+        break;
+    case TORRENT_COLUMN_HAVE_VALID:
+        g_value_set_int64(value, t->haveValid);
+        break;
+    case TORRENT_COLUMN_RATIO:
+        g_value_set_double(value, t->uploadedEver > 0 && t->haveValid > 0 ?
+                           (double) t->uploadedEver /
+                           (double) t->haveValid : 0);
+        break;
+    case TORRENT_COLUMN_ADDED:
+        g_value_set_int64(value, t->addedDate);
+        break;
+    case TORRENT_COLUMN_ID:
+        g_value_set_int64(value, t->id);
+        break;
+    case TORRENT_COLUMN_TORRENT:
+        g_value_set_pointer(value, t);
+        break;
+    case TORRENT_COLUMN_UPDATESERIAL:
+        g_value_set_int64(value, row->serial);
+        break;
+    case TORRENT_COLUMN_FLAGS:
+        g_value_set_int(value, t->flags);
+        break;
+    case TORRENT_COLUMN_DOWNLOADDIR:
+        /* Interned, so never freed. */
+        g_value_set_static_string(value, t->downloadDir);
+        break;
+    case TORRENT_COLUMN_DOWNLOADDIR_SHORT:
+        g_value_set_string(value, row->downloadDirShort);
+        break;
+    case TORRENT_COLUMN_BANDWIDTH_PRIORITY:
+        g_value_set_int64(value, t->bandwidthPriority);
+        break;
+    case TORRENT_COLUMN_DONE_DATE:
+        g_value_set_int64(value, t->doneDate);
+        break;
+    case TORRENT_COLUMN_FROMPEX:
+        g_value_set_int64(value, t->fromPex);
+        break;
+    case TORRENT_COLUMN_FROMDHT:
+        g_value_set_int64(value, t->fromDht);
+        break;
+    case TORRENT_COLUMN_FROMTRACKERS:
+        g_value_set_int64(value, t->fromTrackers);
+        break;
+    case TORRENT_COLUMN_FROMLTEP:
+        g_value_set_int64(value, t->fromLtep);
+        break;
+    case TORRENT_COLUMN_FROMRESUME:
+        g_value_set_int64(value, t->fromResume);
+        break;
+    case TORRENT_COLUMN_FROMINCOMING:
+        g_value_set_int64(value, t->fromIncoming);
+        break;
+    case TORRENT_COLUMN_PEER_SOURCES:
+        g_value_set_string(value, row->peerSources);
+        break;
+    case TORRENT_COLUMN_TRACKERHOST:
+        g_value_set_static_string(value,
+                                  t->trackerHost ? t->trackerHost : "");
+        break;
+    case TORRENT_COLUMN_QUEUE_POSITION:
+        g_value_set_int64(value, t->queuePosition);
+        break;
+    case TORRENT_COLUMN_LASTACTIVE:
+        g_value_set_int64(value, t->activityDate);
+        break;
+    case TORRENT_COLUMN_FILECOUNT:
+        g_value_set_uint(value, t->fileCount);
+        break;
+    case TORRENT_COLUMN_ERROR:
+        g_value_set_int64(value, t->error);
+        break;
+    case TORRENT_COLUMN_SEED_RATIO_MODE:
+        g_value_set_int64(value, t->seedRatioMode);
+        break;
+    case TORRENT_COLUMN_SEED_RATIO_LIMIT:
+        g_value_set_double(value, t->seedRatioLimit);
+        break;
+    case TORRENT_COLUMN_CLIENT:
+        g_value_set_pointer(value, row->src->client);
+        break;
+    case TORRENT_COLUMN_SOURCE:
+        g_value_set_string(value, row->src->name);
+        break;
+    }
 }
 
 static gboolean
-trg_torrent_model_reload_dir_aliases_foreachfunc(GtkTreeModel * model,
-                                                 GtkTreePath *
-                                                 path G_GNUC_UNUSED,
-                                                 GtkTreeIter * iter,
-                                                 gpointer gdata)
+trg_torrent_model_iter_next(GtkTreeModel * model, GtkTreeIter * iter)
 {
-    gchar *downloadDir, *shortDownloadDir;
+    trg_torrent_row *row = trg_torrent_model_iter_row(model, iter);
+
+    g_return_val_if_fail(row != NULL, FALSE);
 
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_DOWNLOADDIR,
-                       &downloadDir, -1);
+    return trg_torrent_model_nth_iter(model,
+                                      trg_torrent_model_row_pos
+                                      (TRG_TORRENT_MODEL_GET_PRIVATE
+                                       (model), row) + 1, iter);
+}
 
-    shortDownloadDir =
-        shorten_download_dir((TrgClient *) gdata, downloadDir);
+static gboolean
+trg_torrent_model_iter_nth_child(GtkTreeModel * model, GtkTreeIter * iter,
+                                 GtkTreeIter * parent, gint n)
+{
+    if (parent)
+        return FALSE;
 
-    gtk_list_store_set(GTK_LIST_STORE(model), iter,
-                       TORRENT_COLUMN_DOWNLOADDIR_SHORT, shortDownloadDir,
-                       -1);
+    return trg_torrent_model_nth_iter(model, n, iter);
+}
 
-    g_free(downloadDir);
-    g_free(shortDownloadDir);
+static gboolean
+trg_torrent_model_iter_children(GtkTreeModel * model, GtkTreeIter * iter,
+                                GtkTreeIter * parent)
+{
+    return trg_torrent_model_iter_nth_child(model, iter, parent, 0);
+}
 
+static gboolean
+trg_torrent_model_iter_has_child(GtkTreeModel * model G_GNUC_UNUSED,
+                                 GtkTreeIter * iter G_GNUC_UNUSED)
+{
     return FALSE;
 }
 
-void
-trg_torrent_model_reload_dir_aliases(TrgClient * tc, GtkTreeModel * model)
+static gint
+trg_torrent_model_iter_n_children(GtkTreeModel * model, GtkTreeIter * iter)
 {
-    gtk_tree_model_foreach(model,
-                           trg_torrent_model_reload_dir_aliases_foreachfunc,
-                           tc);
-    g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0,
-                  TORRENT_UPDATE_PATH_CHANGE);
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+
+    return iter ? 0 : (gint) (priv->rows->len - priv->gapLen);
 }
 
 static gboolean
-trg_torrent_model_stats_scan_foreachfunc(GtkTreeModel *
-                                         model,
-                                         GtkTreePath *
-                                         path
-                                         G_GNUC_UNUSED,
-                                         GtkTreeIter * iter,
-                                         gpointer gdata)
+trg_torrent_model_iter_parent(GtkTreeModel * model G_GNUC_UNUSED,
+                              GtkTreeIter * iter G_GNUC_UNUSED,
+                              GtkTreeIter * child G_GNUC_UNUSED)
+{
+    return FALSE;
+}
+
+static void trg_torrent_model_tree_model_init(GtkTreeModelIface * iface)
+{
+    iface->get_flags = trg_torrent_model_get_flags;
+    iface->get_n_columns = trg_torrent_model_get_n_columns;
+    iface->get_column_type = trg_torrent_model_get_column_type;
+    iface->get_iter = trg_torrent_model_get_iter;
+    iface->get_path = trg_torrent_model_get_path;
+    iface->get_value = trg_torrent_model_get_value;
+    iface->iter_next = trg_torrent_model_iter_next;
+    iface->iter_children = trg_torrent_model_iter_children;
+    iface->iter_has_child = trg_torrent_model_iter_has_child;
+    iface->iter_n_children = trg_torrent_model_iter_n_children;
+    iface->iter_nth_child = trg_torrent_model_iter_nth_child;
+    iface->iter_parent = trg_torrent_model_iter_parent;
+}
+
+static GHashTable *trg_torrent_model_shadow_new(void)
 {
-    trg_torrent_model_update_stats *stats =
-        (trg_torrent_model_update_stats *) gdata;
-    guint flags;
+    return g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                 (GDestroyNotify) trg_torrent_unref);
+}
+
+/* Only the main thread adds or removes sources, so it can look them up
+ * without the lock, but the worker can't. */
+static trg_torrent_model_source *trg_torrent_model_get_source(TrgTorrentModel
+                                                              * model,
+                                                              TrgClient *
+                                                              tc)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src = g_hash_table_lookup(priv->sources, tc);
+
+    if (!src) {
+        src = g_new0(trg_torrent_model_source, 1);
+        src->model = model;
+        src->client = tc;
+        src->ht = priv->ht;
+        src->shadow = trg_torrent_model_shadow_new();
+
+        g_mutex_lock(&priv->lock);
+        src->generation = ++priv->generations;
+        g_hash_table_insert(priv->sources, tc, src);
+        g_mutex_unlock(&priv->lock);
+    }
+
+    /* The profile name, which is shown for the rows from this client. */
+    g_free(src->name);
+    src->name = trg_prefs_get_string(trg_client_get_prefs(tc),
+                                     TRG_PREFS_KEY_PROFILE_NAME,
+                                     TRG_PREFS_CONNECTION);
+
+    return src;
+}
 
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_FLAGS, &flags, -1);
+static void trg_torrent_model_init(TrgTorrentModel * self)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(self);
 
+    priv->rows = g_ptr_array_new();
+    priv->stamp = g_random_int();
+    priv->ht = g_hash_table_new(g_int64_hash, g_int64_equal);
+    g_mutex_init(&priv->lock);
+    priv->pending = g_queue_new();
+    priv->sources = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                          NULL,
+                                          trg_torrent_model_source_free);
+
+    g_object_set_data(G_OBJECT(self), PROP_REMOVE_IN_PROGRESS,
+                      GINT_TO_POINTER(FALSE));
+
+    priv->detailsId = -1;
+}
+
+gboolean trg_torrent_model_is_remove_in_progress(TrgTorrentModel * model)
+{
+    return (gboolean) GPOINTER_TO_INT(g_object_get_data
+                                      (G_OBJECT(model),
+                                       PROP_REMOVE_IN_PROGRESS));
+}
+
+/* Count a row in (delta 1) or out (delta -1) of the state counts, by its
+ * flags. Rows are counted in as they're added or change state, and out as
+ * they change state or are swept, so the counts are always for the rows in
+ * the model without ever going through them all. */
+static void
+trg_torrent_model_stats_count(trg_torrent_model_update_stats * stats,
+                              guint flags, gint delta)
+{
     if (flags & TORRENT_FLAG_SEEDING)
-        stats->seeding++;
+        stats->seeding += delta;
     else if (flags & TORRENT_FLAG_DOWNLOADING)
-        stats->down++;
+        stats->down += delta;
     else if (flags & TORRENT_FLAG_PAUSED)
-        stats->paused++;
+        stats->paused += delta;
 
     if (flags & TORRENT_FLAG_ERROR)
-        stats->error++;
+        stats->error += delta;
 
     if (flags & TORRENT_FLAG_COMPLETE)
-        stats->complete++;
+        stats->complete += delta;
     else
-        stats->incomplete++;
+        stats->incomplete += delta;
 
     if (flags & TORRENT_FLAG_CHECKING)
-        stats->checking++;
+        stats->checking += delta;
 
     if (flags & TORRENT_FLAG_ACTIVE)
-        stats->active++;
+        stats->active += delta;
 
     if (flags & TORRENT_FLAG_SEEDING_WAIT)
-        stats->seed_wait++;
+        stats->seed_wait += delta;
 
     if (flags & TORRENT_FLAG_DOWNLOADING_WAIT)
-        stats->down_wait++;
+        stats->down_wait += delta;
 
-    stats->count++;
+    stats->count += delta;
+}
 
-    return FALSE;
+/* Take the rows marked as removed out of the array, telling the views about
+ * each as it goes, in one pass. The rows kept are moved down over the ones
+ * taken out, which leaves a gap between those done and those still to go.
+ * The iter and path functions skip that, so the model is already as each
+ * row-deleted says when it's emitted, at the position the row now has. The
+ * caller has already taken them out of their ID table. */
+static gboolean trg_torrent_model_sweep(TrgTorrentModel * model)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    GPtrArray *rows = priv->rows;
+    gboolean any = FALSE;
+    guint i, kept = 0;
+
+    for (i = 0; i < rows->len; i++) {
+        trg_torrent_row *row = g_ptr_array_index(rows, i);
+        GtkTreePath *path;
+
+        if (!row->removed) {
+            if (kept != i) {
+                g_ptr_array_index(rows, kept) = row;
+                row->index = kept;
+            }
+            priv->gapStart = ++kept;
+            continue;
+        }
+
+        if (!any) {
+            g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS,
+                              GINT_TO_POINTER(TRUE));
+            any = TRUE;
+        }
+
+        priv->gapStart = kept;
+        priv->gapLen = i + 1 - kept;
+
+        trg_torrent_model_stats_count(&priv->stats, row->t->flags, -1);
+
+        path = gtk_tree_path_new_from_indices(kept, -1);
+        gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+        gtk_tree_path_free(path);
+
+        trg_torrent_row_free(row);
+    }
+
+    g_ptr_array_set_size(rows, kept);
+    priv->gapStart = 0;
+    priv->gapLen = 0;
+
+    if (any)
+        g_object_set_data(G_OBJECT(model), PROP_REMOVE_IN_PROGRESS,
+                          GINT_TO_POINTER(FALSE));
+
+    return any;
+}
+
+void
+trg_torrent_model_reload_dir_aliases(TrgClient * tc, GtkTreeModel * model)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    guint i;
+
+    for (i = 0; i < priv->rows->len; i++) {
+        trg_torrent_row *row = g_ptr_array_index(priv->rows, i);
+
+        g_free(row->downloadDirShort);
+        row->downloadDirShort = shorten_download_dir(tc, row->t->downloadDir);
+        trg_torrent_model_row_changed(TRG_TORRENT_MODEL(model), row);
+    }
+
+    g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0,
+                  TORRENT_UPDATE_PATH_CHANGE);
 }
 
 void trg_torrent_model_remove_all(TrgTorrentModel * model)
 {
     TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    GHashTableIter hiter;
+    gpointer value;
+    guint i;
+
+    /* Anything still being prepared or applied is for the rows going now,
+     * so give each source a new generation, which makes the rest of it be
+     * dropped. */
+    g_mutex_lock(&priv->lock);
+    g_hash_table_iter_init(&hiter, priv->sources);
+    while (g_hash_table_iter_next(&hiter, NULL, &value)) {
+        trg_torrent_model_source *src = (trg_torrent_model_source *) value;
+        if (src->ownTable)
+            g_hash_table_remove_all(src->ht);
+        g_hash_table_remove_all(src->shadow);
+        src->generation = ++priv->generations;
+        src->downRateTotal = src->upRateTotal = 0;
+    }
+    g_mutex_unlock(&priv->lock);
+
     g_hash_table_remove_all(priv->ht);
-    gtk_list_store_clear(GTK_LIST_STORE(model));
+
+    for (i = 0; i < priv->rows->len; i++)
+        ((trg_torrent_row *) g_ptr_array_index(priv->rows, i))->removed =
+            TRUE;
+
+    trg_torrent_model_sweep(model);
+
+    priv->detailsId = -1;
+    priv->staleClient = NULL;
+}
+
+/* Give another client its own ID table, so its torrents can be merged in
+ * by passing it to trg_torrent_model_update(). */
+void trg_torrent_model_add_source(TrgTorrentModel * model, TrgClient * tc)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src = g_new0(trg_torrent_model_source, 1);
+
+    src->model = model;
+    src->client = tc;
+    src->ht = g_hash_table_new(g_int64_hash, g_int64_equal);
+    src->ownTable = TRUE;
+    src->shadow = trg_torrent_model_shadow_new();
+
+    g_mutex_lock(&priv->lock);
+    src->generation = ++priv->generations;
+    g_hash_table_replace(priv->sources, tc, src);
+    g_mutex_unlock(&priv->lock);
+
+    trg_client_set_torrent_table(tc, src->ht);
+}
+
+static void trg_torrent_model_sum_rates(TrgTorrentModel * model)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    GHashTableIter hiter;
+    gpointer value;
+
+    priv->stats.downRateTotal = priv->stats.upRateTotal = 0;
+
+    g_hash_table_iter_init(&hiter, priv->sources);
+    while (g_hash_table_iter_next(&hiter, NULL, &value)) {
+        trg_torrent_model_source *src = (trg_torrent_model_source *) value;
+        priv->stats.downRateTotal += src->downRateTotal;
+        priv->stats.upRateTotal += src->upRateTotal;
+    }
+}
+
+/* Drop a client added with trg_torrent_model_add_source(), and its rows. */
+void
+trg_torrent_model_remove_source(TrgTorrentModel * model, TrgClient * tc)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src = g_hash_table_lookup(priv->sources, tc);
+    guint i;
+
+    if (!src || !src->ownTable)
+        return;
+
+    g_mutex_lock(&priv->lock);
+    g_hash_table_steal(priv->sources, tc);
+    g_mutex_unlock(&priv->lock);
+
+    trg_client_set_torrent_table(tc, NULL);
+    g_hash_table_remove_all(src->ht);
+
+    for (i = 0; i < priv->rows->len; i++) {
+        trg_torrent_row *row = g_ptr_array_index(priv->rows, i);
+        if (row->src == src)
+            row->removed = TRUE;
+    }
+
+    trg_torrent_model_sweep(model);
+    trg_torrent_model_source_free(src);
+
+    trg_torrent_model_sum_rates(model);
+
+    g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0,
+                  TORRENT_UPDATE_ADDREMOVE);
 }
 
 gchar *shorten_download_dir(TrgClient * tc, const gchar * downloadDir)
@@ -375,7 +1037,8 @@ gchar *shorten_download_dir(TrgClient * tc, const gchar * downloadDir)
         trg_prefs_get_array(prefs, TRG_PREFS_KEY_DESTINATIONS,
                             TRG_PREFS_CONNECTION);
     JsonObject *session = trg_client_get_session(tc);
-    const gchar *defaultDownloadDir = session_get_download_dir(session);
+    const gchar *defaultDownloadDir =
+        session ? session_get_download_dir(session) : NULL;
     gchar *shortDownloadDir = NULL;
 
     if (labels) {
@@ -419,240 +1082,139 @@ gchar *shorten_download_dir(TrgClient * tc, const gchar * downloadDir)
     return g_strdup(downloadDir);
 }
 
-static inline void
-update_torrent_iter(TrgTorrentModel * model,
-                    TrgClient * tc, gint64 rpcv,
-                    gint64 serial, GtkTreeIter * iter,
-                    JsonObject * t,
-                    trg_torrent_model_update_stats *
-                    stats, guint * whatsChanged)
+static gchar *trg_torrent_model_peer_sources(trg_torrent * t)
 {
-    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
-    GtkListStore *ls = GTK_LIST_STORE(model);
-    guint lastFlags, newFlags;
-    JsonObject *lastJson, *pf;
-    JsonArray *trackerStats;
-    gchar *statusString, *statusIcon, *downloadDir;
-    gint64 downRate, upRate, haveValid, uploaded, downloaded, id, status,
-        lpd;
-    guint fileCount;
-    gchar *firstTrackerHost = NULL;
-    gchar *peerSources = NULL;
-    gchar *lastDownloadDir = NULL;
-
-    downRate = torrent_get_rate_down(t);
-    stats->downRateTotal += downRate;
-
-    upRate = torrent_get_rate_up(t);
-    stats->upRateTotal += upRate;
-
-    uploaded = torrent_get_uploaded(t);
-    downloaded = torrent_get_downloaded(t);
-    haveValid = torrent_get_have_valid(t);
-
-    downloadDir = (gchar *) torrent_get_download_dir(t);
-    rm_trailing_slashes(downloadDir);
-
-    id = torrent_get_id(t);
-    status = torrent_get_status(t);
-    fileCount = json_array_get_length(torrent_get_files(t));
-    newFlags =
-        torrent_get_flags(t, rpcv, status, fileCount, downRate, upRate);
-    statusString = torrent_get_status_string(rpcv, status, newFlags);
-    statusIcon = torrent_get_status_icon(rpcv, newFlags);
-    pf = torrent_get_peersfrom(t);
-    trackerStats = torrent_get_tracker_stats(t);
-
-    gtk_tree_model_get(GTK_TREE_MODEL(model), iter, TORRENT_COLUMN_FLAGS,
-                       &lastFlags, TORRENT_COLUMN_JSON, &lastJson,
-                       TORRENT_COLUMN_DOWNLOADDIR, &lastDownloadDir, -1);
-
-    json_object_ref(t);
-
-    if (json_array_get_length(trackerStats) > 0) {
-        JsonObject *firstTracker =
-            json_array_get_object_element(trackerStats,
-                                          0);
-        firstTrackerHost = trg_gregex_get_first(priv->urlHostRegex,
-                                                tracker_stats_get_host
-                                                (firstTracker));
-    }
+    if (!(t->flags & TORRENT_FLAG_ACTIVE))
+        return NULL;
+
+    if (t->fromLpd >= 0)
+        return g_strdup_printf("%d / %d / %d / %d / %d / %d / %d",
+                               t->fromTrackers, t->fromIncoming,
+                               t->fromLtep, t->fromDht, t->fromPex,
+                               t->fromLpd, t->fromResume);
+    else
+        return g_strdup_printf("%d / %d / %d / %d / %d / N/A / %d",
+                               t->fromTrackers, t->fromIncoming,
+                               t->fromLtep, t->fromDht, t->fromPex,
+                               t->fromResume);
+}
 
-    lpd = peerfrom_get_lpd(pf);
-    if (newFlags & TORRENT_FLAG_ACTIVE) {
-        if (lpd >= 0) {
-            peerSources =
-                g_strdup_printf("%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                                " / %" G_GINT64_FORMAT " / %"
-                                G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                                " / %" G_GINT64_FORMAT " / %"
-                                G_GINT64_FORMAT, peerfrom_get_trackers(pf),
-                                peerfrom_get_incoming(pf),
-                                peerfrom_get_ltep(pf),
-                                peerfrom_get_dht(pf), peerfrom_get_pex(pf),
-                                lpd, peerfrom_get_resume(pf));
-        } else {
-            peerSources =
-                g_strdup_printf("%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                                " / %" G_GINT64_FORMAT " / %"
-                                G_GINT64_FORMAT " / %" G_GINT64_FORMAT
-                                " / N/A / %" G_GINT64_FORMAT,
-                                peerfrom_get_trackers(pf),
-                                peerfrom_get_incoming(pf),
-                                peerfrom_get_ltep(pf),
-                                peerfrom_get_dht(pf), peerfrom_get_pex(pf),
-                                peerfrom_get_resume(pf));
-        }
+/* Whether anything shown from a row (any column, the fields the cell
+ * renderer reads from the record itself, or the tracker hosts the filter
+ * matches on) differs between two records for
+ * the same torrent. The update serial and the record pointer change on every
+ * poll, but aren't shown, so don't count. The ratio and peer sources are
+ * worked out from fields compared here. Strings which are static or
+ * interned are compared by pointer. */
+static gboolean trg_torrent_model_row_differs(trg_torrent * a,
+                                              trg_torrent * b)
+{
+    return a->flags != b->flags
+        || a->rateDownload != b->rateDownload
+        || a->rateUpload != b->rateUpload
+        || a->eta != b->eta
+        || a->percentDone != b->percentDone
+        || a->recheckProgress != b->recheckProgress
+        || a->metadataPercentComplete != b->metadataPercentComplete
+        || a->haveValid != b->haveValid
+        || a->haveUnchecked != b->haveUnchecked
+        || a->downloadedEver != b->downloadedEver
+        || a->uploadedEver != b->uploadedEver
+        || a->sizeWhenDone != b->sizeWhenDone
+        || a->totalSize != b->totalSize
+        || a->activityDate != b->activityDate
+        || a->peersConnected != b->peersConnected
+        || a->peersSendingToUs != b->peersSendingToUs
+        || a->peersGettingFromUs != b->peersGettingFromUs
+        || a->webSeedsSendingToUs != b->webSeedsSendingToUs
+        || a->fromTrackers != b->fromTrackers
+        || a->fromIncoming != b->fromIncoming
+        || a->fromLtep != b->fromLtep
+        || a->fromDht != b->fromDht
+        || a->fromPex != b->fromPex
+        || a->fromLpd != b->fromLpd
+        || a->fromResume != b->fromResume
+        || a->seeders != b->seeders
+        || a->leechers != b->leechers
+        || a->downloads != b->downloads
+        || a->statusIcon != b->statusIcon
+        || a->statusString != b->statusString
+        || a->downloadDir != b->downloadDir
+        || a->trackerHost != b->trackerHost
+        || a->error != b->error
+        || a->queuePosition != b->queuePosition
+        || a->bandwidthPriority != b->bandwidthPriority
+        || a->seedRatioMode != b->seedRatioMode
+        || a->seedRatioLimit != b->seedRatioLimit
+        || a->fileCount != b->fileCount
+        || a->addedDate != b->addedDate
+        || a->doneDate != b->doneDate
+        || g_strcmp0(a->name, b->name)
+        || g_strcmp0(a->errorString, b->errorString)
+        || !trg_torrent_announce_hosts_equal(a, b);
+}
+
+/* Replace the record a row holds, taking over the change's record and peer
+ * sources. A new row (with no record yet) is left for the caller to announce
+ * with row-inserted, and an existing one only gets row-changed if the worker
+ * found something shown had changed, as each one costs the filter, the sort
+ * and the view. */
+static void
+update_torrent_row(TrgTorrentModel * model, trg_torrent_row * row,
+                   gint64 serial, trg_torrent_model_change * change,
+                   guint * whatsChanged)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src = row->src;
+    trg_torrent *t = change->t;
+    trg_torrent *last = row->t;
+    guint lastFlags = last ? last->flags : 0;
+
+    if (last && t->id == priv->detailsId)
+        trg_torrent_take_details(t, last);
+
+    row->t = t;
+    row->serial = serial;
+    change->t = NULL;
+
+    if (change->shown) {
+        g_free(row->peerSources);
+        row->peerSources = change->peerSources;
+        change->peerSources = NULL;
     }
-#ifdef TRG_DEBUG
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_ICON, statusIcon, -1);
-    gtk_list_store_set(ls, iter,
-                       TORRENT_COLUMN_NAME, torrent_get_name(t), -1);
-    gtk_list_store_set(ls, iter,
-                       TORRENT_COLUMN_SIZEWHENDONE,
-                       torrent_get_size_when_done(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_PERCENTDONE,
-                       (newFlags & TORRENT_FLAG_CHECKING) ?
-                       torrent_get_recheck_progress(t)
-                       : torrent_get_percent_done(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_STATUS, statusString, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_DOWNSPEED, downRate, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_FLAGS, newFlags, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_UPSPEED, upRate, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_ETA, torrent_get_eta(t),
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_UPLOADED, uploaded, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_DOWNLOADED, downloaded,
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_RATIO, uploaded > 0
-                       && downloaded >
-                       0 ? (double) uploaded / (double) downloaded : 0,
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_ID, id, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_JSON, t, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_UPDATESERIAL, serial, -1);
-    gtk_list_store_set(ls, iter,
-                       TORRENT_COLUMN_ADDED, torrent_get_added_date(t),
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_DOWNLOADDIR, downloadDir,
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_PEERS_CONNECTED, torrent_get_peers_connected(t),
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_ETA, torrent_get_eta(t),
-                       -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_BANDWIDTH_PRIORITY,
-                       torrent_get_bandwidth_priority(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_TOTALSIZE,
-                       torrent_get_total_size(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_HAVE_UNCHECKED,
-                       torrent_get_have_unchecked(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_METADATAPERCENTCOMPLETE,
-                       torrent_get_metadata_percent_complete(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_PEERS_TO_US,
-                       torrent_get_peers_sending_to_us(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_PEERS_FROM_US,
-                       torrent_get_peers_getting_from_us(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_WEB_SEEDS_TO_US,
-                       torrent_get_web_seeds_sending_to_us(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_SEED_RATIO_LIMIT,
-                       torrent_get_seed_ratio_limit(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_SEED_RATIO_MODE,
-                       torrent_get_seed_ratio_mode(t), -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_FILECOUNT, fileCount, -1);
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_HAVE_VALID, haveValid, -1);
-#else
-    gtk_list_store_set(ls, iter, TORRENT_COLUMN_ICON, statusIcon,
-                       TORRENT_COLUMN_ADDED, torrent_get_added_date(t),
-                       TORRENT_COLUMN_FILECOUNT,
-                       fileCount,
-                       TORRENT_COLUMN_DONE_DATE, torrent_get_done_date(t),
-                       TORRENT_COLUMN_NAME, torrent_get_name(t),
-                       TORRENT_COLUMN_ERROR, torrent_get_error(t),
-                       TORRENT_COLUMN_SIZEWHENDONE,
-                       torrent_get_size_when_done(t),
-                       TORRENT_COLUMN_PERCENTDONE,
-                       (newFlags & TORRENT_FLAG_CHECKING) ?
-                       torrent_get_recheck_progress(t)
-                       : torrent_get_percent_done(t),
-                       TORRENT_COLUMN_METADATAPERCENTCOMPLETE,
-                       torrent_get_metadata_percent_complete(t),
-                       TORRENT_COLUMN_STATUS, statusString,
-                       TORRENT_COLUMN_DOWNSPEED, downRate,
-                       TORRENT_COLUMN_FLAGS, newFlags,
-                       TORRENT_COLUMN_UPSPEED, upRate, TORRENT_COLUMN_ETA,
-                       torrent_get_eta(t), TORRENT_COLUMN_UPLOADED,
-                       uploaded, TORRENT_COLUMN_DOWNLOADED, downloaded,
-                       TORRENT_COLUMN_TOTALSIZE, torrent_get_total_size(t),
-                       TORRENT_COLUMN_HAVE_UNCHECKED,
-                       torrent_get_have_unchecked(t),
-                       TORRENT_COLUMN_HAVE_VALID, haveValid,
-                       TORRENT_COLUMN_FROMPEX, peerfrom_get_pex(pf),
-                       TORRENT_COLUMN_FROMDHT, peerfrom_get_dht(pf),
-                       TORRENT_COLUMN_FROMTRACKERS,
-                       peerfrom_get_trackers(pf), TORRENT_COLUMN_FROMLTEP,
-                       peerfrom_get_ltep(pf), TORRENT_COLUMN_FROMRESUME,
-                       peerfrom_get_resume(pf),
-                       TORRENT_COLUMN_FROMINCOMING,
-                       peerfrom_get_incoming(pf),
-                       TORRENT_COLUMN_PEER_SOURCES, peerSources,
-                       TORRENT_COLUMN_PEERS_CONNECTED,
-                       torrent_get_peers_connected(t),
-                       TORRENT_COLUMN_PEERS_TO_US,
-                       torrent_get_peers_sending_to_us(t),
-                       TORRENT_COLUMN_PEERS_FROM_US,
-                       torrent_get_peers_getting_from_us(t),
-                       TORRENT_COLUMN_WEB_SEEDS_TO_US,
-                       torrent_get_web_seeds_sending_to_us(t),
-                       TORRENT_COLUMN_QUEUE_POSITION,
-                       torrent_get_queue_position(t),
-                       TORRENT_COLUMN_SEED_RATIO_LIMIT,
-                       torrent_get_seed_ratio_limit(t),
-                       TORRENT_COLUMN_SEED_RATIO_MODE,
-                       torrent_get_seed_ratio_mode(t),
-                       TORRENT_COLUMN_LASTACTIVE,
-                       torrent_get_activity_date(t), TORRENT_COLUMN_RATIO,
-                       uploaded > 0
-                       && haveValid >
-                       0 ? (double) uploaded / (double) haveValid : 0,
-                       TORRENT_COLUMN_DOWNLOADDIR, downloadDir,
-                       TORRENT_COLUMN_BANDWIDTH_PRIORITY,
-                       torrent_get_bandwidth_priority(t),
-                       TORRENT_COLUMN_ID, id, TORRENT_COLUMN_JSON, t,
-                       TORRENT_COLUMN_TRACKERHOST,
-                       firstTrackerHost ? firstTrackerHost : "",
-                       TORRENT_COLUMN_UPDATESERIAL, serial, -1);
-#endif
 
-    if (!lastDownloadDir || g_strcmp0(downloadDir, lastDownloadDir)) {
-        gchar *shortDownloadDir = shorten_download_dir(tc, downloadDir);
-        gtk_list_store_set(ls, iter, TORRENT_COLUMN_DOWNLOADDIR_SHORT,
-                           shortDownloadDir, -1);
-        g_free(shortDownloadDir);
+    /* Interned, so the same directory is the same pointer. */
+    if (!last || t->downloadDir != last->downloadDir) {
+        g_free(row->downloadDirShort);
+        row->downloadDirShort =
+            shorten_download_dir(src->client, t->downloadDir);
         *whatsChanged |= TORRENT_UPDATE_PATH_CHANGE;
     }
 
-    if (lastJson)
-        json_object_unref(lastJson);
+    if (last && !trg_torrent_announce_hosts_equal(t, last))
+        *whatsChanged |= TORRENT_UPDATE_TRACKER_CHANGE;
 
-    if ((lastFlags & TORRENT_FLAG_DOWNLOADING)
-        && (!(newFlags & TORRENT_FLAG_DOWNLOADING))
-        && (newFlags & TORRENT_FLAG_COMPLETE))
-        g_signal_emit(model, signals[TMODEL_TORRENT_COMPLETED], 0, iter);
-
-    if (lastFlags != newFlags)
-        *whatsChanged |= TORRENT_UPDATE_STATE_CHANGE;
+    if (last && change->shown)
+        trg_torrent_model_row_changed(model, row);
 
-    trg_torrent_model_count_peers(model, iter, t);
+    if ((lastFlags & TORRENT_FLAG_DOWNLOADING)
+        && (!(t->flags & TORRENT_FLAG_DOWNLOADING))
+        && (t->flags & TORRENT_FLAG_COMPLETE)) {
+        GtkTreeIter iter;
+        trg_torrent_model_row_iter(model, row, &iter);
+        g_signal_emit(model, signals[TMODEL_TORRENT_COMPLETED], 0, &iter);
+    }
 
-    if (firstTrackerHost)
-        g_free(firstTrackerHost);
+    if (!last || lastFlags != t->flags) {
+        if (last)
+            trg_torrent_model_stats_count(&priv->stats, lastFlags, -1);
+        trg_torrent_model_stats_count(&priv->stats, t->flags, 1);
+    }
 
-    if (peerSources)
-        g_free(peerSources);
+    if (lastFlags != t->flags)
+        *whatsChanged |= TORRENT_UPDATE_STATE_CHANGE;
 
-    g_free(lastDownloadDir);
-    g_free(statusString);
-    g_free(statusIcon);
+    trg_torrent_unref(last);
 }
 
 TrgTorrentModel *trg_torrent_model_new(void)
@@ -660,196 +1222,574 @@ TrgTorrentModel *trg_torrent_model_new(void)
     return g_object_new(TRG_TYPE_TORRENT_MODEL, NULL);
 }
 
-struct TrgModelRemoveData {
-    GList *toRemove;
-    gint64 currentSerial;
-};
-
 GHashTable *get_torrent_table(TrgTorrentModel * model)
 {
     TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
     return priv->ht;
 }
 
-static gboolean
-trg_model_find_removed_foreachfunc(GtkTreeModel * model,
-                                   GtkTreePath *
-                                   path G_GNUC_UNUSED,
-                                   GtkTreeIter * iter, gpointer gdata)
+gboolean
+get_torrent_data(GHashTable * table, gint64 id, trg_torrent ** t,
+                 GtkTreeIter * out_iter)
 {
-    struct TrgModelRemoveData *args = (struct TrgModelRemoveData *) gdata;
-    gint64 rowSerial;
+    trg_torrent_row *row = (trg_torrent_row *) g_hash_table_lookup(table,
+                                                                   &id);
 
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_UPDATESERIAL,
-                       &rowSerial, -1);
+    if (!row)
+        return FALSE;
 
-    if (rowSerial != args->currentSerial) {
-        gint64 *id = g_new(gint64, 1);
-        gtk_tree_model_get(model, iter, TORRENT_COLUMN_ID, id, -1);
-        args->toRemove = g_list_append(args->toRemove, id);
-    }
+    if (out_iter)
+        trg_torrent_model_row_iter(row->src->model, row, out_iter);
+    if (t)
+        *t = row->t;
 
-    return FALSE;
+    return TRUE;
 }
 
-static GList *trg_torrent_model_find_removed(GtkTreeModel * model,
-                                      gint64 currentSerial)
+/* Attach the files/peers/trackers from a torrent_get_details() response to
+ * the torrent in the model, which is where the notebook and dialogs read
+ * them.
+ */
+gboolean
+trg_torrent_model_merge_details(TrgTorrentModel * model,
+                                JsonObject * details)
 {
-    struct TrgModelRemoveData args;
-    args.toRemove = NULL;
-    args.currentSerial = currentSerial;
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    gint64 id = torrent_get_id(details);
+    trg_torrent *t;
 
-    gtk_tree_model_foreach(GTK_TREE_MODEL(model),
-                           trg_model_find_removed_foreachfunc, &args);
+    if (!get_torrent_data(priv->ht, id, &t, NULL))
+        return FALSE;
 
-    return args.toRemove;
+    trg_torrent_set_details(t, details);
+    priv->detailsId = id;
+
+    return TRUE;
 }
 
-gboolean
-get_torrent_data(GHashTable * table, gint64 id, JsonObject ** t,
-                 GtkTreeIter * out_iter)
+static void
+trg_torrent_model_insert(TrgTorrentModel * model,
+                         trg_torrent_model_source * src,
+                         gint64 serial, trg_torrent_model_change * change,
+                         GtkTreeIter * iter, guint * whatsChanged)
 {
-    gpointer result = g_hash_table_lookup(table, &id);
-    gboolean found = FALSE;
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_row *row = g_slice_new0(trg_torrent_row);
+    GtkTreePath *path;
 
-    if (result) {
-        GtkTreeRowReference *rr = (GtkTreeRowReference *) result;
-        GtkTreePath *path = gtk_tree_row_reference_get_path(rr);
-        GtkTreeIter iter;
-        if (path) {
-            GtkTreeModel *model = gtk_tree_row_reference_get_model(rr);
-            gtk_tree_model_get_iter(model, &iter, path);
-            if (out_iter)
-                *out_iter = iter;
-            if (t)
-                gtk_tree_model_get(model, &iter, TORRENT_COLUMN_JSON, t,
-                                   -1);
-            found = TRUE;
-            gtk_tree_path_free(path);
-        }
-    }
+    row->id = change->t->id;
+    row->src = src;
+    row->index = priv->rows->len;
+    g_ptr_array_add(priv->rows, row);
+    g_hash_table_insert(src->ht, &row->id, row);
+    *whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
+
+    update_torrent_row(model, row, serial, change, whatsChanged);
 
-    return found;
+    trg_torrent_model_row_iter(model, row, iter);
+    path = gtk_tree_path_new_from_indices(row->index, -1);
+    gtk_tree_model_row_inserted(GTK_TREE_MODEL(model), path, iter);
+    gtk_tree_path_free(path);
 }
 
-static void
-trg_torrent_model_stat_counts_clear(trg_torrent_model_update_stats * stats)
+/* Fill the model with the main connection's torrents from a snapshot (see
+ * trg_snapshot_load()), before tc is connected. They stay stale until the
+ * first full update from tc. */
+void
+trg_torrent_model_load_snapshot(TrgTorrentModel * model, TrgClient * tc,
+                                JsonArray * torrents, gint64 rpcv)
 {
-    stats->count = stats->down = stats->error = stats->paused =
-        stats->seeding = stats->complete = stats->incomplete =
-        stats->active = stats->checking = stats->seed_wait =
-        stats->down_wait = 0;
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src = trg_torrent_model_get_source(model, tc);
+    GList *torrentList = json_array_get_elements(torrents);
+    GPtrArray *decoded = g_ptr_array_new();
+    guint whatsChanged = 0;
+    GtkTreeIter iter;
+    GList *li;
+    guint i;
+
+    src->downRateTotal = 0;
+    src->upRateTotal = 0;
+
+    for (li = torrentList; li; li = g_list_next(li)) {
+        trg_torrent *t =
+            trg_torrent_new(json_node_get_object((JsonNode *) li->data),
+                            rpcv);
+        src->downRateTotal += t->rateDownload;
+        src->upRateTotal += t->rateUpload;
+        g_ptr_array_add(decoded, t);
+    }
+
+    g_list_free(torrentList);
+
+    /* So the first update is diffed against these, and drops those which
+     * haven't gone as it would for any other full update. */
+    g_mutex_lock(&priv->lock);
+    for (i = 0; i < decoded->len; i++) {
+        trg_torrent *t = g_ptr_array_index(decoded, i);
+        g_hash_table_replace(src->shadow, &t->id, trg_torrent_ref(t));
+    }
+    g_mutex_unlock(&priv->lock);
+
+    for (i = 0; i < decoded->len; i++) {
+        trg_torrent_model_change change;
+
+        change.t = g_ptr_array_index(decoded, i);
+        change.peerSources = trg_torrent_model_peer_sources(change.t);
+        change.shown = TRUE;
+
+        trg_torrent_model_insert(model, src, -1, &change, &iter,
+                                 &whatsChanged);
+    }
+
+    g_ptr_array_free(decoded, TRUE);
+
+    priv->staleClient = tc;
+
+    trg_torrent_model_sum_rates(model);
+
+    g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0,
+                  TORRENT_UPDATE_ADDREMOVE);
 }
 
-trg_torrent_model_update_stats *trg_torrent_model_update(TrgTorrentModel *
-                                                         model,
-                                                         TrgClient * tc,
-                                                         JsonObject *
-                                                         response,
-                                                         gint mode)
+gboolean trg_torrent_model_is_stale(TrgTorrentModel * model)
 {
     TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    return priv->staleClient != NULL;
+}
 
-    GList *torrentList;
-    JsonObject *args, *t;
-    GList *li;
-    gint64 id;
-    gint64 serial = trg_client_get_serial(tc);
-    JsonArray *removedTorrents;
-    GtkTreeIter iter;
-    GtkTreePath *path;
-    GtkTreeRowReference *rr;
-    gpointer *result;
-    guint whatsChanged = 0;
+/* Called on the main thread, so the serial, RPC version and source are
+ * those of the response. */
+static trg_torrent_model_changes *trg_torrent_model_changes_new(TrgTorrentModel
+                                                                * model,
+                                                                TrgClient *
+                                                                tc,
+                                                                JsonObject *
+                                                                response,
+                                                                gint mode,
+                                                                GSourceFunc
+                                                                callback,
+                                                                gpointer
+                                                                data)
+{
+    trg_torrent_model_source *src = trg_torrent_model_get_source(model, tc);
+    trg_torrent_model_changes *changes =
+        g_new0(trg_torrent_model_changes, 1);
+
+    changes->model = g_object_ref(model);
+    changes->client = tc;
+    changes->response = response;
+    changes->mode = mode;
+    changes->rpcv = trg_client_get_rpc_version(tc);
+    changes->serial = trg_client_get_serial(tc);
+    changes->generation = src->generation;
+    changes->callback = callback;
+    changes->data = data;
+    changes->updates = g_array_new(FALSE, FALSE,
+                                   sizeof(trg_torrent_model_change));
+    changes->removed = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+    return changes;
+}
 
-    gint64 rpcv = trg_client_get_rpc_version(tc);
+static void trg_torrent_model_changes_free(trg_torrent_model_changes *
+                                           changes)
+{
+    guint i;
+
+    /* Whatever wasn't applied. */
+    for (i = 0; i < changes->updates->len; i++) {
+        trg_torrent_model_change *change =
+            &g_array_index(changes->updates, trg_torrent_model_change, i);
+        trg_torrent_unref(change->t);
+        g_free(change->peerSources);
+    }
 
-    args = get_arguments(response);
-    torrentList = json_array_get_elements(get_torrents(args));
+    g_array_free(changes->updates, TRUE);
+    g_array_free(changes->removed, TRUE);
+    g_object_unref(changes->model);
+    g_free(changes);
+}
 
-    priv->stats.downRateTotal = 0;
-    priv->stats.upRateTotal = 0;
+gpointer trg_torrent_model_changes_get_data(trg_torrent_model_changes *
+                                            changes)
+{
+    return changes->data;
+}
 
-    for (li = torrentList; li; li = g_list_next(li)) {
-        t = json_node_get_object((JsonNode *) li->data);
-        id = torrent_get_id(t);
+gint trg_torrent_model_changes_get_mode(trg_torrent_model_changes *
+                                        changes)
+{
+    return changes->mode;
+}
+
+/* The model's stats once the list is in, or NULL if it was dropped. */
+trg_torrent_model_update_stats
+    * trg_torrent_model_changes_get_stats(trg_torrent_model_changes *
+                                          changes)
+{
+    return changes->stats;
+}
 
-        result =
-            mode == TORRENT_GET_MODE_FIRST ? NULL :
-            g_hash_table_lookup(priv->ht, &id);
+/* Time spent applying it on the main thread, in microseconds. */
+gint64 trg_torrent_model_changes_get_apply_time(trg_torrent_model_changes *
+                                                changes)
+{
+    return changes->applyTime;
+}
+
+/* How far through applying it is, as torrents applied out of total. */
+void
+trg_torrent_model_changes_get_progress(trg_torrent_model_changes *
+                                       changes, guint * applied,
+                                       guint * total)
+{
+    *applied = changes->applied;
+    *total = changes->updates->len;
+}
+
+/* Decode the response and diff it against the source's shadow, which needs
+ * nothing from the rows, so can run on the worker. Torrents which decode
+ * the same as last time are dropped here, so the main thread never sees
+ * them. A full update replaces the shadow, and whatever was in the old one
+ * but not the new has gone. */
+static void trg_torrent_model_prepare(trg_torrent_model_changes * changes)
+{
+    TrgTorrentModelPrivate *priv =
+        TRG_TORRENT_MODEL_GET_PRIVATE(changes->model);
+    JsonObject *args = get_arguments(changes->response);
+    gboolean full = changes->mode == TORRENT_GET_MODE_FIRST
+        || changes->mode == TORRENT_GET_MODE_UPDATE;
+    GPtrArray *decoded = trg_torrents_decode(get_torrents(args),
+                                             changes->rpcv);
+    trg_torrent_model_source *src;
+    GHashTable *shadow;
+    guint i;
+
+    for (i = 0; i < decoded->len; i++) {
+        trg_torrent *t = g_ptr_array_index(decoded, i);
+        changes->downRateTotal += t->rateDownload;
+        changes->upRateTotal += t->rateUpload;
+    }
+
+    g_mutex_lock(&priv->lock);
+
+    src = g_hash_table_lookup(priv->sources, changes->client);
+    if (!src || src->generation != changes->generation) {
+        g_mutex_unlock(&priv->lock);
+        changes->stale = TRUE;
+        g_ptr_array_foreach(decoded, (GFunc) trg_torrent_unref, NULL);
+        g_ptr_array_free(decoded, TRUE);
+        return;
+    }
+
+    shadow = full ? trg_torrent_model_shadow_new() : src->shadow;
+
+    for (i = 0; i < decoded->len; i++) {
+        trg_torrent *t = g_ptr_array_index(decoded, i);
+        trg_torrent *last = g_hash_table_lookup(src->shadow, &t->id);
+        trg_torrent_model_change change;
+
+        if (last && trg_torrent_equal(last, t)) {
+            if (full)
+                g_hash_table_replace(shadow, &last->id,
+                                     trg_torrent_ref(last));
+            trg_torrent_unref(t);
+            continue;
+        }
+
+        change.t = t;
+        change.shown = !last || trg_torrent_model_row_differs(last, t);
+        change.peerSources =
+            change.shown ? trg_torrent_model_peer_sources(t) : NULL;
+        g_array_append_val(changes->updates, change);
+
+        g_hash_table_replace(shadow, &t->id, trg_torrent_ref(t));
+    }
+
+    g_ptr_array_free(decoded, TRUE);
+
+    if (full) {
+        GHashTableIter hiter;
+        gpointer key;
+
+        g_hash_table_iter_init(&hiter, src->shadow);
+        while (g_hash_table_iter_next(&hiter, &key, NULL))
+            if (!g_hash_table_contains(shadow, key))
+                g_array_append_val(changes->removed, *(gint64 *) key);
+
+        g_hash_table_destroy(src->shadow);
+        src->shadow = shadow;
+    } else {
+        JsonArray *removedTorrents = get_torrents_removed(args);
+        guint n = removedTorrents ? json_array_get_length(removedTorrents)
+            : 0;
+
+        for (i = 0; i < n; i++) {
+            gint64 id = json_array_get_int_element(removedTorrents, i);
+            if (g_hash_table_remove(src->shadow, &id))
+                g_array_append_val(changes->removed, id);
+        }
+    }
+
+    g_mutex_unlock(&priv->lock);
+}
 
-        if (!result) {
-            gint64 *idCopy;
-            gtk_list_store_append(GTK_LIST_STORE(model), &iter);
-            whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
+/* The source a change list is for, or NULL if the rows it was worked out
+ * against have gone since (a disconnect, or the source was removed). */
+static trg_torrent_model_source
+    * trg_torrent_model_changes_source(TrgTorrentModel * model,
+                                       trg_torrent_model_changes * changes)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src =
+        g_hash_table_lookup(priv->sources, changes->client);
+
+    if (changes->stale || !src || src->generation != changes->generation)
+        return NULL;
+
+    return src;
+}
+
+/* Apply a change list's torrents to the rows until budget (microseconds,
+ * or no limit if not positive) is spent. Returns TRUE when there are none
+ * left, or the list has gone stale. The source is looked up again each
+ * time, as it may have gone in between. */
+static gboolean
+trg_torrent_model_apply_step(TrgTorrentModel * model,
+                             trg_torrent_model_changes * changes,
+                             gint64 budget)
+{
+    trg_torrent_model_source *src =
+        trg_torrent_model_changes_source(model, changes);
+    gint64 start = g_get_monotonic_time();
+    GtkTreeIter iter;
 
-            update_torrent_iter(model, tc, rpcv, serial,
-                                &iter, t, &(priv->stats), &whatsChanged);
+    if (!src)
+        return TRUE;
 
-            path = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &iter);
-            rr = gtk_tree_row_reference_new(GTK_TREE_MODEL(model), path);
-            idCopy = g_new(gint64, 1);
-            *idCopy = id;
-            g_hash_table_insert(priv->ht, idCopy, rr);
-            gtk_tree_path_free(path);
+    while (changes->applied < changes->updates->len) {
+        trg_torrent_model_change *change =
+            &g_array_index(changes->updates, trg_torrent_model_change,
+                           changes->applied++);
+        trg_torrent_row *row =
+            (trg_torrent_row *) g_hash_table_lookup(src->ht,
+                                                    &change->t->id);
 
-            if (mode != TORRENT_GET_MODE_FIRST)
+        if (!row) {
+            trg_torrent_model_insert(model, src, changes->serial, change,
+                                     &iter, &changes->whatsChanged);
+
+            if (changes->mode != TORRENT_GET_MODE_FIRST)
                 g_signal_emit(model, signals[TMODEL_TORRENT_ADDED], 0,
                               &iter);
         } else {
-            path = gtk_tree_row_reference_get_path((GtkTreeRowReference *)
-                                                   result);
-            if (path) {
-                if (gtk_tree_model_get_iter(GTK_TREE_MODEL(model), &iter,
-                                            path)) {
-                    update_torrent_iter(model, tc, rpcv,
-                                        serial, &iter,
-                                        t, &(priv->stats), &whatsChanged);
-                }
-                gtk_tree_path_free(path);
-            }
+            update_torrent_row(model, row, changes->serial, change,
+                               &changes->whatsChanged);
         }
+
+        if (budget > 0 && g_get_monotonic_time() - start >= budget)
+            break;
     }
 
-    g_list_free(torrentList);
+    changes->applyTime += g_get_monotonic_time() - start;
 
-    if (mode == TORRENT_GET_MODE_UPDATE) {
-        GList *hitlist =
-            trg_torrent_model_find_removed(GTK_TREE_MODEL(model), serial);
-        if (hitlist) {
-            for (li = hitlist; li; li = g_list_next(li)) {
-                g_hash_table_remove(priv->ht, li->data);
-                g_free(li->data);
-            }
-            whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
-            g_list_free(hitlist);
-        }
-    } else if (mode > TORRENT_GET_MODE_FIRST) {
-        removedTorrents = get_torrents_removed(args);
-        if (removedTorrents) {
-            GList *hitlist = json_array_get_elements(removedTorrents);
-            for (li = hitlist; li; li = g_list_next(li)) {
-                id = json_node_get_int((JsonNode *) li->data);
-                g_hash_table_remove(priv->ht, &id);
-                whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
-            }
-            g_list_free(hitlist);
+    return changes->applied >= changes->updates->len;
+}
+
+/* Once all the torrents are in: the rates, the removals, and the signals
+ * for the whole list. Sets the list's stats unless it went stale. */
+static void
+trg_torrent_model_apply_finish(TrgTorrentModel * model,
+                               trg_torrent_model_changes * changes)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    trg_torrent_model_source *src =
+        trg_torrent_model_changes_source(model, changes);
+    gint64 start = g_get_monotonic_time();
+    /* The first update after loading a snapshot updates its rows in place,
+     * then removes those which have gone, as a normal update would. */
+    gboolean reconcile = changes->mode == TORRENT_GET_MODE_FIRST
+        && priv->staleClient == changes->client;
+    guint i;
+
+    if (!src)
+        return;
+
+    src->downRateTotal = changes->downRateTotal;
+    src->upRateTotal = changes->upRateTotal;
+    trg_torrent_model_sum_rates(model);
+
+    for (i = 0; i < changes->removed->len; i++) {
+        gint64 id = g_array_index(changes->removed, gint64, i);
+        trg_torrent_row *row =
+            (trg_torrent_row *) g_hash_table_lookup(src->ht, &id);
+
+        if (row) {
+            g_hash_table_remove(src->ht, &id);
+            row->removed = TRUE;
         }
     }
 
-    if (whatsChanged != 0) {
-        if ((whatsChanged & TORRENT_UPDATE_ADDREMOVE)
-            || (whatsChanged & TORRENT_UPDATE_STATE_CHANGE)) {
-            trg_torrent_model_stat_counts_clear(&priv->stats);
-            gtk_tree_model_foreach(GTK_TREE_MODEL(model),
-                                   trg_torrent_model_stats_scan_foreachfunc,
-                                   &(priv->stats));
-        }
+    if (changes->removed->len > 0 && trg_torrent_model_sweep(model))
+        changes->whatsChanged |= TORRENT_UPDATE_ADDREMOVE;
+
+    if (changes->mode == TORRENT_GET_MODE_UPDATE || reconcile)
+        priv->staleClient = NULL;
+
+    if (changes->whatsChanged != 0)
         g_signal_emit(model, signals[TMODEL_STATE_CHANGED], 0,
-                      whatsChanged);
-    }
+                      changes->whatsChanged);
 
     g_signal_emit(model, signals[TMODEL_UPDATE], 0);
 
-    return &(priv->stats);
+    changes->applyTime += g_get_monotonic_time() - start;
+    changes->stats = &(priv->stats);
+}
+
+/* How many torrents the queued change lists have still to apply. */
+static guint trg_torrent_model_pending_count(TrgTorrentModelPrivate * priv)
+{
+    guint n = 0;
+    GList *li;
+
+    for (li = priv->pending->head; li; li = g_list_next(li)) {
+        trg_torrent_model_changes *changes =
+            (trg_torrent_model_changes *) li->data;
+        n += changes->updates->len - changes->applied;
+    }
+
+    return n;
+}
+
+/* Works through the queued change lists in order, for up to the budget each
+ * dispatch, at idle priority so redraws come first. A run with enough
+ * torrents queued that it will need several dispatches is bracketed by
+ * "apply-started", before any of it is applied, and "apply-finished", once
+ * the queue is empty, so a view can hold off sorting and filtering until
+ * the end. Each list's callback is called once it's all in. */
+static gboolean trg_torrent_model_apply_idle(gpointer data)
+{
+    TrgTorrentModel *model = TRG_TORRENT_MODEL(data);
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+    gint64 deadline = g_get_monotonic_time() +
+        TRG_TORRENT_MODEL_APPLY_BUDGET;
+    trg_torrent_model_changes *changes;
+
+    /* Held until the queue is done with, as the last list holds the only
+     * other reference. */
+    g_object_ref(model);
+
+    if (!priv->applying
+        && trg_torrent_model_pending_count(priv) >=
+        TRG_TORRENT_MODEL_APPLY_BRACKET) {
+        priv->applying = TRUE;
+        g_signal_emit(model, signals[TMODEL_APPLY_STARTED], 0,
+                      g_queue_peek_head(priv->pending));
+    }
+
+    while ((changes = g_queue_peek_head(priv->pending))) {
+        gint64 left = deadline - g_get_monotonic_time();
+
+        if (left <= 0)
+            break;
+
+        if (!trg_torrent_model_apply_step(model, changes, left))
+            break;
+
+        g_queue_pop_head(priv->pending);
+        trg_torrent_model_apply_finish(model, changes);
+
+        changes->callback(changes);
+        trg_torrent_model_changes_free(changes);
+    }
+
+    if (changes) {
+        g_signal_emit(model, signals[TMODEL_APPLY_PROGRESS], 0, changes);
+        g_object_unref(model);
+        return TRUE;
+    }
+
+    priv->applyId = 0;
+    if (priv->applying) {
+        priv->applying = FALSE;
+        g_signal_emit(model, signals[TMODEL_APPLY_FINISHED], 0);
+    }
+    g_object_unref(model);
+
+    return FALSE;
+}
+
+/* Back from the worker, so queue it to be applied. */
+static gboolean trg_torrent_model_changes_ready(gpointer data)
+{
+    trg_torrent_model_changes *changes =
+        (trg_torrent_model_changes *) data;
+    TrgTorrentModel *model = changes->model;
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+
+    g_queue_push_tail(priv->pending, changes);
+
+    if (!priv->applyId)
+        priv->applyId = g_idle_add(trg_torrent_model_apply_idle, model);
+
+    return FALSE;
+}
+
+static void
+trg_torrent_model_prepare_threadfunc(gpointer data,
+                                     gpointer user_data G_GNUC_UNUSED)
+{
+    trg_torrent_model_changes *changes =
+        (trg_torrent_model_changes *) data;
+
+    trg_torrent_model_prepare(changes);
+    g_idle_add(trg_torrent_model_changes_ready, changes);
+}
+
+/* Decode and diff a torrent-get response on the model's worker, then apply
+ * it on the main thread, a slice at a time (trg_torrent_model_apply_idle()).
+ * callback is then called with the change list, which has the stats and
+ * data; the list is freed when it returns. The response must be kept until
+ * then. There's one worker and one queue, so the lists are applied in the
+ * order they were asked for. */
+void
+trg_torrent_model_prepare_async(TrgTorrentModel * model, TrgClient * tc,
+                                JsonObject * response, gint mode,
+                                GSourceFunc callback, gpointer data)
+{
+    TrgTorrentModelPrivate *priv = TRG_TORRENT_MODEL_GET_PRIVATE(model);
+
+    if (!priv->pool)
+        priv->pool =
+            g_thread_pool_new(trg_torrent_model_prepare_threadfunc, NULL,
+                              1, FALSE, NULL);
+
+    g_thread_pool_push(priv->pool,
+                       trg_torrent_model_changes_new(model, tc, response,
+                                                     mode, callback, data),
+                       NULL);
+}
+
+/* Prepare and apply a response in one go, on the main thread. */
+trg_torrent_model_update_stats *trg_torrent_model_update(TrgTorrentModel *
+                                                         model,
+                                                         TrgClient * tc,
+                                                         JsonObject *
+                                                         response,
+                                                         gint mode)
+{
+    trg_torrent_model_changes *changes =
+        trg_torrent_model_changes_new(model, tc, response, mode, NULL,
+                                      NULL);
+    trg_torrent_model_update_stats *stats;
+
+    trg_torrent_model_prepare(changes);
+    trg_torrent_model_apply_step(model, changes, 0);
+    trg_torrent_model_apply_finish(model, changes);
+
+    stats = changes->stats;
+    trg_torrent_model_changes_free(changes);
+
+    return stats;
 }
@@ -21,9 +21,11 @@
 #define TRG_TORRENT_MODEL_H_
 
 #include <glib-object.h>
+#include <gtk/gtk.h>
 #include <json-glib/json-glib.h>
 
 #include "trg-client.h"
+#include "torrent.h"
 
 G_BEGIN_DECLS
 #define TRG_TYPE_TORRENT_MODEL trg_torrent_model_get_type()
@@ -38,11 +40,11 @@ G_BEGIN_DECLS
 #define TRG_TORRENT_MODEL_GET_CLASS(obj) \
   (G_TYPE_INSTANCE_GET_CLASS ((obj), TRG_TYPE_TORRENT_MODEL, TrgTorrentModelClass))
     typedef struct {
-    GtkListStore parent;
+    GObject parent;
 } TrgTorrentModel;
 
 typedef struct {
-    GtkListStoreClass parent_class;
+    GObjectClass parent_class;
     void (*torrent_completed) (TrgTorrentModel * model,
                                GtkTreeIter * iter, gpointer data);
     void (*update) (TrgTorrentModel * model, gpointer data);
@@ -50,6 +52,12 @@ typedef struct {
                            GtkTreeIter * iter, gpointer data);
 
     void (*torrent_removed) (TrgTorrentModel * model, gpointer data);
+
+    void (*apply_started) (TrgTorrentModel * model, gpointer changes,
+                           gpointer data);
+    void (*apply_progress) (TrgTorrentModel * model, gpointer changes,
+                            gpointer data);
+    void (*apply_finished) (TrgTorrentModel * model, gpointer data);
 } TrgTorrentModelClass;
 
 typedef struct {
@@ -71,6 +79,7 @@ typedef struct {
 #define TORRENT_UPDATE_STATE_CHANGE        (1 << 0)
 #define TORRENT_UPDATE_PATH_CHANGE         (1 << 1)
 #define TORRENT_UPDATE_ADDREMOVE           (1 << 2)
+#define TORRENT_UPDATE_TRACKER_CHANGE      (1 << 3)
 
 GType trg_torrent_model_get_type(void);
 
@@ -87,15 +96,42 @@ trg_torrent_model_update_stats *trg_torrent_model_update(TrgTorrentModel *
                                                          JsonObject *
                                                          response,
                                                          gint mode);
+
+typedef struct _trg_torrent_model_changes trg_torrent_model_changes;
+
+void trg_torrent_model_prepare_async(TrgTorrentModel * model,
+                                     TrgClient * tc, JsonObject * response,
+                                     gint mode, GSourceFunc callback,
+                                     gpointer data);
+gpointer trg_torrent_model_changes_get_data(trg_torrent_model_changes *
+                                            changes);
+gint trg_torrent_model_changes_get_mode(trg_torrent_model_changes *
+                                        changes);
+trg_torrent_model_update_stats
+    * trg_torrent_model_changes_get_stats(trg_torrent_model_changes *
+                                          changes);
+gint64 trg_torrent_model_changes_get_apply_time(trg_torrent_model_changes *
+                                                changes);
+void trg_torrent_model_changes_get_progress(trg_torrent_model_changes *
+                                            changes, guint * applied,
+                                            guint * total);
 trg_torrent_model_update_stats *trg_torrent_model_get_stats(TrgTorrentModel
                                                             * model);
 
 GHashTable *get_torrent_table(TrgTorrentModel * model);
 void trg_torrent_model_remove_all(TrgTorrentModel * model);
+void trg_torrent_model_add_source(TrgTorrentModel * model, TrgClient * tc);
+void trg_torrent_model_remove_source(TrgTorrentModel * model,
+                                     TrgClient * tc);
+void trg_torrent_model_load_snapshot(TrgTorrentModel * model, TrgClient * tc,
+                                     JsonArray * torrents, gint64 rpcv);
+gboolean trg_torrent_model_is_stale(TrgTorrentModel * model);
 
 gboolean trg_torrent_model_is_remove_in_progress(TrgTorrentModel * model);
+gboolean trg_torrent_model_merge_details(TrgTorrentModel * model,
+                                         JsonObject * details);
 
-gboolean get_torrent_data(GHashTable * table, gint64 id, JsonObject ** t,
+gboolean get_torrent_data(GHashTable * table, gint64 id, trg_torrent ** t,
                           GtkTreeIter * out_iter);
 
 gchar *shorten_download_dir(TrgClient * tc, const gchar * downloadDir);
@@ -127,7 +163,7 @@ enum {
     TORRENT_COLUMN_RATIO,
     TORRENT_COLUMN_ADDED,
     TORRENT_COLUMN_ID,
-    TORRENT_COLUMN_JSON,
+    TORRENT_COLUMN_TORRENT,
     TORRENT_COLUMN_UPDATESERIAL,
     TORRENT_COLUMN_FLAGS,
     TORRENT_COLUMN_DOWNLOADDIR,
@@ -148,6 +184,8 @@ enum {
     TORRENT_COLUMN_ERROR,
     TORRENT_COLUMN_SEED_RATIO_MODE,
     TORRENT_COLUMN_SEED_RATIO_LIMIT,
+    TORRENT_COLUMN_CLIENT,
+    TORRENT_COLUMN_SOURCE,
     TORRENT_COLUMN_COLUMNS
 };
 
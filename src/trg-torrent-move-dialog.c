@@ -44,7 +44,7 @@ struct _TrgTorrentMoveDialogPrivate {
     TrgClient *client;
     TrgMainWindow *win;
     TrgTorrentTreeView *treeview;
-    JsonArray *ids;
+    GList *targets;
     GtkWidget *location_combo, *move_check, *move_button;
 };
 
@@ -65,18 +65,27 @@ trg_torrent_move_response_cb(GtkDialog * dlg, gint res_id, gpointer data)
         gchar *location =
             trg_destination_combo_get_dir(TRG_DESTINATION_COMBO
                                           (priv->location_combo));
-        JsonNode *request = torrent_set_location(priv->ids, location,
-                                                 gtk_toggle_button_get_active
-                                                 (GTK_TOGGLE_BUTTON
-                                                  (priv->move_check)));
+        gboolean move =
+            gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON
+                                         (priv->move_check));
+        GList *li;
+
+        /* Each daemon gets its own torrents, as in a merged list. */
+        for (li = priv->targets; li; li = g_list_next(li)) {
+            trg_client_ids *target = (trg_client_ids *) li->data;
+            dispatch_async(target->client,
+                           torrent_set_location(target->ids, location,
+                                                move),
+                           on_generic_interactive_action_response, data);
+            target->ids = NULL;
+        }
+
         g_free(location);
         trg_destination_combo_save_selection(TRG_DESTINATION_COMBO
                                              (priv->location_combo));
-        dispatch_async(priv->client, request,
-                       on_generic_interactive_action_response, data);
-    } else {
-        json_array_unref(priv->ids);
     }
+    trg_client_ids_list_free(priv->targets);
+    priv->targets = NULL;
     gtk_widget_destroy(GTK_WIDGET(dlg));
 }
 
@@ -153,17 +162,15 @@ static GObject *trg_torrent_move_dialog_constructor(GType type,
         gtk_tree_selection_count_selected_rows(gtk_tree_view_get_selection
                                                (GTK_TREE_VIEW
                                                 (priv->treeview)));
-    priv->ids = build_json_id_array(priv->treeview);
+    priv->targets = build_json_id_arrays(priv->treeview);
 
     if (count == 1) {
-        JsonObject *json;
-        const gchar *name;
+        trg_torrent *torrent;
 
         get_torrent_data(trg_client_get_torrent_table(priv->client),
-                         trg_mw_get_selected_torrent_id(priv->win), &json,
+                         trg_mw_get_selected_torrent_id(priv->win), &torrent,
                          NULL);
-        name = torrent_get_name(json);
-        msg = g_strdup_printf(_("Move %s"), name);
+        msg = g_strdup_printf(_("Move %s"), torrent->name);
     } else {
         msg = g_strdup_printf(_("Move %d torrents"), count);
     }
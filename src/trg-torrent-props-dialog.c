@@ -73,6 +73,7 @@ struct _TrgTorrentPropsDialogPrivate {
     TrgClient *client;
     TrgMainWindow *parent;
     JsonArray *targetIds;
+    GList *targets;
 
     GList *widgets;
 
@@ -84,7 +85,7 @@ struct _TrgTorrentPropsDialogPrivate {
     TrgTrackersModel *trackersModel;
     TrgFilesTreeView *filesTv;
     TrgFilesModel *filesModel;
-    JsonObject *lastJson;
+    trg_torrent *lastTorrent;
 
     GtkWidget *size_lb;
     GtkWidget *have_lb;
@@ -160,26 +161,37 @@ static void trg_torrent_props_response_cb(GtkDialog * dialog, gint res_id,
                               TRG_TREE_VIEW_PERSIST_LAYOUT);
     }
 
-    if (res_id != GTK_RESPONSE_OK) {
-        json_array_unref(priv->targetIds);
-    } else {
-        JsonNode *request = torrent_set(priv->targetIds);
-        JsonObject *args = node_get_arguments(request);
+    if (res_id == GTK_RESPONSE_OK) {
+        GList *li;
 
-        json_object_set_int_member(args, FIELD_SEED_RATIO_MODE,
-                gtk_combo_box_get_active(GTK_COMBO_BOX
-                (priv->seedRatioMode) ));
-        json_object_set_int_member(args, FIELD_BANDWIDTH_PRIORITY,
-                gtk_combo_box_get_active(GTK_COMBO_BOX
-                (priv->bandwidthPriorityCombo) ) - 1);
+        /* The same settings go to each daemon with a selected torrent. */
+        for (li = priv->targets; li; li = g_list_next(li)) {
+            trg_client_ids *target = (trg_client_ids *) li->data;
+            JsonNode *request = torrent_set(target->ids);
+            JsonObject *args = node_get_arguments(request);
 
-        trg_json_widgets_save(priv->widgets, args);
-        trg_json_widget_desc_list_free(priv->widgets);
+            target->ids = NULL;
+
+            json_object_set_int_member(args, FIELD_SEED_RATIO_MODE,
+                    gtk_combo_box_get_active(GTK_COMBO_BOX
+                    (priv->seedRatioMode) ));
+            json_object_set_int_member(args, FIELD_BANDWIDTH_PRIORITY,
+                    gtk_combo_box_get_active(GTK_COMBO_BOX
+                    (priv->bandwidthPriorityCombo) ) - 1);
 
-        dispatch_async(priv->client, request, on_generic_interactive_action_response,
-                priv->parent);
+            trg_json_widgets_save(priv->widgets, args);
+
+            dispatch_async(target->client, request,
+                    on_generic_interactive_action_response, priv->parent);
+        }
+
+        trg_json_widget_desc_list_free(priv->widgets);
     }
 
+    json_array_unref(priv->targetIds);
+    trg_client_ids_list_free(priv->targets);
+    priv->targets = NULL;
+
     gtk_widget_destroy(GTK_WIDGET(dialog));
 }
 
@@ -295,33 +307,14 @@ static GtkWidget *info_page_new(TrgTorrentPropsDialog * dialog)
 }
 
 static void info_page_update(TrgTorrentPropsDialog * dialog,
-                             JsonObject * t,
-                             TrgTorrentModel * torrentModel,
-                             GtkTreeIter * iter)
+                             trg_torrent * t)
 {
     TrgTorrentPropsDialogPrivate *priv = GET_PRIVATE(dialog);
-    GtkTreeModel *model = GTK_TREE_MODEL(torrentModel);
-    gint64 sizeWhenDone, haveValid, downloaded, uploaded, percentDone, eta,
-        activityDate, error;
-    gchar *statusString;
-    guint flags;
     const gchar *str;
 
     char buf[512];
 
-    gtk_tree_model_get(model, iter,
-                       TORRENT_COLUMN_SIZEWHENDONE, &sizeWhenDone,
-                       TORRENT_COLUMN_UPLOADED, &uploaded,
-                       TORRENT_COLUMN_DOWNLOADED, &downloaded,
-                       TORRENT_COLUMN_HAVE_VALID, &haveValid,
-                       TORRENT_COLUMN_PERCENTDONE, &percentDone,
-                       TORRENT_COLUMN_ETA, &eta,
-                       TORRENT_COLUMN_LASTACTIVE, &activityDate,
-                       TORRENT_COLUMN_STATUS, &statusString,
-                       TORRENT_COLUMN_FLAGS, &flags,
-                       TORRENT_COLUMN_ERROR, &error, -1);
-
-    if (torrent_get_is_private(t))
+    if (t->isPrivate)
         str = _("Private to this tracker -- DHT and PEX disabled");
     else
         str = _("Public torrent");
@@ -329,8 +322,8 @@ static void info_page_update(TrgTorrentPropsDialog * dialog,
     gtk_label_set_text(GTK_LABEL(priv->privacy_lb), str);
 
     {
-        const gchar *creator = torrent_get_creator(t);
-        gint64 dateCreated = torrent_get_date_created(t);
+        const gchar *creator = t->creator;
+        gint64 dateCreated = t->dateCreated;
         gchar *dateStr = epoch_to_string(dateCreated);
 
         if (creator && strlen(creator) > 0 && dateCreated > 0)
@@ -347,52 +340,49 @@ static void info_page_update(TrgTorrentPropsDialog * dialog,
         gtk_label_set_text(GTK_LABEL(priv->origin_lb), buf);
     }
 
-    gtk_text_buffer_set_text(priv->comment_buffer, torrent_get_comment(t),
-                             -1);
-    gtk_label_set_text(GTK_LABEL(priv->destination_lb),
-                       torrent_get_download_dir(t));
+    gtk_text_buffer_set_text(priv->comment_buffer, t->comment, -1);
+    gtk_label_set_text(GTK_LABEL(priv->destination_lb), t->downloadDir);
 
-    gtk_label_set_text(GTK_LABEL(priv->state_lb), statusString);
-    g_free(statusString);
+    gtk_label_set_text(GTK_LABEL(priv->state_lb), t->statusString);
 
     {
-        gchar *addedStr = epoch_to_string(torrent_get_added_date(t));
+        gchar *addedStr = epoch_to_string(t->addedDate);
         gtk_label_set_text(GTK_LABEL(priv->date_started_lb), addedStr);
         g_free(addedStr);
     }
 
     /* eta */
 
-    if (eta > 0) {
-        tr_strltime_long(buf, eta, sizeof(buf));
+    if (t->eta > 0) {
+        tr_strltime_long(buf, t->eta, sizeof(buf));
         gtk_label_set_text(GTK_LABEL(priv->eta_lb), buf);
     } else {
         gtk_label_set_text(GTK_LABEL(priv->eta_lb), "");
     }
 
-    gtk_label_set_text(GTK_LABEL(priv->hash_lb), torrent_get_hash(t));
+    gtk_label_set_text(GTK_LABEL(priv->hash_lb), t->hashString);
     gtk_label_set_text(GTK_LABEL(priv->error_lb),
-                       error ? torrent_get_errorstr(t) : _("No errors"));
+                       t->error ? t->errorString : _("No errors"));
 
-    if (flags & TORRENT_FLAG_ACTIVE) {
+    if (t->flags & TORRENT_FLAG_ACTIVE) {
         gtk_label_set_text(GTK_LABEL(priv->last_activity_lb),
                            _("Active now"));
     } else {
-        gchar *activityStr = epoch_to_string(activityDate);
+        gchar *activityStr = epoch_to_string(t->activityDate);
         gtk_label_set_text(GTK_LABEL(priv->last_activity_lb), activityStr);
         g_free(activityStr);
     }
 
-    tr_strlsize(buf, sizeWhenDone, sizeof(buf));
+    tr_strlsize(buf, t->sizeWhenDone, sizeof(buf));
     gtk_label_set_text(GTK_LABEL(priv->size_lb), buf);
 
-    tr_strlsize(buf, downloaded, sizeof(buf));
+    tr_strlsize(buf, t->downloadedEver, sizeof(buf));
     gtk_label_set_text(GTK_LABEL(priv->dl_lb), buf);
 
-    tr_strlsize(buf, uploaded, sizeof(buf));
+    tr_strlsize(buf, t->uploadedEver, sizeof(buf));
     gtk_label_set_text(GTK_LABEL(priv->ul_lb), buf);
 
-    tr_strlsize(buf, haveValid, sizeof(buf));
+    tr_strlsize(buf, t->haveValid, sizeof(buf));
     gtk_label_set_text(GTK_LABEL(priv->have_lb), buf);
 }
 
@@ -475,31 +465,32 @@ static void models_updated(TrgTorrentModel * model, gpointer data)
     TrgTorrentPropsDialogPrivate *priv = GET_PRIVATE(data);
     GHashTable *ht = get_torrent_table(model);
     gint64 serial = trg_client_get_serial(priv->client);
-    JsonObject *t = NULL;
-    GtkTreeIter iter;
+    trg_torrent *t = NULL;
     gboolean exists = get_torrent_data(ht,
                                        json_array_get_int_element(priv->
                                                                   targetIds,
                                                                   0), &t,
-                                       &iter);
-
-    if (exists && priv->lastJson != t) {
-        trg_files_model_update(priv->filesModel,
-                               GTK_TREE_VIEW(priv->filesTv), serial, t,
-                               TORRENT_GET_MODE_UPDATE);
-        trg_peers_model_update(priv->peersModel,
-                               TRG_TREE_VIEW(priv->peersTv), serial, t,
-                               TORRENT_GET_MODE_UPDATE);
-        trg_trackers_model_update(priv->trackersModel, serial, t,
-                                  TORRENT_GET_MODE_UPDATE);
-        info_page_update(TRG_TORRENT_PROPS_DIALOG(data), t, model, &iter);
+                                       NULL);
+
+    if (exists && priv->lastTorrent != t) {
+        if (trg_torrent_has_details(t)) {
+            trg_files_model_update(priv->filesModel,
+                                   GTK_TREE_VIEW(priv->filesTv), serial,
+                                   t, TORRENT_GET_MODE_UPDATE);
+            trg_peers_model_update(priv->peersModel,
+                                   TRG_TREE_VIEW(priv->peersTv), serial,
+                                   t, TORRENT_GET_MODE_UPDATE);
+            trg_trackers_model_update(priv->trackersModel, serial, t,
+                                      TORRENT_GET_MODE_UPDATE);
+        }
+        info_page_update(TRG_TORRENT_PROPS_DIALOG(data), t);
     }
 
     gtk_widget_set_sensitive(GTK_WIDGET(priv->filesTv), exists);
     gtk_widget_set_sensitive(GTK_WIDGET(priv->trackersTv), exists);
     gtk_widget_set_sensitive(GTK_WIDGET(priv->peersTv), exists);
 
-    priv->lastJson = t;
+    priv->lastTorrent = t;
 }
 
 static GObject *trg_torrent_props_dialog_constructor(GType type,
@@ -527,14 +518,15 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
 
     gint64 width, height;
 
+    trg_torrent *t = NULL;
     JsonObject *json;
-    GtkTreeIter iter;
     GtkWidget *notebook, *contentvbox;
 
     get_torrent_data(trg_client_get_torrent_table(priv->client),
-                     trg_mw_get_selected_torrent_id(priv->parent), &json,
-                     &iter);
+                     trg_mw_get_selected_torrent_id(priv->parent), &t,
+                     NULL);
     priv->targetIds = build_json_id_array(priv->tv);
+    priv->targets = build_json_id_arrays(priv->tv);
 
     if (rowCount > 1) {
         gchar *windowTitle =
@@ -543,7 +535,7 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
         gtk_window_set_title(window, windowTitle);
         g_free(windowTitle);
     } else if (rowCount == 1) {
-        gtk_window_set_title(window, torrent_get_name(json));
+        gtk_window_set_title(window, t->name);
     }
 
     gtk_window_set_transient_for(window, GTK_WINDOW(priv->parent));
@@ -571,7 +563,7 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
         gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                                  info_page_new(propsDialog),
                                  gtk_label_new(_("Information")));
-        info_page_update(propsDialog, json, priv->torrentModel, &iter);
+        info_page_update(propsDialog, t);
 
         /* Files */
 
@@ -580,9 +572,10 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
             trg_files_tree_view_new(priv->filesModel, priv->parent,
                                     priv->client,
                                     "TrgFilesTreeView-dialog");
-        trg_files_model_update(priv->filesModel,
-                               GTK_TREE_VIEW(priv->filesTv), serial, json,
-                               TORRENT_GET_MODE_FIRST);
+        if (trg_torrent_has_details(t))
+            trg_files_model_update(priv->filesModel,
+                                   GTK_TREE_VIEW(priv->filesTv), serial,
+                                   t, TORRENT_GET_MODE_FIRST);
         gtk_widget_set_sensitive(GTK_WIDGET(priv->filesTv), TRUE);
         gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                                  my_scrolledwin_new(GTK_WIDGET
@@ -594,9 +587,10 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
         priv->peersModel = trg_peers_model_new();
         priv->peersTv = trg_peers_tree_view_new(prefs, priv->peersModel,
                                                 "TrgPeersTreeView-dialog");
-        trg_peers_model_update(priv->peersModel,
-                               TRG_TREE_VIEW(priv->peersTv), serial, json,
-                               TORRENT_GET_MODE_FIRST);
+        if (trg_torrent_has_details(t))
+            trg_peers_model_update(priv->peersModel,
+                                   TRG_TREE_VIEW(priv->peersTv), serial,
+                                   t, TORRENT_GET_MODE_FIRST);
         gtk_widget_set_sensitive(GTK_WIDGET(priv->peersTv), TRUE);
         gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                                  my_scrolledwin_new(GTK_WIDGET
@@ -612,8 +606,9 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
                                                       "TrgTrackersTreeView-dialog");
         trg_trackers_tree_view_new_connection(priv->trackersTv,
                                               priv->client);
-        trg_trackers_model_update(priv->trackersModel, serial, json,
-                                  TORRENT_GET_MODE_FIRST);
+        if (trg_torrent_has_details(t))
+            trg_trackers_model_update(priv->trackersModel, serial, t,
+                                      TORRENT_GET_MODE_FIRST);
         gtk_widget_set_sensitive(GTK_WIDGET(priv->trackersTv), TRUE);
         gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                                  my_scrolledwin_new(GTK_WIDGET
@@ -627,12 +622,15 @@ static GObject *trg_torrent_props_dialog_constructor(GType type,
         g_signal_connect_object(priv->torrentModel, "update", G_CALLBACK
                                 (models_updated), object, G_CONNECT_AFTER);
 
-        priv->lastJson = json;
+        priv->lastTorrent = t;
     }
 
+    /* The limits page is made of JSON widgets, which read by field name. */
+    json = trg_torrent_to_json(t);
     gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
                              trg_props_limits_page_new(propsDialog, json),
                              gtk_label_new(_("Limits")));
+    json_object_unref(json);
 
     gtk_container_set_border_width(GTK_CONTAINER(notebook), GUI_PAD);
 
@@ -142,6 +142,9 @@ static void trg_torrent_tree_view_init(TrgTorrentTreeView * tttv)
     trg_tree_view_reg_column(ttv, TRG_COLTYPE_TEXT,
                              TORRENT_COLUMN_DOWNLOADDIR, _("Location"),
                              "download-dir", TRG_COLUMN_EXTRA);
+    trg_tree_view_reg_column(ttv, TRG_COLTYPE_TEXT,
+                             TORRENT_COLUMN_SOURCE, _("Daemon"),
+                             "source", TRG_COLUMN_EXTRA);
     trg_tree_view_reg_column(ttv, TRG_COLTYPE_TEXT, TORRENT_COLUMN_ID,
                              _("ID"), "id", TRG_COLUMN_EXTRA);
     trg_tree_view_reg_column(ttv, TRG_COLTYPE_PRIO,
@@ -162,6 +165,11 @@ static void trg_torrent_tree_view_init(TrgTorrentTreeView * tttv)
                                     TORRENT_COLUMN_NAME);
 }
 
+struct json_id_array_args {
+    JsonArray *ids;
+    TrgClient *client;
+};
+
 static void
 trg_torrent_model_get_json_id_array_foreach(GtkTreeModel * model,
                                             GtkTreePath *
@@ -169,24 +177,101 @@ trg_torrent_model_get_json_id_array_foreach(GtkTreeModel * model,
                                             GtkTreeIter * iter,
                                             gpointer data)
 {
-    JsonArray *output = (JsonArray *) data;
+    struct json_id_array_args *args = (struct json_id_array_args *) data;
+    TrgClient *client;
     gint64 id;
-    gtk_tree_model_get(model, iter, TORRENT_COLUMN_ID, &id, -1);
-    json_array_add_int_element(output, id);
+
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_ID, &id,
+                       TORRENT_COLUMN_CLIENT, &client, -1);
+
+    /* IDs only mean something to the daemon they came from. */
+    if (client == args->client)
+        json_array_add_int_element(args->ids, id);
 }
 
-JsonArray *build_json_id_array(TrgTorrentTreeView * tv)
+/* The selected torrents of one daemon, in a merged view. */
+JsonArray *build_json_id_array_for_client(TrgTorrentTreeView * tv,
+                                          TrgClient * client)
 {
     GtkTreeSelection *selection =
         gtk_tree_view_get_selection(GTK_TREE_VIEW(tv));
+    struct json_id_array_args args;
 
-    JsonArray *ids = json_array_new();
+    args.ids = json_array_new();
+    args.client = client;
     gtk_tree_selection_selected_foreach(selection,
                                         (GtkTreeSelectionForeachFunc)
                                         trg_torrent_model_get_json_id_array_foreach,
-                                        ids);
+                                        &args);
+
+    return args.ids;
+}
+
+/* The selected torrents of the main connection. */
+JsonArray *build_json_id_array(TrgTorrentTreeView * tv)
+{
+    TrgTorrentTreeViewPrivate *priv = GET_PRIVATE(tv);
+    return build_json_id_array_for_client(tv, priv->client);
+}
+
+static void
+trg_torrent_tree_view_selected_clients_foreach(GtkTreeModel * model,
+                                               GtkTreePath *
+                                               path G_GNUC_UNUSED,
+                                               GtkTreeIter * iter,
+                                               gpointer data)
+{
+    GList **clients = (GList **) data;
+    TrgClient *client;
+
+    gtk_tree_model_get(model, iter, TORRENT_COLUMN_CLIENT, &client, -1);
 
-    return ids;
+    if (client && !g_list_find(*clients, client))
+        *clients = g_list_prepend(*clients, client);
+}
+
+/* Each daemon with a torrent in the selection, once. Free with
+ * g_list_free(). */
+GList *trg_torrent_tree_view_get_selected_clients(TrgTorrentTreeView * tv)
+{
+    GtkTreeSelection *selection =
+        gtk_tree_view_get_selection(GTK_TREE_VIEW(tv));
+    GList *clients = NULL;
+
+    gtk_tree_selection_selected_foreach(selection,
+                                        trg_torrent_tree_view_selected_clients_foreach,
+                                        &clients);
+
+    return clients;
+}
+
+/* The selection split by daemon, a trg_client_ids for each, for holding
+ * on to while a dialog is open. Free with trg_client_ids_list_free(). */
+GList *build_json_id_arrays(TrgTorrentTreeView * tv)
+{
+    GList *clients = trg_torrent_tree_view_get_selected_clients(tv);
+    GList *li;
+
+    for (li = clients; li; li = g_list_next(li)) {
+        trg_client_ids *target = g_new(trg_client_ids, 1);
+        target->client = (TrgClient *) li->data;
+        target->ids = build_json_id_array_for_client(tv, target->client);
+        li->data = target;
+    }
+
+    return clients;
+}
+
+static void trg_client_ids_free(trg_client_ids * target)
+{
+    if (target->ids)
+        json_array_unref(target->ids);
+    g_free(target);
+}
+
+void trg_client_ids_list_free(GList * list)
+{
+    g_list_free_full(list, (GDestroyNotify) trg_client_ids_free);
 }
 
 static void setup_classic_layout(TrgTorrentTreeView * tv)
@@ -257,8 +342,8 @@ static void setup_transmission_layout(TrgTorrentTreeView * tv,
                                                  "webSeedsToUs",
                                                  TORRENT_COLUMN_WEB_SEEDS_TO_US,
                                                  "eta", TORRENT_COLUMN_ETA,
-                                                 "json",
-                                                 TORRENT_COLUMN_JSON,
+                                                 "torrent",
+                                                 TORRENT_COLUMN_TORRENT,
                                                  "seedRatioMode",
                                                  TORRENT_COLUMN_SEED_RATIO_MODE,
                                                  "seedRatioLimit",
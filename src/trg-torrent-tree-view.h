@@ -50,9 +50,22 @@ typedef struct {
 
 GType trg_torrent_tree_view_get_type(void);
 
+/* The selected torrents of one daemon, from build_json_id_arrays(). A
+ * request made with the IDs takes them, so set ids to NULL after. */
+typedef struct {
+    TrgClient *client;
+    JsonArray *ids;
+} trg_client_ids;
+
 TrgTorrentTreeView *trg_torrent_tree_view_new(TrgClient * tc,
                                               GtkTreeModel * model);
 JsonArray *build_json_id_array(TrgTorrentTreeView * tv);
+GList *build_json_id_arrays(TrgTorrentTreeView * tv);
+void trg_client_ids_list_free(GList * list);
+JsonArray *build_json_id_array_for_client(TrgTorrentTreeView * tv,
+                                          TrgClient * client);
+GList *trg_torrent_tree_view_get_selected_clients(TrgTorrentTreeView *
+                                                  tv);
 
 G_END_DECLS
 #endif                          /* _TRG_TORRENT_TREE_VIEW_H_ */
@@ -54,7 +54,7 @@ gint64 trg_trackers_model_get_torrent_id(TrgTrackersModel * model)
 
 void
 trg_trackers_model_update(TrgTrackersModel * model,
-                          gint64 updateSerial, JsonObject * t, gint mode)
+                          gint64 updateSerial, trg_torrent * t, gint mode)
 {
     TrgTrackersModelPrivate *priv = TRG_TRACKERS_MODEL_GET_PRIVATE(model);
 
@@ -67,13 +67,13 @@ trg_trackers_model_update(TrgTrackersModel * model,
 
     if (mode == TORRENT_GET_MODE_FIRST) {
         gtk_list_store_clear(GTK_LIST_STORE(model));
-        priv->torrentId = torrent_get_id(t);
+        priv->torrentId = t->id;
         priv->accept = TRUE;
     } else if (!priv->accept) {
         return;
     }
 
-    trackers = json_array_get_elements(torrent_get_tracker_stats(t));
+    trackers = json_array_get_elements(t->details->trackerStats);
 
     for (li = trackers; li; li = g_list_next(li)) {
         tracker = json_node_get_object((JsonNode *) li->data);
@@ -23,6 +23,8 @@
 #include <glib-object.h>
 #include <json-glib/json-glib.h>
 
+#include "torrent.h"
+
 G_BEGIN_DECLS
 #define TRG_TYPE_TRACKERS_MODEL trg_trackers_model_get_type()
 #define TRG_TRACKERS_MODEL(obj) \
@@ -49,7 +51,7 @@ TrgTrackersModel *trg_trackers_model_new(void);
 
 G_END_DECLS
     void trg_trackers_model_update(TrgTrackersModel * model,
-                                   gint64 updateSerial, JsonObject * t,
+                                   gint64 updateSerial, trg_torrent * t,
                                    gint mode);
 void trg_trackers_model_set_accept(TrgTrackersModel * model,
                                    gboolean accept);
@@ -0,0 +1,208 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <curl/curl.h>
+
+#include "protocol-constants.h"
+#include "json.h"
+#include "trg-upload-stream.h"
+
+/* The body of a torrent-add for a local .torrent file, given to curl a
+ * piece at a time through its read callback, rather than base64 encoding
+ * the whole file into the JSON and then serialising that.
+ *
+ * The request is serialised once with a placeholder for the metainfo, and
+ * split around it. The file is memory mapped and encoded as curl asks for
+ * it, so nothing bigger than curl's upload buffer is held in memory.
+ * Base64 needs no escaping in a JSON string.
+ *
+ * Reads go from an offset into the whole body, so curl can seek back (for
+ * a 409 retry, or to resend for authentication).
+ */
+
+#define TRG_UPLOAD_PLACEHOLDER "trg-metainfo-placeholder"
+
+struct _trg_upload_stream {
+    GMappedFile *file;
+    const guchar *contents;
+    gsize contents_len;
+    gchar *prefix;              /* the JSON up to the metainfo value */
+    gsize prefix_len;
+    const gchar *suffix;        /* and after it, within prefix's buffer */
+    gsize suffix_len;
+    gsize encoded_len;
+    gsize length;
+    gsize pos;
+};
+
+static const gchar base64_table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* req must have arguments. It isn't changed, and isn't needed after. */
+trg_upload_stream *trg_upload_stream_new(JsonNode * req,
+                                         const gchar * filename,
+                                         GError ** error)
+{
+    JsonObject *args = node_get_arguments(req);
+    GMappedFile *file = g_mapped_file_new(filename, FALSE, error);
+    trg_upload_stream *s;
+    gchar *json, *marker;
+
+    if (!file)
+        return NULL;
+
+    json_object_set_string_member(args, PARAM_METAINFO,
+                                  TRG_UPLOAD_PLACEHOLDER);
+    json = trg_serialize(req);
+    json_object_remove_member(args, PARAM_METAINFO);
+
+    marker = strstr(json, "\"" TRG_UPLOAD_PLACEHOLDER "\"");
+    if (!marker) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                    "Unable to build the request for \"%s\"", filename);
+        g_free(json);
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    s = g_new0(trg_upload_stream, 1);
+    s->file = file;
+    s->contents = (const guchar *) g_mapped_file_get_contents(file);
+    s->contents_len = g_mapped_file_get_length(file);
+    s->encoded_len = ((s->contents_len + 2) / 3) * 4;
+
+    /* Keep the quotes either side. */
+    s->prefix = json;
+    s->prefix_len = marker - json + 1;
+    s->suffix = marker + strlen(TRG_UPLOAD_PLACEHOLDER) + 1;
+    s->suffix_len = strlen(s->suffix);
+
+    s->length = s->prefix_len + s->encoded_len + s->suffix_len;
+
+    return s;
+}
+
+/* Encode from offset into the base64, a group of four at a time. */
+static gsize
+trg_upload_stream_encode(trg_upload_stream * s, gsize offset, gchar * out,
+                         gsize room)
+{
+    const guchar *in = s->contents;
+    gsize written = 0;
+
+    while (room > 0 && offset < s->encoded_len) {
+        gsize i = (offset / 4) * 3;
+        gsize n_in = MIN(3, s->contents_len - i);
+        guint32 bits = in[i] << 16;
+        gchar group[4];
+        gsize k;
+
+        if (n_in > 1)
+            bits |= in[i + 1] << 8;
+        if (n_in > 2)
+            bits |= in[i + 2];
+
+        group[0] = base64_table[(bits >> 18) & 63];
+        group[1] = base64_table[(bits >> 12) & 63];
+        group[2] = n_in > 1 ? base64_table[(bits >> 6) & 63] : '=';
+        group[3] = n_in > 2 ? base64_table[bits & 63] : '=';
+
+        for (k = offset % 4; k < 4 && room > 0; k++, room--, offset++)
+            out[written++] = group[k];
+    }
+
+    return written;
+}
+
+static size_t
+trg_upload_stream_read(char *buffer, size_t size, size_t nitems,
+                       void *data)
+{
+    trg_upload_stream *s = (trg_upload_stream *) data;
+    gsize room = size * nitems;
+    gsize written = 0;
+
+    while (room > 0 && s->pos < s->length) {
+        gsize n;
+
+        if (s->pos < s->prefix_len) {
+            n = MIN(room, s->prefix_len - s->pos);
+            memcpy(buffer + written, s->prefix + s->pos, n);
+        } else if (s->pos < s->prefix_len + s->encoded_len) {
+            n = trg_upload_stream_encode(s, s->pos - s->prefix_len,
+                                         buffer + written, room);
+        } else {
+            gsize offset = s->pos - s->prefix_len - s->encoded_len;
+            n = MIN(room, s->suffix_len - offset);
+            memcpy(buffer + written, s->suffix + offset, n);
+        }
+
+        s->pos += n;
+        written += n;
+        room -= n;
+    }
+
+    return written;
+}
+
+static int
+trg_upload_stream_seek(void *data, curl_off_t offset, int origin)
+{
+    trg_upload_stream *s = (trg_upload_stream *) data;
+
+    if (origin != SEEK_SET || offset < 0 || (gsize) offset > s->length)
+        return CURL_SEEKFUNC_CANTSEEK;
+
+    s->pos = (gsize) offset;
+
+    return CURL_SEEKFUNC_OK;
+}
+
+/* Make this the body of curl's next POST, from the start. */
+void trg_upload_stream_setup(trg_upload_stream * s, CURL * curl)
+{
+    s->pos = 0;
+
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, NULL);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t) s->length);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, trg_upload_stream_read);
+    curl_easy_setopt(curl, CURLOPT_READDATA, s);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, trg_upload_stream_seek);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, s);
+}
+
+void trg_upload_stream_free(trg_upload_stream * s)
+{
+    if (!s)
+        return;
+
+    g_mapped_file_unref(s->file);
+    g_free(s->prefix);
+    g_free(s);
+}
@@ -0,0 +1,35 @@
+/*
+ * transmission-remote-gtk - A GTK RPC client to Transmission
+ * Copyright (C) 2011-2013  Alan Fitton
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TRG_UPLOAD_STREAM_H_
+#define TRG_UPLOAD_STREAM_H_
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <curl/curl.h>
+
+typedef struct _trg_upload_stream trg_upload_stream;
+
+trg_upload_stream *trg_upload_stream_new(JsonNode * req,
+                                         const gchar * filename,
+                                         GError ** error);
+void trg_upload_stream_setup(trg_upload_stream * s, CURL * curl);
+void trg_upload_stream_free(trg_upload_stream * s);
+
+#endif                          /* TRG_UPLOAD_STREAM_H_ */
@@ -2,6 +2,10 @@
 #include "config.h"
 #endif
 
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
 #include "protocol-constants.h"
 #include "requests.h"
 #include "trg-client.h"
@@ -11,7 +15,6 @@
 #include "upload.h"
 
 static gboolean upload_complete_callback(gpointer data);
-static void next_upload(trg_upload *upload);
 
 static void
 add_set_common_args(JsonObject * args, gint priority, gchar * dir)
@@ -28,6 +31,8 @@ void trg_upload_free(trg_upload *upload) {
 	g_free(upload->file_wanted);
 	g_free(upload->file_priorities);
 	trg_response_free(upload->upload_response);
+	if (upload->failures)
+		g_string_free(upload->failures, TRUE);
 	g_free(upload);
 }
 
@@ -55,16 +60,143 @@ static void add_wanteds(JsonObject *args, gint* wanteds, gint n_files) {
 	}
 }
 
-static void next_upload(trg_upload *upload) {
+/* Several are sent at once, up to TRG_PREFS_KEY_UPLOAD_CONCURRENCY, so a
+ * big batch isn't one round trip after another. With a main window, the
+ * progress is shown in its status bar, failures are collected into one
+ * dialog at the end, and the torrent list is refreshed once.
+ */
+
+typedef struct {
+	trg_upload *upload;
+	gchar *target; // in upload->list, or NULL for upload_response
+	gboolean local;
+	guint64 size;
+} trg_upload_item;
+
+static void upload_add_failure(trg_upload *upload, const gchar *target,
+		const gchar *msg) {
+	gchar *name = target && !is_url(target) && !is_magnet(target) ?
+			g_path_get_basename(target) : g_strdup(target ? target : _("Torrent"));
+
+	upload->failed++;
+
+	if (!upload->failures)
+		upload->failures = g_string_new(NULL);
+
+	g_string_append_printf(upload->failures, "%s: %s\n", name, msg);
+	g_free(name);
+}
+
+static void upload_show_progress(trg_upload *upload) {
+	gdouble elapsed, rate;
+	gchar speed[32];
+	gchar *text;
+
+	if (!upload->main_window || upload->total < 2)
+		return;
+
+	elapsed = (g_get_monotonic_time() - upload->started) / (gdouble) G_USEC_PER_SEC;
+	rate = elapsed > 0 ? upload->bytes / elapsed : 0;
+	trg_strlspeed(speed, rate / speed_K);
+
+	if (upload->failed)
+		text = g_strdup_printf(_("Adding torrents: %u of %u, %u failed (%s)"),
+				upload->done, upload->total, upload->failed, speed);
+	else
+		text = g_strdup_printf(_("Adding torrents: %u of %u (%s)"),
+				upload->done, upload->total, speed);
+
+	trg_main_window_set_progress(upload->main_window,
+			(gdouble) upload->done / upload->total, text);
+	g_free(text);
+}
+
+static void upload_finish(trg_upload *upload) {
+	TrgMainWindow *win = upload->main_window;
+
+	if (win) {
+		if (upload->total > 1)
+			trg_main_window_set_progress(win, 0, NULL);
+
+		if (upload->failures) {
+			GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(win),
+					GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+					ngettext("Failed to add %u torrent",
+							"Failed to add %u torrents", upload->failed),
+					upload->failed);
+			g_string_truncate(upload->failures, upload->failures->len - 1);
+			gtk_message_dialog_format_secondary_text(
+					GTK_MESSAGE_DIALOG(dialog), "%s", upload->failures->str);
+			gtk_window_set_title(GTK_WINDOW(dialog), _("Error"));
+			gtk_dialog_run(GTK_DIALOG(dialog));
+			gtk_widget_destroy(dialog);
+		}
+
+		if (upload->done > upload->failed)
+			trg_main_window_refresh(win);
+	}
+
+	trg_upload_free(upload);
+}
+
+/* The next request in the batch, or NULL when there are no more. */
+static JsonNode *upload_next_request(trg_upload *upload,
+		trg_upload_item **item) {
 	JsonNode *req = NULL;
 
-	if (upload->upload_response && upload->progress_index < 1)
-		req = torrent_add_from_response(upload->upload_response, upload->flags);
-	else if (upload->list && upload->progress_index < g_slist_length(upload->list))
-		req = torrent_add_from_file((gchar*)g_slist_nth_data(upload->list, upload->progress_index), upload->flags);
+	while (!req) {
+		trg_upload_item *i;
+		gchar *target = NULL;
 
-	if (req) {
+		if (upload->upload_response && upload->sent < 1) {
+			req = torrent_add_from_response(upload->upload_response,
+					upload->flags);
+		} else if (upload->next) {
+			target = (gchar*)upload->next->data;
+			upload->next = g_slist_next(upload->next);
+			req = torrent_add_from_file(target, upload->flags);
+		} else {
+			return NULL;
+		}
+
+		upload->sent++;
+
+		if (!req) {
+			upload->done++;
+			upload_add_failure(upload, target, _("No such file"));
+			continue;
+		}
+
+		i = g_new0(trg_upload_item, 1);
+		i->upload = upload;
+		i->target = target;
+		i->local = target && !is_url(target) && !is_magnet(target);
+
+		if (i->local) {
+			GStatBuf st;
+			if (!g_stat(target, &st))
+				i->size = st.st_size;
+		} else if (!target) {
+			i->size = upload->upload_response->size;
+		}
+
+		*item = i;
+	}
+
+	return req;
+}
+
+static void upload_fill(trg_upload *upload) {
+	TrgPrefs *prefs = trg_client_get_prefs(upload->client);
+	guint limit = (guint) MAX(1, trg_prefs_get_int(prefs,
+			TRG_PREFS_KEY_UPLOAD_CONCURRENCY, TRG_PREFS_GLOBAL));
+	trg_upload_item *item;
+	JsonNode *req;
+
+	while (upload->in_flight < limit
+			&& (req = upload_next_request(upload, &item))) {
 		JsonObject *args = node_get_arguments(req);
+		GError *error = NULL;
 
 		if (upload->extra_args)
 			add_set_common_args(args, upload->priority, upload->dir);
@@ -75,33 +207,64 @@ static void next_upload(trg_upload *upload) {
 		if (upload->file_priorities)
 			add_priorities(args, upload->file_priorities, upload->n_files);
 
-		upload->progress_index++;
-		dispatch_async(upload->client, req, upload_complete_callback, upload);
-	} else {
-		trg_upload_free(upload);
+		if (dispatch_async_upload(upload->client, req,
+				item->local ? item->target : NULL, upload_complete_callback,
+				item, &error)) {
+			upload->in_flight++;
+		} else {
+			upload->done++;
+			upload_add_failure(upload, item->target, error->message);
+			g_error_free(error);
+			g_free(item);
+		}
 	}
+
+	upload_show_progress(upload);
+
+	if (!upload->in_flight)
+		upload_finish(upload);
 }
 
 static gboolean upload_complete_callback(gpointer data) {
 	trg_response *response = (trg_response*)data;
-	trg_upload *upload = (trg_upload*)response->cb_data;
+	trg_upload_item *item = (trg_upload_item*)response->cb_data;
+	trg_upload *upload = item->upload;
+
+	upload->in_flight--;
+	upload->done++;
+
+	if (response->status == CURLE_OK) {
+		upload->bytes += item->size;
+
+		/* Only now, as it was read while being sent, and not if it
+		 * failed, so it can be tried again. */
+		if (item->local && (upload->flags & TORRENT_ADD_FLAG_DELETE))
+			g_unlink(item->target);
+	} else {
+		gchar *msg = make_error_message(response->obj, response->status);
+		upload_add_failure(upload, item->target, msg);
+		g_free(msg);
+	}
 
+	/* The callback sees the upload as cb_data, and doesn't free the
+	 * response. */
+	response->cb_data = upload;
 	if (upload->callback)
 		upload->callback(data);
 
-	/* the callback we're delegating to will destroy the response */
+	trg_response_free(response);
+	g_free(item);
 
-	if (upload->main_window)
-		on_generic_interactive_action(upload->main_window, response);
-	else
-		trg_response_free(response);
-
-	next_upload(upload);
+	upload_fill(upload);
 
 	return FALSE;
 }
 
 void trg_do_upload(trg_upload *upload)
 {
-	next_upload(upload);
+	upload->next = upload->list;
+	upload->total = upload->upload_response ? 1 : g_slist_length(upload->list);
+	upload->started = g_get_monotonic_time();
+
+	upload_fill(upload);
 }
@@ -19,9 +19,18 @@ typedef struct {
     gint* file_wanted;
     guint n_files;
     gboolean extra_args;
-    guint progress_index;
     GSourceFunc callback;
     gchar *uid;
+    /* the progress of the batch, see upload.c */
+    GSList *next; // the next file to send
+    guint total;
+    guint sent;
+    guint in_flight;
+    guint done;
+    guint failed;
+    guint64 bytes;
+    gint64 started;
+    GString *failures;
 } trg_upload;
 
 void trg_upload_free(trg_upload *upload);